@@ -34,7 +34,8 @@ public:
 	// Creates a tape variable that will store the operations of the forward pass.
 	CPtr<const CDnnBlob> Variable( const CDnnBlob& blob );
 
-	// Computes the gradient using the operations recorded in this tape.
+	// Computes the gradient of the sum of the 'expression' elements with respect to the 'var'
+	// by going backward along the operations recorded in this tape.
 	CPtr<const CDnnBlob> Gradient( const CDnnBlob& expression, const CDnnBlob& var );
 
 private:
@@ -69,6 +70,21 @@ private:
 
 //------------------------------------------------------------------------------------------------------------
 
+// The gradients accumulated by CGradientTape while going backward along the tape.
+class ITapeGradientAccumulator {
+public:
+	virtual ~ITapeGradientAccumulator() {}
+
+	// Checks if the gradient with respect to the 'blob' is needed.
+	virtual bool IsNeeded( const CDnnBlob* blob ) const = 0;
+
+	// Adds the gradient with respect to the 'blob'. The 'gradient' should have the same data size as the 'blob'.
+	// The accumulator takes the ownership of the 'gradient' blob and may change its contents.
+	virtual void Add( const CDnnBlob* blob, CDnnBlob* gradient ) = 0;
+};
+
+//------------------------------------------------------------------------------------------------------------
+
 // The interface for a tape operation.
 // If you wish to use autodifferentiation with CGradientTape for user-defined operations,
 // all these operations should implement this interface.
@@ -78,6 +94,14 @@ public:
 	// Jacobian has size GetObjectCount() x GetObjectSize().
 	// If GetObjectCount() == 1 then jacobian is a diagonal matrix of GetObjectSize() x GetObjectSize() size, stored like a vector.
 	virtual CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const = 0;
+
+	// Calculates the vector-Jacobian products: for each operation input that needs the gradient
+	// passes resultGradient x d(result)/d(input) to the 'accumulator'.
+	// The 'resultGradient' is the gradient with respect to the operation result, of the same size as the result.
+	// Unlike Jacobian, the memory used is linear in the blob sizes.
+	// Returns false if the operation doesn't support it; in this case CGradientTape falls back to Jacobian.
+	virtual bool VectorJacobianProduct( const CDnnBlob& /*resultGradient*/, ITapeGradientAccumulator& /*accumulator*/ ) const
+		{ return false; }
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -84,6 +84,8 @@ inline CLayerClassRegistrar<T>::~CLayerClassRegistrar()
 class CDnn;
 class CDnnLayerGraph;
 class CBaseLayer;
+class CDnnLayerScheduler;
+class CDnnMemoryPlanner;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -383,6 +385,7 @@ private:
 	friend class CDnn;
 	friend class CDnnLayerGraph;
 	friend class CDnnSolver;
+	friend class CDnnMemoryPlanner;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -539,6 +542,36 @@ public:
 	// Enables profiling for all the layers in the network
 	void EnableProfile( bool profile );
 
+	// Creates a copy of the network for inference that shares the trainable parameters with this network
+	// The copy has its own layer outputs and runtime data, so the copies may be run from different threads
+	// while the memory for the parameters is allocated only once
+	// The copy uses the same math engine; learning is disabled for it and may not be enabled
+	// The parameters of this network must be initialized (the network is trained or loaded)
+	// and must not be changed while the copies exist: do not train this network or change its layers
+	// The copy should be destroyed with standard delete
+	CDnn* CreateInferenceClone( CRandom& cloneRandom );
+	// Indicates if the network shares its trainable parameters with another network (see CreateInferenceClone)
+	bool HasSharedParams() const { return hasSharedParams; }
+
+	// Sets the number of threads used by RunOnce to run the independent branches of the network in parallel
+	// The layers are ordered by their dependencies once per rebuild and dispatched to a thread pool
+	// The default value 1 means that the layers are run one after another
+	// Only the CPU math engine is supported; for other engines the layers are always run sequentially
+	// Each layer still uses the math engine threads, so you may want to create the engine with fewer threads
+	void SetParallelThreadCount( int threadCount );
+	int GetParallelThreadCount() const;
+
+	// Enables the static memory planning for RunOnce
+	// After the network is reshaped the lifetimes of the layer outputs are calculated from the execution order
+	// and the outputs are placed into one memory block, so that RunOnce does not allocate memory for them
+	// The plan is rebuilt when the blob sizes or the network change
+	// The planning is not used for the parallel run (see SetParallelThreadCount)
+	void EnableMemoryPlanning( bool enable );
+	bool IsMemoryPlanningEnabled() const { return memoryPlanner != nullptr; }
+	// Gets the size of the memory block allocated for the layer outputs by the current plan, in bytes
+	// Returns 0 if there is no plan; compare with IMathEngine::GetPeakMemoryUsage for the pool-based allocation
+	size_t GetPlannedMemorySize() const;
+
 private:
 	// Adds or deletes a layer
 	void AddLayerImpl(CBaseLayer& layer) override;
@@ -581,12 +614,26 @@ private:
 	// The low memory use mode
 	bool isReuseMemoryMode;
 
+	// The scheduler that runs the independent layers in parallel (null if parallel run is off)
+	CDnnLayerScheduler* scheduler;
+	// Indicates that the layers are currently run by the scheduler
+	bool isParallelRun;
+	// Guards the layer outputs shared by several consumers during the parallel run
+	CCriticalSection outputsSection;
+	// The static memory planner for the layer outputs (null if the planning is off)
+	CDnnMemoryPlanner* memoryPlanner;
+	// Indicates that the trainable parameters are shared with another network
+	bool hasSharedParams;
+
 	void setProcessingParams(bool isRecurrentMode, int sequenceLength, bool isReverseSequense, bool isBackwardPerformed);
 	void runOnce(int curSequencePos);
+	void runOnceParallel();
+	void setSchedulerGraph();
 	void backwardRunAndLearnOnce(int curSequencePos);
 	void reshape();
 	void rebuild();
 	size_t getOutputBlobsSize() const;
+	static void shareParamBlobs( CBaseLayer& from, CBaseLayer& to );
 
 	friend class CBaseLayer;
 	friend class CCompositeLayer;
@@ -0,0 +1,70 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoML.h>
+
+namespace NeoML {
+
+class CDnnBatchingQueue;
+
+// Runs the small requests to a network in batches
+// The requests from different threads are queued; the worker thread merges the queued requests
+// along the BatchWidth dimension, runs the network once and splits the sink outputs back
+// A batch is started when it has maxBatchSize objects or when the oldest request has waited for maxWait
+class NEOML_API CDnnBatchingRunner {
+public:
+	// The network is used only by the worker thread until the runner is destroyed
+	// sources and sinks are the names of the CSourceLayer and CSinkLayer layers of the network
+	// The network must keep the BatchWidth of its inputs: the objects of a batch must not affect each other
+	CDnnBatchingRunner( CDnn& dnn, const CArray<CString>& sources, const CArray<CString>& sinks,
+		int maxBatchSize, int maxWaitMicroseconds );
+	// All the Run calls must be finished before the runner is destroyed
+	~CDnnBatchingRunner();
+
+	int GetMaxBatchSize() const { return maxBatchSize; }
+	int GetMaxWait() const { return maxWait; }
+
+	// Runs the request and waits for its result; may be called from several threads at once
+	// inputs[i] is the blob for sources[i]; all the inputs must have the same BatchWidth,
+	// the other dimensions must be the same for all the requests
+	// outputs[i] is set to the result of sinks[i] for this request
+	// Rethrows the exception thrown by the network
+	void Run( const CObjectArray<CDnnBlob>& inputs, CObjectArray<CDnnBlob>& outputs );
+
+	// The latency histogram: the latency is the time from the Run call to the moment the result is ready
+	// The i-th element is the number of requests with latency in [2^i, 2^(i+1)) microseconds
+	void GetLatencyHistogram( CArray<int>& histogram ) const;
+	// Gets the latency percentile in microseconds estimated by the histogram (the upper bound of the bucket)
+	// percentile is from 0 to 100
+	int GetLatencyPercentile( double percentile ) const;
+	// The number of processed requests and batches
+	int GetRequestCount() const;
+	int GetBatchCount() const;
+	// Resets the latency statistics
+	void ResetStatistics();
+
+private:
+	const int maxBatchSize;
+	const int maxWait;
+	// The queue of the requests and the worker thread
+	CDnnBatchingQueue* queue;
+
+	CDnnBatchingRunner( const CDnnBatchingRunner& );
+	CDnnBatchingRunner& operator=( const CDnnBatchingRunner& );
+};
+
+} // namespace NeoML
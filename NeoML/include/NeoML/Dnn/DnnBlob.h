@@ -180,6 +180,8 @@ public:
 	static void SplitByBatchLength( IMathEngine& mathEngine, const CPtr<CDnnBlob>& from, const CObjectArray<CDnnBlob>& to );
 	static void SplitByObject( IMathEngine& mathEngine, const CPtr<CDnnBlob>& from, const CObjectArray<CDnnBlob>& to );
 
+	// When loading from CMappedFile on the CPU math engine, the blobs stored in the mappable layout
+	// use the mapped file data directly instead of copying it (see CDnnBlobMappableLayout)
 	virtual void Serialize( CArchive& );
 
 	// Gets the pointer to the MathEngine on which the blob was created
@@ -219,6 +221,7 @@ private:
 	CBlobDesc desc;
 	CMemoryHandle data;
 	bool dataOwned;
+	CPtr<IObject> dataHolder; // the object that keeps the external data alive (the file mapping)
 
 	CPtr<CDnnBlob> parent;	// parent blob
 	int parentPos;
@@ -228,10 +231,29 @@ private:
 	void initializeTensor(TBlobType _type, std::initializer_list<int> dimensions);
 	void initializeWindow(const CPtr<CDnnBlob>& _parent, int windowSize);
 	void initializeByPattern(TBlobType type, const CBlobDesc& pattern);
+	bool bindMappedData( CArchive& archive, const CBlobDesc& mappedDesc );
 
 	friend class CDnnBlobClassRegistrar;
 };
 
+// While an object of this class exists, the blobs stored on the current thread use the mappable layout:
+// the data of each blob is aligned in the archive, so that it can be used directly from CMappedFile on loading
+// The archives with this layout can't be loaded by the earlier versions of the library
+class NEOML_API CDnnBlobMappableLayout {
+public:
+	CDnnBlobMappableLayout();
+	~CDnnBlobMappableLayout();
+
+	// Checks if the blobs stored on the current thread use the mappable layout
+	static bool IsEnabled();
+
+private:
+	const bool wasEnabled; // the state before the object was created
+
+	CDnnBlobMappableLayout( const CDnnBlobMappableLayout& ) = delete;
+	CDnnBlobMappableLayout& operator=( const CDnnBlobMappableLayout& ) = delete;
+};
+
 inline void SerializeBlob( IMathEngine& mathEngine, CArchive& archive, CPtr<CDnnBlob>& blob )
 {
 	if( archive.IsStoring() ) {
@@ -22,15 +22,28 @@ public:
 	virtual void SetInputBatch( CDnn& dnn, int thread ) = 0;
 };
 
+class CDistributedWorkers;
+
 // Single process, multiple threads distributed training
 class NEOML_API CDistributedTraining {
 public:
-	// Creates `count` cpu models
-	explicit CDistributedTraining( CArchive& archive, int count );
+	// Creates `count` cpu models, each of them uses `threadCount` threads
+	// If `pinThreads` is true the threads of each model are bound to their own set of cores (Linux only)
+	explicit CDistributedTraining( CArchive& archive, int count, int threadCount = 1, bool pinThreads = false );
 	// Creates gpu models, `devs` should contain numbers of using devices
 	explicit CDistributedTraining( CArchive& archive, const CArray<int>& cudaDevs );
+	// Sets the solver for all models; the archive should contain the solver stored by SerializeSolver
+	void SetSolver( CArchive& archive );
+	// Sets the synchronization mode for all models (see CDnnSolver::SetAveragingGradients)
+	void SetAveragingGradients( bool isAveraging );
 	// Runs the networks, performs a backward pass and updates the trainable weights of all models
 	void RunAndLearnOnce( IDistributedDataset& data );
+	// Starts RunAndLearnOnce on the worker threads and returns immediately
+	// The next batch may be prepared while the models are trained; `data` must stay valid until Wait
+	void StartRunAndLearnOnce( IDistributedDataset& data );
+	// Waits until the step started by StartRunAndLearnOnce is finished
+	// Rethrows the exception thrown by any of the models
+	void Wait();
 	// Returns last loss of `layerName` for all models
 	// `layerName` should correspond to CLossLayer or CCtcLossLayer
 	void GetLastLoss( const CString& layerName, CArray<float>& losses );
@@ -39,8 +52,10 @@ private:
 	CArray<IMathEngine*> mathEngines;
 	CArray<CRandom*> rands;
 	CArray<CDnn*> cnns;
+	// The persistent threads that run the models, one per model
+	CDistributedWorkers* workers;
 
-	void initialize( CArchive& archive, int count );
+	void initialize( CArchive& archive, int count, int threadCount, bool pinThreads );
 };
 
 
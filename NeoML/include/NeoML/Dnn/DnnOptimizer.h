@@ -0,0 +1,54 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+// CDnnOptimizer simplifies a trained network for the inference by merging the layers
+// The merged layers are deleted and their consumers are connected to the layer they were merged into,
+// so the network may be serialized as usual, but it can't be trained anymore
+// Only the layers of the network itself are processed (the layers inside the composite layers are not)
+//
+// A layer is merged only if it is the only consumer of the preceding layer's output
+class NEOML_API CDnnOptimizer {
+public:
+	explicit CDnnOptimizer( CDnn& dnn );
+
+	// Folds the CBatchNormalizationLayer layers into the weights and free terms
+	// of the preceding CConvLayer or CFullyConnectedLayer layers
+	// Returns the number of the removed layers
+	int FoldBatchNormalization();
+
+	// Fuses the CReLULayer, CSigmoidLayer and CHSwishLayer layers into the preceding CConvLayer layers
+	// (see CConvLayer::SetActivation)
+	// Returns the number of the removed layers
+	int FuseActivations();
+
+	// Performs all the optimizations above
+	// Returns the number of the removed layers
+	int Optimize();
+
+private:
+	CDnn& dnn;
+
+	CBaseLayer* getSingleInput( const CBaseLayer& layer, const CArray<CString>& layerNames ) const;
+	void removeLayer( CBaseLayer& layer, const CArray<CString>& layerNames );
+};
+
+} // namespace NeoML
@@ -0,0 +1,49 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+// CDnnQuantizer converts a trained network for the 8-bit inference on CPU
+// The CFullyConnectedLayer and CConvLayer layers are replaced by CQuantizedFullyConnectedLayer and CQuantizedConvLayer
+// with the same names, so the network may be serialized as usual
+// Only the layers of the network itself are processed (the layers inside the composite layers are not)
+//
+// Usage: for each batch of the representative dataset set the input blobs and call Calibrate, then call Quantize
+class NEOML_API CDnnQuantizer {
+public:
+	explicit CDnnQuantizer( CDnn& dnn );
+
+	// Runs the network on the current input and updates the ranges of the inputs of the layers
+	void Calibrate();
+
+	// Replaces the layers by the quantized ones
+	// The layers whose inputs were all zero during the calibration are left as they are
+	// Returns the number of the replaced layers
+	int Quantize();
+
+private:
+	CDnn& dnn;
+	// The maximum absolute values of the layers' inputs found during the calibration
+	CMap<CString, float> inputRanges;
+
+	static bool isQuantizable( const CBaseLayer& layer );
+};
+
+} // namespace NeoML
@@ -31,6 +31,12 @@ public:
 	// forSharedWeightsLayer=true should only be used within layers that share weights with other layers.
 	void AddDiff( CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramDiffBlobs, 
 		bool sharedWeights = false );
+	// Stores the rows of the layer parameter blob that may have non-zero gradients in the AddDiff calls before Train
+	// The blob is treated as a matrix with rows of rowSize elements; the rows may repeat and go in any order
+	// If the rows are added for a layer, they should be added for all its parameter blobs on every step,
+	// otherwise the blobs without the rows are updated completely
+	// Used by the lookup layers when sparse update is enabled
+	void AddDiffRows( CBaseLayer* layer, int paramIndex, int rowSize, const int* rows, int rowCount );
 
 	// Modifies the trainable parameters of the network layers, 
 	// using the accumulated gradients and previous steps' history (moment, etc.) 
@@ -50,6 +56,19 @@ public:
 	// Upper limit for gradient norm (if set to < 0, that means no limit)
 	float GetMaxGradientNorm() const { return maxGradientNorm; }
 	void SetMaxGradientNorm(float _maxGradientNorm) { maxGradientNorm = _maxGradientNorm; }
+	// Synchronization mode for the distributed training
+	// If true, the gradients are averaged over all threads before the update,
+	// so the weights and the solver history stay the same in all threads
+	// Otherwise (the default) the weights are averaged after each thread has updated them
+	bool IsAveragingGradients() const { return isAveragingGradients; }
+	void SetAveragingGradients( bool isAveraging ) { isAveragingGradients = isAveraging; }
+	// Sparse (lazy) update of the lookup tables
+	// If enabled, only the rows of the embeddings used on the step are updated together with their history,
+	// the moments of the other rows don't decay. Supported by Adam and Nadam on CPU (Nadam without regularization),
+	// the other solvers and the distributed training update the whole tables
+	// Off by default
+	bool IsSparseUpdateEnabled() const { return isSparseUpdateEnabled; }
+	void EnableSparseUpdate( bool enable ) { isSparseUpdateEnabled = enable; }
 
 	// Serialize to archive
 	virtual void Serialize( CArchive& archive, CDnn& dnn );
@@ -72,6 +91,14 @@ protected:
 	// learningHistory may change during training
 	virtual void TrainLayer( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
 		const CObjectArray<CDnnBlob>& paramDiffBlobs, CObjectArray<CDnnBlob>& learningHistory ) = 0;
+	// Modifies only the given rows of the trainable parameters of a given layer (see EnableSparseUpdate)
+	// rowSizes[i] is the size of the paramBlobs[i] row, 0 means that the whole blob should be modified
+	// rows[i] contains the sorted indices of the paramBlobs[i] rows
+	// By default the whole parameter blobs are modified
+	virtual void TrainLayerRows( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
+		const CObjectArray<CDnnBlob>& paramDiffBlobs, const CArray<int>& /*rowSizes*/, const CArray<CArray<int>>& /*rows*/,
+		CObjectArray<CDnnBlob>& learningHistory )
+		{ TrainLayer( layer, paramBlobs, paramDiffBlobs, learningHistory ); }
 
 private:
 	IMathEngine& mathEngine;
@@ -79,6 +106,8 @@ private:
 	float regularizationL2;
 	float regularizationL1;
 	float maxGradientNorm;
+	bool isAveragingGradients;
+	bool isSparseUpdateEnabled;
 
 	// The blobs sum
 	struct CDiffBlobSum {
@@ -86,16 +115,31 @@ private:
 
 		CObjectArray<CDnnBlob> Sum; // the blobs sums
 		int Count; // the number of terms in each sum
+		// The row sizes of the blobs with the rows added by AddDiffRows (0 for the other blobs)
+		// Empty if no rows were added
+		CArray<int> RowSizes;
+		// The sorted rows of the blobs that may have non-zero gradients
+		CArray<CArray<int>> Rows;
 	};
 
 	// The buffers used to add up the gradients from several AddDiff calls
 	CMap<CBaseLayer*, CDiffBlobSum> layerToParamDiffBlobsSum;
+	// The layers of layerToParamDiffBlobsSum in the order they were added
+	// The order is the same in all threads of the distributed training
+	CArray<CBaseLayer*> diffLayers;
 	// The buffers for storing gradients history and moment
 	// Used in the inheriting classes
 	CMap<CBaseLayer*, CObjectArray<CDnnBlob>> layerToGradientHistory;
 
+	// The buffer used to average the small parameter blobs together
+	CPtr<CDnnBlob> allReduceBucket;
+
 	// Averages weights over all threads
 	void allReduce();
+	// Averages gradients over all threads
+	void allReduceGradients();
+	void allReduceBlobs( const CArray<CDnnBlob*>& blobs );
+	void allReduceBucketed( const CArray<CDnnBlob*>& blobs, int size );
 
 	// Clips gradients according to the settings
 	void clipGradients(const CObjectArray<CDnnBlob>& paramDiffBlobs);
@@ -229,6 +273,10 @@ protected:
 	// Updates the trainable weights of the layer
 	virtual void TrainLayer( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
 		const CObjectArray<CDnnBlob>& paramDiffBlobs, CObjectArray<CDnnBlob>& gradientHistory ) override;
+	// Updates the given rows of the trainable weights of the layer
+	void TrainLayerRows( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
+		const CObjectArray<CDnnBlob>& paramDiffBlobs, const CArray<int>& rowSizes, const CArray<CArray<int>>& rows,
+		CObjectArray<CDnnBlob>& gradientHistory ) override;
 
 private:
 	// The gradientHistory array stores the previous values of gradients of different types
@@ -286,6 +334,8 @@ private:
 
 	// Add regularization
 	CDnnBlob* addRegularization( CDnnBlob* diffBlob, CDnnBlob* params, float regL1, float regL2 );
+	// The settings of the fused step for the layer
+	CAdaptiveGradientStep getStep( const CBaseLayer* layer ) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -325,6 +375,10 @@ protected:
 	// Updates the trainable weights of the layer
 	virtual void TrainLayer( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
 		const CObjectArray<CDnnBlob>& paramDiffBlobs, CObjectArray<CDnnBlob>& gradientHistory ) override;
+	// Updates the given rows of the trainable weights of the layer
+	void TrainLayerRows( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
+		const CObjectArray<CDnnBlob>& paramDiffBlobs, const CArray<int>& rowSizes, const CArray<CArray<int>>& rows,
+		CObjectArray<CDnnBlob>& gradientHistory ) override;
 
 private:
 	// The gradientHistory array stores the previous values of gradients of different types
@@ -383,6 +437,11 @@ private:
 	// m with a stroke (from the paper referred to)
 	// It is a weighted sum of the gradient and the first moment
 	CPtr<CDnnBlob> mBarBlob;
+
+	// The settings of the fused step for the layer
+	CAdaptiveGradientStep getStep( const CBaseLayer* layer ) const;
+	// Checks if the fused step may be used
+	bool isFusedStep( const CAdaptiveGradientStep& step ) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -532,6 +591,10 @@ private:
 	void getWeightDecayIndices( const CBaseLayer& layer, int paramsCount, CHashTable<int>& indexes ) const;
 
 	void calcNormalizeMultiplier( const CDnnBlob& weights, const CDnnBlob& update, const CFloatHandle& multiplier ) const;
+
+	void fusedTrainParams( const CAdaptiveGradientStep& step, const CArray<int>& indices,
+		const CObjectArray<CDnnBlob>& paramBlobs, const CObjectArray<CDnnBlob>& paramDiffBlobs,
+		const CObjectArray<CDnnBlob>& gradientHistory, CArray<float>& gradientNormSquares );
 };
 
 template<typename TLayer>
@@ -0,0 +1,88 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoML.h>
+
+namespace NeoML {
+
+// Runs a recurrent network on many independent streams, one chunk of the sequence at a time
+// The state of the recurrent layers is kept for each stream between the steps,
+// so the result is the same as if the whole sequence of the stream was processed at once
+// The state is kept for the CRecurrentLayer layers of the network (CLstmLayer, CGruLayer, CIrnnLayer, etc.)
+// that are added to the network directly; such layers must not have the initial state inputs
+// and must process the sequence in the direct order
+// The runner is not thread-safe
+class NEOML_API CDnnStreamingRunner {
+public:
+	// The network is used only by the runner until the runner is destroyed
+	// sources and sinks are the names of the CSourceLayer and CSinkLayer layers of the network
+	CDnnStreamingRunner( CDnn& dnn, const CArray<CString>& sources, const CArray<CString>& sinks );
+	~CDnnStreamingRunner();
+
+	// Opens a new stream with the empty state; returns the stream id
+	// The ids of the closed streams are reused
+	int OpenStream();
+	// Closes the stream
+	void CloseStream( int stream );
+	// The number of open streams
+	int GetStreamCount() const { return streamCount; }
+
+	// Processes the next chunk of each stream in the streams array
+	// inputs[i] is the blob for sources[i]; BatchLength is the chunk length and
+	// the j-th object along BatchWidth belongs to streams[j]; the streams must be different
+	// outputs[i] is set to the result of sinks[i] which is valid until the next step
+	// The time of the step depends only on the number of the streams in it, not on the number of open streams
+	void Step( const CArray<int>& streams, const CObjectArray<CDnnBlob>& inputs, CObjectArray<CDnnBlob>& outputs );
+
+private:
+	CDnn& dnn;
+	const bool oldAutoRestartMode;
+	CObjectArray<CSourceLayer> sources;
+	CObjectArray<CSinkLayer> sinks;
+	CObjectArray<CRecurrentLayer> recurrentLayers;
+
+	// The states of all the streams, one table per back link of each recurrent layer
+	// The row with the stream id index contains the state of the stream
+	// The tables are created on the first step when the state sizes are known
+	CObjectArray<CDnnBlob> stateTables;
+	// The descriptions of the states of one stream
+	CArray<CBlobDesc> stateDescs;
+	// The number of rows in each table
+	int capacity;
+
+	// Indicates if the stream id is used by an open stream
+	CArray<bool> isStreamOpen;
+	// The ids of the closed streams
+	CArray<int> freeStreams;
+	int streamCount;
+	// The number of the last step that has processed the stream (to check the streams of a step are different)
+	CArray<int> lastStreamStep;
+	int stepCount;
+
+	// The states passed to the recurrent layers on the step, stateTables.Size() blobs
+	CObjectArray<CDnnBlob> stepStates;
+
+	void createStateTables( int streamsInStep );
+	void growStateTables( int newCapacity );
+	void clearStreamState( int stream );
+	void copyStates( const CArray<int>& streams, bool toTables );
+
+	CDnnStreamingRunner( const CDnnStreamingRunner& );
+	CDnnStreamingRunner& operator=( const CDnnStreamingRunner& );
+};
+
+} // namespace NeoML
@@ -119,6 +119,15 @@ public:
 
 	void Serialize( CArchive& archive ) override;
 
+	// The activation applied to the result by the convolution itself (AF_Linear by default)
+	// (see IMathEngine::BlobConvolutionWithActivation for where it is applied in the same pass)
+	// Only AF_Linear, AF_ReLU, AF_Sigmoid and AF_HSwish are supported
+	// activationParam is the upper threshold for AF_ReLU (0 means no threshold)
+	// The layer with an activation can't be trained; it is set by CDnnOptimizer for the inference
+	TActivationFunction GetActivation() const { return activation; }
+	float GetActivationParam() const { return activationParam; }
+	void SetActivation( TActivationFunction activation, float activationParam = 0 );
+
 protected:
 	virtual ~CConvLayer();
 
@@ -129,6 +138,8 @@ protected:
 
 private:
 	CConvolutionDesc* convDesc; // the convolution descriptor
+	TActivationFunction activation; // the fused activation
+	float activationParam; // the fused activation parameter
 
 	void calcOutputBlobSize(int& outputHeight, int& outputWidth) const;
 	void initConvDesc();
@@ -47,6 +47,10 @@ public:
 	void SetGateWeightsData(CDnnBlob* newWeights) { gateLayer->SetWeightsData(newWeights); }
 	void SetGateFreeTermData(CDnnBlob* newFreeTerm) { gateLayer->SetFreeTermData(newFreeTerm); }
 
+protected:
+	void RunOnce() override;
+	void RunInternalDnnBackward() override;
+
 private:
 	// The indices of the gates in the hidden layer output
 	enum TGateOut {
@@ -61,7 +65,26 @@ private:
 	CPtr<CSplitChannelsLayer> splitLayer;
 	CPtr<CBackLinkLayer> mainBackLink;
 
+	// Indicates that the last run processed the whole sequence at once instead of running the internal network
+	bool isWholeSequenceProcessed;
+	// The weights split into the input and the recurrent parts
+	CPtr<CDnnBlob> gateInputWeights;
+	CPtr<CDnnBlob> gateRecurWeights;
+	CPtr<CDnnBlob> mainInputWeights;
+	CPtr<CDnnBlob> mainRecurWeights;
+	// The activated gates, the activated main output and the reset previous state for all the steps of the sequence
+	CPtr<CDnnBlob> sequenceGates;
+	CPtr<CDnnBlob> sequenceMain;
+	CPtr<CDnnBlob> sequenceResetMain;
+	// The state before the first step (null for the reverse sequence)
+	CPtr<CDnnBlob> initialMain;
+
 	void buildLayer();
+	void runWholeSequence();
+	void backwardWholeSequence();
+	void splitWeights( CDnnBlob& weights, CPtr<CDnnBlob>& inputWeights, CPtr<CDnnBlob>& recurWeights ) const;
+	void learnWholeSequence( CFullyConnectedLayer& layer, const CDnnBlob& outputDiff, const CDnnBlob& recurInput,
+		bool isShiftedRecurInput );
 };
 
 NEOML_API CLayerWrapper<CGruLayer> Gru( int hiddenSize );
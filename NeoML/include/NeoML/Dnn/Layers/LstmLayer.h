@@ -66,6 +66,10 @@ public:
 	bool IsInCompatibilityMode() const { return isInCompatibilityMode; }
 	void SetCompatibilityMode( bool compatibilityMode );
 
+protected:
+	void RunOnce() override;
+	void RunInternalDnnBackward() override;
+
 private:
 	// The gate numbers for the hidden layer output
 	enum TGateOut {
@@ -92,8 +96,21 @@ private:
 	TActivationFunction recurrentActivation;
 	bool isInCompatibilityMode;
 
+	// Indicates that the last run processed the whole sequence at once instead of running the internal network
+	bool isWholeSequenceProcessed;
+	// The activated gates for all the steps of the sequence
+	CPtr<CDnnBlob> sequenceGates;
+	// The cell state for all the steps if the second output is not connected
+	CPtr<CDnnBlob> sequenceState;
+	// The state before the first step (null for the reverse sequence)
+	CPtr<CDnnBlob> initialMain;
+	CPtr<CDnnBlob> initialState;
+
 	void buildLayer(float dropout);
 	void setWeightsData(const CPtr<CDnnBlob>& newWeights);
+	bool canProcessWholeSequence() const;
+	void runWholeSequence();
+	void backwardWholeSequence();
 };
 
 NEOML_API CLayerWrapper<CLstmLayer> Lstm(
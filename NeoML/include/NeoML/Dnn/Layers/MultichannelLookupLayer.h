@@ -90,6 +90,8 @@ private:
 	CObjectArray<CDnnBlob> ownParams; // "internal" training parameters
 	CObjectArray<CDnnBlob>& getParams() { return useFrameworkLearning ? paramBlobs : ownParams; }
 	const CObjectArray<CDnnBlob>& getParams() const { return useFrameworkLearning ? paramBlobs : ownParams; }
+
+	void addDiffRows();
 };
 
 NEOML_API CLayerWrapper<CMultichannelLookupLayer> MultichannelLookup(
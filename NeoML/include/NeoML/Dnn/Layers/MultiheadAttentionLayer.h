@@ -43,6 +43,9 @@ namespace NeoML {
 //  W_* - trainable parameters and W_O is an additional trainable matrix of size (GetHiddenSize() x GetOutputSize())
 //
 // Result has size (1, BatchWidth, ListSize_Q, 1, 1, 1, GetOutputSize())
+//
+// On CPU the inference without the softmax output (#1) is calculated by IMathEngine::ScaledDotProductAttention
+// which never stores the whole ListSize_Q x ListSize_V attention matrix
 class NEOML_API CMultiheadAttentionLayer : public CCompositeLayer {
 	NEOML_DNN_LAYER( CMultiheadAttentionLayer )
 public:
@@ -77,6 +80,7 @@ public:
 
 protected:
 	void Reshape() override;
+	void RunOnce() override;
 
 private:
 	// The amount of heads
@@ -115,6 +119,10 @@ private:
 	CBaseLayer* prepareK( CBaseLayer* input );
 	CBaseLayer* prepareV( CBaseLayer* input );
 	CBaseLayer* prepareOutput( CBaseLayer* input );
+
+	bool canRunFusedAttention() const;
+	void runFusedAttention();
+	void applyFullyConnected( const char* name, const CDnnBlob& input, CDnnBlob& output );
 };
 
 NEOML_API CLayerWrapper<CMultiheadAttentionLayer> MultiheadAttention(
@@ -0,0 +1,117 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+#include <NeoML/TraditionalML/Problem.h>
+
+namespace NeoML {
+
+// The reader of the objects passed into the network by CPrefetchSourceLayer
+// ReadObject is called from the background threads, several threads may call it at once
+class NEOML_API IDnnDataReader : virtual public IObject {
+public:
+	// The number of objects in the data set
+	virtual int GetObjectCount() const = 0;
+	// The descriptions of one object for each output of the layer
+	// Only the data type (CT_Float or CT_Int) and the Height, Width, Depth and Channels dimensions are used
+	virtual void GetObjectDescs( CArray<CBlobDesc>& descs ) const = 0;
+	// Writes the object with the given index into the buffers, one buffer per output
+	// data[i] points to the memory for the ObjectSize elements of the i-th output data type
+	virtual void ReadObject( int index, void* const* data ) = 0;
+};
+
+// The reader of the IProblem vectors
+// Has the same outputs as CProblemSourceLayer: the data, the labels and the vector weights
+class NEOML_API CProblemDataReader : public IDnnDataReader {
+public:
+	CProblemDataReader( const IProblem* problem, TBlobType labelType = CT_Float, float emptyFill = 0 );
+
+	// IDnnDataReader interface methods
+	int GetObjectCount() const override { return problem->GetVectorCount(); }
+	void GetObjectDescs( CArray<CBlobDesc>& descs ) const override;
+	void ReadObject( int index, void* const* data ) override;
+
+private:
+	const CPtr<const IProblem> problem;
+	const TBlobType labelType;
+	const float emptyFill;
+	const int labelSize;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CDnnPrefetchQueue;
+
+// CPrefetchSourceLayer passes the objects of IDnnDataReader into the network, BatchSize objects per run
+// The batches are read by the background threads while the network is processing the previous ones,
+// at most GetQueueSize() batches are prepared in advance
+// All the objects are passed once per epoch, in the random order if shuffling is on;
+// the batch at the end of an epoch is filled with the objects of the next epoch
+class NEOML_API CPrefetchSourceLayer : public CBaseLayer {
+	NEOML_DNN_LAYER( CPrefetchSourceLayer )
+public:
+	explicit CPrefetchSourceLayer( IMathEngine& mathEngine );
+
+	void Serialize( CArchive& archive ) override;
+
+	// Changing any of the settings stops the background threads
+	// and restarts the reading from the first epoch
+
+	// The reader of the data; the layer has one output per object description of the reader
+	CPtr<IDnnDataReader> GetReader() const { return reader; }
+	void SetReader( IDnnDataReader* reader );
+
+	// The number of objects passed into the network on one run
+	int GetBatchSize() const { return batchSize; }
+	void SetBatchSize( int batchSize );
+
+	// The maximum number of batches read in advance; 2 by default
+	int GetQueueSize() const { return queueSize; }
+	void SetQueueSize( int queueSize );
+
+	// The number of background threads reading the batches; 1 by default
+	// Each thread reads whole batches, the batches are passed into the network in the original order
+	int GetThreadCount() const { return threadCount; }
+	void SetThreadCount( int threadCount );
+
+	// Shuffles the objects on each epoch using the random generator with the given seed; off by default
+	bool IsShuffled() const { return isShuffled; }
+	unsigned int GetShuffleSeed() const { return shuffleSeed; }
+	void SetShuffle( bool isShuffled, unsigned int seed = 0xDEADFACE );
+
+protected:
+	virtual ~CPrefetchSourceLayer();
+
+	void Reshape() override;
+	void RunOnce() override;
+	void BackwardOnce() override;
+
+private:
+	CPtr<IDnnDataReader> reader;
+	int batchSize;
+	int queueSize;
+	int threadCount;
+	bool isShuffled;
+	unsigned int shuffleSeed;
+	// The background threads and the batches read by them; created on the first run
+	CDnnPrefetchQueue* queue;
+
+	void stopReading();
+};
+
+} // namespace NeoML
@@ -0,0 +1,127 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+class CFullyConnectedLayer;
+class CConvLayer;
+
+// The layers below are used for inference only; they are created by CDnnQuantizer from the trained float layers
+// The weights are quantized to signed 8 bits with a separate scale for each output channel
+// The input is quantized on the fly with the scale found during calibration
+// Only the CPU math engine supports these layers
+
+// CQuantizedFullyConnectedLayer is the quantized version of CFullyConnectedLayer
+class NEOML_API CQuantizedFullyConnectedLayer : public CBaseLayer {
+	NEOML_DNN_LAYER( CQuantizedFullyConnectedLayer )
+public:
+	explicit CQuantizedFullyConnectedLayer( IMathEngine& mathEngine );
+
+	void Serialize( CArchive& archive ) override;
+
+	// The number of elements ("neurons") of the layer
+	int GetNumberOfElements() const { return numberOfElements; }
+	// The size of the input object
+	int GetInputSize() const { return inputSize; }
+
+	// Quantizes and sets the parameters of the fully-connected layer
+	void SetWeights( const CFullyConnectedLayer& source );
+
+	// The scale of the input: the value x is quantized to round( x / scale )
+	float GetInputScale() const { return inputScale; }
+	void SetInputScale( float scale );
+
+protected:
+	~CQuantizedFullyConnectedLayer() override {}
+
+	void Reshape() override;
+	void RunOnce() override;
+	void BackwardOnce() override;
+
+private:
+	int numberOfElements; // the number of elements
+	int inputSize; // the size of the input object
+	float inputScale; // the scale of the input
+
+	// The quantized weights, the weight scales and the free term (may be null)
+	const CPtr<CDnnBlob>& Weights() const { return paramBlobs[0]; }
+	const CPtr<CDnnBlob>& Scales() const { return paramBlobs[1]; }
+	const CPtr<CDnnBlob>& FreeTerms() const { return paramBlobs[2]; }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// CQuantizedConvLayer is the quantized version of CConvLayer
+class NEOML_API CQuantizedConvLayer : public CBaseLayer {
+	NEOML_DNN_LAYER( CQuantizedConvLayer )
+public:
+	explicit CQuantizedConvLayer( IMathEngine& mathEngine );
+
+	void Serialize( CArchive& archive ) override;
+
+	// The convolution parameters are the same as in CConvLayer
+	int GetFilterCount() const { return filterCount; }
+	int GetFilterHeight() const { return filterHeight; }
+	int GetFilterWidth() const { return filterWidth; }
+	int GetStrideHeight() const { return strideHeight; }
+	int GetStrideWidth() const { return strideWidth; }
+	int GetPaddingHeight() const { return paddingHeight; }
+	int GetPaddingWidth() const { return paddingWidth; }
+	int GetDilationHeight() const { return dilationHeight; }
+	int GetDilationWidth() const { return dilationWidth; }
+
+	// Copies the parameters of the convolution and quantizes its filter
+	void SetWeights( const CConvLayer& source );
+
+	// The scale of the input: the value x is quantized to round( x / scale )
+	float GetInputScale() const { return inputScale; }
+	void SetInputScale( float scale );
+
+protected:
+	~CQuantizedConvLayer() override;
+
+	void Reshape() override;
+	void RunOnce() override;
+	void BackwardOnce() override;
+
+private:
+	int filterCount;
+	int filterHeight;
+	int filterWidth;
+	int filterDepth;
+	int filterChannels;
+	int strideHeight;
+	int strideWidth;
+	int paddingHeight;
+	int paddingWidth;
+	int dilationHeight;
+	int dilationWidth;
+	float inputScale; // the scale of the input
+	CConvolutionDesc* convDesc; // the convolution descriptor
+
+	// The quantized filter, the filter scales and the free term (may be null)
+	const CPtr<CDnnBlob>& Filter() const { return paramBlobs[0]; }
+	const CPtr<CDnnBlob>& Scales() const { return paramBlobs[1]; }
+	const CPtr<CDnnBlob>& FreeTerms() const { return paramBlobs[2]; }
+
+	void destroyConvDesc();
+};
+
+} // namespace NeoML
@@ -55,6 +55,11 @@ protected:
 	void RunInternalDnnBackward() override;
 	void SetInternalDnnParams() override;
 
+	// Indicates if the layer may process the whole sequence by itself
+	// instead of running the internal network step by step
+	// (the derived layers with the fused CPU implementation use it)
+	bool CanProcessWholeSequence() const;
+
 private:
 	// The backward links
 	CObjectArray<CBackLinkLayer> backLinks;
@@ -0,0 +1,69 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+
+namespace NeoML {
+
+class CFileMapping;
+
+// Read-only file mapped into memory
+// The pages are mapped copy-on-write: the processes that map the same file share its pages in the page cache,
+// and a page is copied only when it is modified
+// The data may be used after the file is closed while the object returned by GetMapping is alive
+class NEOML_API CMappedFile : public CBaseFile {
+public:
+	CMappedFile();
+	// Creates an object and maps the file
+	// The same as calling a constructor without parameters and then the Open method
+	explicit CMappedFile( const char* fileName );
+	virtual ~CMappedFile();
+
+	// Checks if the file is open
+	bool IsOpen() const { return mapping != nullptr; }
+
+	// Maps the file
+	void Open( const char* fileName );
+
+	// The mapped file contents
+	const void* GetData() const;
+	// The object that keeps the mapping alive
+	IObject* GetMapping() const;
+
+	// CBaseFile class methods
+#ifdef FINEOBJ_VERSION
+	virtual CUnicodeString GetFileName() const { return fileName.CreateUnicodeString( CP_UTF8 ); }
+#else
+	virtual const char* GetFileName() const { return fileName; }
+#endif
+	virtual int Read( void*, int bytesCount );
+	virtual void Write( const void*, int bytesCount );
+	virtual __int64 GetPosition() const;
+	virtual __int64 Seek( __int64 offset, TSeekPosition from );
+	virtual void SetLength( __int64 newLength );
+	virtual __int64 GetLength() const;
+	virtual void Abort();
+	virtual void Flush();
+	virtual void Close();
+
+private:
+	CPtr<CFileMapping> mapping; // the file mapping
+	CString fileName; // the file name (needed for the CBaseFile::GetFileName() method)
+	__int64 position; // the current position in the file
+};
+
+} // namespace NeoML
@@ -77,6 +77,8 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/ReorgLayer.h>
 #include <NeoML/Dnn/Layers/GruLayer.h>
 #include <NeoML/Dnn/DnnSolver.h>
+#include <NeoML/Dnn/DnnQuantizer.h>
+#include <NeoML/Dnn/DnnOptimizer.h>
 #include <NeoML/Dnn/DnnInitializer.h>
 #include <NeoML/Dnn/Layers/MultichannelLookupLayer.h>
 #include <NeoML/Dnn/Layers/MaxOverTimePoolingLayer.h>
@@ -121,7 +123,10 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/CastLayer.h>
 #include <NeoML/Dnn/Layers/DataLayer.h>
 #include <NeoML/Dnn/Layers/TransformerLayer.h>
+#include <NeoML/Dnn/Layers/QuantizedLayers.h>
+#include <NeoML/Dnn/Layers/PrefetchSourceLayer.h>
 #include <NeoML/ArchiveFile.h>
+#include <NeoML/MappedFile.h>
 
 #ifndef NO_NEOML_NAMESPACE
 using namespace NeoML;
@@ -30,17 +30,53 @@ struct NEOML_API CCrossValidationResult {
 	CArray<int> ModelIndex; // the index of the model that classified the given vector
 };
 
+// The factory of training models for cross-validation with concurrent folds
+// Each fold is trained by its own training model, so the folds may be trained at the same time
+class NEOML_API ITrainingModelFactory {
+public:
+	virtual ~ITrainingModelFactory();
+
+	// Creates a training model that may use up to threadCount threads
+	// The caller takes ownership of the returned object
+	virtual ITrainingModel* CreateTrainingModel( int threadCount ) const = 0;
+};
+
+// The factory for the training models whose CParams have the ThreadCount field (CLinear, CSvm, CDecisionTree)
+template<class TTrainingModel>
+class CTrainingModelFactory : public ITrainingModelFactory {
+public:
+	explicit CTrainingModelFactory( const typename TTrainingModel::CParams& _params ) : params( _params ) {}
+
+	ITrainingModel* CreateTrainingModel( int threadCount ) const override
+	{
+		typename TTrainingModel::CParams modelParams = params;
+		modelParams.ThreadCount = threadCount;
+		return FINE_DEBUG_NEW TTrainingModel( modelParams );
+	}
+
+private:
+	const typename TTrainingModel::CParams params; // the training parameters
+};
+
 // The cross-validation algorithm
 class NEOML_API CCrossValidation {
 public:
 	CCrossValidation( ITrainingModel& trainingModel, const IProblem* problem );
+	// The folds are trained concurrently by the models created by the factory
+	// threadCount threads are split between the folds and the training models:
+	// min( threadCount, partsCount ) folds are run at the same time, each trainer gets the rest of the threads
+	CCrossValidation( const ITrainingModelFactory& trainingModelFactory, const IProblem* problem, int threadCount );
 
 	// Performs cross-validation
 	void Execute( int partsCount, TScore score, CCrossValidationResult& results, bool stratified );
 
 private:
-	ITrainingModel& trainingModel; // the base training model
+	ITrainingModel* const trainingModel; // the base training model
+	const ITrainingModelFactory* const trainingModelFactory; // the factory of training models for concurrent folds
 	const CPtr<const IProblem> problem; // the input data
+	const int threadCount; // the number of threads used by the concurrent folds
+
+	void executeParallel( int partsCount, TScore score, CCrossValidationResult& results, bool stratified );
 };
 
 } // namespace NeoML
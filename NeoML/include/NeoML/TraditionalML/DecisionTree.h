@@ -25,6 +25,8 @@ namespace NeoML {
 
 class CDecisionTreeNodeBase;
 class CDecisionTreeNodeStatisticBase;
+class CDecisionTreeHistogram;
+struct CDecisionTreeNodeSplit;
 
 // The node types for a decision tree
 enum TDecisionTreeNodeType {
@@ -113,6 +115,18 @@ public:
 		SC_Count
 	};
 
+	// The way the continuous feature values are grouped when looking for a split
+	enum TSplitMode {
+		// The feature values are merged into intervals separately for each node
+		// This mode can provide better quality
+		SM_Intervals = 0,
+		// The steps of a histogram built once on the feature values of the whole problem will be used for splitting
+		// The params.MaxBins value sets the histogram size
+		// This mode is faster on large problems
+		SM_Histogram,
+		SM_Count
+	};
+
 	// Classification parameters
 	struct CParams {
 		// The minimum number of vectors corresponding to a node subtree:
@@ -138,6 +152,12 @@ public:
 		size_t AvailableMemory; 
 		// The algorithm used for multi-class classification
 		TMulticlassMode MulticlassMode;
+		// The way the continuous feature values are grouped when looking for a split
+		TSplitMode SplitMode;
+		// The largest possible histogram size to be used in SM_Histogram mode
+		int MaxBins;
+		// The number of processing threads used
+		int ThreadCount;
 
 		CParams() :
 			MinContinuousSubsetSize( 1 ),
@@ -151,7 +171,10 @@ public:
 			ConstNodeThreshold( 0.99 ),
 			RandomSelectedFeaturesCount( NotFound ),
 			AvailableMemory( Gigabyte ),
-			MulticlassMode( MM_SingleClassifier )
+			MulticlassMode( MM_SingleClassifier ),
+			SplitMode( SM_Intervals ),
+			MaxBins( 32 ),
+			ThreadCount( 1 )
 		{
 		}
 	};
@@ -178,11 +201,15 @@ private:
 	mutable CPointerArray<CDecisionTreeNodeStatisticBase> statisticsCache; // the cache for statistics
 	mutable CArray<CDecisionTreeNodeBase*> classifyNodesCache; // the cache for leaf nodes
 	mutable CArray<int> classifyNodesLevel; // the levels of leaf nodes
+	mutable CArray< CArray<int> > statisticsVectors; // the vectors of the nodes in the statistics cache
+	CPtr<const CDecisionTreeHistogram> histogram; // the feature histograms (only in SM_Histogram mode)
 
 	CPtr<CDecisionTreeNodeBase> buildTree( int vectorCount );
 	bool buildTreeLevel( const CFloatMatrixDesc& matrix, int level, CDecisionTreeNodeBase& root ) const;
 	bool collectStatistics( const CFloatMatrixDesc& matrix, int level, CDecisionTreeNodeBase* root ) const;
-	bool split( const CDecisionTreeNodeStatisticBase& nodeStatistics, int level ) const;
+	void findSplit( const CDecisionTreeNodeStatisticBase& nodeStatistics, int threadCount,
+		CDecisionTreeNodeSplit& nodeSplit ) const;
+	bool split( const CDecisionTreeNodeStatisticBase& nodeStatistics, CDecisionTreeNodeSplit& nodeSplit, int level ) const;
 	void generateUsedFeatures( int randomSelectedFeaturesCount, int featuresCount, CArray<int>& features ) const;
 
 	CPtr<CDecisionTreeNodeBase> createNode() const;
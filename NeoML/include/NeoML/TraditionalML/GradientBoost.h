@@ -312,6 +312,11 @@ public:
 
 	// Converts model to the compact representation (GBMR_Compact).
 	virtual void ConvertToCompact() = 0;
+
+	// Gets the predictions for all rows of the matrix, the same as calling Predict for each row
+	// The trees are evaluated for a block of rows at a time; the rows are split between threadCount threads
+	// The default implementation calls Predict for each row in the current thread
+	virtual void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const;
 };
 
 //------------------------------------------------------------------------------------------------------------
@@ -46,6 +46,11 @@ public:
 
 	// Gets the learning rate
 	virtual double GetLearningRate() const = 0;
+
+	// Gets the predictions for all rows of the matrix, the same as calling Predict for each row
+	// The dense rows are scored by several documents at once; the rows are split between threadCount threads
+	// The default implementation calls Predict for each row in the current thread
+	virtual void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const;
 };
 
 // The QuickScorer algorithm for optimizing a gradient boosting model
@@ -53,6 +53,7 @@ public:
 	explicit CTapeVar( const CTapeBlob& var );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob&, ITapeGradientAccumulator& ) const override { return true; }
 
 private:
 	const CTapeBlob* variable;
@@ -78,18 +79,32 @@ CPtr<CDnnBlob> CTapeVar::Jacobian( const CTapeBlob* var ) const
 
 class CGradientTapeImpl : public IGradientTape {
 public:
+	CGradientTapeImpl() : nextStep( 0 ) {}
 
 	void Add( const CTapeBlob* result, const ITapeOperation* operation ) override;
 	void Remove( const CTapeBlob* result ) override;
 	CPtr<const ITapeOperation> GetOperation( const CTapeBlob* expression ) override;
 
+	// Gets the ordinal number of the operation which has been used for calculating blob 'result'.
+	// The operations are numbered in the order they were added, so an operation always goes after its inputs.
+	// Returns NotFound if the blob isn't recorded.
+	__int64 GetStep( const CTapeBlob* result ) const;
+
 	void RemoveAllBlobs();
 
 protected:
 	virtual ~CGradientTapeImpl() { NeoPresume( operations.IsEmpty() ); }
 
 private:
-	CMap<const CTapeBlob*, CPtr<const ITapeOperation>> operations;
+	struct CTapeRecord {
+		CPtr<const ITapeOperation> Operation;
+		__int64 Step;
+
+		CTapeRecord() : Step( NotFound ) {}
+	};
+
+	CMap<const CTapeBlob*, CTapeRecord> operations;
+	__int64 nextStep;
 };
 
 void CGradientTapeImpl::Add( const CTapeBlob* result, const ITapeOperation* operation )
@@ -97,9 +112,10 @@ void CGradientTapeImpl::Add( const CTapeBlob* result, const ITapeOperation* oper
 	NeoAssert( result != 0 );
 	NeoAssert( operation != 0 );
 
-	CPtr<const ITapeOperation>& tapeOperation = operations.GetOrCreateValue( result );
-	NeoAssert( tapeOperation == 0 );
-	tapeOperation = operation;
+	CTapeRecord& record = operations.GetOrCreateValue( result );
+	NeoAssert( record.Operation == 0 );
+	record.Operation = operation;
+	record.Step = nextStep++;
 }
 
 void CGradientTapeImpl::Remove( const CTapeBlob* result )
@@ -128,7 +144,151 @@ CPtr<const ITapeOperation> CGradientTapeImpl::GetOperation( const CTapeBlob* exp
 		return 0;
 	}
 
-	return operations.GetValue( pos );
+	return operations.GetValue( pos ).Operation;
+}
+
+__int64 CGradientTapeImpl::GetStep( const CTapeBlob* result ) const
+{
+	TMapPosition pos = operations.GetFirstPosition( result );
+	if( pos == NotFound ) {
+		return NotFound;
+	}
+
+	return operations.GetValue( pos ).Step;
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+// The backward pass along the tape.
+// The gradients are propagated from the expression to the variable as vectors:
+// the operations are visited in the reverse order of their recording,
+// so that each operation receives the full gradient of its result before passing it to the inputs.
+class CTapeBackwardPass : public ITapeGradientAccumulator {
+public:
+	CTapeBackwardPass( CGradientTapeImpl& tape, const CTapeBlob& var );
+
+	// Calculates the gradient of the sum of the expression elements with respect to the variable
+	CPtr<CDnnBlob> Run( const CTapeBlob& expression );
+
+	// ITapeGradientAccumulator
+	bool IsNeeded( const CDnnBlob* blob ) const override;
+	void Add( const CDnnBlob* blob, CDnnBlob* gradient ) override;
+
+private:
+	// The blob waiting for its gradient to be propagated
+	struct CPendingBlob {
+		__int64 Step;
+		const CTapeBlob* Blob;
+
+		CPendingBlob() : Step( NotFound ), Blob( 0 ) {}
+		CPendingBlob( __int64 step, const CTapeBlob* blob ) : Step( step ), Blob( blob ) {}
+	};
+
+	CGradientTapeImpl& tape;
+	const CTapeBlob& var;
+	// The blobs recorded before the variable do not depend on it
+	const __int64 varStep;
+	// The gradients accumulated for the pending blobs
+	CMap<const CTapeBlob*, CPtr<CDnnBlob>> gradients;
+	// The pending blobs, the last recorded on top
+	CPriorityQueue<CArray<CPendingBlob>, AscendingByMember<CPendingBlob, __int64, &CPendingBlob::Step>> queue;
+
+	void addJacobianProduct( const ITapeOperation& operation, const CDnnBlob& resultGradient );
+};
+
+CTapeBackwardPass::CTapeBackwardPass( CGradientTapeImpl& _tape, const CTapeBlob& _var ) :
+	tape( _tape ),
+	var( _var ),
+	varStep( _tape.GetStep( &_var ) )
+{
+	NeoAssert( varStep != NotFound );
+}
+
+CPtr<CDnnBlob> CTapeBackwardPass::Run( const CTapeBlob& expression )
+{
+	CPtr<CDnnBlob> seed = CDnnBlob::CreateBlob( expression.GetMathEngine(), expression.GetDesc() );
+	seed->Fill( 1.f );
+	Add( &expression, seed );
+
+	CPendingBlob pending;
+	while( queue.Pop( pending ) ) {
+		CPtr<CDnnBlob> gradient = gradients.Get( pending.Blob );
+		gradients.Delete( pending.Blob );
+		if( pending.Blob == &var ) {
+			// All the blobs left have been recorded before the variable
+			return gradient;
+		}
+
+		CPtr<const ITapeOperation> operation = tape.GetOperation( pending.Blob );
+		NeoAssert( operation != 0 );
+		if( !operation->VectorJacobianProduct( *gradient, *this ) ) {
+			addJacobianProduct( *operation, *gradient );
+		}
+	}
+
+	// The expression doesn't depend on the variable
+	CPtr<CDnnBlob> result = CDnnBlob::CreateBlob( var.GetMathEngine(), var.GetDesc() );
+	result->Clear();
+	return result;
+}
+
+bool CTapeBackwardPass::IsNeeded( const CDnnBlob* blob ) const
+{
+	const CTapeBlob* tapeBlob = dynamic_cast<const CTapeBlob*>( blob );
+	if( tapeBlob == 0 || tapeBlob->Tape() != &tape ) {
+		return false;
+	}
+	return tape.GetStep( tapeBlob ) >= varStep;
+}
+
+void CTapeBackwardPass::Add( const CDnnBlob* blob, CDnnBlob* gradientPtr )
+{
+	CPtr<CDnnBlob> gradient = gradientPtr;
+	NeoAssert( gradient != 0 );
+	if( !IsNeeded( blob ) ) {
+		return;
+	}
+	NeoAssert( gradient->GetDataSize() == blob->GetDataSize() );
+
+	const CTapeBlob* tapeBlob = static_cast<const CTapeBlob*>( blob );
+	CPtr<CDnnBlob>& accumulated = gradients.GetOrCreateValue( tapeBlob );
+	if( accumulated == 0 ) {
+		gradient->ReinterpretDimensions( blob->GetDesc() );
+		accumulated = gradient;
+		queue.Push( CPendingBlob( tape.GetStep( tapeBlob ), tapeBlob ) );
+	} else {
+		accumulated->GetMathEngine().VectorAdd( accumulated->GetData(), gradient->GetData(),
+			accumulated->GetData(), accumulated->GetDataSize() );
+	}
+}
+
+// Passes the gradient straight to the variable for the operations that only provide the jacobian
+void CTapeBackwardPass::addJacobianProduct( const ITapeOperation& operation, const CDnnBlob& resultGradient )
+{
+	CPtr<CDnnBlob> jacobian = operation.Jacobian( &var );
+	if( jacobian == 0 ) {
+		return;
+	}
+
+	IMathEngine& mathEngine = jacobian->GetMathEngine();
+	const int height = jacobian->GetObjectCount();
+	const int width = jacobian->GetObjectSize();
+	NeoAssert( width == var.GetDataSize() );
+
+	CPtr<CDnnBlob> product = CDnnBlob::CreateBlob( mathEngine, var.GetDesc() );
+	if( height > 1 ) {
+		NeoAssert( height == resultGradient.GetDataSize() );
+		mathEngine.MultiplyTransposedMatrixByMatrix( 1, resultGradient.GetData(), height, 1,
+			jacobian->GetData(), width, product->GetData(), product->GetDataSize() );
+	} else if( resultGradient.GetDataSize() == 1 ) {
+		// The jacobian of the one-element result
+		mathEngine.VectorMultiply( jacobian->GetData(), product->GetData(), width, resultGradient.GetData() );
+	} else {
+		// The diagonal jacobian
+		NeoAssert( width == resultGradient.GetDataSize() );
+		mathEngine.VectorEltwiseMultiply( jacobian->GetData(), resultGradient.GetData(), product->GetData(), width );
+	}
+	Add( &var, product );
 }
 
 //------------------------------------------------------------------------------------------------------------
@@ -165,17 +325,8 @@ CPtr<const CDnnBlob> CGradientTape::Gradient( const CDnnBlob& expression, const
 	NeoAssert( expressionTapeBlob->Tape() == impl );
 	NeoAssert( varTapeBlob->Tape() == impl );
 
-	CPtr<const ITapeOperation> operation = impl->GetOperation( expressionTapeBlob );
-	CPtr<const CDnnBlob> grad( operation->Jacobian( varTapeBlob ) );
-
-	if( grad->GetObjectCount() == 1 ) {
-		return grad;
-	}
-
-	CPtr<CDnnBlob> result( CDnnBlob::CreateBlob( grad->GetMathEngine(), var.GetDesc() ) );
-	NeoAssert( var.GetDataSize() == grad->GetObjectSize() );
-	grad->GetMathEngine().SumMatrixRows( 1, result->GetData(), grad->GetData(), grad->GetObjectCount(), grad->GetObjectSize() );
-	return result.Ptr();
+	CTapeBackwardPass backwardPass( *impl, *varTapeBlob );
+	return backwardPass.Run( *expressionTapeBlob ).Ptr();
 }
 
 } // namespace NeoML
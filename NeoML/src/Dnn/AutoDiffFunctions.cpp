@@ -104,6 +104,48 @@ static CBlobDesc getBroadcastedDesc( const CBlobDesc& firstDesc, const CBlobDesc
 	return res;
 }
 
+// Calculates resultGradient * factor elementwise
+static CPtr<CDnnBlob> eltwiseProductGradient( const CDnnBlob& resultGradient, const CDnnBlob* factor )
+{
+	NeoPresume( resultGradient.GetDataSize() == factor->GetDataSize() );
+	CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( resultGradient.GetMathEngine(), factor->GetDesc() );
+	gradient->GetMathEngine().VectorEltwiseMultiply( resultGradient.GetData(), factor->GetData(), gradient->GetData(),
+		gradient->GetDataSize() );
+	return gradient;
+}
+
+// Sums the gradient of the broadcasted blob over the broadcasted dimensions
+static CPtr<CDnnBlob> sumBroadcastedGradient( const CDnnBlob& resultGradient, const CBlobDesc& toDesc, const CBlobDesc& fromDesc )
+{
+	IMathEngine& mathEngine = resultGradient.GetMathEngine();
+	CPtr<const CDnnBlob> gradient = &resultGradient;
+	CBlobDesc desc = toDesc;
+	for( int d = 0; d < BD_Count; d++ ) {
+		if( desc.DimSize( d ) == fromDesc.DimSize( d ) ) {
+			continue;
+		}
+		NeoAssert( fromDesc.DimSize( d ) == 1 );
+		int followingDimension = 1;
+		for( int i = 0; i < d; i++ ) {
+			followingDimension *= desc.DimSize( i );
+		}
+		int precedingDimension = 1;
+		for( int i = d + 1; i < BD_Count; i++ ) {
+			precedingDimension *= desc.DimSize( i );
+		}
+		const int dimension = desc.DimSize( d );
+		desc.SetDimSize( d, 1 );
+		CPtr<CDnnBlob> sum = CDnnBlob::CreateBlob( mathEngine, desc );
+		mathEngine.VectorSumAlongDimension( gradient->GetData(), precedingDimension, dimension, followingDimension,
+			sum->GetData() );
+		gradient = sum.Ptr();
+	}
+
+	CPtr<CDnnBlob> result = gradient == &resultGradient ? resultGradient.GetCopy() : const_cast<CDnnBlob*>( gradient.Ptr() );
+	result->ReinterpretDimensions( fromDesc );
+	return result;
+}
+
 //------------------------------------------------------------------------------------------------------------
 
 CPtr<const CDnnBlob> Const( IMathEngine& mathEngine, float data, const CBlobDesc& desc )
@@ -127,6 +169,7 @@ public:
 	CTapeAdd( const CDnnBlob* first, const CDnnBlob* second );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -166,6 +209,17 @@ CPtr<CDnnBlob> CTapeAdd::Jacobian( const CTapeBlob* var ) const
 	return firstJacobian;
 }
 
+bool CTapeAdd::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		accumulator.Add( first, resultGradient.GetCopy() );
+	}
+	if( accumulator.IsNeeded( second ) ) {
+		accumulator.Add( second, resultGradient.GetCopy() );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Add( const CDnnBlob* first, const CDnnBlob* second )
 {
 	NeoAssert( first != 0 );
@@ -231,6 +285,7 @@ public:
 	CTapeSub( const CDnnBlob* first, const CDnnBlob* second );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -276,6 +331,19 @@ CPtr<CDnnBlob> CTapeSub::Jacobian( const CTapeBlob* var ) const
 	return firstJacobian;
 }
 
+bool CTapeSub::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		accumulator.Add( first, resultGradient.GetCopy() );
+	}
+	if( accumulator.IsNeeded( second ) ) {
+		CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( resultGradient.GetMathEngine(), second->GetDesc() );
+		gradient->GetMathEngine().VectorNeg( resultGradient.GetData(), gradient->GetData(), gradient->GetDataSize() );
+		accumulator.Add( second, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Sub( const CDnnBlob* first, const CDnnBlob* second )
 {
 	NeoAssert( first != 0 );
@@ -353,6 +421,7 @@ public:
 	explicit CTapeMul( const CDnnBlob* first, const CDnnBlob* second );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -421,6 +490,17 @@ CPtr<CDnnBlob> CTapeMul::Jacobian( const CTapeBlob* var ) const
 	return firstJacobian;
 }
 
+bool CTapeMul::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		accumulator.Add( first, eltwiseProductGradient( resultGradient, second ) );
+	}
+	if( accumulator.IsNeeded( second ) ) {
+		accumulator.Add( second, eltwiseProductGradient( resultGradient, first ) );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Mul( const CDnnBlob* first, const CDnnBlob* second )
 {
 	NeoAssert( first != 0 );
@@ -474,6 +554,7 @@ public:
 	explicit CTapeDiv( const CDnnBlob* first, const CDnnBlob* second );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -576,6 +657,36 @@ CPtr<CDnnBlob> CTapeDiv::Jacobian( const CTapeBlob* var ) const
 	return secondJacobian;
 }
 
+bool CTapeDiv::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	const bool isFirstNeeded = accumulator.IsNeeded( first );
+	const bool isSecondNeeded = accumulator.IsNeeded( second );
+	if( !isFirstNeeded && !isSecondNeeded ) {
+		return true;
+	}
+
+	IMathEngine& mathEngine = resultGradient.GetMathEngine();
+	// firstGradient = resultGradient / second
+	CPtr<CDnnBlob> firstGradient = CDnnBlob::CreateBlob( mathEngine, first->GetDesc() );
+	mathEngine.VectorEltwiseDivide( resultGradient.GetData(), second->GetData(), firstGradient->GetData(),
+		firstGradient->GetDataSize() );
+
+	if( isSecondNeeded ) {
+		// secondGradient = -resultGradient * first / (second * second)
+		CPtr<CDnnBlob> secondGradient = CDnnBlob::CreateBlob( mathEngine, second->GetDesc() );
+		mathEngine.VectorEltwiseMultiply( firstGradient->GetData(), first->GetData(), secondGradient->GetData(),
+			secondGradient->GetDataSize() );
+		mathEngine.VectorEltwiseDivide( secondGradient->GetData(), second->GetData(), secondGradient->GetData(),
+			secondGradient->GetDataSize() );
+		mathEngine.VectorNeg( secondGradient->GetData(), secondGradient->GetData(), secondGradient->GetDataSize() );
+		accumulator.Add( second, secondGradient );
+	}
+	if( isFirstNeeded ) {
+		accumulator.Add( first, firstGradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Div( const CDnnBlob* first, const CDnnBlob* second )
 {
 	NeoAssert( first != 0 );
@@ -630,6 +741,7 @@ public:
 	explicit CTapeMax( const CDnnBlob& first, float second );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -655,6 +767,16 @@ CPtr<CDnnBlob> CTapeMax::Jacobian( const CTapeBlob* var ) const
 	return jacobian;
 }
 
+bool CTapeMax::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		CPtr<CDnnBlob> gradient = resultGradient.GetCopy();
+		gradient->GetMathEngine().VectorMaxDiff( first->GetData(), second, gradient->GetData(), 1, gradient->GetDataSize() );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> NEOML_API Max( const CDnnBlob* first, float second )
 {
 	NeoAssert( first != 0 );
@@ -687,9 +809,12 @@ public:
 	explicit CTapeSum( const CDnnBlob& first, const CArray<int>& axes );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 	static CPtr<CTapeBlob> Impl( const CDnnBlob* blob, const CArray<int>& axes, IGradientTape* tape );
 	static CPtr<CDnnBlob> JacobianImpl( const CDnnBlob* blob, const CArray<int>& axes, const CTapeBlob* var );
+	static CPtr<CDnnBlob> VectorJacobianProductImpl( const CDnnBlob* blob, const CArray<int>& axes,
+		const CDnnBlob& resultGradient );
 private:
 	CPtr<const CDnnBlob> first;
 	CArray<int> axes;
@@ -778,6 +903,31 @@ CPtr<CDnnBlob> CTapeSum::Jacobian( const CTapeBlob* var ) const
 	return JacobianImpl( first, axes, var );
 }
 
+CPtr<CDnnBlob> CTapeSum::VectorJacobianProductImpl( const CDnnBlob* blob, const CArray<int>& axes,
+	const CDnnBlob& resultGradient )
+{
+	CBlobDesc resultDesc = blob->GetDesc();
+	for( int d = 0; d < BD_Count; d++ ) {
+		if( axes.IsEmpty() || axes.Has( d ) ) {
+			resultDesc.SetDimSize( d, 1 );
+		}
+	}
+	NeoAssert( resultDesc.BlobSize() == resultGradient.GetDataSize() );
+
+	CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( resultGradient.GetMathEngine(), blob->GetDesc() );
+	gradient->GetMathEngine().BroadcastCopy( gradient->GetData(), resultGradient.GetData(),
+		blob->GetDesc(), resultDesc, 1 );
+	return gradient;
+}
+
+bool CTapeSum::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		accumulator.Add( first, VectorJacobianProductImpl( first, axes, resultGradient ) );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Sum( const CDnnBlob* first, const CArray<int>& _axes )
 {
 	CArray<int> axes;
@@ -811,6 +961,7 @@ public:
 	explicit CTapeCumSum( const CDnnBlob& first, int axis );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 private:
 	CPtr<const CDnnBlob> first;
 	int axis;
@@ -852,6 +1003,38 @@ CPtr<CDnnBlob> CTapeCumSum::Jacobian( const CTapeBlob* var ) const
 	return result;
 }
 
+bool CTapeCumSum::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( !accumulator.IsNeeded( first ) ) {
+		return true;
+	}
+
+	int precedingDimension;
+	int dimension;
+	int followingDimension;
+	getSequentialAxesDimensions( first, { axis }, followingDimension, dimension, precedingDimension );
+
+	IMathEngine& mathEngine = resultGradient.GetMathEngine();
+	const int dataSize = first->GetDataSize();
+	// The gradient is the reverse cumulative sum: total - cumSum + resultGradient
+	CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( mathEngine, first->GetDesc() );
+	mathEngine.VectorCumSumAlongDimension( resultGradient.GetData(), precedingDimension, dimension,
+		followingDimension, gradient->GetData() );
+	mathEngine.VectorSub( resultGradient.GetData(), gradient->GetData(), gradient->GetData(), dataSize );
+
+	CBlobDesc totalDesc = first->GetDesc();
+	totalDesc.SetDimSize( axis, 1 );
+	CPtr<CDnnBlob> total = CDnnBlob::CreateBlob( mathEngine, totalDesc );
+	mathEngine.VectorSumAlongDimension( resultGradient.GetData(), precedingDimension, dimension,
+		followingDimension, total->GetData() );
+	CPtr<CDnnBlob> totalBroadcasted = CDnnBlob::CreateBlob( mathEngine, first->GetDesc() );
+	mathEngine.BroadcastCopy( totalBroadcasted->GetData(), total->GetData(), first->GetDesc(), totalDesc, 1 );
+	mathEngine.VectorAdd( gradient->GetData(), totalBroadcasted->GetData(), gradient->GetData(), dataSize );
+
+	accumulator.Add( first, gradient );
+	return true;
+}
+
 CPtr<const CDnnBlob> CumSum( const CDnnBlob* first, int axis )
 {
 	NeoAssert( first != 0 );
@@ -884,6 +1067,7 @@ public:
 	explicit CTapeMean( const CDnnBlob& first, const CArray<int>& axes );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 	static void DivideByCount( const CDnnBlob* in, CDnnBlob* out, const CArray<int>& axes );
 private:
@@ -920,6 +1104,16 @@ CPtr<CDnnBlob> CTapeMean::Jacobian( const CTapeBlob* var ) const
 	return jacobian;
 }
 
+bool CTapeMean::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		CPtr<CDnnBlob> gradient = CTapeSum::VectorJacobianProductImpl( first, axes, resultGradient );
+		DivideByCount( first, gradient, axes );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Mean( const CDnnBlob* first, const CArray<int>& _axes )
 {
 	CArray<int> axes;
@@ -954,6 +1148,7 @@ public:
 	explicit CTapeNeg( const CDnnBlob& first );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -976,6 +1171,16 @@ CPtr<CDnnBlob> CTapeNeg::Jacobian( const CTapeBlob* var ) const
 	return jacobian;
 }
 
+bool CTapeNeg::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( resultGradient.GetMathEngine(), first->GetDesc() );
+		gradient->GetMathEngine().VectorNeg( resultGradient.GetData(), gradient->GetData(), gradient->GetDataSize() );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Neg( const CDnnBlob* first )
 {
 	NeoAssert( first != 0 );
@@ -1002,6 +1207,7 @@ public:
 	explicit CTapeAbs( const CDnnBlob& first );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -1027,6 +1233,17 @@ CPtr<CDnnBlob> CTapeAbs::Jacobian( const CTapeBlob* var ) const
 	return jacobian;
 }
 
+bool CTapeAbs::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( resultGradient.GetMathEngine(), first->GetDesc() );
+		gradient->GetMathEngine().VectorAbsDiff( resultGradient.GetData(), 1, gradient->GetDataSize(),
+			first->GetData(), gradient->GetData() );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Abs( const CDnnBlob* first )
 {
 	NeoAssert( first != 0 );
@@ -1053,6 +1270,7 @@ public:
 	explicit CTapeExp( const CDnnBlob& first );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -1087,6 +1305,19 @@ CPtr<CDnnBlob> CTapeExp::Jacobian( const CTapeBlob* var ) const
 	return result;
 }
 
+bool CTapeExp::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		IMathEngine& mathEngine = resultGradient.GetMathEngine();
+		CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( mathEngine, first->GetDesc() );
+		mathEngine.VectorExp( first->GetData(), gradient->GetData(), gradient->GetDataSize() );
+		mathEngine.VectorEltwiseMultiply( gradient->GetData(), resultGradient.GetData(), gradient->GetData(),
+			gradient->GetDataSize() );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Exp( const CDnnBlob* first )
 {
 	NeoAssert( first != 0 );
@@ -1113,6 +1344,7 @@ public:
 	explicit CTapeLog( const CDnnBlob& first );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -1138,6 +1370,17 @@ CPtr<CDnnBlob> CTapeLog::Jacobian( const CTapeBlob* var ) const
 	return result;
 }
 
+bool CTapeLog::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( resultGradient.GetMathEngine(), first->GetDesc() );
+		gradient->GetMathEngine().VectorLogDiff( resultGradient.GetData(), 1, gradient->GetDataSize(),
+			first->GetData(), gradient->GetData() );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Log( const CDnnBlob* first )
 {
 	NeoAssert( first != 0 );
@@ -1164,6 +1407,7 @@ public:
 	explicit CTapeTopK( const CDnnBlob& first, const CDnnBlob& indices );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -1192,6 +1436,18 @@ CPtr<CDnnBlob> CTapeTopK::Jacobian( const CTapeBlob* var ) const
 	return result;
 }
 
+bool CTapeTopK::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		// Scatters the gradient to the selected elements
+		CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( resultGradient.GetMathEngine(), first->GetDesc() );
+		gradient->GetMathEngine().LookupAndAddToTable( indices->GetData<int>(), indices->GetDataSize(), 1,
+			resultGradient.GetData(), 1, gradient->GetData(), gradient->GetDataSize() );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> NEOML_API TopK( const CDnnBlob* first, int k )
 {
 	NeoAssert( first != 0 );
@@ -1220,6 +1476,7 @@ public:
 	explicit CTapeClip( const CDnnBlob& first, float minValue, float maxValue );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CPtr<const CDnnBlob> first;
@@ -1254,6 +1511,22 @@ CPtr<CDnnBlob> CTapeClip::Jacobian( const CTapeBlob* var ) const
 	return result.Ptr();
 }
 
+bool CTapeClip::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		IMathEngine& mathEngine = resultGradient.GetMathEngine();
+		CFloatHandleStackVar minHandle( mathEngine, 1 );
+		minHandle.SetValue( minValue );
+		CFloatHandleStackVar maxHandle( mathEngine, 1 );
+		maxHandle.SetValue( maxValue );
+		CPtr<CDnnBlob> gradient = CDnnBlob::CreateBlob( mathEngine, first->GetDesc() );
+		mathEngine.VectorMinMaxDiff( resultGradient.GetData(), 1, gradient->GetDataSize(), first->GetData(),
+			gradient->GetData(), minHandle, maxHandle );
+		accumulator.Add( first, gradient );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Clip( const CDnnBlob* first, float minValue, float maxValue )
 {
 	NeoAssert( first != 0 );
@@ -1285,6 +1558,7 @@ public:
 	explicit CTapeConcat( const CObjectArray<CDnnBlob>& _blobs, int _axis );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 
 private:
 	CObjectArray<CDnnBlob> blobs;
@@ -1337,6 +1611,30 @@ CPtr<CDnnBlob> CTapeConcat::Jacobian( const CTapeBlob* var ) const
 	return result.Ptr();
 }
 
+bool CTapeConcat::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	IMathEngine& mathEngine = resultGradient.GetMathEngine();
+	CBlobDesc resultDesc = blobs[0]->GetDesc();
+	int resultAxis = 0;
+	CObjectArray<CDnnBlob> gradients;
+	for( int i = 0; i < blobs.Size(); i++ ) {
+		resultAxis += blobs[i]->DimSize( axis );
+		gradients.Add( CDnnBlob::CreateBlob( mathEngine, blobs[i]->GetDesc() ) );
+	}
+	resultDesc.SetDimSize( axis, resultAxis );
+
+	CPtr<CDnnBlob> gradient = resultGradient.GetCopy();
+	gradient->ReinterpretDimensions( resultDesc );
+	CDnnBlob::SplitByDim( mathEngine, static_cast<TBlobDim>( axis ), gradient, gradients );
+
+	for( int i = 0; i < blobs.Size(); i++ ) {
+		if( accumulator.IsNeeded( blobs[i] ) ) {
+			accumulator.Add( blobs[i], gradients[i] );
+		}
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Concat( const CObjectArray<CDnnBlob>& blobs, int axis )
 {
 	IMathEngine& mathEngine = blobs[0]->GetMathEngine();
@@ -1374,6 +1672,7 @@ public:
 	explicit CTapeBroadcast( const CDnnBlob* first, const CBlobDesc& fromDesc );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 private:
 	CPtr<const CDnnBlob> first;
 	CBlobDesc toDesc;
@@ -1405,6 +1704,14 @@ CPtr<CDnnBlob> CTapeBroadcast::Jacobian( const CTapeBlob* var ) const
 	return result.Ptr();
 }
 
+bool CTapeBroadcast::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	if( accumulator.IsNeeded( first ) ) {
+		accumulator.Add( first, sumBroadcastedGradient( resultGradient, toDesc, first->GetDesc() ) );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Broadcast( const CDnnBlob* first, const CBlobDesc& toDesc )
 {
 	const CBlobDesc& firstDesc = first->GetDesc();
@@ -1487,6 +1794,7 @@ public:
 	explicit CTapePower( const CDnnBlob* first, const CDnnBlob* second );
 
 	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override;
+	bool VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const override;
 private:
 	CPtr<const CDnnBlob> first;
 	CPtr<const CDnnBlob> second;
@@ -1592,6 +1900,38 @@ CPtr<CDnnBlob> CTapePower::Jacobian( const CTapeBlob* var ) const
 	}
 }
 
+bool CTapePower::VectorJacobianProduct( const CDnnBlob& resultGradient, ITapeGradientAccumulator& accumulator ) const
+{
+	const bool isFirstNeeded = accumulator.IsNeeded( first );
+	const bool isSecondNeeded = accumulator.IsNeeded( second );
+	if( !isFirstNeeded && !isSecondNeeded ) {
+		return true;
+	}
+
+	IMathEngine& mathEngine = resultGradient.GetMathEngine();
+	const int dataSize = first->GetDataSize();
+	// temp = resultGradient * first ^ (second - 1)
+	CPtr<CDnnBlob> temp = CDnnBlob::CreateBlob( mathEngine, first->GetDesc() );
+	mathEngine.VectorSub( second->GetData(), 1.f, temp->GetData(), dataSize );
+	mathEngine.VectorEltwisePower( first->GetData(), temp->GetData(), temp->GetData(), dataSize );
+	mathEngine.VectorEltwiseMultiply( temp->GetData(), resultGradient.GetData(), temp->GetData(), dataSize );
+
+	if( isSecondNeeded ) {
+		// secondGradient = temp * first * log(first)
+		CPtr<CDnnBlob> secondGradient = CDnnBlob::CreateBlob( mathEngine, second->GetDesc() );
+		mathEngine.VectorLog( first->GetData(), secondGradient->GetData(), dataSize );
+		mathEngine.VectorEltwiseMultiply( secondGradient->GetData(), first->GetData(), secondGradient->GetData(), dataSize );
+		mathEngine.VectorEltwiseMultiply( secondGradient->GetData(), temp->GetData(), secondGradient->GetData(), dataSize );
+		accumulator.Add( second, secondGradient );
+	}
+	if( isFirstNeeded ) {
+		// firstGradient = temp * second
+		mathEngine.VectorEltwiseMultiply( temp->GetData(), second->GetData(), temp->GetData(), dataSize );
+		accumulator.Add( first, temp );
+	}
+	return true;
+}
+
 CPtr<const CDnnBlob> Pow( const CDnnBlob* first, const CDnnBlob* second )
 {
 	NeoAssert( first != 0 );
@@ -420,20 +420,24 @@ void CBaseLayer::runOnce()
 
 	// Either this is the first runOnce after reshape
 	// or the input and output blobs are released directly after use
-	for( int i = 0; i < inputBlobs.Size(); ++i ) {
-		CBaseLayer* inputLayer = GetInputLayer( i );
-		int outputNumber = inputs[i].OutputNumber;
-		CDnnBlob* prevLayerOutput = inputLayer->outputBlobs[outputNumber].Ptr();
+	{
+		// During the parallel run several layers may be taking the same output at once
+		CCriticalSectionLock lock( dnn->outputsSection, dnn->isParallelRun );
+		for( int i = 0; i < inputBlobs.Size(); ++i ) {
+			CBaseLayer* inputLayer = GetInputLayer( i );
+			int outputNumber = inputs[i].OutputNumber;
+			CDnnBlob* prevLayerOutput = inputLayer->outputBlobs[outputNumber].Ptr();
 
-		if( prevLayerOutput == inputBlobs[i].Ptr() ) {
-			continue;
-		}
+			if( prevLayerOutput == inputBlobs[i].Ptr() ) {
+				continue;
+			}
 
-		inputBlobs[i] = prevLayerOutput;
+			inputBlobs[i] = prevLayerOutput;
 
-		if( GetDnn()->isReuseMemoryMode ) {
-			// Notify that the output has been processed
-			inputLayer->onOutputProcessed( outputNumber );
+			if( GetDnn()->isReuseMemoryMode ) {
+				// Notify that the output has been processed
+				inputLayer->onOutputProcessed( outputNumber );
+			}
 		}
 	}
 
@@ -26,6 +26,7 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/LossLayer.h>
 #include <NeoML/Dnn/Layers/ConvLayer.h>
 #include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/Layers/QuantizedLayers.h>
 #include <NeoML/Dnn/Layers/FullyConnectedSourceLayer.h>
 #include <NeoML/Dnn/Layers/ActivationLayers.h>
 #include <NeoML/Dnn/Layers/PoolingLayer.h>
@@ -89,6 +90,10 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/CastLayer.h>
 #include <NeoML/Dnn/Layers/DataLayer.h>
 #include <NeoML/Dnn/Layers/TransformerLayer.h>
+#include <NeoML/Dnn/Layers/PrefetchSourceLayer.h>
+#include <Dnn/DnnLayerScheduler.h>
+#include <Dnn/DnnMemoryPlanner.h>
+#include <Dnn/DnnMemoryFile.h>
 
 namespace NeoML {
 
@@ -338,6 +343,9 @@ REGISTER_NEOML_LAYER( CLrnLayer, "NeoMLDnnLrnLayer" )
 REGISTER_NEOML_LAYER( CCastLayer, "NeoMLDnnCastLayer" )
 REGISTER_NEOML_LAYER( CDataLayer, "NeoMLDnnDataLayer" )
 REGISTER_NEOML_LAYER( CTransformerEncoderLayer, "NeoMLDnnTransformerEncoderLayer" )
+REGISTER_NEOML_LAYER( CQuantizedFullyConnectedLayer, "NeoMLDnnQuantizedFullyConnectedLayer" )
+REGISTER_NEOML_LAYER( CQuantizedConvLayer, "NeoMLDnnQuantizedConvLayer" )
+REGISTER_NEOML_LAYER( CPrefetchSourceLayer, "NeoMLDnnPrefetchSourceLayer" )
 
 }
 
@@ -357,7 +365,11 @@ CDnn::CDnn( CRandom& _random, IMathEngine& _mathEngine ) :
 	currentSequencePos( 0 ),
 	isReverseSequense( false ),
 	autoRestartMode( true ),
-	isReuseMemoryMode( false )
+	isReuseMemoryMode( false ),
+	scheduler( nullptr ),
+	isParallelRun( false ),
+	memoryPlanner( nullptr ),
+	hasSharedParams( false )
 {
 	solver = FINE_DEBUG_NEW CDnnSimpleGradientSolver( mathEngine );
 	initializer = FINE_DEBUG_NEW CDnnXavierInitializer( random );
@@ -370,6 +382,8 @@ CDnn::~CDnn()
 		DeleteLayer(*layer);
 		layer->setDnn(0);
 	}
+	delete scheduler;
+	delete memoryPlanner;
 }
 
 void CDnn::GetLayerList( CArray<const char*>& layerList ) const
@@ -462,6 +476,8 @@ void CDnn::EnableLearning()
 	if( isLearningEnabled ) {
 		return;
 	}
+	// The shared parameters are read-only
+	NeoAssert( !hasSharedParams );
 	isLearningEnabled = true;
 	RequestReshape(true);
 }
@@ -521,6 +537,91 @@ void CDnn::runOnce(int curSequencePos)
 	}
 }
 
+// Runs the network using the scheduler: each layer is started as soon as all its inputs are ready
+void CDnn::runOnceParallel()
+{
+	NeoPresume( scheduler != nullptr );
+	currentSequencePos = 0;
+	++runNumber;
+
+	if( !scheduler->HasGraph() ) {
+		setSchedulerGraph();
+	}
+
+	isParallelRun = true;
+	try {
+		// All inputs of a layer have already been run, so CBaseLayer::runOnce does not recurse here
+		scheduler->Run( [this]( int index ) { layers[index]->runOnce(); } );
+	} catch( ... ) {
+		isParallelRun = false;
+		throw;
+	}
+	isParallelRun = false;
+
+	if( IsLogging() ) {
+		*log << "Run " << runNumber << " : " << currentSequencePos;
+		for( int i = 0; i < sinkLayers.Size(); ++i ) {
+			CLossLayer* loss = dynamic_cast<CLossLayer*>( sinkLayers[i] );
+			if( loss != 0 ) {
+				*log << ", loss = " << loss->GetLastLoss();
+			}
+		}
+		*log << "\n";
+	}
+}
+
+// Passes the dependencies between the layers to the scheduler
+void CDnn::setSchedulerGraph()
+{
+	NeoPresume( scheduler != nullptr );
+	CMap<const CBaseLayer*, int> layerIndices;
+	for( int i = 0; i < layers.Size(); ++i ) {
+		layerIndices.Add( layers[i], i );
+	}
+	CArray<CArray<int>> inputs;
+	inputs.SetSize( layers.Size() );
+	for( int i = 0; i < layers.Size(); ++i ) {
+		for( int j = 0; j < layers[i]->GetInputCount(); ++j ) {
+			inputs[i].Add( layerIndices.Get( layers[i]->GetInputLayer( j ) ) );
+		}
+	}
+	scheduler->SetGraph( inputs );
+}
+
+void CDnn::SetParallelThreadCount( int threadCount )
+{
+	NeoAssert( threadCount > 0 );
+	if( threadCount == GetParallelThreadCount() ) {
+		return;
+	}
+	delete scheduler;
+	scheduler = threadCount > 1 ? FINE_DEBUG_NEW CDnnLayerScheduler( threadCount ) : nullptr;
+}
+
+int CDnn::GetParallelThreadCount() const
+{
+	return scheduler == nullptr ? 1 : scheduler->GetThreadCount();
+}
+
+void CDnn::EnableMemoryPlanning( bool enable )
+{
+	if( enable == IsMemoryPlanningEnabled() ) {
+		return;
+	}
+	if( enable ) {
+		memoryPlanner = FINE_DEBUG_NEW CDnnMemoryPlanner( mathEngine );
+	} else {
+		memoryPlanner->Reset();
+		delete memoryPlanner;
+		memoryPlanner = nullptr;
+	}
+}
+
+size_t CDnn::GetPlannedMemorySize() const
+{
+	return memoryPlanner == nullptr ? 0 : memoryPlanner->GetPlannedSize();
+}
+
 void CDnn::RunOnce()
 {
 	try {
@@ -534,9 +635,26 @@ void CDnn::RunOnce()
 			RestartSequence();
 		}
 		reshape(); // rebuild the network if necessary
-		
-		isReuseMemoryMode = ( getOutputBlobsSize() > MinReuseMemoryModeNetSize );
-		runOnce(0);
+
+		const bool isParallel = scheduler != nullptr && mathEngine.GetType() == MET_Cpu;
+		if( memoryPlanner != nullptr && !isParallel ) {
+			// The planned outputs are never released during the run
+			isReuseMemoryMode = false;
+			if( !memoryPlanner->IsValid() ) {
+				memoryPlanner->Plan( sinkLayers );
+			}
+		} else {
+			if( memoryPlanner != nullptr ) {
+				// The plan relies on the sequential order of the layers
+				memoryPlanner->Reset();
+			}
+			isReuseMemoryMode = ( getOutputBlobsSize() > MinReuseMemoryModeNetSize );
+		}
+		if( isParallel ) {
+			runOnceParallel();
+		} else {
+			runOnce(0);
+		}
 	}
 #ifdef NEOML_USE_FINEOBJ
 	catch( CCheckException* exception ) {
@@ -570,6 +688,10 @@ void CDnn::RunAndBackwardOnce()
 			RestartSequence();
 		}
 		reshape(); // rebuild the network if necessary
+		if( memoryPlanner != nullptr ) {
+			// The outputs are needed for the backward pass, so they may not share memory
+			memoryPlanner->Reset();
+		}
 		isReuseMemoryMode = false;
 		runOnce(0);
 		backwardRunAndLearnOnce(0);
@@ -666,6 +788,12 @@ void CDnn::rebuild()
 			sinkLayers.Add(layers[i]);
 		}
 	}
+	if( scheduler != nullptr ) {
+		scheduler->ResetGraph();
+	}
+	if( memoryPlanner != nullptr ) {
+		memoryPlanner->Reset();
+	}
 	RequestReshape(true);
 }
 
@@ -768,4 +896,53 @@ void CDnn::EnableProfile( bool profile )
 	}
 }
 
+CDnn* CDnn::CreateInferenceClone( CRandom& cloneRandom )
+{
+	CDnn* clone = FINE_DEBUG_NEW CDnn( cloneRandom, mathEngine );
+	clone->logFrequency = logFrequency;
+	clone->hasSharedParams = true;
+	clone->isLearningEnabled = false;
+
+	// The layers are copied one by one, so the temporary copy of the parameters is never larger than one layer
+	CDnnMemoryFile file;
+	for( int i = 0; i < layers.Size(); ++i ) {
+		const CString className = getLayerClass( layers[i] );
+		{
+			CArchive archive( &file, CArchive::SD_Storing );
+			layers[i]->Serialize( archive );
+		}
+		file.SeekToBegin();
+		CPtr<CBaseLayer> layer = createLayer( mathEngine, className );
+		NeoAssert( layer != nullptr );
+		{
+			CArchive archive( &file, CArchive::SD_Loading );
+			layer->Serialize( archive );
+		}
+		file.Close();
+
+		shareParamBlobs( *layers[i], *layer );
+		clone->AddLayer( *layer );
+	}
+	return clone;
+}
+
+// Replaces the parameters of the layer copy with the parameters of the original layer
+void CDnn::shareParamBlobs( CBaseLayer& from, CBaseLayer& to )
+{
+	NeoAssert( from.paramBlobs.Size() == to.paramBlobs.Size() );
+	for( int i = 0; i < from.paramBlobs.Size(); ++i ) {
+		to.paramBlobs[i] = from.paramBlobs[i];
+	}
+
+	CCompositeLayer* composite = dynamic_cast<CCompositeLayer*>( &from );
+	if( composite != nullptr ) {
+		CCompositeLayer* compositeCopy = CheckCast<CCompositeLayer>( &to );
+		CArray<const char*> layerList;
+		composite->GetLayerList( layerList );
+		for( int i = 0; i < layerList.Size(); ++i ) {
+			shareParamBlobs( *composite->GetLayer( layerList[i] ), *compositeCopy->GetLayer( layerList[i] ) );
+		}
+	}
+}
+
 } // namespace NeoML
@@ -0,0 +1,357 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <NeoML/Dnn/DnnBatchingRunner.h>
+
+namespace NeoML {
+
+typedef std::chrono::steady_clock CBatchingClock;
+
+// The number of the latency histogram buckets: the last one is for the latencies over 2^31 microseconds
+static const int LatencyBucketCount = 32;
+
+// A request waiting in the queue
+struct CDnnBatchingRequest {
+	const CObjectArray<CDnnBlob>* Inputs;
+	CObjectArray<CDnnBlob>* Outputs;
+	int BatchWidth;
+	CBatchingClock::time_point StartTime;
+	bool IsDone;
+	std::exception_ptr Error;
+
+	CDnnBatchingRequest( const CObjectArray<CDnnBlob>& inputs, CObjectArray<CDnnBlob>& outputs ) :
+		Inputs( &inputs ), Outputs( &outputs ), BatchWidth( inputs[0]->GetBatchWidth() ),
+		StartTime( CBatchingClock::now() ), IsDone( false ) {}
+};
+
+// The queue of the requests processed by the worker thread
+class CDnnBatchingQueue {
+public:
+	CDnnBatchingQueue( CDnn& dnn, const CArray<CString>& sources, const CArray<CString>& sinks,
+		int maxBatchSize, int maxWait );
+	~CDnnBatchingQueue();
+
+	// Adds the request to the queue and waits until it is processed
+	void Process( CDnnBatchingRequest& request );
+
+	// The number of the inputs of a request
+	int GetSourceCount() const { return sources.Size(); }
+
+	void GetLatencyHistogram( CArray<int>& histogram ) const;
+	int GetRequestCount() const;
+	int GetBatchCount() const;
+	void ResetStatistics();
+
+private:
+	CDnn& dnn;
+	CObjectArray<CSourceLayer> sources;
+	CObjectArray<CSinkLayer> sinks;
+	// The merged inputs of the last batch, reused if the size is the same
+	CObjectArray<CDnnBlob> mergedInputs;
+	const int maxBatchSize;
+	const std::chrono::microseconds maxWait;
+
+	mutable std::mutex lock;
+	std::condition_variable requestAdded;
+	std::condition_variable requestsDone;
+	std::deque<CDnnBatchingRequest*> requests;
+	bool isStopping;
+	std::thread worker;
+
+	int histogram[LatencyBucketCount];
+	int requestCount;
+	int batchCount;
+
+	void threadMain();
+	void runBatch( const CArray<CDnnBatchingRequest*>& batch );
+	void setBatchInputs( const CArray<CDnnBatchingRequest*>& batch, int batchWidth );
+	void getBatchOutputs( const CArray<CDnnBatchingRequest*>& batch, int batchWidth );
+};
+
+CDnnBatchingQueue::CDnnBatchingQueue( CDnn& _dnn, const CArray<CString>& sourceNames,
+		const CArray<CString>& sinkNames, int _maxBatchSize, int _maxWait ) :
+	dnn( _dnn ),
+	maxBatchSize( _maxBatchSize ),
+	maxWait( _maxWait ),
+	isStopping( false ),
+	requestCount( 0 ),
+	batchCount( 0 )
+{
+	for( int i = 0; i < sourceNames.Size(); ++i ) {
+		sources.Add( CheckCast<CSourceLayer>( dnn.GetLayer( sourceNames[i] ) ) );
+	}
+	mergedInputs.SetSize( sources.Size() );
+	for( int i = 0; i < sinkNames.Size(); ++i ) {
+		sinks.Add( CheckCast<CSinkLayer>( dnn.GetLayer( sinkNames[i] ) ) );
+	}
+	ResetStatistics();
+	worker = std::thread( &CDnnBatchingQueue::threadMain, this );
+}
+
+CDnnBatchingQueue::~CDnnBatchingQueue()
+{
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		isStopping = true;
+	}
+	requestAdded.notify_all();
+	worker.join();
+}
+
+void CDnnBatchingQueue::Process( CDnnBatchingRequest& request )
+{
+	std::unique_lock<std::mutex> guard( lock );
+	requests.push_back( &request );
+	requestAdded.notify_one();
+	requestsDone.wait( guard, [&request]() { return request.IsDone; } );
+}
+
+void CDnnBatchingQueue::GetLatencyHistogram( CArray<int>& result ) const
+{
+	std::lock_guard<std::mutex> guard( lock );
+	result.SetSize( LatencyBucketCount );
+	for( int i = 0; i < LatencyBucketCount; ++i ) {
+		result[i] = histogram[i];
+	}
+}
+
+int CDnnBatchingQueue::GetRequestCount() const
+{
+	std::lock_guard<std::mutex> guard( lock );
+	return requestCount;
+}
+
+int CDnnBatchingQueue::GetBatchCount() const
+{
+	std::lock_guard<std::mutex> guard( lock );
+	return batchCount;
+}
+
+void CDnnBatchingQueue::ResetStatistics()
+{
+	std::lock_guard<std::mutex> guard( lock );
+	for( int i = 0; i < LatencyBucketCount; ++i ) {
+		histogram[i] = 0;
+	}
+	requestCount = 0;
+	batchCount = 0;
+}
+
+void CDnnBatchingQueue::threadMain()
+{
+	CArray<CDnnBatchingRequest*> batch;
+	std::unique_lock<std::mutex> guard( lock );
+	while( true ) {
+		requestAdded.wait( guard, [this]() { return isStopping || !requests.empty(); } );
+		if( isStopping ) {
+			return;
+		}
+
+		// Wait for more requests until the batch is full or the oldest request has waited long enough
+		const CBatchingClock::time_point deadline = requests.front()->StartTime + maxWait;
+		while( !isStopping && CBatchingClock::now() < deadline ) {
+			int queuedBatchWidth = 0;
+			for( size_t i = 0; i < requests.size(); ++i ) {
+				queuedBatchWidth += requests[i]->BatchWidth;
+			}
+			if( queuedBatchWidth >= maxBatchSize ) {
+				break;
+			}
+			requestAdded.wait_until( guard, deadline );
+		}
+
+		// A request larger than maxBatchSize is processed alone
+		int batchWidth = 0;
+		batch.DeleteAll();
+		while( !requests.empty() && ( batch.IsEmpty() || batchWidth + requests.front()->BatchWidth <= maxBatchSize ) ) {
+			batch.Add( requests.front() );
+			batchWidth += requests.front()->BatchWidth;
+			requests.pop_front();
+		}
+
+		guard.unlock();
+		std::exception_ptr error;
+		try {
+			runBatch( batch );
+		} catch( ... ) {
+			error = std::current_exception();
+		}
+		const CBatchingClock::time_point finishTime = CBatchingClock::now();
+		guard.lock();
+
+		for( int i = 0; i < batch.Size(); ++i ) {
+			const long long latency = std::chrono::duration_cast<std::chrono::microseconds>(
+				finishTime - batch[i]->StartTime ).count();
+			int bucket = 0;
+			while( bucket < LatencyBucketCount - 1 && ( 2LL << bucket ) <= latency ) {
+				bucket++;
+			}
+			histogram[bucket]++;
+			batch[i]->Error = error;
+			batch[i]->IsDone = true;
+		}
+		requestCount += batch.Size();
+		batchCount++;
+		requestsDone.notify_all();
+	}
+}
+
+void CDnnBatchingQueue::runBatch( const CArray<CDnnBatchingRequest*>& batch )
+{
+	int batchWidth = 0;
+	for( int i = 0; i < batch.Size(); ++i ) {
+		batchWidth += batch[i]->BatchWidth;
+	}
+	setBatchInputs( batch, batchWidth );
+	dnn.RunOnce();
+	getBatchOutputs( batch, batchWidth );
+}
+
+// Merges the inputs of the requests and sets them to the source layers
+void CDnnBatchingQueue::setBatchInputs( const CArray<CDnnBatchingRequest*>& batch, int batchWidth )
+{
+	for( int i = 0; i < sources.Size(); ++i ) {
+		if( batch.Size() == 1 ) {
+			sources[i]->SetBlob( ( *batch[0]->Inputs )[i] );
+			continue;
+		}
+		CObjectArray<CDnnBlob> inputs;
+		for( int j = 0; j < batch.Size(); ++j ) {
+			inputs.Add( ( *batch[j]->Inputs )[i] );
+		}
+		CBlobDesc desc = inputs[0]->GetDesc();
+		desc.SetDimSize( BD_BatchWidth, batchWidth );
+		if( mergedInputs[i] == nullptr || !mergedInputs[i]->GetDesc().HasEqualDimensions( desc )
+			|| mergedInputs[i]->GetDataType() != desc.GetDataType() )
+		{
+			mergedInputs[i] = CDnnBlob::CreateBlob( dnn.GetMathEngine(), desc.GetDataType(), desc );
+		}
+		CDnnBlob::MergeByBatchWidth( dnn.GetMathEngine(), inputs, mergedInputs[i] );
+		sources[i]->SetBlob( mergedInputs[i] );
+	}
+}
+
+// Splits the outputs of the sink layers between the requests
+void CDnnBatchingQueue::getBatchOutputs( const CArray<CDnnBatchingRequest*>& batch, int batchWidth )
+{
+	for( int i = 0; i < batch.Size(); ++i ) {
+		batch[i]->Outputs->SetSize( sinks.Size() );
+	}
+	for( int i = 0; i < sinks.Size(); ++i ) {
+		CPtr<CDnnBlob> output = sinks[i]->GetBlob();
+		NeoAssert( output->GetBatchWidth() == batchWidth );
+		CObjectArray<CDnnBlob> outputs;
+		for( int j = 0; j < batch.Size(); ++j ) {
+			CBlobDesc desc = output->GetDesc();
+			desc.SetDimSize( BD_BatchWidth, batch[j]->BatchWidth );
+			outputs.Add( CDnnBlob::CreateBlob( dnn.GetMathEngine(), desc.GetDataType(), desc ) );
+			( *batch[j]->Outputs )[i] = outputs.Last();
+		}
+		if( batch.Size() == 1 ) {
+			outputs[0]->CopyFrom( output );
+		} else {
+			CDnnBlob::SplitByBatchWidth( dnn.GetMathEngine(), output, outputs );
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+CDnnBatchingRunner::CDnnBatchingRunner( CDnn& dnn, const CArray<CString>& sources, const CArray<CString>& sinks,
+		int _maxBatchSize, int maxWaitMicroseconds ) :
+	maxBatchSize( _maxBatchSize ),
+	maxWait( maxWaitMicroseconds ),
+	queue( nullptr )
+{
+	NeoAssert( maxBatchSize > 0 );
+	NeoAssert( maxWait >= 0 );
+	NeoAssert( !sources.IsEmpty() );
+	queue = FINE_DEBUG_NEW CDnnBatchingQueue( dnn, sources, sinks, maxBatchSize, maxWait );
+}
+
+CDnnBatchingRunner::~CDnnBatchingRunner()
+{
+	delete queue;
+}
+
+void CDnnBatchingRunner::Run( const CObjectArray<CDnnBlob>& inputs, CObjectArray<CDnnBlob>& outputs )
+{
+	NeoAssert( !inputs.IsEmpty() );
+	NeoAssert( inputs.Size() == queue->GetSourceCount() );
+	for( int i = 1; i < inputs.Size(); ++i ) {
+		NeoAssert( inputs[i]->GetBatchWidth() == inputs[0]->GetBatchWidth() );
+	}
+
+	CDnnBatchingRequest request( inputs, outputs );
+	queue->Process( request );
+	if( request.Error != nullptr ) {
+		std::rethrow_exception( request.Error );
+	}
+}
+
+void CDnnBatchingRunner::GetLatencyHistogram( CArray<int>& histogram ) const
+{
+	queue->GetLatencyHistogram( histogram );
+}
+
+int CDnnBatchingRunner::GetLatencyPercentile( double percentile ) const
+{
+	NeoAssert( 0 <= percentile && percentile <= 100 );
+	CArray<int> histogram;
+	queue->GetLatencyHistogram( histogram );
+	int total = 0;
+	for( int i = 0; i < histogram.Size(); ++i ) {
+		total += histogram[i];
+	}
+	if( total == 0 ) {
+		return 0;
+	}
+
+	const double rank = percentile / 100 * total;
+	int count = 0;
+	for( int i = 0; i < histogram.Size() - 1; ++i ) {
+		count += histogram[i];
+		if( count >= rank && count > 0 ) {
+			return static_cast<int>( ( 2LL << i ) - 1 );
+		}
+	}
+	return INT_MAX;
+}
+
+int CDnnBatchingRunner::GetRequestCount() const
+{
+	return queue->GetRequestCount();
+}
+
+int CDnnBatchingRunner::GetBatchCount() const
+{
+	return queue->GetBatchCount();
+}
+
+void CDnnBatchingRunner::ResetStatistics()
+{
+	queue->ResetStatistics();
+}
+
+} // namespace NeoML
@@ -19,6 +19,7 @@ limitations under the License.
 #include <NeoML/Dnn/DnnBlob.h>
 #include <NeoMathEngine/NeoMathEngine.h>
 #include <NeoML/Dnn/Layers/LossLayer.h>
+#include <NeoML/MappedFile.h>
 
 namespace NeoML {
 
@@ -519,13 +520,98 @@ static void writeRawData( IMathEngine& mathEngine, const int size, const CTypedM
 	}
 }
 
+// Writes the data into archive so that it starts at the position aligned to alignment bytes
+template<typename T>
+static void writeAlignedRawData( IMathEngine& mathEngine, const int size, const CTypedMemoryHandle<T>& handle,
+	CArchive& archive, int alignment )
+{
+	archive << static_cast<unsigned int>( size );
+
+	// The padding size is stored before the padding
+	const int padding = static_cast<int>( ( alignment - ( archive.GetPosition() + 1 ) % alignment ) % alignment );
+	archive << static_cast<unsigned char>( padding );
+	for( int i = 0; i < padding; i++ ) {
+		archive << static_cast<unsigned char>( 0 );
+	}
+
+	if( size > 0 ) {
+		void* ptr = mathEngine.GetBuffer( handle, 0, size * sizeof(T), true );
+		archive.Write( ptr, size * sizeof(T) );
+		mathEngine.ReleaseBuffer( handle, ptr, false );
+	}
+}
+
+// The memory handle for the data that is not allocated by the math engine
+class CExternalMemoryHandle : public CMemoryHandle {
+public:
+	CExternalMemoryHandle( IMathEngine* mathEngine, const void* object ) :
+		CMemoryHandle( mathEngine, object, 0 )
+	{
+	}
+};
+
+static thread_local bool isMappableLayoutEnabled = false;
+
+CDnnBlobMappableLayout::CDnnBlobMappableLayout() :
+	wasEnabled( isMappableLayoutEnabled )
+{
+	isMappableLayoutEnabled = true;
+}
+
+CDnnBlobMappableLayout::~CDnnBlobMappableLayout()
+{
+	isMappableLayoutEnabled = wasEnabled;
+}
+
+bool CDnnBlobMappableLayout::IsEnabled()
+{
+	return isMappableLayoutEnabled;
+}
+
 static const int BlobVersion = 2000;
+// The version with the data aligned in the archive (the mappable layout)
+static const int BlobMappableVersion = 2001;
+// The alignment of the blob data in the mappable layout, in bytes
+static const int MappableBlobAlignment = 64;
+
+// Binds the uninitialized blob to the data in the mapped file instead of allocating memory and copying the data
+// The archive must be positioned at the beginning of the blob data
+// Returns false if the data can't be used directly; the archive position stays the same in this case
+bool CDnnBlob::bindMappedData( CArchive& archive, const CBlobDesc& mappedDesc )
+{
+	NeoAssert( desc.GetDataType() == CT_Invalid );
+	const int dataSize = mappedDesc.BlobSize()
+		* static_cast<int>( mappedDesc.GetDataType() == CT_Float ? sizeof( float ) : sizeof( int ) );
+	if( mathEngine.GetType() != MET_Cpu || dataSize == 0 ) {
+		return false;
+	}
+	CMappedFile* file = dynamic_cast<CMappedFile*>( archive.GetFile() );
+	if( file == nullptr ) {
+		return false;
+	}
+
+	// Return the data read ahead by the archive so that the file position is the position of the blob data
+	archive.Flush();
+	const __int64 offset = file->GetPosition();
+	const char* ptr = static_cast<const char*>( file->GetData() ) + offset;
+	if( offset + dataSize > file->GetLength() || reinterpret_cast<size_t>( ptr ) % MappableBlobAlignment != 0 ) {
+		return false;
+	}
+	archive.Skip( dataSize );
+
+	desc = mappedDesc;
+	data = CExternalMemoryHandle( &mathEngine, ptr );
+	dataOwned = false;
+	dataHolder = file->GetMapping();
+	return true;
+}
 
 void CDnnBlob::Serialize( CArchive& archive )
 {
 	NeoAssert( parent == 0 ); // a blob that links to another may not be serialized
 
-	archive.SerializeVersion( BlobVersion, CDnn::ArchiveMinSupportedVersion );
+	const int version = archive.SerializeVersion( archive.IsStoring() && !CDnnBlobMappableLayout::IsEnabled()
+		? BlobVersion : BlobMappableVersion, CDnn::ArchiveMinSupportedVersion );
 
 	if( archive.IsStoring() ) {
 		archive << static_cast<int>( GetDataType() );
@@ -536,10 +622,18 @@ void CDnnBlob::Serialize( CArchive& archive )
 
 		switch(GetDataType()) {
 			case CT_Float:
-				writeRawData( mathEngine, desc.BlobSize(), GetData<float>(), archive );
+				if( version >= BlobMappableVersion ) {
+					writeAlignedRawData( mathEngine, desc.BlobSize(), GetData<float>(), archive, MappableBlobAlignment );
+				} else {
+					writeRawData( mathEngine, desc.BlobSize(), GetData<float>(), archive );
+				}
 				break;
 			case CT_Int:
-				writeRawData( mathEngine, desc.BlobSize(), GetData<int>(), archive );
+				if( version >= BlobMappableVersion ) {
+					writeAlignedRawData( mathEngine, desc.BlobSize(), GetData<int>(), archive, MappableBlobAlignment );
+				} else {
+					writeRawData( mathEngine, desc.BlobSize(), GetData<int>(), archive );
+				}
 				break;
 			default:
 				NeoAssert( false );
@@ -553,6 +647,39 @@ void CDnnBlob::Serialize( CArchive& archive )
 		archive >> intPack;
 		int batchLength, batchWidth, listSize, height, width, depth, channels;
 		archive >> batchLength >> batchWidth >> listSize >> height >> width >> depth >> channels;
+
+		if( version >= BlobMappableVersion ) {
+			check( type == CT_Float || type == CT_Int, ERR_BAD_ARCHIVE, archive.Name() );
+			CBlobDesc mappedDesc( type );
+			mappedDesc.SetDimSize( BD_BatchLength, batchLength );
+			mappedDesc.SetDimSize( BD_BatchWidth, batchWidth );
+			mappedDesc.SetDimSize( BD_ListSize, listSize );
+			mappedDesc.SetDimSize( BD_Height, height );
+			mappedDesc.SetDimSize( BD_Width, width );
+			mappedDesc.SetDimSize( BD_Depth, depth );
+			mappedDesc.SetDimSize( BD_Channels, channels );
+
+			unsigned int size = 0;
+			archive >> size;
+			check( static_cast<int>( size ) == mappedDesc.BlobSize(), ERR_BAD_ARCHIVE, archive.Name() );
+			unsigned char padding = 0;
+			archive >> padding;
+			check( padding < MappableBlobAlignment, ERR_BAD_ARCHIVE, archive.Name() );
+			archive.Skip( padding );
+
+			if( !bindMappedData( archive, mappedDesc ) ) {
+				initializeBlob( type, batchLength, batchWidth, listSize, height, width, depth, channels );
+				const int dataSize = desc.BlobSize() * static_cast<int>( type == CT_Float ? sizeof( float ) : sizeof( int ) );
+				if( dataSize > 0 ) {
+					void* ptr = mathEngine.GetBuffer( data, 0, dataSize, false );
+					archive.Read( ptr, dataSize );
+					mathEngine.ReleaseBuffer( data, ptr, true );
+				}
+			}
+			parentPos = 0;
+			return;
+		}
+
 		initializeBlob(type, batchLength, batchWidth, listSize, height, width, depth, channels);
 
 		switch( type ) {
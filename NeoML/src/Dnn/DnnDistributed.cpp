@@ -16,12 +16,157 @@ limitations under the License.
 #include <thread>
 #include <vector>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <NeoMathEngine/NeoMathEngine.h>
 #include <NeoML/Dnn/DnnDistributed.h>
 
+#if FINE_PLATFORM( FINE_LINUX )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace NeoML {
 
-void CDistributedTraining::initialize( CArchive& archive, int count )
+// The persistent threads that run the distributed models, one thread per model
+class CDistributedWorkers {
+public:
+    CDistributedWorkers( int count, int coresPerWorker, bool pinThreads );
+    ~CDistributedWorkers();
+
+    // Starts task( i ) on the i-th thread for all threads
+    void Start( const std::function<void( int )>& task );
+    // Waits until all threads finish the task; rethrows the first exception thrown by the task
+    void Wait();
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable taskStarted;
+    std::condition_variable taskFinished;
+    std::function<void( int )> task;
+    int generation; // the number of the current task
+    int runningCount; // the number of threads still running the current task
+    bool isStopping;
+    std::exception_ptr error;
+
+    void threadMain( int index, int firstCore, int coreCount );
+
+    CDistributedWorkers( const CDistributedWorkers& );
+    CDistributedWorkers& operator=( const CDistributedWorkers& );
+};
+
+// Binds the current thread to the cores [firstCore, firstCore + coreCount)
+static void pinCurrentThread( int firstCore, int coreCount )
+{
+#if FINE_PLATFORM( FINE_LINUX )
+    const int hardwareCores = static_cast<int>( std::thread::hardware_concurrency() );
+    if( hardwareCores <= 0 ) {
+        return;
+    }
+    cpu_set_t cores;
+    CPU_ZERO( &cores );
+    for( int i = 0; i < coreCount; i++ ) {
+        CPU_SET( ( firstCore + i ) % hardwareCores, &cores );
+    }
+    pthread_setaffinity_np( pthread_self(), sizeof( cores ), &cores );
+#else
+    ( void ) firstCore;
+    ( void ) coreCount;
+#endif
+}
+
+CDistributedWorkers::CDistributedWorkers( int count, int coresPerWorker, bool pinThreads ) :
+    generation( 0 ),
+    runningCount( 0 ),
+    isStopping( false )
+{
+    for( int i = 0; i < count; i++ ) {
+        threads.push_back( std::thread( &CDistributedWorkers::threadMain, this, i,
+            i * coresPerWorker, pinThreads ? coresPerWorker : 0 ) );
+    }
+}
+
+CDistributedWorkers::~CDistributedWorkers()
+{
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        taskFinished.wait( guard, [this] { return runningCount == 0; } );
+        isStopping = true;
+    }
+    taskStarted.notify_all();
+    for( size_t i = 0; i < threads.size(); i++ ) {
+        threads[i].join();
+    }
+}
+
+void CDistributedWorkers::Start( const std::function<void( int )>& _task )
+{
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        NeoAssert( runningCount == 0 );
+        task = _task;
+        error = nullptr;
+        runningCount = static_cast<int>( threads.size() );
+        generation++;
+    }
+    taskStarted.notify_all();
+}
+
+void CDistributedWorkers::Wait()
+{
+    std::exception_ptr taskError;
+    {
+        std::unique_lock<std::mutex> guard( lock );
+        taskFinished.wait( guard, [this] { return runningCount == 0; } );
+        std::swap( taskError, error );
+    }
+    if( taskError != nullptr ) {
+        std::rethrow_exception( taskError );
+    }
+}
+
+void CDistributedWorkers::threadMain( int index, int firstCore, int coreCount )
+{
+    if( coreCount > 0 ) {
+        pinCurrentThread( firstCore, coreCount );
+    }
+
+    int lastGeneration = 0;
+    while( true ) {
+        {
+            std::unique_lock<std::mutex> guard( lock );
+            taskStarted.wait( guard, [&] { return isStopping || generation != lastGeneration; } );
+            if( isStopping ) {
+                return;
+            }
+            lastGeneration = generation;
+        }
+
+        std::exception_ptr taskError;
+        try {
+            task( index );
+        } catch( ... ) {
+            taskError = std::current_exception();
+        }
+
+        {
+            std::unique_lock<std::mutex> guard( lock );
+            if( taskError != nullptr && error == nullptr ) {
+                error = taskError;
+            }
+            runningCount--;
+            if( runningCount == 0 ) {
+                taskFinished.notify_all();
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CDistributedTraining::initialize( CArchive& archive, int count, int threadCount, bool pinThreads )
 {
     for( int i = 0; i < count; i++ ){
         rands.Add( new CRandom( 42 ) );
@@ -30,24 +175,28 @@ void CDistributedTraining::initialize( CArchive& archive, int count )
         archive.Serialize( *cnns[i] );
         archive.Seek( 0, static_cast<CBaseFile::TSeekPosition>( 0 ) );
     }
+    workers = new CDistributedWorkers( count, threadCount, pinThreads );
 }
 
-CDistributedTraining::CDistributedTraining( CArchive& archive, int count )
+CDistributedTraining::CDistributedTraining( CArchive& archive, int count, int threadCount, bool pinThreads ) :
+    workers( nullptr )
 {
     mathEngines.SetSize( count );
-    CreateDistributedCpuMathEngines( mathEngines.GetPtr(), count );
-    initialize( archive, count );
+    CreateDistributedCpuMathEngines( mathEngines.GetPtr(), count, threadCount );
+    initialize( archive, count, threadCount, pinThreads );
 }
 
-CDistributedTraining::CDistributedTraining( CArchive& archive, const CArray<int>& cudaDevs )
+CDistributedTraining::CDistributedTraining( CArchive& archive, const CArray<int>& cudaDevs ) :
+    workers( nullptr )
 {
     mathEngines.SetSize( cudaDevs.Size() );
     CreateDistributedCudaMathEngines( mathEngines.GetPtr(), cudaDevs.Size(), cudaDevs.GetPtr() );
-    initialize( archive, cudaDevs.Size() );
+    initialize( archive, cudaDevs.Size(), 1, false );
 }
 
 CDistributedTraining::~CDistributedTraining()
 {
+    delete workers;
     for( int i = 0; i < cnns.Size(); i++ ){
         delete cnns[i];
         delete rands[i];
@@ -55,22 +204,42 @@ CDistributedTraining::~CDistributedTraining()
     }
 }
 
-void CDistributedTraining::RunAndLearnOnce( IDistributedDataset& data )
+void CDistributedTraining::SetSolver( CArchive& archive )
 {
-    std::vector<std::thread> threads;
-    for ( int i = 0; i < cnns.Size(); i++ ) {
-        std::thread t( std::bind(
-            [&]( int thread ){
-                data.SetInputBatch( *cnns[thread], thread );
-                cnns[thread]->RunAndLearnOnce();
-            },  i ) );
-        threads.push_back( std::move( t ) );
+    for( int i = 0; i < cnns.Size(); i++ ){
+        CPtr<CDnnSolver> solver = nullptr;
+        SerializeSolver( archive, *cnns[i], solver );
+        cnns[i]->SetSolver( solver );
+        archive.Seek( 0, static_cast<CBaseFile::TSeekPosition>( 0 ) );
     }
-    for ( int i = 0; i < cnns.Size(); i++ ) {
-        threads[i].join();
+}
+
+void CDistributedTraining::SetAveragingGradients( bool isAveraging )
+{
+    for( int i = 0; i < cnns.Size(); i++ ){
+        cnns[i]->GetSolver()->SetAveragingGradients( isAveraging );
     }
 }
 
+void CDistributedTraining::RunAndLearnOnce( IDistributedDataset& data )
+{
+    StartRunAndLearnOnce( data );
+    Wait();
+}
+
+void CDistributedTraining::StartRunAndLearnOnce( IDistributedDataset& data )
+{
+    workers->Start( [this, &data]( int thread ){
+        data.SetInputBatch( *cnns[thread], thread );
+        cnns[thread]->RunAndLearnOnce();
+    } );
+}
+
+void CDistributedTraining::Wait()
+{
+    workers->Wait();
+}
+
 void CDistributedTraining::GetLastLoss( const CString& layerName, CArray<float>& losses )
 {
     losses.SetSize( cnns.Size() );
@@ -0,0 +1,232 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <Dnn/DnnLayerScheduler.h>
+
+namespace NeoML {
+
+CDnnLayerScheduler::CDnnLayerScheduler( int _threadCount ) :
+	threadCount( max( 1, _threadCount ) ),
+	queues( new CThreadQueue[max( 1, _threadCount )] ),
+	isGraphSet( false ),
+	currentTask( nullptr ),
+	remainingTasks( 0 ),
+	queuedTasks( 0 ),
+	hasError( false ),
+	generation( 0 ),
+	activeThreads( 0 ),
+	isStopping( false )
+{
+	for( int i = 1; i < threadCount; ++i ) {
+		threads.push_back( std::thread( &CDnnLayerScheduler::threadMain, this, i ) );
+	}
+}
+
+CDnnLayerScheduler::~CDnnLayerScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock( stateLock );
+		isStopping = true;
+	}
+	stateChanged.notify_all();
+	for( size_t i = 0; i < threads.size(); ++i ) {
+		threads[i].join();
+	}
+}
+
+void CDnnLayerScheduler::SetGraph( const CArray<CArray<int>>& inputs )
+{
+	const int taskCount = inputs.Size();
+	initialDependencies.assign( taskCount, 0 );
+	consumers.assign( taskCount, std::vector<int>() );
+
+	CArray<int> uniqueInputs;
+	for( int i = 0; i < taskCount; ++i ) {
+		inputs[i].CopyTo( uniqueInputs );
+		uniqueInputs.QuickSort<Ascending<int>>();
+		for( int j = 0; j < uniqueInputs.Size(); ++j ) {
+			if( j > 0 && uniqueInputs[j] == uniqueInputs[j - 1] ) {
+				continue;
+			}
+			NeoAssert( 0 <= uniqueInputs[j] && uniqueInputs[j] < taskCount && uniqueInputs[j] != i );
+			consumers[uniqueInputs[j]].push_back( i );
+			initialDependencies[i]++;
+		}
+	}
+	dependencies.reset( new std::atomic<int>[taskCount] );
+	isGraphSet = true;
+}
+
+void CDnnLayerScheduler::Run( const std::function<void( int )>& task )
+{
+	NeoAssert( isGraphSet );
+	const int taskCount = static_cast<int>( initialDependencies.size() );
+	if( taskCount == 0 ) {
+		return;
+	}
+
+	{
+		// Wait for the threads that may still be leaving the previous run
+		std::unique_lock<std::mutex> lock( stateLock );
+		stateChanged.wait( lock, [this]() { return activeThreads == 0; } );
+
+		currentTask = &task;
+		hasError = false;
+		error = nullptr;
+		queuedTasks = 0;
+		remainingTasks = taskCount;
+		int nextQueue = 0;
+		for( int i = 0; i < taskCount; ++i ) {
+			dependencies[i] = initialDependencies[i];
+			if( initialDependencies[i] == 0 ) {
+				queues[nextQueue].Tasks.push_back( i );
+				queuedTasks++;
+				nextQueue = ( nextQueue + 1 ) % threadCount;
+			}
+		}
+		generation++;
+		activeThreads++;
+	}
+	stateChanged.notify_all();
+
+	processTasks( 0 );
+
+	{
+		std::unique_lock<std::mutex> lock( stateLock );
+		activeThreads--;
+		stateChanged.wait( lock, [this]() { return activeThreads == 0; } );
+		currentTask = nullptr;
+	}
+
+	if( hasError ) {
+		std::rethrow_exception( error );
+	}
+}
+
+void CDnnLayerScheduler::threadMain( int threadIndex )
+{
+	int lastGeneration = 0;
+	while( true ) {
+		{
+			std::unique_lock<std::mutex> lock( stateLock );
+			stateChanged.wait( lock, [this, lastGeneration]() { return isStopping || generation != lastGeneration; } );
+			if( isStopping ) {
+				return;
+			}
+			lastGeneration = generation;
+			activeThreads++;
+		}
+
+		processTasks( threadIndex );
+
+		{
+			std::lock_guard<std::mutex> lock( stateLock );
+			activeThreads--;
+		}
+		stateChanged.notify_all();
+	}
+}
+
+// Processes the tasks until all tasks of the current run are finished
+void CDnnLayerScheduler::processTasks( int threadIndex )
+{
+	while( remainingTasks > 0 ) {
+		int task = NotFound;
+		if( popTask( threadIndex, task ) ) {
+			executeTask( threadIndex, task );
+			continue;
+		}
+		// Nothing to do: wait until a task is queued or the run is finished
+		std::unique_lock<std::mutex> lock( stateLock );
+		stateChanged.wait( lock, [this]() { return queuedTasks > 0 || remainingTasks == 0; } );
+	}
+}
+
+// Takes a task from the thread's own queue (the most recent one, its inputs are likely in cache)
+// or steals the oldest task from another thread
+bool CDnnLayerScheduler::popTask( int threadIndex, int& task )
+{
+	for( int i = 0; i < threadCount; ++i ) {
+		const int queueIndex = ( threadIndex + i ) % threadCount;
+		CThreadQueue& queue = queues[queueIndex];
+		std::lock_guard<std::mutex> lock( queue.Lock );
+		if( queue.Tasks.empty() ) {
+			continue;
+		}
+		if( i == 0 ) {
+			task = queue.Tasks.back();
+			queue.Tasks.pop_back();
+		} else {
+			task = queue.Tasks.front();
+			queue.Tasks.pop_front();
+		}
+		queuedTasks--;
+		return true;
+	}
+	return false;
+}
+
+void CDnnLayerScheduler::pushTask( int threadIndex, int task )
+{
+	{
+		CThreadQueue& queue = queues[threadIndex];
+		std::lock_guard<std::mutex> lock( queue.Lock );
+		queue.Tasks.push_back( task );
+	}
+	queuedTasks++;
+	notifyAll();
+}
+
+void CDnnLayerScheduler::executeTask( int threadIndex, int task )
+{
+	// After an error the remaining tasks are only marked as finished
+	if( !hasError ) {
+		try {
+			( *currentTask )( task );
+		} catch( ... ) {
+			std::lock_guard<std::mutex> lock( errorLock );
+			if( !hasError ) {
+				error = std::current_exception();
+				hasError = true;
+			}
+		}
+	}
+
+	const std::vector<int>& taskConsumers = consumers[task];
+	for( size_t i = 0; i < taskConsumers.size(); ++i ) {
+		if( --dependencies[taskConsumers[i]] == 0 ) {
+			pushTask( threadIndex, taskConsumers[i] );
+		}
+	}
+
+	if( --remainingTasks == 0 ) {
+		notifyAll();
+	}
+}
+
+// Wakes up the waiting threads
+// Locking the mutex guarantees that a thread is either already waiting or will see the changed counters
+void CDnnLayerScheduler::notifyAll()
+{
+	{
+		std::lock_guard<std::mutex> lock( stateLock );
+	}
+	stateChanged.notify_all();
+}
+
+} // namespace NeoML
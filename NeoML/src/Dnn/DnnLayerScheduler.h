@@ -0,0 +1,98 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NeoML {
+
+// Runs a graph of dependent tasks (the layers of a network) on a pool of persistent threads
+// A task is started when all the tasks it depends on are finished
+// Every thread has its own queue of ready tasks; an idle thread steals tasks from the other queues
+// The thread that calls Run takes part in processing, so the pool has ( threadCount - 1 ) additional threads
+class CDnnLayerScheduler {
+public:
+	explicit CDnnLayerScheduler( int threadCount );
+	~CDnnLayerScheduler();
+
+	int GetThreadCount() const { return threadCount; }
+
+	// Sets the dependency graph
+	// inputs[i] contains the indices of the tasks that must be finished before the i-th task is started
+	// The graph must be acyclic; repeated indices are allowed
+	void SetGraph( const CArray<CArray<int>>& inputs );
+	// Indicates if the graph has been set
+	bool HasGraph() const { return isGraphSet; }
+	// Resets the graph (e.g. when the network is rebuilt)
+	void ResetGraph() { isGraphSet = false; }
+
+	// Runs all tasks of the graph, calling task( i ) for the i-th task
+	// Returns when all tasks are finished; rethrows the first exception thrown by a task
+	void Run( const std::function<void( int )>& task );
+
+private:
+	// The queue of the tasks ready to be run by one thread
+	struct CThreadQueue {
+		std::mutex Lock;
+		std::deque<int> Tasks;
+	};
+
+	const int threadCount;
+	std::vector<std::thread> threads;
+	std::unique_ptr<CThreadQueue[]> queues;
+
+	// The graph
+	bool isGraphSet;
+	std::vector<int> initialDependencies; // the number of unique inputs of each task
+	std::vector<std::vector<int>> consumers; // the tasks depending on each task
+
+	// The state of the current run
+	const std::function<void( int )>* currentTask;
+	std::unique_ptr<std::atomic<int>[]> dependencies;
+	std::atomic<int> remainingTasks;
+	std::atomic<int> queuedTasks;
+	std::atomic<bool> hasError;
+	std::exception_ptr error;
+	std::mutex errorLock;
+
+	// The pool state
+	std::mutex stateLock;
+	std::condition_variable stateChanged;
+	int generation; // the number of the current run
+	int activeThreads; // the number of threads processing the tasks of a run
+	bool isStopping;
+
+	void threadMain( int threadIndex );
+	void processTasks( int threadIndex );
+	bool popTask( int threadIndex, int& task );
+	void pushTask( int threadIndex, int task );
+	void executeTask( int threadIndex, int task );
+	void notifyAll();
+
+	CDnnLayerScheduler( const CDnnLayerScheduler& );
+	CDnnLayerScheduler& operator=( const CDnnLayerScheduler& );
+};
+
+} // namespace NeoML
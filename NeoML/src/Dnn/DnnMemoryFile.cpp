@@ -0,0 +1,88 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <Dnn/DnnMemoryFile.h>
+
+namespace NeoML {
+
+CDnnMemoryFile::CDnnMemoryFile() :
+	position( 0 )
+{
+}
+
+int CDnnMemoryFile::Read( void* ptr, int bytesCount )
+{
+	NeoAssert( bytesCount >= 0 );
+	const int size = min( buffer.Size() - position, bytesCount );
+	if( size <= 0 ) {
+		return 0;
+	}
+	::memcpy( ptr, buffer.GetPtr() + position, size );
+	position += size;
+	return size;
+}
+
+void CDnnMemoryFile::Write( const void* ptr, int bytesCount )
+{
+	NeoAssert( bytesCount >= 0 );
+	if( bytesCount == 0 ) {
+		return;
+	}
+	NeoAssert( bytesCount <= INT_MAX - position );
+	if( position + bytesCount > buffer.Size() ) {
+		buffer.SetSize( position + bytesCount );
+	}
+	::memcpy( buffer.GetPtr() + position, ptr, bytesCount );
+	position += bytesCount;
+}
+
+__int64 CDnnMemoryFile::Seek( __int64 offset, TSeekPosition from )
+{
+	__int64 newPosition = offset;
+	switch( from ) {
+		case begin:
+			break;
+		case current:
+			newPosition += position;
+			break;
+		case end:
+			newPosition += buffer.Size();
+			break;
+		default:
+			NeoAssert( false );
+	}
+	NeoAssert( 0 <= newPosition && newPosition <= INT_MAX );
+	position = static_cast<int>( newPosition );
+	return position;
+}
+
+void CDnnMemoryFile::SetLength( __int64 newLength )
+{
+	NeoAssert( 0 <= newLength && newLength <= INT_MAX );
+	buffer.SetSize( static_cast<int>( newLength ) );
+	position = min( position, buffer.Size() );
+}
+
+void CDnnMemoryFile::Close()
+{
+	buffer.DeleteAll();
+	buffer.FreeBuffer();
+	position = 0;
+}
+
+} // namespace NeoML
@@ -0,0 +1,45 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+
+namespace NeoML {
+
+// A binary file in memory, used to copy the objects through serialization
+// The file is opened for both reading and writing; Close empties it
+class CDnnMemoryFile : public CBaseFile {
+public:
+	CDnnMemoryFile();
+
+	// CBaseFile methods
+	const char* GetFileName() const override { return "Memory file."; }
+	int Read( void* ptr, int bytesCount ) override;
+	void Write( const void* ptr, int bytesCount ) override;
+	__int64 GetPosition() const override { return position; }
+	__int64 Seek( __int64 offset, TSeekPosition from ) override;
+	void SetLength( __int64 newLength ) override;
+	__int64 GetLength() const override { return buffer.Size(); }
+	void Abort() override { Close(); }
+	void Flush() override {}
+	void Close() override;
+
+private:
+	CArray<char> buffer;
+	int position;
+};
+
+} // namespace NeoML
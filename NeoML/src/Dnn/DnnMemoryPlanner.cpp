@@ -0,0 +1,230 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <Dnn/DnnMemoryPlanner.h>
+#include <NeoML/Dnn/Layers/BaseInPlaceLayer.h>
+
+namespace NeoML {
+
+// The alignment of the blobs in the memory block, in elements (64 bytes)
+static const int PlannedBlobAlignment = 16;
+
+// The blob that occupies a part of the memory block
+class CPlannedBlob : public CDnnBlob {
+public:
+	CPlannedBlob( CDnnBlob* _memoryBlock, const CBlobDesc& desc, int offset ) :
+		CDnnBlob( _memoryBlock->GetMathEngine(), desc, _memoryBlock->GetData() + offset, false ),
+		memoryBlock( _memoryBlock )
+	{
+	}
+
+private:
+	// The memory block is kept while any of its blobs is used
+	CPtr<CDnnBlob> memoryBlock;
+};
+
+// Sorts the intervals by size descending, then by start
+class CIntervalPlacementOrder {
+public:
+	template<class T>
+	bool Predicate( const T& first, const T& second ) const
+		{ return first.Size > second.Size || ( first.Size == second.Size && first.Start < second.Start ); }
+	template<class T>
+	bool IsEqual( const T& first, const T& second ) const
+		{ return first.Size == second.Size && first.Start == second.Start; }
+	template<class T>
+	void Swap( T& first, T& second ) const { std::swap( first, second ); }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+
+CDnnMemoryPlanner::CDnnMemoryPlanner( IMathEngine& _mathEngine ) :
+	mathEngine( _mathEngine )
+{
+}
+
+bool CDnnMemoryPlanner::IsValid() const
+{
+	if( memoryBlock == nullptr ) {
+		return false;
+	}
+	for( int i = 0; i < plannedOutputs.Size(); ++i ) {
+		const CPlannedOutput& output = plannedOutputs[i];
+		if( output.Layer->outputBlobs.Size() <= output.OutputNumber
+			|| output.Layer->outputBlobs[output.OutputNumber] != output.Blob )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void CDnnMemoryPlanner::Plan( const CArray<CBaseLayer*>& sinkLayers )
+{
+	// Free the previous memory block before allocating the new one
+	Reset();
+
+	// The layers in the order of CDnn::runOnce
+	CMap<const CBaseLayer*, int> steps;
+	CArray<CBaseLayer*> order;
+	for( int i = 0; i < sinkLayers.Size(); ++i ) {
+		addToOrder( sinkLayers[i], steps, order );
+	}
+
+	// The outputs of each layer; the aliased outputs of the in-place layers point to the intervals of their inputs
+	CArray<CInterval> intervals;
+	CArray<CArray<int>> layerIntervals;
+	layerIntervals.SetSize( order.Size() );
+	for( int step = 0; step < order.Size(); ++step ) {
+		CBaseLayer* layer = order[step];
+		CArray<int>& outputIntervals = layerIntervals[step];
+		outputIntervals.Add( NotFound, layer->GetOutputCount() );
+
+		if( isOutputAliased( layer ) ) {
+			for( int i = 0; i < layer->GetInputCount(); ++i ) {
+				const CBaseLayer* inputLayer = layer->GetInputLayer( i );
+				outputIntervals[i] = layerIntervals[steps.Get( inputLayer )][layer->inputLinks[i].OutputNumber];
+			}
+		} else if( isOutputPlanned( layer ) ) {
+			for( int i = 0; i < layer->GetOutputCount(); ++i ) {
+				CInterval interval;
+				interval.Layer = layer;
+				interval.OutputNumber = i;
+				interval.Size = CeilTo( layer->outputDescs[i].BlobSize(), PlannedBlobAlignment );
+				interval.Start = step;
+				interval.Finish = step;
+				interval.Offset = 0;
+				outputIntervals[i] = intervals.Size();
+				intervals.Add( interval );
+			}
+		}
+
+		// Extend the lifetimes of the inputs up to this layer
+		// The sinks and the composite layers may keep references to their inputs after the run
+		const int finish = ( layer->GetOutputCount() == 0 || layer->isComposite() ) ? order.Size() : step;
+		for( int i = 0; i < layer->GetInputCount(); ++i ) {
+			const CBaseLayer* inputLayer = layer->GetInputLayer( i );
+			const int inputInterval = layerIntervals[steps.Get( inputLayer )][layer->inputLinks[i].OutputNumber];
+			if( inputInterval != NotFound ) {
+				intervals[inputInterval].Finish = max( intervals[inputInterval].Finish, finish );
+			}
+		}
+	}
+
+	if( intervals.IsEmpty() ) {
+		return;
+	}
+
+	assignOffsets( intervals );
+	int blockSize = 0;
+	for( int i = 0; i < intervals.Size(); ++i ) {
+		blockSize = max( blockSize, intervals[i].Offset + intervals[i].Size );
+	}
+	memoryBlock = CDnnBlob::CreateVector( mathEngine, CT_Float, blockSize );
+
+	plannedOutputs.SetBufferSize( intervals.Size() );
+	for( int i = 0; i < intervals.Size(); ++i ) {
+		const CInterval& interval = intervals[i];
+		CPlannedOutput& output = plannedOutputs.Append();
+		output.Layer = interval.Layer;
+		output.OutputNumber = interval.OutputNumber;
+		output.Blob = FINE_DEBUG_NEW CPlannedBlob( memoryBlock, interval.Layer->outputDescs[interval.OutputNumber],
+			interval.Offset );
+		interval.Layer->outputBlobs[interval.OutputNumber] = output.Blob;
+	}
+}
+
+void CDnnMemoryPlanner::Reset()
+{
+	for( int i = 0; i < plannedOutputs.Size(); ++i ) {
+		CPlannedOutput& output = plannedOutputs[i];
+		if( output.Layer->outputBlobs.Size() > output.OutputNumber
+			&& output.Layer->outputBlobs[output.OutputNumber] == output.Blob )
+		{
+			output.Layer->outputBlobs[output.OutputNumber] = nullptr;
+		}
+	}
+	plannedOutputs.DeleteAll();
+	memoryBlock = nullptr;
+}
+
+size_t CDnnMemoryPlanner::GetPlannedSize() const
+{
+	return memoryBlock == nullptr ? 0 : memoryBlock->GetDataSize() * sizeof( float );
+}
+
+// Adds the layer to the execution order after all its inputs
+void CDnnMemoryPlanner::addToOrder( CBaseLayer* layer, CMap<const CBaseLayer*, int>& steps, CArray<CBaseLayer*>& order )
+{
+	if( steps.Has( layer ) ) {
+		return;
+	}
+	for( int i = 0; i < layer->GetInputCount(); ++i ) {
+		addToOrder( layer->GetInputLayer( i ), steps, order );
+	}
+	steps.Add( layer, order.Size() );
+	order.Add( layer );
+}
+
+// Indicates if the outputs of the layer are allocated by CBaseLayer::AllocateOutputBlobs
+bool CDnnMemoryPlanner::isOutputPlanned( CBaseLayer* layer )
+{
+	// The source layers provide the user blobs, the composite layers provide the blobs of their sub-networks
+	return layer->GetInputCount() > 0 && !layer->isComposite() && !isOutputAliased( layer );
+}
+
+// Indicates if the layer outputs are its input blobs
+bool CDnnMemoryPlanner::isOutputAliased( CBaseLayer* layer )
+{
+	return dynamic_cast<CBaseInPlaceLayer*>( layer ) != nullptr && layer->IsInPlaceProcessAvailable();
+}
+
+// Assigns the offsets so that the intervals with intersecting lifetimes do not intersect in memory
+// The largest intervals are placed first, each into the lowest gap that fits it
+void CDnnMemoryPlanner::assignOffsets( CArray<CInterval>& intervals )
+{
+	intervals.QuickSort<CIntervalPlacementOrder>();
+
+	// The placed intervals sorted by offset
+	CArray<int> placed;
+	for( int i = 0; i < intervals.Size(); ++i ) {
+		CInterval& interval = intervals[i];
+		int offset = 0;
+		int insertPos = placed.Size();
+		for( int j = 0; j < placed.Size(); ++j ) {
+			const CInterval& other = intervals[placed[j]];
+			if( other.Finish < interval.Start || interval.Finish < other.Start ) {
+				continue;
+			}
+			if( offset + interval.Size <= other.Offset ) {
+				break;
+			}
+			offset = max( offset, other.Offset + other.Size );
+		}
+		interval.Offset = offset;
+		for( int j = 0; j < placed.Size(); ++j ) {
+			if( intervals[placed[j]].Offset > offset ) {
+				insertPos = j;
+				break;
+			}
+		}
+		placed.InsertAt( i, insertPos );
+	}
+}
+
+} // namespace NeoML
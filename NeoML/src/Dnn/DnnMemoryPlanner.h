@@ -0,0 +1,75 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Dnn.h>
+
+namespace NeoML {
+
+// Plans the memory for the layer outputs of a network with fixed blob sizes
+// The layers are ordered in the same way as CDnn::RunOnce runs them, and the lifetime of each output
+// lasts from the step of the layer that produces it to the step of its last consumer
+// The outputs are placed into one memory block so that the outputs with disjoint lifetimes share memory
+// The source, composite and in-place layers keep allocating their outputs themselves
+class CDnnMemoryPlanner {
+public:
+	explicit CDnnMemoryPlanner( IMathEngine& mathEngine );
+
+	// Checks if the planned blobs are still used by the layers
+	// The plan becomes invalid when any of the planned layers is reshaped
+	bool IsValid() const;
+	// Builds the plan for the network with the given sink layers and sets the planned output blobs to the layers
+	// Must be called after the network has been reshaped
+	void Plan( const CArray<CBaseLayer*>& sinkLayers );
+	// Detaches the planned blobs from the layers and frees the memory block
+	void Reset();
+
+	// The size of the memory block, in bytes
+	size_t GetPlannedSize() const;
+
+private:
+	// A layer output placed into the memory block
+	struct CPlannedOutput {
+		CPtr<CBaseLayer> Layer;
+		int OutputNumber;
+		CPtr<CDnnBlob> Blob;
+	};
+
+	// The lifetime of a layer output in the execution order
+	struct CInterval {
+		CBaseLayer* Layer;
+		int OutputNumber;
+		int Size; // in elements, aligned
+		int Start; // the step of the layer that produces the output
+		int Finish; // the step of the last consumer
+		int Offset; // the offset in the memory block, in elements
+	};
+
+	IMathEngine& mathEngine;
+	CPtr<CDnnBlob> memoryBlock;
+	CArray<CPlannedOutput> plannedOutputs;
+
+	static void addToOrder( CBaseLayer* layer, CMap<const CBaseLayer*, int>& steps, CArray<CBaseLayer*>& order );
+	static bool isOutputPlanned( CBaseLayer* layer );
+	static bool isOutputAliased( CBaseLayer* layer );
+	static void assignOffsets( CArray<CInterval>& intervals );
+
+	CDnnMemoryPlanner( const CDnnMemoryPlanner& );
+	CDnnMemoryPlanner& operator=( const CDnnMemoryPlanner& );
+};
+
+} // namespace NeoML
@@ -0,0 +1,188 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/Dnn/DnnOptimizer.h>
+#include <NeoML/Dnn/Layers/ConvLayer.h>
+#include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/Layers/BatchNormalizationLayer.h>
+#include <NeoML/Dnn/Layers/ActivationLayers.h>
+
+namespace NeoML {
+
+static void getLayerNames( const CDnn& dnn, CArray<CString>& layerNames )
+{
+	CArray<const char*> layerList;
+	dnn.GetLayerList( layerList );
+	layerNames.DeleteAll();
+	for( int i = 0; i < layerList.Size(); ++i ) {
+		layerNames.Add( layerList[i] );
+	}
+}
+
+CDnnOptimizer::CDnnOptimizer( CDnn& _dnn ) :
+	dnn( _dnn )
+{
+}
+
+// Returns the layer connected to the single input of the given layer
+// if the given layer is the only consumer of that layer's single output; otherwise returns null
+CBaseLayer* CDnnOptimizer::getSingleInput( const CBaseLayer& layer, const CArray<CString>& layerNames ) const
+{
+	if( layer.GetInputCount() != 1 || layer.GetInputOutputNumber( 0 ) != 0 ) {
+		return nullptr;
+	}
+	const CString inputName = layer.GetInputName( 0 );
+	if( !dnn.HasLayer( inputName ) ) {
+		return nullptr;
+	}
+	CBaseLayer* input = dnn.GetLayer( inputName ).Ptr();
+	if( input->GetInputCount() != 1 ) {
+		return nullptr;
+	}
+
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		if( !dnn.HasLayer( layerNames[i] ) || layerNames[i] == layer.GetName() ) {
+			continue;
+		}
+		const CBaseLayer* other = dnn.GetLayer( layerNames[i] );
+		for( int j = 0; j < other->GetInputCount(); ++j ) {
+			if( inputName == other->GetInputName( j ) ) {
+				return nullptr;
+			}
+		}
+	}
+	return input;
+}
+
+// Deletes the layer and connects its consumers to its input
+void CDnnOptimizer::removeLayer( CBaseLayer& layer, const CArray<CString>& layerNames )
+{
+	const CString inputName = layer.GetInputName( 0 );
+	const int inputOutputNumber = layer.GetInputOutputNumber( 0 );
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		if( !dnn.HasLayer( layerNames[i] ) || layerNames[i] == layer.GetName() ) {
+			continue;
+		}
+		CPtr<CBaseLayer> consumer = dnn.GetLayer( layerNames[i] );
+		for( int j = 0; j < consumer->GetInputCount(); ++j ) {
+			if( CString( layer.GetName() ) == consumer->GetInputName( j ) ) {
+				NeoAssert( consumer->GetInputOutputNumber( j ) == 0 );
+				consumer->Connect( j, inputName, inputOutputNumber );
+			}
+		}
+	}
+	dnn.DeleteLayer( layer );
+}
+
+int CDnnOptimizer::FoldBatchNormalization()
+{
+	CArray<CString> layerNames;
+	getLayerNames( dnn, layerNames );
+
+	int result = 0;
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		CPtr<CBaseLayer> layer = dnn.GetLayer( layerNames[i] );
+		if( GetLayerClass( *layer ) != "FmlCnnBatchNormalizationLayer" ) {
+			continue;
+		}
+		CBaseLayer* input = getSingleInput( *layer, layerNames );
+		if( input == nullptr ) {
+			continue;
+		}
+		CBatchNormalizationLayer* batchNorm = CheckCast<CBatchNormalizationLayer>( layer.Ptr() );
+		CPtr<CDnnBlob> params = batchNorm->GetFinalParams();
+		if( params == nullptr ) {
+			continue;
+		}
+
+		// Only the layers of these exact classes are processed (their descendants may behave differently)
+		const CString inputClass = GetLayerClass( *input );
+		if( inputClass == "FmlCnnConvLayer" ) {
+			CConvLayer* conv = CheckCast<CConvLayer>( input );
+			if( conv->GetActivation() != AF_Linear || conv->GetFilterData() == nullptr
+				|| params->GetObjectSize() != conv->GetFilterCount() )
+			{
+				continue;
+			}
+			conv->ApplyBatchNormalization( *batchNorm );
+			conv->SetZeroFreeTerm( false );
+		} else if( inputClass == "FmlCnnFullyConnectedLayer" ) {
+			CFullyConnectedLayer* fc = CheckCast<CFullyConnectedLayer>( input );
+			if( fc->GetWeightsData() == nullptr || fc->GetFreeTermData() == nullptr
+				|| params->GetObjectSize() != fc->GetNumberOfElements() )
+			{
+				continue;
+			}
+			fc->ApplyBatchNormalization( *batchNorm );
+			fc->SetZeroFreeTerm( false );
+		} else {
+			continue;
+		}
+
+		removeLayer( *layer, layerNames );
+		result++;
+	}
+	return result;
+}
+
+int CDnnOptimizer::FuseActivations()
+{
+	CArray<CString> layerNames;
+	getLayerNames( dnn, layerNames );
+
+	int result = 0;
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		CPtr<CBaseLayer> layer = dnn.GetLayer( layerNames[i] );
+		const CString layerClass = GetLayerClass( *layer );
+		TActivationFunction activation = AF_Linear;
+		float activationParam = 0;
+		if( layerClass == "FmlCnnReLULayer" ) {
+			activation = AF_ReLU;
+			activationParam = CheckCast<CReLULayer>( layer.Ptr() )->GetUpperThreshold();
+		} else if( layerClass == "FmlCnnSigmoidLayer" ) {
+			activation = AF_Sigmoid;
+		} else if( layerClass == "FmlCnnHSwishLayer" ) {
+			activation = AF_HSwish;
+		} else {
+			continue;
+		}
+
+		CBaseLayer* input = getSingleInput( *layer, layerNames );
+		if( input == nullptr || GetLayerClass( *input ) != "FmlCnnConvLayer" ) {
+			continue;
+		}
+		CConvLayer* conv = CheckCast<CConvLayer>( input );
+		if( conv->GetActivation() != AF_Linear ) {
+			continue;
+		}
+		conv->SetActivation( activation, activationParam );
+
+		removeLayer( *layer, layerNames );
+		result++;
+	}
+	return result;
+}
+
+int CDnnOptimizer::Optimize()
+{
+	// The batch normalization must be folded first, it may be placed between the convolution and the activation
+	const int result = FoldBatchNormalization();
+	return result + FuseActivations();
+}
+
+} // namespace NeoML
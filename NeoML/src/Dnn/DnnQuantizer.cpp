@@ -0,0 +1,136 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/Dnn/DnnQuantizer.h>
+#include <NeoML/Dnn/Layers/SinkLayer.h>
+#include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/Layers/ConvLayer.h>
+#include <NeoML/Dnn/Layers/QuantizedLayers.h>
+#include <cmath>
+
+namespace NeoML {
+
+CDnnQuantizer::CDnnQuantizer( CDnn& _dnn ) :
+	dnn( _dnn )
+{
+}
+
+// Only the layers of these exact classes are replaced (their descendants may behave differently)
+bool CDnnQuantizer::isQuantizable( const CBaseLayer& layer )
+{
+	const CString layerClass = GetLayerClass( layer );
+	if( layerClass == "FmlCnnConvLayer" ) {
+		// The quantized convolution has no fused activation
+		return static_cast<const CConvLayer&>( layer ).GetActivation() == AF_Linear;
+	}
+	return layerClass == "FmlCnnFullyConnectedLayer";
+}
+
+void CDnnQuantizer::Calibrate()
+{
+	CArray<const char*> layerList;
+	dnn.GetLayerList( layerList );
+	CArray<CString> layerNames;
+	for( int i = 0; i < layerList.Size(); ++i ) {
+		layerNames.Add( layerList[i] );
+	}
+
+	// Catch the inputs of the quantizable layers with the temporary sinks
+	CObjectArray<CSinkLayer> sinks;
+	CArray<CString> sinkOwners;
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		CPtr<CBaseLayer> layer = dnn.GetLayer( layerNames[i] );
+		if( !isQuantizable( *layer ) ) {
+			continue;
+		}
+		for( int input = 0; input < layer->GetInputCount(); ++input ) {
+			CPtr<CSinkLayer> sink = FINE_DEBUG_NEW CSinkLayer( dnn.GetMathEngine() );
+			sink->SetName( layerNames[i] + "_QuantizationSink" + Str( input ) );
+			sink->Connect( 0, layer->GetInputName( input ), layer->GetInputOutputNumber( input ) );
+			dnn.AddLayer( *sink );
+			sinks.Add( sink );
+			sinkOwners.Add( layerNames[i] );
+		}
+	}
+
+	dnn.RunOnce();
+
+	CArray<float> buffer;
+	for( int i = 0; i < sinks.Size(); ++i ) {
+		const CPtr<CDnnBlob>& blob = sinks[i]->GetBlob();
+		buffer.SetSize( blob->GetDataSize() );
+		blob->CopyTo( buffer.GetPtr() );
+
+		float maxAbs = inputRanges.Has( sinkOwners[i] ) ? inputRanges.Get( sinkOwners[i] ) : 0.f;
+		for( int j = 0; j < buffer.Size(); ++j ) {
+			maxAbs = max( maxAbs, fabsf( buffer[j] ) );
+		}
+		inputRanges.Set( sinkOwners[i], maxAbs );
+
+		dnn.DeleteLayer( *sinks[i] );
+	}
+}
+
+int CDnnQuantizer::Quantize()
+{
+	CArray<const char*> layerList;
+	dnn.GetLayerList( layerList );
+	CArray<CString> layerNames;
+	for( int i = 0; i < layerList.Size(); ++i ) {
+		layerNames.Add( layerList[i] );
+	}
+
+	int result = 0;
+	for( int i = 0; i < layerNames.Size(); ++i ) {
+		CPtr<CBaseLayer> layer = dnn.GetLayer( layerNames[i] );
+		if( !isQuantizable( *layer ) || !inputRanges.Has( layerNames[i] ) || inputRanges.Get( layerNames[i] ) <= 0 ) {
+			continue;
+		}
+		// The maximum absolute value of the input is mapped to 127
+		const float inputScale = inputRanges.Get( layerNames[i] ) / 127.f;
+
+		CPtr<CBaseLayer> quantized;
+		CFullyConnectedLayer* fc = dynamic_cast<CFullyConnectedLayer*>( layer.Ptr() );
+		if( fc != nullptr ) {
+			CPtr<CQuantizedFullyConnectedLayer> quantizedFc = FINE_DEBUG_NEW CQuantizedFullyConnectedLayer( dnn.GetMathEngine() );
+			quantizedFc->SetWeights( *fc );
+			quantizedFc->SetInputScale( inputScale );
+			quantized = quantizedFc.Ptr();
+		} else {
+			CConvLayer* conv = dynamic_cast<CConvLayer*>( layer.Ptr() );
+			NeoAssert( conv != nullptr );
+			CPtr<CQuantizedConvLayer> quantizedConv = FINE_DEBUG_NEW CQuantizedConvLayer( dnn.GetMathEngine() );
+			quantizedConv->SetWeights( *conv );
+			quantizedConv->SetInputScale( inputScale );
+			quantized = quantizedConv.Ptr();
+		}
+
+		// The consumers are connected by the name so they will be linked to the new layer
+		quantized->SetName( layerNames[i] );
+		for( int input = 0; input < layer->GetInputCount(); ++input ) {
+			quantized->Connect( input, layer->GetInputName( input ), layer->GetInputOutputNumber( input ) );
+		}
+		dnn.DeleteLayer( *layer );
+		dnn.AddLayer( *quantized );
+		inputRanges.Delete( layerNames[i] );
+		result++;
+	}
+	return result;
+}
+
+} // namespace NeoML
@@ -159,7 +159,9 @@ CDnnSolver::CDnnSolver( IMathEngine& _mathEngine ) :
 	learningRate( 0.01f ),
 	regularizationL2( 0.f ),
 	regularizationL1( 0.f ),
-	maxGradientNorm( -1.f )
+	maxGradientNorm( -1.f ),
+	isAveragingGradients( false ),
+	isSparseUpdateEnabled( false )
 {
 }
 
@@ -169,6 +171,9 @@ void CDnnSolver::AddDiff( CBaseLayer* layer, const CObjectArray<CDnnBlob>& param
 {
 	NeoAssert( layer != 0 );
 
+	if( !layerToParamDiffBlobsSum.Has( layer ) ) {
+		diffLayers.Add( layer );
+	}
 	CDiffBlobSum& paramDiffBlobsSum = layerToParamDiffBlobsSum.GetOrCreateValue( layer );
 
 	if( !sharedWeights ) {
@@ -185,12 +190,65 @@ void CDnnSolver::AddDiff( CBaseLayer* layer, const CObjectArray<CDnnBlob>& param
 	}
 }
 
+// Merges the sorted rows with the new ones
+static void addSortedRows( CArray<int>& rows, const int* newRows, int newRowCount )
+{
+	CArray<int> sortedNewRows;
+	sortedNewRows.SetSize( newRowCount );
+	for( int i = 0; i < newRowCount; ++i ) {
+		sortedNewRows[i] = newRows[i];
+	}
+	sortedNewRows.QuickSort<Ascending<int>>();
+
+	CArray<int> result;
+	result.SetBufferSize( rows.Size() + newRowCount );
+	int i = 0;
+	int j = 0;
+	while( i < rows.Size() || j < sortedNewRows.Size() ) {
+		int row;
+		if( j == sortedNewRows.Size() || ( i < rows.Size() && rows[i] <= sortedNewRows[j] ) ) {
+			row = rows[i++];
+		} else {
+			row = sortedNewRows[j++];
+		}
+		if( result.IsEmpty() || result.Last() != row ) {
+			result.Add( row );
+		}
+	}
+	result.MoveTo( rows );
+}
+
+void CDnnSolver::AddDiffRows( CBaseLayer* layer, int paramIndex, int rowSize, const int* rows, int rowCount )
+{
+	NeoAssert( layer != 0 );
+	NeoAssert( 0 <= paramIndex && paramIndex < layer->paramBlobs.Size() );
+	NeoAssert( rowSize > 0 );
+	NeoAssert( rowCount >= 0 );
+
+	if( !layerToParamDiffBlobsSum.Has( layer ) ) {
+		diffLayers.Add( layer );
+	}
+	CDiffBlobSum& paramDiffBlobsSum = layerToParamDiffBlobsSum.GetOrCreateValue( layer );
+	if( paramDiffBlobsSum.RowSizes.IsEmpty() ) {
+		paramDiffBlobsSum.RowSizes.Add( 0, layer->paramBlobs.Size() );
+		paramDiffBlobsSum.Rows.SetSize( layer->paramBlobs.Size() );
+	}
+	NeoAssert( paramDiffBlobsSum.RowSizes[paramIndex] == 0 || paramDiffBlobsSum.RowSizes[paramIndex] == rowSize );
+	paramDiffBlobsSum.RowSizes[paramIndex] = rowSize;
+	addSortedRows( paramDiffBlobsSum.Rows[paramIndex], rows, rowCount );
+}
+
 // Modifies the trainable parameters of the network layers, using the accumulated gradient values 
 // and the history of previous modifications (moment, etc.)
 void CDnnSolver::Train()
 {
 	OnTrain();
 
+	const bool isDistributed = MathEngine().IsDistributed();
+	if( isDistributed && isAveragingGradients ) {
+		allReduceGradients();
+	}
+
 	CFloatHandleStackVar oneDivEpoch( mathEngine );
 
 	for( TMapPosition pos = layerToParamDiffBlobsSum.GetFirstPosition(); pos != NotFound;
@@ -199,6 +257,8 @@ void CDnnSolver::Train()
 		CBaseLayer* layer = layerToParamDiffBlobsSum.GetKey( pos );
 		CDiffBlobSum& paramDiffBlobsSum = layerToParamDiffBlobsSum.GetValue( pos );
 		if( paramDiffBlobsSum.Sum.IsEmpty() ) {
+			paramDiffBlobsSum.RowSizes.DeleteAll();
+			paramDiffBlobsSum.Rows.DeleteAll();
 			continue;
 		}
 		NeoAssert( paramDiffBlobsSum.Count > 0 );
@@ -216,14 +276,23 @@ void CDnnSolver::Train()
 		clipGradients( paramDiffBlobsSum.Sum );
 
 		// Train the layer based on the calculated diff data
-		TrainLayer( layer, layer->paramBlobs, paramDiffBlobsSum.Sum, layerToGradientHistory.GetOrCreateValue( layer ) );
+		// The threads of the distributed training may use different rows so the whole blobs are updated
+		CObjectArray<CDnnBlob>& gradientHistory = layerToGradientHistory.GetOrCreateValue( layer );
+		if( isSparseUpdateEnabled && !isDistributed && !paramDiffBlobsSum.RowSizes.IsEmpty() ) {
+			TrainLayerRows( layer, layer->paramBlobs, paramDiffBlobsSum.Sum, paramDiffBlobsSum.RowSizes,
+				paramDiffBlobsSum.Rows, gradientHistory );
+		} else {
+			TrainLayer( layer, layer->paramBlobs, paramDiffBlobsSum.Sum, gradientHistory );
+		}
 
 		// Clear the diff data
 		paramDiffBlobsSum.Sum.Empty();
 		paramDiffBlobsSum.Count = 0;
+		paramDiffBlobsSum.RowSizes.DeleteAll();
+		paramDiffBlobsSum.Rows.DeleteAll();
 	}
 
-	if( MathEngine().IsDistributed() ){
+	if( isDistributed && !isAveragingGradients ) {
 		allReduce();
 	}
 }
@@ -231,24 +300,136 @@ void CDnnSolver::Train()
 void CDnnSolver::Reset()
 {
 	layerToParamDiffBlobsSum.DeleteAll();
+	diffLayers.DeleteAll();
 	layerToGradientHistory.DeleteAll();
 	OnReset();
 }
 
+// The maximum size of the parameters averaged together, in elements
+// The parameter blobs smaller than that are packed into a single buffer to reduce the number of synchronizations
+static const int AllReduceBucketSize = 1 << 18;
+
 void CDnnSolver::allReduce()
 {
 	CDnn* dnn = layerToParamDiffBlobsSum.GetKey( layerToParamDiffBlobsSum.GetFirstPosition() )->GetDnn();
 	CArray<const char*> layerList;
 	dnn->GetLayerList( layerList );
+
+	CArray<CDnnBlob*> params;
 	for( int i = 0; i < layerList.Size(); i++ ){
 		CBaseLayer* layer = dnn->GetLayer( layerList[i] );
 		if( layer->IsLearnable() && layer->IsLearningEnabled() ){
-			const CObjectArray<CDnnBlob>& params = layer->paramBlobs;
-			for( int j = 0; j < params.Size(); j++ ){
-				MathEngine().AllReduce( params[j]->GetData(), params[j]->GetDataSize() );
+			for( int j = 0; j < layer->paramBlobs.Size(); j++ ){
+				params.Add( layer->paramBlobs[j] );
+			}
+		}
+	}
+	allReduceBlobs( params );
+}
+
+void CDnnSolver::allReduceGradients()
+{
+	CFloatHandleStackVar oneDivEpoch( mathEngine );
+
+	// The flags of the layers that have the gradients in this thread
+	// All the threads must take part in the same collective operations,
+	// so the layers without the gradients reduce zeros
+	CArray<float> hasGradients;
+	hasGradients.Add( 0.f, diffLayers.Size() );
+	CArray<CDnnBlob*> diffs;
+	for( int i = 0; i < diffLayers.Size(); i++ ) {
+		CDiffBlobSum& paramDiffBlobsSum = layerToParamDiffBlobsSum.Get( diffLayers[i] );
+		if( paramDiffBlobsSum.Sum.IsEmpty() ) {
+			const CObjectArray<CDnnBlob>& paramBlobs = diffLayers[i]->paramBlobs;
+			for( int j = 0; j < paramBlobs.Size(); j++ ) {
+				CPtr<CDnnBlob> zeros = CDnnBlob::CreateBlob( MathEngine(), CT_Float, paramBlobs[j]->GetDesc() );
+				zeros->Clear();
+				paramDiffBlobsSum.Sum.Add( zeros );
 			}
+			paramDiffBlobsSum.Count = 1;
+		} else {
+			hasGradients[i] = 1.f;
+		}
+		// Average the local sum first so that the result is the mean over all runs in all threads
+		if( paramDiffBlobsSum.Count > 1 ) {
+			oneDivEpoch.SetValue( 1.f / paramDiffBlobsSum.Count );
+			for( int j = 0; j < paramDiffBlobsSum.Sum.Size(); j++ ) {
+				MathEngine().VectorMultiply( paramDiffBlobsSum.Sum[j]->GetData(), paramDiffBlobsSum.Sum[j]->GetData(),
+					paramDiffBlobsSum.Sum[j]->GetDataSize(), oneDivEpoch );
+			}
+			paramDiffBlobsSum.Count = 1;
+		}
+		for( int j = 0; j < paramDiffBlobsSum.Sum.Size(); j++ ) {
+			diffs.Add( paramDiffBlobsSum.Sum[j] );
 		}
 	}
+	if( diffLayers.IsEmpty() ) {
+		return;
+	}
+	CPtr<CDnnBlob> hasGradientsBlob = CDnnBlob::CreateVector( MathEngine(), CT_Float, hasGradients.Size() );
+	hasGradientsBlob->CopyFrom( hasGradients.GetPtr() );
+	diffs.Add( hasGradientsBlob );
+	allReduceBlobs( diffs );
+
+	// The layers without the gradients in all threads are not trained
+	hasGradientsBlob->CopyTo( hasGradients.GetPtr() );
+	for( int i = 0; i < diffLayers.Size(); i++ ) {
+		if( hasGradients[i] == 0.f ) {
+			CDiffBlobSum& paramDiffBlobsSum = layerToParamDiffBlobsSum.Get( diffLayers[i] );
+			paramDiffBlobsSum.Sum.Empty();
+			paramDiffBlobsSum.Count = 0;
+		}
+	}
+}
+
+// Averages the blobs over all threads, packing the small ones into buckets
+void CDnnSolver::allReduceBlobs( const CArray<CDnnBlob*>& blobs )
+{
+	CArray<CDnnBlob*> bucket;
+	int bucketSize = 0;
+	for( int i = 0; i < blobs.Size(); i++ ) {
+		const int size = blobs[i]->GetDataSize();
+		if( size >= AllReduceBucketSize ) {
+			MathEngine().AllReduce( blobs[i]->GetData(), size );
+			continue;
+		}
+		if( bucketSize + size > AllReduceBucketSize ) {
+			allReduceBucketed( bucket, bucketSize );
+			bucket.DeleteAll();
+			bucketSize = 0;
+		}
+		bucket.Add( blobs[i] );
+		bucketSize += size;
+	}
+	allReduceBucketed( bucket, bucketSize );
+}
+
+// Averages the blobs over all threads with a single call, copying them into the bucket buffer
+void CDnnSolver::allReduceBucketed( const CArray<CDnnBlob*>& blobs, int size )
+{
+	if( blobs.IsEmpty() ) {
+		return;
+	}
+	if( blobs.Size() == 1 ) {
+		MathEngine().AllReduce( blobs[0]->GetData(), size );
+		return;
+	}
+
+	if( allReduceBucket == nullptr ) {
+		allReduceBucket = CDnnBlob::CreateVector( MathEngine(), CT_Float, AllReduceBucketSize );
+	}
+	CFloatHandle bucketData = allReduceBucket->GetData();
+	int offset = 0;
+	for( int i = 0; i < blobs.Size(); i++ ) {
+		MathEngine().VectorCopy( bucketData + offset, blobs[i]->GetData(), blobs[i]->GetDataSize() );
+		offset += blobs[i]->GetDataSize();
+	}
+	MathEngine().AllReduce( bucketData, size );
+	offset = 0;
+	for( int i = 0; i < blobs.Size(); i++ ) {
+		MathEngine().VectorCopy( blobs[i]->GetData(), bucketData + offset, blobs[i]->GetDataSize() );
+		offset += blobs[i]->GetDataSize();
+	}
 }
 
 void CDnnSolver::clipGradients(const CObjectArray<CDnnBlob>& paramDiffBlobs)
@@ -281,11 +462,24 @@ void CDnnSolver::clipGradients(const CObjectArray<CDnnBlob>& paramDiffBlobs)
 	}
 }
 
-static const int DnnSolverVersion = 0;
+static const int DnnSolverVersion = 2;
+
+// Serializes the rows of the blobs added by AddDiffRows
+static void serializeDiffRows( CArchive& archive, CArray<int>& rowSizes, CArray<CArray<int>>& rows )
+{
+	rowSizes.Serialize( archive );
+	if( archive.IsLoading() ) {
+		rows.DeleteAll();
+		rows.SetSize( rowSizes.Size() );
+	}
+	for( int i = 0; i < rows.Size(); ++i ) {
+		rows[i].Serialize( archive );
+	}
+}
 
 void CDnnSolver::Serialize( CArchive& archive, CDnn& dnn )
 {
-	archive.SerializeVersion( DnnSolverVersion );
+	const int version = archive.SerializeVersion( DnnSolverVersion );
 	if( archive.IsStoring() ) {
 		CMap<CBaseLayer*, CString> layerPtrToId;
 		mapLayerPtrToId( dnn, layerPtrToId );
@@ -295,8 +489,10 @@ void CDnnSolver::Serialize( CArchive& archive, CDnn& dnn )
 			pos = layerToParamDiffBlobsSum.GetNextPosition( pos ) )
 		{
 			archive << layerPtrToId[layerToParamDiffBlobsSum.GetKey( pos )];
-			archive << layerToParamDiffBlobsSum.GetValue( pos ).Count;
-			SerializeBlobs( mathEngine, archive, layerToParamDiffBlobsSum.GetValue( pos ).Sum );
+			CDiffBlobSum& blobSum = layerToParamDiffBlobsSum.GetValue( pos );
+			archive << blobSum.Count;
+			SerializeBlobs( mathEngine, archive, blobSum.Sum );
+			serializeDiffRows( archive, blobSum.RowSizes, blobSum.Rows );
 		}
 
 		archive << layerToGradientHistory.Size();
@@ -307,11 +503,14 @@ void CDnnSolver::Serialize( CArchive& archive, CDnn& dnn )
 			SerializeBlobs( mathEngine, archive, layerToGradientHistory.GetValue( pos ) );
 		}
 		archive << learningRate << regularizationL1 << regularizationL2 << maxGradientNorm;
+		archive << isSparseUpdateEnabled;
+		archive << isAveragingGradients;
 	} else {
 		CMap<CString, CBaseLayer*> layerIdToPtr;
 		mapLayerIdToPtr( dnn, layerIdToPtr );
 
 		layerToParamDiffBlobsSum.DeleteAll();
+		diffLayers.DeleteAll();
 		layerToGradientHistory.DeleteAll();
 
 		int size;
@@ -319,9 +518,16 @@ void CDnnSolver::Serialize( CArchive& archive, CDnn& dnn )
 		for( int i = 0; i < size; ++i ) {
 			CString layerId;
 			archive >> layerId;
-			CDiffBlobSum& blobSum = layerToParamDiffBlobsSum.GetOrCreateValue( layerIdToPtr[layerId] );
+			CBaseLayer* layer = layerIdToPtr[layerId];
+			if( !layerToParamDiffBlobsSum.Has( layer ) ) {
+				diffLayers.Add( layer );
+			}
+			CDiffBlobSum& blobSum = layerToParamDiffBlobsSum.GetOrCreateValue( layer );
 			archive >> blobSum.Count;
 			SerializeBlobs( mathEngine, archive, blobSum.Sum );
+			if( version >= 1 ) {
+				serializeDiffRows( archive, blobSum.RowSizes, blobSum.Rows );
+			}
 		}
 
 		archive >> size;
@@ -331,6 +537,16 @@ void CDnnSolver::Serialize( CArchive& archive, CDnn& dnn )
 			SerializeBlobs( mathEngine, archive, layerToGradientHistory.GetOrCreateValue( layerIdToPtr[layerId] ) );
 		}
 		archive >> learningRate >> regularizationL1 >> regularizationL2 >> maxGradientNorm;
+		if( version >= 1 ) {
+			archive >> isSparseUpdateEnabled;
+		} else {
+			isSparseUpdateEnabled = false;
+		}
+		if( version >= 2 ) {
+			archive >> isAveragingGradients;
+		} else {
+			isAveragingGradients = false;
+		}
 	}
 }
 
@@ -412,6 +628,131 @@ void CDnnSimpleGradientSolver::TrainLayer( const CBaseLayer* layer, const CObjec
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Updates the parameter blobs with the given indices with one fused math engine call
+// The gradient history stores the moments, the second moments and (if isAmsGradEnabled) their maximums for all the blobs
+// updates - (optional, may be null) the buffer for the updates of the blobs one after another; the parameters are not changed
+// normSquares - (optional, may be null) the squared L2 norms of the diff, the update and the parameters, 3 per blob
+static void adaptiveGradientStep( IMathEngine& mathEngine, const CAdaptiveGradientStep& step, const CArray<int>& indices,
+	const CObjectArray<CDnnBlob>& paramBlobs, const CObjectArray<CDnnBlob>& paramDiffBlobs,
+	const CObjectArray<CDnnBlob>& gradientHistory, bool isAmsGradEnabled, const CFloatHandle& updates,
+	const CFloatHandle& normSquares )
+{
+	if( indices.IsEmpty() ) {
+		return;
+	}
+
+	const int blobCount = paramDiffBlobs.Size();
+	CArray<int> sizes;
+	CArray<CConstFloatHandle> diffs;
+	CArray<CFloatHandle> params;
+	CArray<CFloatHandle> moments;
+	CArray<CFloatHandle> secondMoments;
+	CArray<CFloatHandle> secondMomentMaxes;
+	CArray<CFloatHandle> updateParts;
+	int updateOffset = 0;
+	for( int i = 0; i < indices.Size(); ++i ) {
+		const int index = indices[i];
+		sizes.Add( paramBlobs[index]->GetDataSize() );
+		diffs.Add( paramDiffBlobs[index]->GetData() );
+		params.Add( paramBlobs[index]->GetData() );
+		moments.Add( gradientHistory[index]->GetData() );
+		secondMoments.Add( gradientHistory[index + blobCount]->GetData() );
+		if( isAmsGradEnabled ) {
+			secondMomentMaxes.Add( gradientHistory[index + 2 * blobCount]->GetData() );
+		}
+		if( !updates.IsNull() ) {
+			updateParts.Add( updates + updateOffset );
+			updateOffset += sizes.Last();
+		}
+	}
+
+	mathEngine.AdaptiveGradientStep( step, indices.Size(), sizes.GetPtr(), diffs.GetPtr(), params.GetPtr(),
+		moments.GetPtr(), secondMoments.GetPtr(), isAmsGradEnabled ? secondMomentMaxes.GetPtr() : nullptr,
+		updates.IsNull() ? nullptr : updateParts.GetPtr(), normSquares );
+}
+
+// Updates the given rows of the parameter blobs with one fused math engine call
+// The neighboring rows are joined together; the blobs with zero row size are updated completely
+static void adaptiveGradientRowStep( IMathEngine& mathEngine, const CAdaptiveGradientStep& step,
+	const CArray<int>& rowSizes, const CArray<CArray<int>>& rows, const CObjectArray<CDnnBlob>& paramBlobs,
+	const CObjectArray<CDnnBlob>& paramDiffBlobs, const CObjectArray<CDnnBlob>& gradientHistory, bool isAmsGradEnabled )
+{
+	NeoAssert( rowSizes.Size() == paramBlobs.Size() );
+	NeoAssert( rows.Size() == paramBlobs.Size() );
+
+	const int blobCount = paramDiffBlobs.Size();
+	CArray<int> sizes;
+	CArray<CConstFloatHandle> diffs;
+	CArray<CFloatHandle> params;
+	CArray<CFloatHandle> moments;
+	CArray<CFloatHandle> secondMoments;
+	CArray<CFloatHandle> secondMomentMaxes;
+	// Adds the part of the blob to the step
+	auto addPart = [&]( int blob, int offset, int size ) {
+		NeoAssert( offset >= 0 && offset + size <= paramBlobs[blob]->GetDataSize() );
+		sizes.Add( size );
+		diffs.Add( paramDiffBlobs[blob]->GetData() + offset );
+		params.Add( paramBlobs[blob]->GetData() + offset );
+		moments.Add( gradientHistory[blob]->GetData() + offset );
+		secondMoments.Add( gradientHistory[blob + blobCount]->GetData() + offset );
+		if( isAmsGradEnabled ) {
+			secondMomentMaxes.Add( gradientHistory[blob + 2 * blobCount]->GetData() + offset );
+		}
+	};
+
+	for( int i = 0; i < paramBlobs.Size(); ++i ) {
+		const int rowSize = rowSizes[i];
+		if( rowSize == 0 ) {
+			addPart( i, 0, paramBlobs[i]->GetDataSize() );
+			continue;
+		}
+		const CArray<int>& blobRows = rows[i];
+		int rowIndex = 0;
+		while( rowIndex < blobRows.Size() ) {
+			const int firstRow = blobRows[rowIndex];
+			int rowCount = 1;
+			while( rowIndex + rowCount < blobRows.Size() && blobRows[rowIndex + rowCount] == firstRow + rowCount ) {
+				++rowCount;
+			}
+			addPart( i, firstRow * rowSize, rowCount * rowSize );
+			rowIndex += rowCount;
+		}
+	}
+
+	if( !sizes.IsEmpty() ) {
+		mathEngine.AdaptiveGradientStep( step, sizes.Size(), sizes.GetPtr(), diffs.GetPtr(), params.GetPtr(),
+			moments.GetPtr(), secondMoments.GetPtr(), isAmsGradEnabled ? secondMomentMaxes.GetPtr() : nullptr,
+			nullptr, CFloatHandle() );
+	}
+}
+
+// Creates the zero gradient history blobs of the same size as the parameters if necessary
+static void initGradientHistory( const CObjectArray<CDnnBlob>& paramDiffBlobs, int gradientHistoryTypeCount,
+	CObjectArray<CDnnBlob>& gradientHistory )
+{
+	if( gradientHistory.Size() != 0 ) {
+		return;
+	}
+	for( int j = 0; j < gradientHistoryTypeCount; j++ ) {
+		for( int i = 0; i < paramDiffBlobs.Size(); ++i ) {
+			CDnnBlob* blob = paramDiffBlobs[i]->GetClone();
+			blob->Clear();
+			gradientHistory.Add( blob );
+		}
+	}
+}
+
+// Fills the array with the indices of all the parameter blobs
+static void getAllParamIndices( int paramCount, CArray<int>& indices )
+{
+	indices.SetSize( paramCount );
+	for( int i = 0; i < paramCount; ++i ) {
+		indices[i] = i;
+	}
+}
+
 CDnnAdaptiveGradientSolver::CDnnAdaptiveGradientSolver( IMathEngine& mathEngine ) :
 	CDnnSolver( mathEngine ),
 	momentDecayRate(0.9f),
@@ -489,29 +830,44 @@ CDnnBlob* CDnnAdaptiveGradientSolver::addRegularization( CDnnBlob* diffBlob, CDn
 	return diffBlob;
 }
 
-void CDnnAdaptiveGradientSolver::TrainLayer( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs, 
-	const CObjectArray<CDnnBlob>& paramDiffBlobs, CObjectArray<CDnnBlob>& gradientHistory )
+// The settings of the fused step for the layer
+CAdaptiveGradientStep CDnnAdaptiveGradientSolver::getStep( const CBaseLayer* layer ) const
 {
-	if(gradientHistory.Size() == 0) {
-		// Create blobs
-		int gradientHistoryTypeCount = IsAmsGradEnabled() ? GHTC_AmsGrad : GHTC_Default;
-		for( int j = 0; j < gradientHistoryTypeCount; j++ ) {
-			for(int i = 0; i < paramDiffBlobs.Size(); ++i) {
-				CDnnBlob* blob = paramDiffBlobs[i]->GetClone();
-				blob->Clear();
-				gradientHistory.Add( blob );
-			}
-		}
-	}
-
-	// Add regularization and add diffs to parameters
 	float rate = layer->GetBaseLearningRate() * GetLearningRate() * sqrtf(1 - secondMomentDecayRateN);
 	if( !isInCompatibilityMode ) {
 		rate /= (1 - momentDecayRateN);
 	}
 
-	float regL1 = layer->GetBaseL1RegularizationMult() * GetL1Regularization();
-	float regL2 = layer->GetBaseL2RegularizationMult() * GetL2Regularization();
+	CAdaptiveGradientStep step;
+	step.MomentDecayRate = momentDecayRate;
+	step.SecondMomentDecayRate = secondMomentDecayRate;
+	step.Epsilon = epsilon;
+	step.RegL1 = layer->GetBaseL1RegularizationMult() * GetL1Regularization();
+	step.RegL2 = layer->GetBaseL2RegularizationMult() * GetL2Regularization();
+	step.IsDecoupledWeightDecay = IsDecoupledWeightDecay();
+	step.Rate = -rate;
+	return step;
+}
+
+void CDnnAdaptiveGradientSolver::TrainLayer( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs, 
+	const CObjectArray<CDnnBlob>& paramDiffBlobs, CObjectArray<CDnnBlob>& gradientHistory )
+{
+	initGradientHistory( paramDiffBlobs, IsAmsGradEnabled() ? GHTC_AmsGrad : GHTC_Default, gradientHistory );
+
+	// Add regularization and add diffs to parameters
+	const CAdaptiveGradientStep step = getStep( layer );
+	const float rate = -step.Rate;
+	const float regL1 = step.RegL1;
+	const float regL2 = step.RegL2;
+
+	if( MathEngine().GetType() == MET_Cpu ) {
+		// Update all the parameter blobs of the layer in one pass
+		CArray<int> indices;
+		getAllParamIndices( paramBlobs.Size(), indices );
+		adaptiveGradientStep( MathEngine(), step, indices, paramBlobs, paramDiffBlobs, gradientHistory,
+			IsAmsGradEnabled(), CFloatHandle(), CFloatHandle() );
+		return;
+	}
 
 	// Set the values of the variables
 	CFastArray<float, TV_Count> varValues;
@@ -635,25 +991,50 @@ void CDnnNesterovGradientSolver::OnTrain()
 	productMuT *= muT;
 }
 
+// The settings of the fused step for the layer
+// The update numerator is m with a dash, the denominator uses n with a hat
+CAdaptiveGradientStep CDnnNesterovGradientSolver::getStep( const CBaseLayer* layer ) const
+{
+	CAdaptiveGradientStep step;
+	step.MomentDecayRate = momentDecayRate;
+	step.SecondMomentDecayRate = secondMomentDecayRate;
+	step.Epsilon = epsilon;
+	step.RegL1 = layer->GetBaseL1RegularizationMult() * GetL1Regularization();
+	step.RegL2 = layer->GetBaseL2RegularizationMult() * GetL2Regularization();
+	step.UpdateGradientMult = ( 1.f - muT ) / ( 1.f - productMuT );
+	step.UpdateMomentMult = muTPlusOne / ( 1.f - productMuT * muTPlusOne );
+	step.SecondMomentMult = 1 / ( 1 - secondMomentDecayRateN );
+	step.Rate = -layer->GetBaseLearningRate() * GetLearningRate();
+	return step;
+}
+
+// Checks if the fused step may be used for the layer
+// With regularization the m with a dash is calculated from the squared gradient
+// so only the non-regularized step goes through the fused path
+bool CDnnNesterovGradientSolver::isFusedStep( const CAdaptiveGradientStep& step ) const
+{
+	return MathEngine().GetType() == MET_Cpu && step.RegL1 <= 0 && step.RegL2 <= 0;
+}
+
 void CDnnNesterovGradientSolver::TrainLayer( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
 	const CObjectArray<CDnnBlob>& paramDiffBlobs, CObjectArray<CDnnBlob>& gradientHistory )
 {
-	if(gradientHistory.Size() == 0) {
-		// Create blobs
-		int gradientHistoryTypeCount = IsAmsGradEnabled() ? GHTC_AmsGrad : GHTC_Default;
-		for( int j = 0; j < gradientHistoryTypeCount; j++ ) {
-			for(int i = 0; i < paramDiffBlobs.Size(); ++i) {
-				CDnnBlob* blob = paramDiffBlobs[i]->GetClone();
-				blob->Clear();
-				gradientHistory.Add( blob );
-			}
-		}
-	}
+	initGradientHistory( paramDiffBlobs, IsAmsGradEnabled() ? GHTC_AmsGrad : GHTC_Default, gradientHistory );
 
 	// Apply regularization and add diffs to the parameters
-	float rate = layer->GetBaseLearningRate() * GetLearningRate();
-	float regL1 = layer->GetBaseL1RegularizationMult() * GetL1Regularization();
-	float regL2 = layer->GetBaseL2RegularizationMult() * GetL2Regularization();
+	const CAdaptiveGradientStep step = getStep( layer );
+	const float rate = -step.Rate;
+	const float regL1 = step.RegL1;
+	const float regL2 = step.RegL2;
+
+	if( isFusedStep( step ) ) {
+		// Update all the parameter blobs of the layer in one pass
+		CArray<int> indices;
+		getAllParamIndices( paramBlobs.Size(), indices );
+		adaptiveGradientStep( MathEngine(), step, indices, paramBlobs, paramDiffBlobs, gradientHistory,
+			IsAmsGradEnabled(), CFloatHandle(), CFloatHandle() );
+		return;
+	}
 
 	// Set the values for the variables
 	CFastArray<float, TV_Count> varValues;
@@ -745,6 +1126,37 @@ void CDnnNesterovGradientSolver::TrainLayer( const CBaseLayer* layer, const CObj
 	}
 }
 
+
+void CDnnAdaptiveGradientSolver::TrainLayerRows( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
+	const CObjectArray<CDnnBlob>& paramDiffBlobs, const CArray<int>& rowSizes, const CArray<CArray<int>>& rows,
+	CObjectArray<CDnnBlob>& gradientHistory )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		// Only the fused step can update a part of the blob
+		TrainLayer( layer, paramBlobs, paramDiffBlobs, gradientHistory );
+		return;
+	}
+
+	initGradientHistory( paramDiffBlobs, IsAmsGradEnabled() ? GHTC_AmsGrad : GHTC_Default, gradientHistory );
+	adaptiveGradientRowStep( MathEngine(), getStep( layer ), rowSizes, rows, paramBlobs, paramDiffBlobs,
+		gradientHistory, IsAmsGradEnabled() );
+}
+
+void CDnnNesterovGradientSolver::TrainLayerRows( const CBaseLayer* layer, const CObjectArray<CDnnBlob>& paramBlobs,
+	const CObjectArray<CDnnBlob>& paramDiffBlobs, const CArray<int>& rowSizes, const CArray<CArray<int>>& rows,
+	CObjectArray<CDnnBlob>& gradientHistory )
+{
+	const CAdaptiveGradientStep step = getStep( layer );
+	if( !isFusedStep( step ) ) {
+		// Only the fused step can update a part of the blob
+		TrainLayer( layer, paramBlobs, paramDiffBlobs, gradientHistory );
+		return;
+	}
+
+	initGradientHistory( paramDiffBlobs, IsAmsGradEnabled() ? GHTC_AmsGrad : GHTC_Default, gradientHistory );
+	adaptiveGradientRowStep( MathEngine(), step, rowSizes, rows, paramBlobs, paramDiffBlobs,
+		gradientHistory, IsAmsGradEnabled() );
+}
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 CDnnLambGradientSolver::CDnnLambGradientSolver( IMathEngine& mathEngine ) :
@@ -831,6 +1243,44 @@ void CDnnLambGradientSolver::TrainLayer( const CBaseLayer* layer, const CObjectA
 	const float layerWeighDecay = GetL2Regularization() * layer->GetBaseL2RegularizationMult();
 	const float clipMultiplier = 1.0f / max( 1.0f, totalGradientNorm );
 
+	// Getting parameters affected by weight decay
+	CHashTable<int> weightDecayParamIndexes;
+	getWeightDecayIndices( *layer, paramBlobs.Size(), weightDecayParamIndexes );
+
+	if( MathEngine().GetType() == MET_Cpu ) {
+		CAdaptiveGradientStep step;
+		step.MomentDecayRate = momentDecayRate;
+		step.SecondMomentDecayRate = secondMomentDecayRate;
+		step.Epsilon = epsilon;
+		step.GradientMult = useNvLamb ? clipMultiplier : 1.f;
+		step.IsDecoupledWeightDecay = true;
+		step.Rate = -rate;
+
+		// The parameters with and without weight decay are updated separately
+		CArray<int> weightDecayIndices;
+		CArray<int> otherIndices;
+		for( int i = 0; i < paramBlobs.Size(); ++i ) {
+			if( weightDecayParamIndexes.Has( i ) && layerWeighDecay > 0 ) {
+				weightDecayIndices.Add( i );
+			} else {
+				otherIndices.Add( i );
+			}
+		}
+
+		CArray<float> gradientNormSquares;
+		gradientNormSquares.Add( 0.f, paramBlobs.Size() );
+		step.RegL2 = layerWeighDecay;
+		fusedTrainParams( step, weightDecayIndices, paramBlobs, paramDiffBlobs, gradientHistory, gradientNormSquares );
+		step.RegL2 = 0.f;
+		fusedTrainParams( step, otherIndices, paramBlobs, paramDiffBlobs, gradientHistory, gradientNormSquares );
+
+		// Add squared L2-norm for calculation of L2-norm of the whole mode
+		if( useNvLamb ) {
+			layersGradientNormSquare.Add( gradientNormSquares );
+		}
+		return;
+	}
+
 	CFastArray<float, TV_Count> varValues;
 	varValues.SetSize( TV_Count );
 
@@ -848,10 +1298,6 @@ void CDnnLambGradientSolver::TrainLayer( const CBaseLayer* layer, const CObjectA
 
 	MathEngine().DataExchangeTyped( tempVariables->GetData(), varValues.GetPtr(), TV_Count );
 
-	// Getting parameters affected by weight decay
-	CHashTable<int> weightDecayParamIndexes;
-	getWeightDecayIndices( *layer, paramBlobs.Size(), weightDecayParamIndexes );
-
 	for( int i = 0; i < paramBlobs.Size(); ++i ) {
 		int dataSize = paramBlobs[i]->GetDataSize();
 		CDnnBlob* moment = gradientHistory[i];
@@ -920,6 +1366,63 @@ void CDnnLambGradientSolver::TrainLayer( const CBaseLayer* layer, const CObjectA
 	}
 }
 
+// Updates the parameter blobs with the given indices with the fused adaptive gradient step
+// The squared L2-norms of their gradients are stored in gradientNormSquares
+void CDnnLambGradientSolver::fusedTrainParams( const CAdaptiveGradientStep& step, const CArray<int>& indices,
+	const CObjectArray<CDnnBlob>& paramBlobs, const CObjectArray<CDnnBlob>& paramDiffBlobs,
+	const CObjectArray<CDnnBlob>& gradientHistory, CArray<float>& gradientNormSquares )
+{
+	if( indices.IsEmpty() ) {
+		return;
+	}
+
+	if( !useTrustRatio && !useNvLamb ) {
+		adaptiveGradientStep( MathEngine(), step, indices, paramBlobs, paramDiffBlobs, gradientHistory,
+			false, CFloatHandle(), CFloatHandle() );
+		return;
+	}
+
+	// The trust ratio depends on the norm of the whole update, so the update is stored and applied afterwards
+	CFloatHandle updates;
+	if( useTrustRatio ) {
+		int totalSize = 0;
+		for( int i = 0; i < indices.Size(); ++i ) {
+			totalSize += paramBlobs[indices[i]]->GetDataSize();
+		}
+		if( tempBlob == 0 || tempBlob->GetDataSize() < totalSize ) {
+			tempBlob = CDnnBlob::CreateVector( MathEngine(), CT_Float, totalSize );
+		}
+		updates = tempBlob->GetData();
+	}
+
+	CFloatHandleStackVar normSquaresVar( MathEngine(), 3 * indices.Size() );
+	adaptiveGradientStep( MathEngine(), step, indices, paramBlobs, paramDiffBlobs, gradientHistory,
+		false, updates, normSquaresVar.GetHandle() );
+	CArray<float> normSquares;
+	normSquares.SetSize( 3 * indices.Size() );
+	MathEngine().DataExchangeTyped<float>( normSquares.GetPtr(), normSquaresVar.GetHandle(), normSquares.Size() );
+
+	for( int i = 0; i < indices.Size(); ++i ) {
+		const int index = indices[i];
+		const int dataSize = paramBlobs[index]->GetDataSize();
+		gradientNormSquares[index] = normSquares[3 * i];
+		if( useTrustRatio ) {
+			// The same normalizing multiplier as in calcNormalizeMultiplier
+			float weightNorm = sqrtf( normSquares[3 * i + 2] ) / dataSize;
+			if( weightDecayClip > 0 ) {
+				weightNorm = min( weightNorm, weightDecayClip );
+			}
+			const float updateNorm = sqrtf( normSquares[3 * i + 1] ) / dataSize;
+			const float multiplier = ( weightNorm > 0 && updateNorm > 0 ) ? weightNorm / updateNorm : 1.f;
+
+			tempVariables->GetData( { TV_TrustRatioVar } ).SetValue( step.Rate * multiplier );
+			MathEngine().VectorMultiplyAndAdd( paramBlobs[index]->GetData(), updates,
+				paramBlobs[index]->GetData(), dataSize, tempVariables->GetData( { TV_TrustRatioVar } ) );
+			updates += dataSize;
+		}
+	}
+}
+
 // L2 norm of a vector devided by vector size.
 float CDnnLambGradientSolver::calcL2NormAverage( const CConstFloatHandle& data, int dataSize ) const
 {
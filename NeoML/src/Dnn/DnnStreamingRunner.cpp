@@ -0,0 +1,230 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/Dnn/DnnStreamingRunner.h>
+
+namespace NeoML {
+
+CDnnStreamingRunner::CDnnStreamingRunner( CDnn& _dnn, const CArray<CString>& sourceNames,
+		const CArray<CString>& sinkNames ) :
+	dnn( _dnn ),
+	oldAutoRestartMode( _dnn.GetAutoRestartMode() ),
+	capacity( 0 ),
+	streamCount( 0 ),
+	stepCount( 0 )
+{
+	NeoAssert( !sourceNames.IsEmpty() );
+	NeoAssert( !sinkNames.IsEmpty() );
+	for( int i = 0; i < sourceNames.Size(); i++ ) {
+		sources.Add( CheckCast<CSourceLayer>( dnn.GetLayer( sourceNames[i] ) ) );
+	}
+	for( int i = 0; i < sinkNames.Size(); i++ ) {
+		sinks.Add( CheckCast<CSinkLayer>( dnn.GetLayer( sinkNames[i] ) ) );
+	}
+
+	CArray<const char*> layerNames;
+	dnn.GetLayerList( layerNames );
+	for( int i = 0; i < layerNames.Size(); i++ ) {
+		CRecurrentLayer* recurrent = dynamic_cast<CRecurrentLayer*>( dnn.GetLayer( layerNames[i] ).Ptr() );
+		if( recurrent != 0 ) {
+			NeoAssert( !recurrent->IsReverseSequence() );
+			recurrentLayers.Add( recurrent );
+		}
+	}
+
+	// The sequences are restarted by the runner itself
+	dnn.SetAutoRestartMode( false );
+}
+
+CDnnStreamingRunner::~CDnnStreamingRunner()
+{
+	dnn.SetAutoRestartMode( oldAutoRestartMode );
+}
+
+int CDnnStreamingRunner::OpenStream()
+{
+	int stream = 0;
+	if( freeStreams.IsEmpty() ) {
+		stream = isStreamOpen.Size();
+		isStreamOpen.Add( false );
+		lastStreamStep.Add( 0 );
+		if( !stateTables.IsEmpty() && stream >= capacity ) {
+			growStateTables( max( 2 * capacity, stream + 1 ) );
+		}
+	} else {
+		stream = freeStreams.Last();
+		freeStreams.DeleteLast();
+		if( !stateTables.IsEmpty() ) {
+			clearStreamState( stream );
+		}
+	}
+	isStreamOpen[stream] = true;
+	streamCount++;
+	return stream;
+}
+
+void CDnnStreamingRunner::CloseStream( int stream )
+{
+	NeoAssert( 0 <= stream && stream < isStreamOpen.Size() && isStreamOpen[stream] );
+	isStreamOpen[stream] = false;
+	freeStreams.Add( stream );
+	streamCount--;
+}
+
+void CDnnStreamingRunner::Step( const CArray<int>& streams, const CObjectArray<CDnnBlob>& inputs,
+	CObjectArray<CDnnBlob>& outputs )
+{
+	NeoAssert( !streams.IsEmpty() );
+	NeoAssert( inputs.Size() == sources.Size() );
+
+	stepCount++;
+	for( int i = 0; i < streams.Size(); i++ ) {
+		const int stream = streams[i];
+		NeoAssert( 0 <= stream && stream < isStreamOpen.Size() && isStreamOpen[stream] );
+		NeoAssert( lastStreamStep[stream] != stepCount );
+		lastStreamStep[stream] = stepCount;
+	}
+	for( int i = 0; i < inputs.Size(); i++ ) {
+		NeoAssert( inputs[i]->GetBatchWidth() == streams.Size() );
+		sources[i]->SetBlob( inputs[i] );
+	}
+
+	const bool isFirstStep = stateTables.IsEmpty();
+	if( isFirstStep ) {
+		// All the streams have the empty state before the first step
+		dnn.RestartSequence();
+	} else {
+		copyStates( streams, false );
+	}
+
+	dnn.RunOnce();
+
+	if( isFirstStep ) {
+		createStateTables( streams.Size() );
+	}
+	copyStates( streams, true );
+
+	outputs.SetSize( sinks.Size() );
+	for( int i = 0; i < sinks.Size(); i++ ) {
+		outputs[i] = sinks[i]->GetBlob();
+	}
+}
+
+// Creates the cleared tables using the sizes of the current states of the recurrent layers
+void CDnnStreamingRunner::createStateTables( int streamsInStep )
+{
+	NeoAssert( stateTables.IsEmpty() );
+	capacity = max( isStreamOpen.Size(), 1 );
+	for( int i = 0; i < recurrentLayers.Size(); i++ ) {
+		CObjectArray<CDnnBlob> state;
+		recurrentLayers[i]->GetState( state );
+		for( int j = 0; j < state.Size(); j++ ) {
+			NeoAssert( state[j] != 0 );
+			NeoAssert( state[j]->GetDataType() == CT_Float );
+			NeoAssert( state[j]->GetBatchLength() == 1 && state[j]->GetBatchWidth() == streamsInStep );
+			CBlobDesc desc = state[j]->GetDesc();
+			desc.SetDimSize( BD_BatchWidth, 1 );
+			stateDescs.Add( desc );
+
+			desc.SetDimSize( BD_BatchWidth, capacity );
+			CPtr<CDnnBlob> table = CDnnBlob::CreateBlob( dnn.GetMathEngine(), CT_Float, desc );
+			table->Clear();
+			stateTables.Add( table );
+		}
+	}
+	stepStates.SetSize( stateTables.Size() );
+}
+
+void CDnnStreamingRunner::growStateTables( int newCapacity )
+{
+	NeoAssert( newCapacity > capacity );
+	IMathEngine& mathEngine = dnn.GetMathEngine();
+	for( int i = 0; i < stateTables.Size(); i++ ) {
+		CBlobDesc desc = stateDescs[i];
+		desc.SetDimSize( BD_BatchWidth, newCapacity );
+		CPtr<CDnnBlob> table = CDnnBlob::CreateBlob( mathEngine, CT_Float, desc );
+		const int oldSize = stateTables[i]->GetDataSize();
+		mathEngine.VectorCopy( table->GetData(), stateTables[i]->GetData(), oldSize );
+		mathEngine.VectorFill( table->GetData() + oldSize, 0.f, table->GetDataSize() - oldSize );
+		stateTables[i] = table;
+	}
+	capacity = newCapacity;
+}
+
+void CDnnStreamingRunner::clearStreamState( int stream )
+{
+	IMathEngine& mathEngine = dnn.GetMathEngine();
+	for( int i = 0; i < stateTables.Size(); i++ ) {
+		const int rowSize = stateDescs[i].BlobSize();
+		mathEngine.VectorFill( stateTables[i]->GetData() + stream * rowSize, 0.f, rowSize );
+	}
+}
+
+// Copies the rows of the step streams between the state of the step and the table
+// The streams with the consecutive ids are copied by a single operation
+static void copyStreamRows( IMathEngine& mathEngine, const CArray<int>& streams, CDnnBlob& stepState,
+	CDnnBlob& table, int rowSize, bool toTable )
+{
+	NeoAssert( stepState.GetDataSize() == streams.Size() * rowSize );
+	for( int i = 0; i < streams.Size(); ) {
+		int count = 1;
+		while( i + count < streams.Size() && streams[i + count] == streams[i] + count ) {
+			count++;
+		}
+		CFloatHandle tableRows = table.GetData() + streams[i] * rowSize;
+		CFloatHandle stepRows = stepState.GetData() + i * rowSize;
+		if( toTable ) {
+			mathEngine.VectorCopy( tableRows, stepRows, count * rowSize );
+		} else {
+			mathEngine.VectorCopy( stepRows, tableRows, count * rowSize );
+		}
+		i += count;
+	}
+}
+
+// Copies the states of the step streams from the recurrent layers to the tables or the other way round
+void CDnnStreamingRunner::copyStates( const CArray<int>& streams, bool toTables )
+{
+	IMathEngine& mathEngine = dnn.GetMathEngine();
+	int tableIndex = 0;
+	for( int i = 0; i < recurrentLayers.Size(); i++ ) {
+		CObjectArray<CDnnBlob> state;
+		recurrentLayers[i]->GetState( state );
+		for( int j = 0; j < state.Size(); j++ ) {
+			const int index = tableIndex + j;
+			if( !toTables ) {
+				// The blobs of the step states are reused while the number of the streams in a step is the same
+				CPtr<CDnnBlob>& stepState = stepStates[index];
+				if( stepState == 0 || stepState->GetBatchWidth() != streams.Size() ) {
+					CBlobDesc desc = stateDescs[index];
+					desc.SetDimSize( BD_BatchWidth, streams.Size() );
+					stepState = CDnnBlob::CreateBlob( mathEngine, CT_Float, desc );
+				}
+				state[j] = stepState;
+			}
+			copyStreamRows( mathEngine, streams, *state[j], *stateTables[index], stateDescs[index].BlobSize(), toTables );
+		}
+		if( !toTables ) {
+			recurrentLayers[i]->SetState( state );
+		}
+		tableIndex += state.Size();
+	}
+	NeoAssert( tableIndex == stateTables.Size() );
+}
+
+} // namespace NeoML
@@ -83,6 +83,20 @@ void CAccumulativeLookupLayer::LearnOnce()
 	MathEngine().LookupAndAddToTable( inputBlobs[0]->GetData<int>(), inputBlobs[0]->GetObjectCount(),
 		inputBlobs[0]->GetObjectSize(), outputDiffBlobs[0]->GetData(), lookupDimension.VectorSize,
 		paramDiffBlobs[0]->GetData(), lookupDimension.VectorCount );
+
+	if( GetDnn()->GetSolver()->IsSparseUpdateEnabled() ) {
+		// Pass the indices of the used vectors to the solver, the negative indices are skipped
+		CArray<int> indices;
+		indices.SetSize( inputBlobs[0]->GetDataSize() );
+		inputBlobs[0]->CopyTo( indices.GetPtr() );
+		CArray<int> rows;
+		for( int i = 0; i < indices.Size(); i++ ) {
+			if( indices[i] >= 0 ) {
+				rows.Add( indices[i] );
+			}
+		}
+		GetDnn()->GetSolver()->AddDiffRows( this, 0, lookupDimension.VectorSize, rows.GetPtr(), rows.Size() );
+	}
 }
 
 static const int AccumulativeLookupLayerVersion = 2000;
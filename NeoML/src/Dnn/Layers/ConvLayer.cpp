@@ -23,10 +23,20 @@ namespace NeoML {
 
 CConvLayer::CConvLayer( IMathEngine& mathEngine ) :
 	CBaseConvLayer( mathEngine, "CCnnConvLayer" ),
-	convDesc( 0 )
+	convDesc( 0 ),
+	activation( AF_Linear ),
+	activationParam( 0 )
 {
 }
 
+void CConvLayer::SetActivation( TActivationFunction _activation, float _activationParam )
+{
+	NeoAssert( _activation == AF_Linear || _activation == AF_ReLU || _activation == AF_Sigmoid || _activation == AF_HSwish );
+	activation = _activation;
+	activationParam = _activationParam;
+	ForceReshape();
+}
+
 CConvLayer::~CConvLayer()
 {
 	destroyConvDesc();
@@ -66,6 +76,8 @@ void CConvLayer::Reshape()
 		GetName(), "different number of inputs and outputs in conv layer" );
 	CheckArchitecture( paddingHeight < filterHeight * dilationHeight && paddingWidth < filterWidth * dilationWidth,
 		GetName(), "padding is more or equal to receptive field size" );
+	CheckArchitecture( activation == AF_Linear || !IsBackwardPerformed(),
+		GetName(), "conv layer with activation does not support backward" );
 
 	int outputHeight, outputWidth;
 	calcOutputBlobSize(outputHeight, outputWidth);
@@ -114,8 +126,13 @@ void CConvLayer::RunOnce()
 
 	for( int i = 0; i < outputBlobs.Size(); ++i ) {
 		CFloatHandle freeTerm = FreeTerms()->GetData();
-		MathEngine().BlobConvolution( *convDesc, inputBlobs[i]->GetData(),
-			Filter()->GetData(), &freeTerm, outputBlobs[i]->GetData() );
+		if( activation == AF_Linear ) {
+			MathEngine().BlobConvolution( *convDesc, inputBlobs[i]->GetData(),
+				Filter()->GetData(), &freeTerm, outputBlobs[i]->GetData() );
+		} else {
+			MathEngine().BlobConvolutionWithActivation( *convDesc, inputBlobs[i]->GetData(),
+				Filter()->GetData(), &freeTerm, outputBlobs[i]->GetData(), activation, activationParam );
+		}
 	}
 }
 
@@ -140,12 +157,23 @@ void CConvLayer::LearnOnce()
 	}
 }
 
-static const int ConvLayerVersion = 2000;
+static const int ConvLayerVersion = 2001;
 
 void CConvLayer::Serialize( CArchive& archive )
 {
-	archive.SerializeVersion( ConvLayerVersion, CDnn::ArchiveMinSupportedVersion );
+	const int version = archive.SerializeVersion( ConvLayerVersion, CDnn::ArchiveMinSupportedVersion );
 	CBaseConvLayer::Serialize( archive );
+
+	// v2001 - the fused activation added
+	if( version >= 2001 ) {
+		int activationInt = static_cast<int>( activation );
+		archive.Serialize( activationInt );
+		activation = static_cast<TActivationFunction>( activationInt );
+		archive.Serialize( activationParam );
+	} else {
+		activation = AF_Linear;
+		activationParam = 0;
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
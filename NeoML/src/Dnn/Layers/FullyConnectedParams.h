@@ -0,0 +1,38 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+
+namespace NeoML {
+
+// The read access to the parameters of a fully connected layer for the layers which use its weights directly:
+// the recurrent layers processing the whole sequence at once and the fused attention
+// The members are protected in CBaseLayer, so the pointers to them are taken in the scope of a derived class
+// The class is never created
+class CFullyConnectedParams : public CFullyConnectedLayer {
+public:
+	static const CPtr<CDnnBlob>& Weights( const CFullyConnectedLayer& layer )
+		{ return ( layer.*( &CFullyConnectedParams::paramBlobs ) )[0]; }
+	static const CPtr<CDnnBlob>& FreeTerms( const CFullyConnectedLayer& layer )
+		{ return ( layer.*( &CFullyConnectedParams::paramBlobs ) )[1]; }
+	// Indicates if the weight diffs should be calculated for the layer (see CBaseLayer::IsLearningPerformed)
+	static bool NeedsWeightDiffs( const CFullyConnectedLayer& layer )
+		{ return ( layer.*( &CFullyConnectedParams::IsLearningPerformed ) )(); }
+};
+
+} // namespace NeoML
@@ -21,11 +21,13 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/SplitLayer.h>
 #include <NeoML/Dnn/Layers/ActivationLayers.h>
 #include <NeoML/Dnn/Layers/EltwiseLayer.h>
+#include <Dnn/Layers/FullyConnectedParams.h>
 
 namespace NeoML {
 
 CGruLayer::CGruLayer( IMathEngine& mathEngine ) :
-	CRecurrentLayer( mathEngine, "CCnnGruLayer" )
+	CRecurrentLayer( mathEngine, "CCnnGruLayer" ),
+	isWholeSequenceProcessed( false )
 {
 	buildLayer();
 }
@@ -127,6 +129,185 @@ void CGruLayer::SetHiddenSize(int size)
 	mainBackLink->SetDimSize(BD_Channels, size);
 }
 
+void CGruLayer::RunOnce()
+{
+	isWholeSequenceProcessed = CanProcessWholeSequence();
+	if( isWholeSequenceProcessed ) {
+		runWholeSequence();
+	} else {
+		sequenceGates = nullptr;
+		sequenceMain = nullptr;
+		sequenceResetMain = nullptr;
+		initialMain = nullptr;
+		CRecurrentLayer::RunOnce();
+	}
+}
+
+void CGruLayer::RunInternalDnnBackward()
+{
+	if( isWholeSequenceProcessed ) {
+		backwardWholeSequence();
+	} else {
+		CRecurrentLayer::RunInternalDnnBackward();
+	}
+}
+
+// Splits the fully connected layer weights into the parts for the input and for the previous state
+void CGruLayer::splitWeights( CDnnBlob& weights, CPtr<CDnnBlob>& inputWeights, CPtr<CDnnBlob>& recurWeights ) const
+{
+	const int hiddenSize = GetHiddenSize();
+	const int inputSize = weights.GetObjectSize() - hiddenSize;
+	if( inputWeights == nullptr || inputWeights->GetObjectCount() != weights.GetObjectCount()
+		|| inputWeights->GetObjectSize() != inputSize )
+	{
+		inputWeights = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, weights.GetObjectCount(), inputSize );
+		recurWeights = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, weights.GetObjectCount(), hiddenSize );
+	}
+
+	CBlobDesc weightsDesc = inputWeights->GetDesc();
+	weightsDesc.SetDimSize( BD_Channels, weights.GetObjectSize() );
+	CBlobDesc splitDesc[2] = { inputWeights->GetDesc(), recurWeights->GetDesc() };
+	CFloatHandle splitData[2] = { inputWeights->GetData(), recurWeights->GetData() };
+	MathEngine().BlobSplitByDim( BD_Channels, weightsDesc, weights.GetData(), splitDesc, splitData, 2 );
+}
+
+// Processes the whole sequence at once:
+// the input of all the steps is multiplied by the input weights in one matrix multiplication,
+// then the math engine calculates the recurrent part step by step
+void CGruLayer::runWholeSequence()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int objectCount = inputBlobs[0]->GetObjectCount();
+	const int batchSize = objectCount / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int gatesSize = G_Count * hiddenSize;
+
+	NeoAssert( CFullyConnectedParams::Weights( *gateLayer )->GetObjectSize() == inputSize + hiddenSize );
+	NeoAssert( CFullyConnectedParams::Weights( *mainLayer )->GetObjectSize() == inputSize + hiddenSize );
+	splitWeights( *CFullyConnectedParams::Weights( *gateLayer ), gateInputWeights, gateRecurWeights );
+	splitWeights( *CFullyConnectedParams::Weights( *mainLayer ), mainInputWeights, mainRecurWeights );
+
+	if( sequenceMain == nullptr || sequenceMain->GetDataSize() != objectCount * hiddenSize ) {
+		sequenceGates = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, sequenceLength, batchSize, gatesSize );
+		sequenceMain = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, sequenceLength, batchSize, hiddenSize );
+		sequenceResetMain = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, sequenceLength, batchSize, hiddenSize );
+	}
+
+	// The input part of the gates and of the main output for all the steps
+	MathEngine().MultiplyMatrixByTransposedMatrix( inputBlobs[0]->GetData(), objectCount, inputSize, inputSize,
+		gateInputWeights->GetData(), gatesSize, inputSize, sequenceGates->GetData(), gatesSize,
+		sequenceGates->GetDataSize() );
+	if( !gateLayer->IsZeroFreeTerm() ) {
+		MathEngine().AddVectorToMatrixRows( 1, sequenceGates->GetData(), sequenceGates->GetData(), objectCount,
+			gatesSize, CFullyConnectedParams::FreeTerms( *gateLayer )->GetData() );
+	}
+	MathEngine().MultiplyMatrixByTransposedMatrix( inputBlobs[0]->GetData(), objectCount, inputSize, inputSize,
+		mainInputWeights->GetData(), hiddenSize, inputSize, sequenceMain->GetData(), hiddenSize,
+		sequenceMain->GetDataSize() );
+	if( !mainLayer->IsZeroFreeTerm() ) {
+		MathEngine().AddVectorToMatrixRows( 1, sequenceMain->GetData(), sequenceMain->GetData(), objectCount,
+			hiddenSize, CFullyConnectedParams::FreeTerms( *mainLayer )->GetData() );
+	}
+
+	// The reverse sequence always starts from the empty state
+	CPtr<CDnnBlob> mainState = mainBackLink->GetState();
+	NeoAssert( mainState->GetDataSize() == batchSize * hiddenSize );
+	initialMain = IsReverseSequence() ? nullptr : mainState->GetCopy();
+
+	MathEngine().GruRecurrent( IsReverseSequence(), sequenceLength, batchSize, hiddenSize,
+		sequenceGates->GetData(), sequenceMain->GetData(), gateRecurWeights->GetData(), mainRecurWeights->GetData(),
+		initialMain == nullptr ? CConstFloatHandle() : CConstFloatHandle( initialMain->GetData() ),
+		sequenceGates->GetData(), sequenceMain->GetData(), sequenceResetMain->GetData(), outputBlobs[0]->GetData() );
+
+	// Save the state after the last step
+	const int lastStep = IsReverseSequence() ? 0 : sequenceLength - 1;
+	MathEngine().VectorCopy( mainState->GetData(), outputBlobs[0]->GetObjectData( lastStep * batchSize ),
+		batchSize * hiddenSize );
+}
+
+// The backward pass and learning for the whole sequence
+void CGruLayer::backwardWholeSequence()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int objectCount = inputBlobs[0]->GetObjectCount();
+	const int batchSize = objectCount / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int gatesSize = G_Count * hiddenSize;
+
+	CPtr<CDnnBlob> gatesDiff = sequenceGates->GetClone();
+	CPtr<CDnnBlob> mainDiff = sequenceMain->GetClone();
+	MathEngine().GruRecurrentBackward( IsReverseSequence(), sequenceLength, batchSize, hiddenSize,
+		gateRecurWeights->GetData(), mainRecurWeights->GetData(),
+		initialMain == nullptr ? CConstFloatHandle() : CConstFloatHandle( initialMain->GetData() ),
+		sequenceGates->GetData(), sequenceMain->GetData(), outputBlobs[0]->GetData(), outputDiffBlobs[0]->GetData(),
+		gatesDiff->GetData(), mainDiff->GetData() );
+
+	if( IsBackwardPerformed() ) {
+		CPtr<CDnnBlob> mainInputDiff = inputDiffBlobs[0]->GetClone();
+		MathEngine().MultiplyMatrixByMatrix( 1, gatesDiff->GetData(), objectCount, gatesSize,
+			gateInputWeights->GetData(), inputSize, inputDiffBlobs[0]->GetData(), inputDiffBlobs[0]->GetDataSize() );
+		MathEngine().MultiplyMatrixByMatrix( 1, mainDiff->GetData(), objectCount, hiddenSize,
+			mainInputWeights->GetData(), inputSize, mainInputDiff->GetData(), mainInputDiff->GetDataSize() );
+		inputDiffBlobs[0]->Add( mainInputDiff );
+	}
+
+	if( CFullyConnectedParams::NeedsWeightDiffs( *gateLayer ) ) {
+		learnWholeSequence( *gateLayer, *gatesDiff, *outputBlobs[0], true );
+	}
+	if( CFullyConnectedParams::NeedsWeightDiffs( *mainLayer ) ) {
+		learnWholeSequence( *mainLayer, *mainDiff, *sequenceResetMain, false );
+	}
+}
+
+// Calculates the weights diff of the fully connected layer and passes it to the solver
+// The layer input is the concatenation of the sequence input and recurInput
+// If isShiftedRecurInput is set, the recurrent input of the step is taken from the previous step (or the initial state)
+void CGruLayer::learnWholeSequence( CFullyConnectedLayer& layer, const CDnnBlob& outputDiff, const CDnnBlob& recurInput,
+	bool isShiftedRecurInput )
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int objectCount = inputBlobs[0]->GetObjectCount();
+	const int batchSize = objectCount / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int outputSize = outputDiff.GetObjectSize();
+	const int weightsRowSize = inputSize + hiddenSize;
+
+	CObjectArray<CDnnBlob> diffs;
+	diffs.Add( CFullyConnectedParams::Weights( layer )->GetClone() );
+	diffs.Add( CFullyConnectedParams::FreeTerms( layer )->GetClone() );
+	diffs[0]->Clear();
+	diffs[1]->Clear();
+
+	CFloatHandle weightsDiff = diffs[0]->GetData();
+	CFloatHandle recurWeightsDiff = weightsDiff + inputSize;
+	const int recurWeightsDiffSize = diffs[0]->GetDataSize() - inputSize;
+	MathEngine().MultiplyTransposedMatrixByMatrixAndAdd( outputDiff.GetData(), objectCount, outputSize, outputSize,
+		inputBlobs[0]->GetData(), inputSize, inputSize, weightsDiff, weightsRowSize, diffs[0]->GetDataSize() );
+	if( !isShiftedRecurInput ) {
+		MathEngine().MultiplyTransposedMatrixByMatrixAndAdd( outputDiff.GetData(), objectCount, outputSize, outputSize,
+			recurInput.GetData(), hiddenSize, hiddenSize, recurWeightsDiff, weightsRowSize, recurWeightsDiffSize );
+	} else {
+		if( sequenceLength > 1 ) {
+			const int diffOffset = IsReverseSequence() ? 0 : batchSize * outputSize;
+			const int recurOffset = IsReverseSequence() ? batchSize * hiddenSize : 0;
+			MathEngine().MultiplyTransposedMatrixByMatrixAndAdd( outputDiff.GetData() + diffOffset,
+				objectCount - batchSize, outputSize, outputSize, recurInput.GetData() + recurOffset, hiddenSize, hiddenSize,
+				recurWeightsDiff, weightsRowSize, recurWeightsDiffSize );
+		}
+		if( initialMain != nullptr ) {
+			MathEngine().MultiplyTransposedMatrixByMatrixAndAdd( outputDiff.GetData(), batchSize, outputSize, outputSize,
+				initialMain->GetData(), hiddenSize, hiddenSize, recurWeightsDiff, weightsRowSize, recurWeightsDiffSize );
+		}
+	}
+	if( !layer.IsZeroFreeTerm() ) {
+		MathEngine().SumMatrixRowsAdd( 1, diffs[1]->GetData(), outputDiff.GetData(), objectCount, outputSize );
+	}
+	GetDnn()->GetSolver()->AddDiff( &layer, diffs );
+}
+
 static const int GruLayerVersion = 2000;
 
 void CGruLayer::Serialize( CArchive& archive )
@@ -19,6 +19,7 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/LstmLayer.h>
 #include <NeoML/Dnn/Layers/ConcatLayer.h>
 #include <NeoML/Dnn/Layers/SplitLayer.h>
+#include <Dnn/Layers/FullyConnectedParams.h>
 
 namespace NeoML {
 
@@ -36,7 +37,8 @@ static const char* recurHiddenLayerName = "RecurHidden";
 CLstmLayer::CLstmLayer( IMathEngine& mathEngine ) :
 	CRecurrentLayer( mathEngine, "CCnnLstmLayer" ),
 	recurrentActivation( AF_Sigmoid ),
-	isInCompatibilityMode( false )
+	isInCompatibilityMode( false ),
+	isWholeSequenceProcessed( false )
 {
 	buildLayer(0);
 }
@@ -238,6 +240,173 @@ void CLstmLayer::SetCompatibilityMode( bool compatibilityMode )
 	ForceReshape();
 }
 
+void CLstmLayer::RunOnce()
+{
+	isWholeSequenceProcessed = canProcessWholeSequence();
+	if( isWholeSequenceProcessed ) {
+		runWholeSequence();
+	} else {
+		sequenceGates = nullptr;
+		sequenceState = nullptr;
+		initialMain = nullptr;
+		initialState = nullptr;
+		CRecurrentLayer::RunOnce();
+	}
+}
+
+void CLstmLayer::RunInternalDnnBackward()
+{
+	if( isWholeSequenceProcessed ) {
+		backwardWholeSequence();
+	} else {
+		CRecurrentLayer::RunInternalDnnBackward();
+	}
+}
+
+// Checks if the fused implementation gives the same result as the internal network
+bool CLstmLayer::canProcessWholeSequence() const
+{
+	// The dropout does nothing if there is no backward pass
+	return CanProcessWholeSequence() && recurrentActivation == AF_Sigmoid && !isInCompatibilityMode
+		&& ( inputDropoutLayer == nullptr || !GetDnn()->IsBackwardPerformed() );
+}
+
+// Processes the whole sequence at once:
+// the input of all the steps is multiplied by the input weights in one matrix multiplication,
+// then the math engine calculates the recurrent part step by step
+void CLstmLayer::runWholeSequence()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int objectCount = inputBlobs[0]->GetObjectCount();
+	const int batchSize = objectCount / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int gatesSize = G_Count * hiddenSize;
+
+	const CPtr<CDnnBlob>& inputWeights = CFullyConnectedParams::Weights( *inputHiddenLayer );
+	const CPtr<CDnnBlob>& recurWeights = CFullyConnectedParams::Weights( *recurHiddenLayer );
+	NeoAssert( inputWeights->GetObjectCount() == gatesSize && inputWeights->GetObjectSize() == inputSize );
+	NeoAssert( recurWeights->GetObjectCount() == gatesSize && recurWeights->GetObjectSize() == hiddenSize );
+
+	if( sequenceGates == nullptr || sequenceGates->GetDataSize() != objectCount * gatesSize ) {
+		sequenceGates = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, sequenceLength, batchSize, gatesSize );
+	}
+	if( outputBlobs.Size() < 2 && ( sequenceState == nullptr || sequenceState->GetDataSize() != objectCount * hiddenSize ) ) {
+		sequenceState = outputBlobs[0]->GetClone();
+	}
+	const CPtr<CDnnBlob>& state = outputBlobs.Size() < 2 ? sequenceState : outputBlobs[1];
+
+	// The input part of the gates for all the steps
+	MathEngine().MultiplyMatrixByTransposedMatrix( inputBlobs[0]->GetData(), objectCount, inputSize, inputSize,
+		inputWeights->GetData(), gatesSize, inputSize, sequenceGates->GetData(), gatesSize, sequenceGates->GetDataSize() );
+	if( !inputHiddenLayer->IsZeroFreeTerm() ) {
+		MathEngine().AddVectorToMatrixRows( 1, sequenceGates->GetData(), sequenceGates->GetData(), objectCount,
+			gatesSize, CFullyConnectedParams::FreeTerms( *inputHiddenLayer )->GetData() );
+	}
+	if( !recurHiddenLayer->IsZeroFreeTerm() ) {
+		MathEngine().AddVectorToMatrixRows( 1, sequenceGates->GetData(), sequenceGates->GetData(), objectCount,
+			gatesSize, CFullyConnectedParams::FreeTerms( *recurHiddenLayer )->GetData() );
+	}
+
+	// The reverse sequence always starts from the empty state
+	CPtr<CDnnBlob> mainState = mainBackLink->GetState();
+	CPtr<CDnnBlob> stateState = stateBackLink->GetState();
+	NeoAssert( mainState->GetDataSize() == batchSize * hiddenSize );
+	NeoAssert( stateState->GetDataSize() == batchSize * hiddenSize );
+	if( IsReverseSequence() ) {
+		initialMain = nullptr;
+		initialState = nullptr;
+	} else {
+		initialMain = mainState->GetCopy();
+		initialState = stateState->GetCopy();
+	}
+
+	MathEngine().LstmRecurrent( IsReverseSequence(), sequenceLength, batchSize, hiddenSize,
+		sequenceGates->GetData(), recurWeights->GetData(),
+		initialMain == nullptr ? CConstFloatHandle() : CConstFloatHandle( initialMain->GetData() ),
+		initialState == nullptr ? CConstFloatHandle() : CConstFloatHandle( initialState->GetData() ),
+		sequenceGates->GetData(), outputBlobs[0]->GetData(), state->GetData() );
+
+	// Save the state after the last step
+	const int lastStep = IsReverseSequence() ? 0 : sequenceLength - 1;
+	MathEngine().VectorCopy( mainState->GetData(), outputBlobs[0]->GetObjectData( lastStep * batchSize ),
+		batchSize * hiddenSize );
+	MathEngine().VectorCopy( stateState->GetData(), state->GetObjectData( lastStep * batchSize ),
+		batchSize * hiddenSize );
+}
+
+// The backward pass and learning for the whole sequence
+void CLstmLayer::backwardWholeSequence()
+{
+	const int sequenceLength = inputBlobs[0]->GetBatchLength();
+	const int objectCount = inputBlobs[0]->GetObjectCount();
+	const int batchSize = objectCount / sequenceLength;
+	const int inputSize = inputBlobs[0]->GetObjectSize();
+	const int hiddenSize = GetHiddenSize();
+	const int gatesSize = G_Count * hiddenSize;
+
+	CPtr<CDnnBlob> mainDiff = outputDiffBlobs[0];
+	if( mainDiff == nullptr ) {
+		mainDiff = outputBlobs[0]->GetClone();
+		mainDiff->Clear();
+	}
+	const CPtr<CDnnBlob>& state = outputBlobs.Size() < 2 ? sequenceState : outputBlobs[1];
+	CConstFloatHandle stateDiff = outputDiffBlobs.Size() < 2 || outputDiffBlobs[1] == nullptr ? CConstFloatHandle()
+		: CConstFloatHandle( outputDiffBlobs[1]->GetData() );
+
+	CPtr<CDnnBlob> gatesDiff = sequenceGates->GetClone();
+	MathEngine().LstmRecurrentBackward( IsReverseSequence(), sequenceLength, batchSize, hiddenSize,
+		CFullyConnectedParams::Weights( *recurHiddenLayer )->GetData(),
+		initialState == nullptr ? CConstFloatHandle() : CConstFloatHandle( initialState->GetData() ),
+		sequenceGates->GetData(), state->GetData(), mainDiff->GetData(), stateDiff, gatesDiff->GetData() );
+
+	if( IsBackwardPerformed() ) {
+		MathEngine().MultiplyMatrixByMatrix( 1, gatesDiff->GetData(), objectCount, gatesSize,
+			CFullyConnectedParams::Weights( *inputHiddenLayer )->GetData(), inputSize, inputDiffBlobs[0]->GetData(),
+			inputDiffBlobs[0]->GetDataSize() );
+	}
+
+	CDnnSolver* solver = GetDnn()->GetSolver();
+	if( CFullyConnectedParams::NeedsWeightDiffs( *inputHiddenLayer ) ) {
+		CObjectArray<CDnnBlob> diffs;
+		diffs.Add( CFullyConnectedParams::Weights( *inputHiddenLayer )->GetClone() );
+		diffs.Add( CFullyConnectedParams::FreeTerms( *inputHiddenLayer )->GetClone() );
+		diffs[0]->Clear();
+		diffs[1]->Clear();
+		MathEngine().MultiplyTransposedMatrixByMatrixAndAdd( gatesDiff->GetData(), objectCount, gatesSize, gatesSize,
+			inputBlobs[0]->GetData(), inputSize, inputSize, diffs[0]->GetData(), inputSize, diffs[0]->GetDataSize() );
+		if( !inputHiddenLayer->IsZeroFreeTerm() ) {
+			MathEngine().SumMatrixRowsAdd( 1, diffs[1]->GetData(), gatesDiff->GetData(), objectCount, gatesSize );
+		}
+		solver->AddDiff( inputHiddenLayer, diffs );
+	}
+
+	if( CFullyConnectedParams::NeedsWeightDiffs( *recurHiddenLayer ) ) {
+		CObjectArray<CDnnBlob> diffs;
+		diffs.Add( CFullyConnectedParams::Weights( *recurHiddenLayer )->GetClone() );
+		diffs.Add( CFullyConnectedParams::FreeTerms( *recurHiddenLayer )->GetClone() );
+		diffs[0]->Clear();
+		diffs[1]->Clear();
+		// The previous h of each step except the first one is the output of the adjacent step
+		const int stepSize = batchSize * hiddenSize;
+		if( sequenceLength > 1 ) {
+			const int diffOffset = IsReverseSequence() ? 0 : batchSize * gatesSize;
+			const int mainOffset = IsReverseSequence() ? stepSize : 0;
+			MathEngine().MultiplyTransposedMatrixByMatrixAndAdd( gatesDiff->GetData() + diffOffset,
+				objectCount - batchSize, gatesSize, gatesSize, outputBlobs[0]->GetData() + mainOffset,
+				hiddenSize, hiddenSize, diffs[0]->GetData(), hiddenSize, diffs[0]->GetDataSize() );
+		}
+		if( initialMain != nullptr ) {
+			MathEngine().MultiplyTransposedMatrixByMatrixAndAdd( gatesDiff->GetData(), batchSize, gatesSize, gatesSize,
+				initialMain->GetData(), hiddenSize, hiddenSize, diffs[0]->GetData(), hiddenSize, diffs[0]->GetDataSize() );
+		}
+		if( !recurHiddenLayer->IsZeroFreeTerm() ) {
+			MathEngine().SumMatrixRowsAdd( 1, diffs[1]->GetData(), gatesDiff->GetData(), objectCount, gatesSize );
+		}
+		solver->AddDiff( recurHiddenLayer, diffs );
+	}
+}
+
 static const int LstmLayerVersion = 2001;
 
 void CLstmLayer::Serialize( CArchive& archive )
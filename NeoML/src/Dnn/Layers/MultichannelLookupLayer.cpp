@@ -227,6 +227,9 @@ void CMultichannelLookupLayer::LearnOnce()
 					learningRate, outputDiffBlobs[i]->GetData(), outputBlobs[i]->GetChannelsCount() );
 			}
 		}
+		if( GetDnn()->GetSolver()->IsSparseUpdateEnabled() ) {
+			addDiffRows();
+		}
 	} else {
 		const float rate = GetDnn()->GetSolver()->GetLearningRate() * GetBaseLearningRate();
 		learningRate.SetValue( -rate );
@@ -255,6 +258,38 @@ void CMultichannelLookupLayer::LearnOnce()
 	}
 }
 
+// Passes the indices of the embeddings used on the step to the solver
+void CMultichannelLookupLayer::addDiffRows()
+{
+	CArray<CArray<int>> rows;
+	rows.SetSize( GetDimensions().Size() );
+	CArray<int> indices;
+	for( int i = 0; i < inputBlobs.Size(); i++ ) {
+		indices.SetSize( inputBlobs[i]->GetDataSize() );
+		if( inputBlobs[i]->GetDataType() == CT_Float ) {
+			CArray<float> values;
+			values.SetSize( inputBlobs[i]->GetDataSize() );
+			inputBlobs[i]->CopyTo( values.GetPtr() );
+			for( int j = 0; j < values.Size(); j++ ) {
+				indices[j] = static_cast<int>( values[j] );
+			}
+		} else {
+			inputBlobs[i]->CopyTo( indices.GetPtr() );
+		}
+
+		const int channelCount = inputBlobs[i]->GetChannelsCount();
+		for( int pos = 0; pos < indices.Size(); pos += channelCount ) {
+			for( int j = 0; j < rows.Size(); j++ ) {
+				rows[j].Add( indices[pos + j] );
+			}
+		}
+	}
+
+	for( int j = 0; j < rows.Size(); j++ ) {
+		GetDnn()->GetSolver()->AddDiffRows( this, j, GetDimensions()[j].VectorSize, rows[j].GetPtr(), rows[j].Size() );
+	}
+}
+
 void CMultichannelLookupLayer::Word2VecStep( IMathEngine& mathEngine, int batchSize,
 	CMultichannelLookupLayer& word2vecLayer, CMultichannelLookupLayer& context2vecLayer,
 	const CConstIntHandle& positiveSampleMatrix, int positiveCount,
@@ -25,6 +25,7 @@ limitations under the License.
 #include <NeoML/Dnn/Layers/TransformLayer.h>
 #include <NeoML/Dnn/Layers/TransposeLayer.h>
 #include <NeoML/Dnn/Layers/SoftmaxLayer.h>
+#include <Dnn/Layers/FullyConnectedParams.h>
 
 namespace NeoML {
 
@@ -96,6 +97,77 @@ void CMultiheadAttentionLayer::Reshape()
 	CCompositeLayer::Reshape();
 }
 
+void CMultiheadAttentionLayer::RunOnce()
+{
+	if( canRunFusedAttention() ) {
+		runFusedAttention();
+	} else {
+		CCompositeLayer::RunOnce();
+	}
+}
+
+// Checks if the fused implementation may be used instead of the internal network
+bool CMultiheadAttentionLayer::canRunFusedAttention() const
+{
+	// The fused implementation doesn't store the softmax output needed for the backward pass
+	// The dropout does nothing if there is no backward pass
+	return MathEngine().GetType() == MET_Cpu && !GetDnn()->IsBackwardPerformed()
+		&& GetOutputCount() == 1;
+}
+
+// Calculates the output with the scaled dot-product attention kernel
+// The heads are interleaved in the channels, so no transposition is needed:
+// the result of the kernel has the same layout as the input of the output fully-connected layer
+void CMultiheadAttentionLayer::runFusedAttention()
+{
+	const CBlobDesc& queryDesc = inputBlobs[I_Q]->GetDesc();
+	const CBlobDesc& keyDesc = inputBlobs[I_K]->GetDesc();
+	const int batchSize = queryDesc.BatchLength() * queryDesc.BatchWidth();
+	const int querySize = queryDesc.ListSize();
+	const int keySize = keyDesc.ListSize();
+	NeoAssert( keyDesc.BatchLength() * keyDesc.BatchWidth() == batchSize );
+
+	CPtr<CDnnBlob> query = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, batchSize * querySize, hiddenSize );
+	CPtr<CDnnBlob> key = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, batchSize * keySize, hiddenSize );
+	CPtr<CDnnBlob> value = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, batchSize * keySize, hiddenSize );
+	applyFullyConnected( "Q", *inputBlobs[I_Q], *query );
+	applyFullyConnected( "K", *inputBlobs[I_K], *key );
+	applyFullyConnected( "V", *inputBlobs[I_V], *value );
+
+	CConstFloatHandle mask;
+	if( useMask ) {
+		NeoAssert( inputBlobs[I_Mask]->GetDataSize() == querySize * keySize );
+		mask = inputBlobs[I_Mask]->GetData();
+	}
+
+	// The same scaling factor as in the internal network
+	const float multiplier = static_cast<float>( 1.0 / sqrt( 1.0 * hiddenSize ) );
+	CPtr<CDnnBlob> attention = query->GetClone();
+	MathEngine().ScaledDotProductAttention( batchSize, headCount, querySize, keySize, hiddenSize / headCount,
+		multiplier, query->GetData(), key->GetData(), value->GetData(), mask, attention->GetData() );
+
+	applyFullyConnected( "Out.Dense", *attention, *outputBlobs[O_Output] );
+}
+
+// Calculates the output of the internal fully-connected layer for the given input
+void CMultiheadAttentionLayer::applyFullyConnected( const char* name, const CDnnBlob& input, CDnnBlob& output )
+{
+	CPtr<CFullyConnectedLayer> fc = CheckCast<CFullyConnectedLayer>( GetLayer( name ) );
+	const CPtr<CDnnBlob>& weights = CFullyConnectedParams::Weights( *fc );
+	const int objectCount = input.GetObjectCount();
+	const int inputSize = input.GetObjectSize();
+	const int outputSize = weights->GetObjectCount();
+	NeoAssert( weights->GetObjectSize() == inputSize );
+	NeoAssert( output.GetDataSize() == objectCount * outputSize );
+
+	MathEngine().MultiplyMatrixByTransposedMatrix( input.GetData(), objectCount, inputSize, inputSize,
+		weights->GetData(), outputSize, inputSize, output.GetData(), outputSize, output.GetDataSize() );
+	if( !fc->IsZeroFreeTerm() ) {
+		MathEngine().AddVectorToMatrixRows( 1, output.GetData(), output.GetData(), objectCount, outputSize,
+			CFullyConnectedParams::FreeTerms( *fc )->GetData() );
+	}
+}
+
 // Creates layer with new parameters
 // Here and further blob sizes are shown as [BathcWidth, ListSize, Width, Channels]
 void CMultiheadAttentionLayer::create()
@@ -0,0 +1,389 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <NeoML/Dnn/Layers/PrefetchSourceLayer.h>
+#include <NeoML/TraditionalML/Shuffler.h>
+
+namespace NeoML {
+
+CProblemDataReader::CProblemDataReader( const IProblem* _problem, TBlobType _labelType, float _emptyFill ) :
+	problem( _problem ),
+	labelType( _labelType ),
+	emptyFill( _emptyFill ),
+	labelSize( _problem->GetClassCount() == 2 ? 1 : _problem->GetClassCount() )
+{
+	NeoAssert( labelType == CT_Float || labelType == CT_Int );
+}
+
+void CProblemDataReader::GetObjectDescs( CArray<CBlobDesc>& descs ) const
+{
+	descs.SetSize( 3 );
+	// The data
+	descs[0] = CBlobDesc( CT_Float );
+	descs[0].SetDimSize( BD_Channels, problem->GetFeatureCount() );
+	// The labels
+	descs[1] = CBlobDesc( labelType );
+	if( labelType != CT_Int ) {
+		descs[1].SetDimSize( BD_Channels, labelSize );
+	}
+	// The weights
+	descs[2] = CBlobDesc( CT_Float );
+}
+
+void CProblemDataReader::ReadObject( int index, void* const* data )
+{
+	float* vectorData = static_cast<float*>( data[0] );
+	const int featureCount = problem->GetFeatureCount();
+	for( int i = 0; i < featureCount; ++i ) {
+		vectorData[i] = emptyFill;
+	}
+	CFloatVectorDesc vector;
+	problem->GetMatrix().GetRow( index, vector );
+	for( int i = 0; i < vector.Size; ++i ) {
+		vectorData[vector.Indexes == nullptr ? i : vector.Indexes[i]] = vector.Values[i];
+	}
+
+	if( labelType == CT_Int ) {
+		*static_cast<int*>( data[1] ) = problem->GetClass( index );
+	} else if( labelSize == 1 ) {
+		*static_cast<float*>( data[1] ) = static_cast<float>( problem->GetBinaryClass( index ) );
+	} else {
+		float* labels = static_cast<float*>( data[1] );
+		const int classLabel = problem->GetClass( index );
+		NeoAssert( 0 <= classLabel && classLabel < labelSize );
+		for( int i = 0; i < labelSize; ++i ) {
+			labels[i] = 0;
+		}
+		labels[classLabel] = 1;
+	}
+
+	*static_cast<float*>( data[2] ) = static_cast<float>( problem->GetVectorWeight( index ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A batch read by a background thread
+struct CDnnPrefetchBatch {
+	// The objects of the batch
+	CArray<int> Indices;
+	// The data for each output; the integer data is stored in the float arrays as is
+	CArray<CArray<float>> Buffers;
+	bool IsReady;
+	std::exception_ptr Error;
+
+	CDnnPrefetchBatch() : IsReady( false ) {}
+};
+
+// The batches read in advance by the background threads
+class CDnnPrefetchQueue {
+public:
+	CDnnPrefetchQueue( IDnnDataReader& reader, int batchSize, int queueSize, int threadCount,
+		bool isShuffled, unsigned int seed );
+	~CDnnPrefetchQueue();
+
+	// Waits for the next batch and copies it into the blobs (one blob per output)
+	// Rethrows the exception thrown by the reader
+	void GetNextBatch( const CObjectArray<CDnnBlob>& blobs );
+
+private:
+	const CPtr<IDnnDataReader> reader;
+	CArray<CBlobDesc> objectDescs;
+	const int batchSize;
+	const bool isShuffled;
+	CRandom random;
+	// The objects of the current epoch in the order they are passed
+	CArray<int> order;
+	int orderPos;
+
+	std::mutex lock;
+	std::condition_variable batchFree;
+	std::condition_variable batchReady;
+	// The ring of batches; the batch with the number n is stored at n % batches.Size()
+	CPointerArray<CDnnPrefetchBatch> batches;
+	// The number of the batch to be read next
+	int64_t nextRead;
+	// The number of the batch to be passed into the network next
+	int64_t nextOutput;
+	bool isStopping;
+	std::vector<std::thread> threads;
+
+	void threadMain();
+	void getNextIndices( CArray<int>& indices );
+	void readBatch( CDnnPrefetchBatch& batch );
+};
+
+CDnnPrefetchQueue::CDnnPrefetchQueue( IDnnDataReader& _reader, int _batchSize, int queueSize, int threadCount,
+		bool _isShuffled, unsigned int seed ) :
+	reader( &_reader ),
+	batchSize( _batchSize ),
+	isShuffled( _isShuffled ),
+	random( seed ),
+	orderPos( 0 ),
+	nextRead( 0 ),
+	nextOutput( 0 ),
+	isStopping( false )
+{
+	reader->GetObjectDescs( objectDescs );
+	const int objectCount = reader->GetObjectCount();
+	NeoAssert( objectCount > 0 );
+	order.SetSize( objectCount );
+	for( int i = 0; i < objectCount; ++i ) {
+		order[i] = i;
+	}
+	if( isShuffled ) {
+		// The order is shuffled when the epoch starts
+		orderPos = objectCount;
+	}
+
+	for( int i = 0; i < queueSize; ++i ) {
+		CDnnPrefetchBatch* batch = FINE_DEBUG_NEW CDnnPrefetchBatch;
+		batch->Indices.SetSize( batchSize );
+		batch->Buffers.SetSize( objectDescs.Size() );
+		for( int j = 0; j < objectDescs.Size(); ++j ) {
+			batch->Buffers[j].SetSize( batchSize * objectDescs[j].ObjectSize() );
+		}
+		batches.Add( batch );
+	}
+
+	for( int i = 0; i < threadCount; ++i ) {
+		threads.push_back( std::thread( &CDnnPrefetchQueue::threadMain, this ) );
+	}
+}
+
+CDnnPrefetchQueue::~CDnnPrefetchQueue()
+{
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		isStopping = true;
+	}
+	batchFree.notify_all();
+	for( size_t i = 0; i < threads.size(); ++i ) {
+		threads[i].join();
+	}
+}
+
+void CDnnPrefetchQueue::GetNextBatch( const CObjectArray<CDnnBlob>& blobs )
+{
+	CDnnPrefetchBatch& batch = *batches[static_cast<int>( nextOutput % batches.Size() )];
+	{
+		std::unique_lock<std::mutex> guard( lock );
+		batchReady.wait( guard, [&batch]() { return batch.IsReady; } );
+	}
+
+	// The batch is not changed by the threads until it is released
+	std::exception_ptr error = batch.Error;
+	if( error == nullptr ) {
+		static_assert( sizeof( float ) == sizeof( int ), "sizeof( float ) != sizeof( int )" );
+		for( int i = 0; i < blobs.Size(); ++i ) {
+			if( blobs[i]->GetDataType() == CT_Float ) {
+				blobs[i]->CopyFrom( batch.Buffers[i].GetPtr() );
+			} else {
+				blobs[i]->CopyFrom( reinterpret_cast<const int*>( batch.Buffers[i].GetPtr() ) );
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		batch.IsReady = false;
+		batch.Error = nullptr;
+		++nextOutput;
+	}
+	batchFree.notify_all();
+
+	if( error != nullptr ) {
+		std::rethrow_exception( error );
+	}
+}
+
+void CDnnPrefetchQueue::threadMain()
+{
+	std::unique_lock<std::mutex> guard( lock );
+	while( true ) {
+		batchFree.wait( guard, [this]() { return isStopping || nextRead < nextOutput + batches.Size(); } );
+		if( isStopping ) {
+			return;
+		}
+
+		CDnnPrefetchBatch& batch = *batches[static_cast<int>( nextRead % batches.Size() )];
+		++nextRead;
+		getNextIndices( batch.Indices );
+
+		guard.unlock();
+		try {
+			readBatch( batch );
+		} catch( ... ) {
+			batch.Error = std::current_exception();
+		}
+		guard.lock();
+
+		batch.IsReady = true;
+		batchReady.notify_all();
+	}
+}
+
+// Gets the objects of the next batch; called under the lock
+void CDnnPrefetchQueue::getNextIndices( CArray<int>& indices )
+{
+	for( int i = 0; i < batchSize; ++i ) {
+		if( orderPos == order.Size() ) {
+			// The next epoch
+			if( isShuffled ) {
+				CShuffler shuffler( random, order.Size() );
+				shuffler.GetAllIndices().CopyTo( order );
+			}
+			orderPos = 0;
+		}
+		indices[i] = order[orderPos];
+		++orderPos;
+	}
+}
+
+void CDnnPrefetchQueue::readBatch( CDnnPrefetchBatch& batch )
+{
+	CArray<void*> data;
+	data.SetSize( objectDescs.Size() );
+	for( int i = 0; i < batchSize; ++i ) {
+		for( int j = 0; j < objectDescs.Size(); ++j ) {
+			data[j] = batch.Buffers[j].GetPtr() + i * objectDescs[j].ObjectSize();
+		}
+		reader->ReadObject( batch.Indices[i], data.GetPtr() );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CPrefetchSourceLayer::CPrefetchSourceLayer( IMathEngine& mathEngine ) :
+	CBaseLayer( mathEngine, "CDnnPrefetchSourceLayer", false ),
+	batchSize( 1 ),
+	queueSize( 2 ),
+	threadCount( 1 ),
+	isShuffled( false ),
+	shuffleSeed( 0xDEADFACE ),
+	queue( nullptr )
+{
+}
+
+CPrefetchSourceLayer::~CPrefetchSourceLayer()
+{
+	stopReading();
+}
+
+void CPrefetchSourceLayer::SetReader( IDnnDataReader* _reader )
+{
+	stopReading();
+	reader = _reader;
+	ForceReshape();
+}
+
+void CPrefetchSourceLayer::SetBatchSize( int _batchSize )
+{
+	NeoAssert( _batchSize > 0 );
+	stopReading();
+	if( batchSize != _batchSize ) {
+		batchSize = _batchSize;
+		ForceReshape();
+	}
+}
+
+void CPrefetchSourceLayer::SetQueueSize( int _queueSize )
+{
+	NeoAssert( _queueSize > 0 );
+	stopReading();
+	queueSize = _queueSize;
+}
+
+void CPrefetchSourceLayer::SetThreadCount( int _threadCount )
+{
+	NeoAssert( _threadCount > 0 );
+	stopReading();
+	threadCount = _threadCount;
+}
+
+void CPrefetchSourceLayer::SetShuffle( bool _isShuffled, unsigned int seed )
+{
+	stopReading();
+	isShuffled = _isShuffled;
+	shuffleSeed = seed;
+}
+
+void CPrefetchSourceLayer::Reshape()
+{
+	NeoAssert( !GetDnn()->IsRecurrentMode() );
+
+	CheckArchitecture( reader != nullptr, GetName(), "data reader is null" );
+	CheckOutputs();
+
+	CArray<CBlobDesc> objectDescs;
+	reader->GetObjectDescs( objectDescs );
+	CheckArchitecture( GetOutputCount() <= objectDescs.Size(), GetName(), "the reader has fewer outputs than the layer" );
+	for( int i = 0; i < GetOutputCount(); ++i ) {
+		CheckArchitecture( objectDescs[i].GetDataType() == CT_Float || objectDescs[i].GetDataType() == CT_Int,
+			GetName(), "the reader output data type is neither float nor int" );
+		outputDescs[i] = objectDescs[i];
+		outputDescs[i].SetDimSize( BD_BatchLength, 1 );
+		outputDescs[i].SetDimSize( BD_BatchWidth, batchSize );
+		outputDescs[i].SetDimSize( BD_ListSize, 1 );
+	}
+}
+
+void CPrefetchSourceLayer::RunOnce()
+{
+	NeoAssert( reader != nullptr );
+
+	if( queue == nullptr ) {
+		queue = FINE_DEBUG_NEW CDnnPrefetchQueue( *reader, batchSize, queueSize, threadCount, isShuffled, shuffleSeed );
+	}
+	queue->GetNextBatch( outputBlobs );
+}
+
+void CPrefetchSourceLayer::BackwardOnce()
+{
+	NeoAssert( false );
+}
+
+void CPrefetchSourceLayer::stopReading()
+{
+	delete queue;
+	queue = nullptr;
+}
+
+static const int PrefetchSourceLayerVersion = 0;
+
+void CPrefetchSourceLayer::Serialize( CArchive& archive )
+{
+	archive.SerializeVersion( PrefetchSourceLayerVersion );
+	CBaseLayer::Serialize( archive );
+
+	if( archive.IsLoading() ) {
+		stopReading();
+		reader = nullptr;
+	}
+	archive.Serialize( batchSize );
+	archive.Serialize( queueSize );
+	archive.Serialize( threadCount );
+	archive.Serialize( isShuffled );
+	archive.Serialize( shuffleSeed );
+}
+
+} // namespace NeoML
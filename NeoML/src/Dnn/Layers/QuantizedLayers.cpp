@@ -0,0 +1,287 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/Dnn/Layers/QuantizedLayers.h>
+#include <NeoML/Dnn/Layers/FullyConnectedLayer.h>
+#include <NeoML/Dnn/Layers/ConvLayer.h>
+#include <NeoMathEngine/NeoMathEngine.h>
+#include <cmath>
+
+namespace NeoML {
+
+// Quantizes each row of the weights with its own scale
+// The maximum absolute value of the row is mapped to 127
+static void quantizeWeights( IMathEngine& mathEngine, const CDnnBlob& weights,
+	CPtr<CDnnBlob>& quantized, CPtr<CDnnBlob>& scales )
+{
+	const int height = weights.GetObjectCount();
+	const int width = weights.GetObjectSize();
+	const int rowSize = QuantizedMatrixRowSize( width );
+
+	CArray<float> buffer;
+	buffer.SetSize( weights.GetDataSize() );
+	weights.CopyTo( buffer.GetPtr() );
+
+	CArray<int> quantizedBuffer;
+	quantizedBuffer.Add( 0, height * rowSize );
+	CArray<float> scalesBuffer;
+	scalesBuffer.SetSize( height );
+
+	for( int i = 0; i < height; ++i ) {
+		const float* row = buffer.GetPtr() + i * width;
+		signed char* quantizedRow = reinterpret_cast<signed char*>( quantizedBuffer.GetPtr() + i * rowSize );
+
+		float maxAbs = 0;
+		for( int j = 0; j < width; ++j ) {
+			maxAbs = max( maxAbs, fabsf( row[j] ) );
+		}
+		scalesBuffer[i] = maxAbs > 0 ? maxAbs / 127.f : 1.f;
+
+		for( int j = 0; j < width; ++j ) {
+			const float value = roundf( row[j] / scalesBuffer[i] );
+			quantizedRow[j] = static_cast<signed char>( max( -127.f, min( 127.f, value ) ) );
+		}
+	}
+
+	quantized = CDnnBlob::CreateDataBlob( mathEngine, CT_Int, 1, height, rowSize );
+	quantized->CopyFrom( quantizedBuffer.GetPtr() );
+	scales = CDnnBlob::CreateVector( mathEngine, CT_Float, height );
+	scales->CopyFrom( scalesBuffer.GetPtr() );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CQuantizedFullyConnectedLayer::CQuantizedFullyConnectedLayer( IMathEngine& mathEngine ) :
+	CBaseLayer( mathEngine, "CQuantizedFullyConnectedLayer", false ),
+	numberOfElements( 0 ),
+	inputSize( 0 ),
+	inputScale( 1.f )
+{
+	paramBlobs.SetSize( 3 );
+}
+
+void CQuantizedFullyConnectedLayer::SetWeights( const CFullyConnectedLayer& source )
+{
+	CPtr<CDnnBlob> weights = source.GetWeightsData();
+	NeoAssert( weights != 0 );
+
+	numberOfElements = source.GetNumberOfElements();
+	inputSize = weights->GetObjectSize();
+	quantizeWeights( MathEngine(), *weights, paramBlobs[0], paramBlobs[1] );
+	paramBlobs[2] = source.IsZeroFreeTerm() ? nullptr : source.GetFreeTermData();
+	ForceReshape();
+}
+
+void CQuantizedFullyConnectedLayer::SetInputScale( float scale )
+{
+	NeoAssert( scale > 0 );
+	inputScale = scale;
+}
+
+void CQuantizedFullyConnectedLayer::Reshape()
+{
+	CheckInputs();
+	CheckArchitecture( GetInputCount() == GetOutputCount(),
+		GetName(), "quantized fully connected layer with different numbers of input and output" );
+	CheckArchitecture( Weights() != 0, GetName(), "weights are not set" );
+	CheckArchitecture( !IsBackwardPerformed(), GetName(), "quantized layer does not support backward" );
+	CheckArchitecture( MathEngine().GetType() == MET_Cpu, GetName(), "quantized layer is supported only on CPU" );
+
+	for( int i = 0; i < GetInputCount(); i++ ) {
+		CheckArchitecture( inputDescs[i].ObjectSize() == inputSize, GetName(), "weights size mismatch" );
+
+		outputDescs[i] = inputDescs[i];
+		outputDescs[i].SetDimSize( BD_Height, 1 );
+		outputDescs[i].SetDimSize( BD_Width, 1 );
+		outputDescs[i].SetDimSize( BD_Depth, 1 );
+		outputDescs[i].SetDimSize( BD_Channels, numberOfElements );
+	}
+}
+
+void CQuantizedFullyConnectedLayer::RunOnce()
+{
+	for( int i = 0; i < GetInputCount(); i++ ) {
+		CFloatHandle outputData = outputBlobs[i]->GetData();
+		MathEngine().MultiplyMatrixByTransposedQuantizedMatrix( inputBlobs[i]->GetData(), inputBlobs[i]->GetObjectCount(),
+			inputSize, inputScale, Weights()->GetData<int>(), Scales()->GetData(), numberOfElements, outputData );
+
+		if( FreeTerms() != 0 ) {
+			MathEngine().AddVectorToMatrixRows( 1, outputData, outputData, inputBlobs[i]->GetObjectCount(),
+				numberOfElements, FreeTerms()->GetData() );
+		}
+	}
+}
+
+void CQuantizedFullyConnectedLayer::BackwardOnce()
+{
+	NeoAssert( false );
+}
+
+static const int QuantizedFullyConnectedLayerVersion = 0;
+
+void CQuantizedFullyConnectedLayer::Serialize( CArchive& archive )
+{
+	archive.SerializeVersion( QuantizedFullyConnectedLayerVersion );
+	CBaseLayer::Serialize( archive );
+
+	archive.Serialize( numberOfElements );
+	archive.Serialize( inputSize );
+	archive.Serialize( inputScale );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CQuantizedConvLayer::CQuantizedConvLayer( IMathEngine& mathEngine ) :
+	CBaseLayer( mathEngine, "CQuantizedConvLayer", false ),
+	filterCount( 0 ),
+	filterHeight( 1 ),
+	filterWidth( 1 ),
+	filterDepth( 1 ),
+	filterChannels( 1 ),
+	strideHeight( 1 ),
+	strideWidth( 1 ),
+	paddingHeight( 0 ),
+	paddingWidth( 0 ),
+	dilationHeight( 1 ),
+	dilationWidth( 1 ),
+	inputScale( 1.f ),
+	convDesc( nullptr )
+{
+	paramBlobs.SetSize( 3 );
+}
+
+CQuantizedConvLayer::~CQuantizedConvLayer()
+{
+	destroyConvDesc();
+}
+
+void CQuantizedConvLayer::destroyConvDesc()
+{
+	if( convDesc != nullptr ) {
+		delete convDesc;
+		convDesc = nullptr;
+	}
+}
+
+void CQuantizedConvLayer::SetWeights( const CConvLayer& source )
+{
+	CPtr<CDnnBlob> filter = source.GetFilterData();
+	NeoAssert( filter != 0 );
+
+	filterCount = source.GetFilterCount();
+	filterHeight = source.GetFilterHeight();
+	filterWidth = source.GetFilterWidth();
+	filterDepth = filter->GetDepth();
+	filterChannels = filter->GetChannelsCount();
+	strideHeight = source.GetStrideHeight();
+	strideWidth = source.GetStrideWidth();
+	paddingHeight = source.GetPaddingHeight();
+	paddingWidth = source.GetPaddingWidth();
+	dilationHeight = source.GetDilationHeight();
+	dilationWidth = source.GetDilationWidth();
+	quantizeWeights( MathEngine(), *filter, paramBlobs[0], paramBlobs[1] );
+	paramBlobs[2] = source.IsZeroFreeTerm() ? nullptr : source.GetFreeTermData();
+	ForceReshape();
+}
+
+void CQuantizedConvLayer::SetInputScale( float scale )
+{
+	NeoAssert( scale > 0 );
+	inputScale = scale;
+}
+
+void CQuantizedConvLayer::Reshape()
+{
+	CheckInputs();
+	CheckArchitecture( GetInputCount() == GetOutputCount(),
+		GetName(), "different number of inputs and outputs in quantized conv layer" );
+	CheckArchitecture( Filter() != 0, GetName(), "filter is not set" );
+	CheckArchitecture( !IsBackwardPerformed(), GetName(), "quantized layer does not support backward" );
+	CheckArchitecture( MathEngine().GetType() == MET_Cpu, GetName(), "quantized layer is supported only on CPU" );
+
+	const int outputHeight = 1 + ( inputDescs[0].Height() - ( filterHeight - 1 ) * dilationHeight + 2 * paddingHeight - 1 )
+		/ strideHeight;
+	const int outputWidth = 1 + ( inputDescs[0].Width() - ( filterWidth - 1 ) * dilationWidth + 2 * paddingWidth - 1 )
+		/ strideWidth;
+	for( int i = 0; i < GetInputCount(); i++ ) {
+		CheckArchitecture( inputDescs[i].Depth() == filterDepth && inputDescs[i].Channels() == filterChannels,
+			GetName(), "filter size mismatch" );
+
+		outputDescs[i] = inputDescs[i];
+		outputDescs[i].SetDimSize( BD_Height, outputHeight );
+		outputDescs[i].SetDimSize( BD_Width, outputWidth );
+		outputDescs[i].SetDimSize( BD_Depth, 1 );
+		outputDescs[i].SetDimSize( BD_Channels, filterCount );
+	}
+
+	destroyConvDesc();
+}
+
+void CQuantizedConvLayer::RunOnce()
+{
+	if( convDesc == nullptr ) {
+		CBlobDesc filterDesc( CT_Float );
+		filterDesc.SetDimSize( BD_BatchWidth, filterCount );
+		filterDesc.SetDimSize( BD_Height, filterHeight );
+		filterDesc.SetDimSize( BD_Width, filterWidth );
+		filterDesc.SetDimSize( BD_Depth, filterDepth );
+		filterDesc.SetDimSize( BD_Channels, filterChannels );
+		convDesc = MathEngine().InitBlobConvolution( inputBlobs[0]->GetDesc(),
+			paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth,
+			filterDesc, outputBlobs[0]->GetDesc() );
+	}
+
+	CConstFloatHandle freeTerm = FreeTerms() != 0 ? FreeTerms()->GetData() : CConstFloatHandle();
+	for( int i = 0; i < outputBlobs.Size(); ++i ) {
+		MathEngine().QuantizedBlobConvolution( *convDesc, inputBlobs[i]->GetData(), inputScale,
+			Filter()->GetData<int>(), Scales()->GetData(), FreeTerms() != 0 ? &freeTerm : nullptr,
+			outputBlobs[i]->GetData() );
+	}
+}
+
+void CQuantizedConvLayer::BackwardOnce()
+{
+	NeoAssert( false );
+}
+
+static const int QuantizedConvLayerVersion = 0;
+
+void CQuantizedConvLayer::Serialize( CArchive& archive )
+{
+	archive.SerializeVersion( QuantizedConvLayerVersion );
+	CBaseLayer::Serialize( archive );
+
+	archive.Serialize( filterCount );
+	archive.Serialize( filterHeight );
+	archive.Serialize( filterWidth );
+	archive.Serialize( filterDepth );
+	archive.Serialize( filterChannels );
+	archive.Serialize( strideHeight );
+	archive.Serialize( strideWidth );
+	archive.Serialize( paddingHeight );
+	archive.Serialize( paddingWidth );
+	archive.Serialize( dilationHeight );
+	archive.Serialize( dilationWidth );
+	archive.Serialize( inputScale );
+
+	if( archive.IsLoading() ) {
+		destroyConvDesc();
+	}
+}
+
+} // namespace NeoML
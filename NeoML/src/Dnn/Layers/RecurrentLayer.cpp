@@ -215,6 +215,14 @@ void CRecurrentLayer::RunInternalDnnBackward()
 	}
 }
 
+bool CRecurrentLayer::CanProcessWholeSequence() const
+{
+	// Only the outermost layer has the whole sequence at once
+	// The initial state passed through the inputs and the repeated sequence are processed by the internal network
+	return MathEngine().GetType() == MET_Cpu && !GetDnn()->IsRecurrentMode()
+		&& repeatCount == 1 && GetInputCount() == 1;
+}
+
 void CRecurrentLayer::serializationHook(CArchive& archive)
 {
 	if( archive.IsStoring() ) {
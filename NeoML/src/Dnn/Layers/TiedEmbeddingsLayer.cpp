@@ -147,6 +147,19 @@ void CTiedEmbeddingsLayer::LearnOnce()
 		}
 	}
 
+	if( GetDnn()->GetSolver()->IsSparseUpdateEnabled() ) {
+		// The whole table of the channel is changed, the other tables are not
+		CArray<int> rows;
+		rows.SetBufferSize( vectorsCount );
+		for( int i = 0; i < vectorsCount; i++ ) {
+			rows.Add( i );
+		}
+		for( int i = 0; i < channelsCount; i++ ) {
+			GetDnn()->GetSolver()->AddDiffRows( embeddingsLayer, i, embeddingsLayer->GetDimensions()[i].VectorSize,
+				rows.GetPtr(), i == channelIndex ? rows.Size() : 0 );
+		}
+	}
+
 	GetDnn()->GetSolver()->AddDiff( embeddingsLayer, totalDiffBlobs, true );
 }
 
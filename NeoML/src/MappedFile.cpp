@@ -0,0 +1,281 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoML/NeoMLDefs.h>
+#include <NeoML/MappedFile.h>
+
+#include <cerrno>
+
+#if FINE_PLATFORM( FINE_WINDOWS )
+#include <windows.h>
+#elif FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN ) || FINE_PLATFORM( FINE_IOS ) || FINE_PLATFORM( FINE_ANDROID )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#error Unknown platform
+#endif
+
+namespace NeoML {
+
+static inline void throwMappedFileException( int errorCode, const CString& fileName )
+{
+#ifdef NEOML_USE_FINEOBJ
+	ThrowFileException( errorCode, fileName.CreateUnicodeString( CP_UTF8 ) );
+#else
+	ThrowFileException( errorCode, fileName );
+#endif
+}
+
+// Checks a condition and generates an exception with the last system error if it is not fulfilled
+static inline void checkMappedFileError( bool condition, const CString& fileName )
+{
+	if( !condition ) {
+#if FINE_PLATFORM( FINE_WINDOWS )
+		throwMappedFileException( static_cast<int>( ::GetLastError() ), fileName );
+#elif FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN ) || FINE_PLATFORM( FINE_IOS ) || FINE_PLATFORM( FINE_ANDROID )
+		throwMappedFileException( errno, fileName );
+#else
+		#error Unknown platform
+#endif
+	}
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+// The mapped view of the whole file
+// The view is unmapped when the last reference is released
+class CFileMapping : public IObject {
+public:
+	explicit CFileMapping( const CString& fileName );
+
+	const void* GetData() const { return data; }
+	__int64 GetLength() const { return length; }
+
+protected:
+	virtual ~CFileMapping();
+
+private:
+	void* data; // the mapped view; null for an empty file
+	__int64 length; // the file length
+};
+
+#if FINE_PLATFORM( FINE_WINDOWS )
+
+CFileMapping::CFileMapping( const CString& fileName ) :
+	data( nullptr ),
+	length( 0 )
+{
+	HANDLE file = ::CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr );
+	checkMappedFileError( file != INVALID_HANDLE_VALUE, fileName );
+
+	LARGE_INTEGER fileSize;
+	if( ::GetFileSizeEx( file, &fileSize ) == 0 ) {
+		const DWORD error = ::GetLastError();
+		::CloseHandle( file );
+		throwMappedFileException( static_cast<int>( error ), fileName );
+	}
+	length = fileSize.QuadPart;
+	if( length == 0 ) {
+		::CloseHandle( file );
+		return;
+	}
+
+	// The view is copy-on-write so that the blobs bound to it may be modified
+	HANDLE fileMapping = ::CreateFileMappingA( file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr );
+	const DWORD mappingError = ::GetLastError();
+	::CloseHandle( file );
+	if( fileMapping == nullptr ) {
+		throwMappedFileException( static_cast<int>( mappingError ), fileName );
+	}
+
+	data = ::MapViewOfFile( fileMapping, FILE_MAP_COPY, 0, 0, 0 );
+	const DWORD viewError = ::GetLastError();
+	// The view keeps the mapping object alive
+	::CloseHandle( fileMapping );
+	if( data == nullptr ) {
+		throwMappedFileException( static_cast<int>( viewError ), fileName );
+	}
+}
+
+CFileMapping::~CFileMapping()
+{
+	if( data != nullptr ) {
+		::UnmapViewOfFile( data );
+	}
+}
+
+#elif FINE_PLATFORM( FINE_LINUX ) || FINE_PLATFORM( FINE_DARWIN ) || FINE_PLATFORM( FINE_IOS ) || FINE_PLATFORM( FINE_ANDROID )
+
+CFileMapping::CFileMapping( const CString& fileName ) :
+	data( nullptr ),
+	length( 0 )
+{
+	const int file = ::open( fileName, O_RDONLY );
+	checkMappedFileError( file != -1, fileName );
+
+	struct stat fileStat;
+	if( ::fstat( file, &fileStat ) != 0 ) {
+		const int error = errno;
+		::close( file );
+		throwMappedFileException( error, fileName );
+	}
+	length = static_cast<__int64>( fileStat.st_size );
+	if( length == 0 ) {
+		::close( file );
+		return;
+	}
+
+	// The pages are private so that the blobs bound to them may be modified
+	data = ::mmap( nullptr, static_cast<size_t>( length ), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+	const int error = errno;
+	// The mapping stays valid after the descriptor is closed
+	::close( file );
+	if( data == MAP_FAILED ) {
+		data = nullptr;
+		throwMappedFileException( error, fileName );
+	}
+}
+
+CFileMapping::~CFileMapping()
+{
+	if( data != nullptr ) {
+		::munmap( data, static_cast<size_t>( length ) );
+	}
+}
+
+#else
+	#error Unknown platform
+#endif
+
+//------------------------------------------------------------------------------------------------------------
+
+CMappedFile::CMappedFile() :
+	position( 0 )
+{
+}
+
+CMappedFile::CMappedFile( const char* fileName ) :
+	position( 0 )
+{
+	Open( fileName );
+}
+
+CMappedFile::~CMappedFile()
+{
+	Abort();
+}
+
+void CMappedFile::Open( const char* _fileName )
+{
+	NeoAssert( !IsOpen() );
+	mapping = FINE_DEBUG_NEW CFileMapping( _fileName );
+	fileName = _fileName;
+	position = 0;
+}
+
+const void* CMappedFile::GetData() const
+{
+	NeoAssert( IsOpen() );
+	return mapping->GetData();
+}
+
+IObject* CMappedFile::GetMapping() const
+{
+	NeoAssert( IsOpen() );
+	return mapping;
+}
+
+int CMappedFile::Read( void* buffer, int bytesCount )
+{
+	NeoAssert( IsOpen() );
+	NeoAssert( bytesCount >= 0 );
+	const __int64 bytesRead = min( static_cast<__int64>( bytesCount ), max( mapping->GetLength() - position, static_cast<__int64>( 0 ) ) );
+	if( bytesRead > 0 ) {
+		::memcpy( buffer, static_cast<const char*>( mapping->GetData() ) + position, static_cast<size_t>( bytesRead ) );
+		position += bytesRead;
+	}
+	return static_cast<int>( bytesRead );
+}
+
+void CMappedFile::Write( const void*, int )
+{
+	NeoAssert( false );
+}
+
+__int64 CMappedFile::GetPosition() const
+{
+	NeoAssert( IsOpen() );
+	return position;
+}
+
+__int64 CMappedFile::Seek( __int64 offset, TSeekPosition from )
+{
+	NeoAssert( IsOpen() );
+	__int64 newPosition = 0;
+	switch( from ) {
+		case begin:
+			newPosition = offset;
+			break;
+		case current:
+			newPosition = position + offset;
+			break;
+		case end:
+			newPosition = mapping->GetLength() + offset;
+			break;
+		default:
+			NeoAssert( false );
+	}
+	if( newPosition < 0 ) {
+		throwMappedFileException( EINVAL, fileName );
+	}
+	position = newPosition;
+	return position;
+}
+
+void CMappedFile::SetLength( __int64 )
+{
+	NeoAssert( false );
+}
+
+__int64 CMappedFile::GetLength() const
+{
+	NeoAssert( IsOpen() );
+	return mapping->GetLength();
+}
+
+void CMappedFile::Abort()
+{
+	mapping = nullptr;
+	fileName = CString();
+	position = 0;
+}
+
+void CMappedFile::Flush()
+{
+	NeoAssert( false );
+}
+
+void CMappedFile::Close()
+{
+	Abort();
+}
+
+} // namespace NeoML
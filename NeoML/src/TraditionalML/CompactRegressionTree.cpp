@@ -232,6 +232,17 @@ double CCompactRegressionTree<T>::Predict( const CFloatVectorDesc& features ) co
 	return *predict( features );
 }
 
+template<class T>
+void CCompactRegressionTree<T>::PredictBatch( const CFloatMatrixDesc& data, int begin, int end, double* results ) const
+{
+	NeoPresume( predictionSize == 1 );
+	CFloatVectorDesc row;
+	for( int i = begin; i < end; i++ ) {
+		data.GetRow( i, row );
+		results[i] += *predict( row );
+	}
+}
+
 template<class T>
 void CCompactRegressionTree<T>::CalcFeatureStatistics(
 	int maxFeature, CArray<int>& result ) const
@@ -40,6 +40,7 @@ public:
 		const CFloatVectorDesc& features, CPrediction& result ) const override;
 	virtual double Predict( const CFloatVector& features ) const override;
 	virtual double Predict( const CFloatVectorDesc& features ) const override;
+	virtual void PredictBatch( const CFloatMatrixDesc& data, int begin, int end, double* results ) const override;
 	virtual void CalcFeatureStatistics( int maxFeature, CArray<int>& result ) const override;
 
 	// IRegressionTreeNode interface methods
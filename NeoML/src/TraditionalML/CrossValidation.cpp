@@ -19,16 +19,69 @@ limitations under the License.
 #include <NeoML/TraditionalML/CrossValidation.h>
 #include <NeoML/TraditionalML/CrossValidationSubProblem.h>
 #include <NeoML/TraditionalML/StratifiedCrossValidationSubProblem.h>
+#include <exception>
+#include <thread>
+#include <vector>
 
 namespace NeoML {
 
+ITrainingModelFactory::~ITrainingModelFactory()
+{
+}
+
+// Creates the training or testing subset for the given fold
+// The subset is a view of the input problem matrix and doesn't copy the data
+static CPtr<ISubProblem> createSubProblem( const IProblem* problem, int partsCount, int partIndex,
+	bool stratified, bool testSet )
+{
+	if( stratified ) {
+		return FINE_DEBUG_NEW CStratifiedCrossValidationSubProblem( problem, partsCount, partIndex, testSet );
+	}
+	return FINE_DEBUG_NEW CCrossValidationSubProblem( problem, partsCount, partIndex, testSet );
+}
+
+// Classifies the testing subset of the fold and returns the score
+// The vectors of different folds don't intersect, so the folds may write their results concurrently
+static double testFold( const IModel& model, const ISubProblem& testSubProblem, int partIndex, TScore score,
+	CCrossValidationResult& result )
+{
+	CFloatMatrixDesc testSubProblemMatrix = testSubProblem.GetMatrix();
+
+	// Current model classification result to calculate the loss function
+	CArray<CClassificationResult> classificationResults;
+
+	for( int j = 0; j < testSubProblem.GetVectorCount(); j++ ) {
+		CFloatVectorDesc vector;
+		testSubProblemMatrix.GetRow( j, vector );
+		model.Classify( vector, result.Results[testSubProblem.GetOriginalIndex( j )] );
+		classificationResults.Add( result.Results[testSubProblem.GetOriginalIndex( j )] );
+
+		result.ModelIndex[testSubProblem.GetOriginalIndex( j )] = partIndex;
+	}
+
+	return score( classificationResults, &testSubProblem );
+}
+
 CCrossValidation::CCrossValidation( ITrainingModel& _trainingModel, const IProblem* _problem ) :
-	trainingModel( _trainingModel ),
-	problem( _problem )
+	trainingModel( &_trainingModel ),
+	trainingModelFactory( nullptr ),
+	problem( _problem ),
+	threadCount( 1 )
 {
 	NeoAssert( problem != 0 );
 }
 
+CCrossValidation::CCrossValidation( const ITrainingModelFactory& _trainingModelFactory, const IProblem* _problem,
+		int _threadCount ) :
+	trainingModel( nullptr ),
+	trainingModelFactory( &_trainingModelFactory ),
+	problem( _problem ),
+	threadCount( _threadCount )
+{
+	NeoAssert( problem != 0 );
+	NeoAssert( threadCount >= 1 );
+}
+
 void CCrossValidation::Execute( int partsCount, TScore score, CCrossValidationResult& result, bool stratified )
 {
 	NeoAssert( partsCount > 0 );
@@ -42,42 +95,74 @@ void CCrossValidation::Execute( int partsCount, TScore score, CCrossValidationRe
 	result.ModelIndex.SetSize( problem->GetVectorCount() );
 	result.Success.Empty();
 
+	if( trainingModelFactory != nullptr ) {
+		executeParallel( partsCount, score, result, stratified );
+		return;
+	}
+
 	for( int i = 0; i < partsCount; i++ ) {
 		// Choose the training subset
-		CPtr<ISubProblem> trainSubProblem;
-		if( stratified ) {
-			trainSubProblem = FINE_DEBUG_NEW CStratifiedCrossValidationSubProblem( problem, partsCount, i, false );
-		} else {
-			trainSubProblem = FINE_DEBUG_NEW CCrossValidationSubProblem( problem, partsCount, i, false );
-		}
+		CPtr<ISubProblem> trainSubProblem = createSubProblem( problem, partsCount, i, stratified, false );
 
 		// Train the model
-		CPtr<IModel> model = trainingModel.Train( *trainSubProblem );
+		CPtr<IModel> model = trainingModel->Train( *trainSubProblem );
 		result.Models.Add( model );
 
 		// Choose the testing subset
-		CPtr<ISubProblem> testSubProblem;
-		if( stratified ) {
-			testSubProblem = FINE_DEBUG_NEW CStratifiedCrossValidationSubProblem( problem, partsCount, i, true );
-		} else {
-			testSubProblem = FINE_DEBUG_NEW CCrossValidationSubProblem( problem, partsCount, i, true );
-		}
+		CPtr<ISubProblem> testSubProblem = createSubProblem( problem, partsCount, i, stratified, true );
 
-		CFloatMatrixDesc testSubProblemMatrix = testSubProblem->GetMatrix();
-		
-		// Current model classification result to calculate the loss function
-		CArray<CClassificationResult> classificationResults;
+		result.Success.Add( testFold( *model, *testSubProblem, i, score, result ) );
+	}
+}
 
-		for( int j = 0; j < testSubProblem->GetVectorCount(); j++ ) {
-			CFloatVectorDesc vector;
-			testSubProblemMatrix.GetRow( j, vector );
-			model->Classify( vector, result.Results[testSubProblem->GetOriginalIndex( j )] );
-			classificationResults.Add( result.Results[testSubProblem->GetOriginalIndex( j )] );
+// Trains and tests the folds concurrently
+// The folds are run by their own threads, not by an OpenMP loop: the nested OpenMP regions are run by one thread,
+// while each of the threads may start the parallel region of its training model
+void CCrossValidation::executeParallel( int partsCount, TScore score, CCrossValidationResult& result, bool stratified )
+{
+	const int foldThreadCount = min( threadCount, partsCount );
+	const int modelThreadCount = max( 1, threadCount / foldThreadCount );
+
+	// The subsets and the training models are created beforehand,
+	// so that the folds only read the input problem which they share
+	CObjectArray<ISubProblem> trainSubProblems;
+	CObjectArray<ISubProblem> testSubProblems;
+	CPointerArray<ITrainingModel> trainingModels;
+	for( int i = 0; i < partsCount; i++ ) {
+		trainSubProblems.Add( createSubProblem( problem, partsCount, i, stratified, false ) );
+		testSubProblems.Add( createSubProblem( problem, partsCount, i, stratified, true ) );
+		trainingModels.Add( trainingModelFactory->CreateTrainingModel( modelThreadCount ) );
+	}
 
-			result.ModelIndex[testSubProblem->GetOriginalIndex( j )] = i;
+	result.Models.SetSize( partsCount );
+	result.Success.SetSize( partsCount );
+
+	// The exception of a fold is rethrown after all the threads have finished
+	std::vector<std::exception_ptr> errors( partsCount );
+	auto runFolds = [&]( int firstFold ) {
+		for( int i = firstFold; i < partsCount; i += foldThreadCount ) {
+			try {
+				result.Models[i] = trainingModels[i]->Train( *trainSubProblems[i] );
+				result.Success[i] = testFold( *result.Models[i], *testSubProblems[i], i, score, result );
+			} catch( ... ) {
+				errors[i] = std::current_exception();
+			}
 		}
+	};
+
+	std::vector<std::thread> threads;
+	for( int i = 1; i < foldThreadCount; i++ ) {
+		threads.push_back( std::thread( runFolds, i ) );
+	}
+	runFolds( 0 );
+	for( size_t i = 0; i < threads.size(); i++ ) {
+		threads[i].join();
+	}
 
-		result.Success.Add( score( classificationResults, testSubProblem ) );
+	for( int i = 0; i < partsCount; i++ ) {
+		if( errors[i] != nullptr ) {
+			std::rethrow_exception( errors[i] );
+		}
 	}
 }
 
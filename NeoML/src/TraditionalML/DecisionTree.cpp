@@ -22,6 +22,8 @@ limitations under the License.
 #include <DecisionTreeNodeBase.h>
 #include <DecisionTreeClassificationModel.h>
 #include <DecisionTreeNodeClassificationStatistic.h>
+#include <DecisionTreeHistogram.h>
+#include <NeoMathEngine/OpenMP.h>
 #include <float.h>
 
 namespace NeoML {
@@ -51,6 +53,9 @@ CDecisionTree::CDecisionTree( const CParams& _params, CRandom* _random ) :
 	NeoAssert( params.MaxTreeDepth > 0 );
 	NeoAssert( params.MaxNodesCount > 1 );
 	NeoAssert( 0.00 <= params.ConstNodeThreshold && params.ConstNodeThreshold <= 1.0 );
+	NeoAssert( params.SplitMode == SM_Intervals || params.SplitMode == SM_Histogram );
+	NeoAssert( params.SplitMode != SM_Histogram || params.MaxBins > 1 );
+	NeoAssert( params.ThreadCount > 0 );
 }
 
 CDecisionTree::~CDecisionTree()
@@ -70,8 +75,12 @@ CPtr<IModel> CDecisionTree::Train( const IProblem& problem )
 	}
 
 	classificationProblem = &problem;
+	if( params.SplitMode == SM_Histogram ) {
+		histogram = FINE_DEBUG_NEW CDecisionTreeHistogram( problem, params.MaxBins, params.ThreadCount );
+	}
 	CPtr<CDecisionTreeClassificationModel> root =
 		dynamic_cast<CDecisionTreeClassificationModel*>( buildTree( problem.GetVectorCount() ).Ptr() );
+	histogram.Release();
 
 	return root.Ptr();
 }
@@ -89,12 +98,13 @@ CPtr<CDecisionTreeNodeBase> CDecisionTree::buildTree( int vectorCount )
 	CDecisionTreeNodeStatisticBase* rootStatistic = createStatistic( root );
 	CFloatMatrixDesc matrix = classificationProblem->GetMatrix();
 
-	CFloatVectorDesc desc;
+	CArray<int> vectors;
+	vectors.SetBufferSize( vectorCount );
 	for( int i = 0; i < vectorCount; i++ ) {
-		matrix.GetRow( i, desc );
-		rootStatistic->AddVector( i, desc );
+		vectors.Add( i );
 	}
-	rootStatistic->Finish();
+	rootStatistic->AddVectors( matrix, vectors, params.ThreadCount );
+	rootStatistic->Finish( params.ThreadCount );
 
 	classifyNodesCache.Empty();
 	classifyNodesLevel.Empty();
@@ -107,7 +117,9 @@ CPtr<CDecisionTreeNodeBase> CDecisionTree::buildTree( int vectorCount )
 	statisticsCache.FreeBuffer();
 	statisticsCache.SetBufferSize( statisticsCacheSize );
 
-	split( *rootStatistic, 0 );
+	CDecisionTreeNodeSplit rootSplit;
+	findSplit( *rootStatistic, params.ThreadCount, rootSplit );
+	split( *rootStatistic, rootSplit, 0 );
 	delete rootStatistic;
 
 	// Build the tree level by level
@@ -118,6 +130,7 @@ CPtr<CDecisionTreeNodeBase> CDecisionTree::buildTree( int vectorCount )
 	}
 
 	statisticsCache.FreeBuffer();
+	statisticsVectors.FreeBuffer();
 
 	if( logStream != 0 ) {
 		*logStream << "\nDecision tree training finished\n";
@@ -159,9 +172,25 @@ bool CDecisionTree::buildTreeLevel( const CFloatMatrixDesc& matrix, int level, C
 			}
 		}
 
+		// The nodes are independent, so their statistics are processed in parallel if there are enough nodes
+		// Otherwise the features of each node are split between threads
+		const int nodeCount = statisticsCache.Size();
+		const int nodeThreadCount = nodeCount >= params.ThreadCount ? params.ThreadCount : 1;
+		const int featureThreadCount = nodeThreadCount > 1 ? 1 : params.ThreadCount;
+		CArray<CDecisionTreeNodeSplit> nodeSplits;
+		nodeSplits.SetSize( nodeCount );
+
+		NEOML_OMP_FOR_NUM_THREADS( nodeThreadCount )
+		for( int i = 0; i < nodeCount; i++ ) {
+			statisticsCache[i]->AddVectors( matrix, statisticsVectors[i], featureThreadCount );
+			statisticsCache[i]->Finish( featureThreadCount );
+			findSplit( *statisticsCache[i], featureThreadCount, nodeSplits[i] );
+		}
+
 		// Split according to the statistics just gathered
-		for( int i = 0; i < statisticsCache.Size(); i++ ) {
-			if( split( *statisticsCache[i], level ) ) {
+		// The nodes are split in the same order as the statistics were gathered
+		for( int i = 0; i < nodeCount; i++ ) {
+			if( split( *statisticsCache[i], nodeSplits[i], level ) ) {
 				result = true;
 			}
 		}
@@ -171,7 +200,7 @@ bool CDecisionTree::buildTreeLevel( const CFloatMatrixDesc& matrix, int level, C
 	return result;
 }
 
-// Gathers statistics for the nodes of one level
+// Gathers the vectors for the statistics of the nodes of one level
 // Returns true if all nodes were traversed and false if another pass is needed
 bool CDecisionTree::collectStatistics( const CFloatMatrixDesc& matrix, int level, CDecisionTreeNodeBase* root ) const
 {
@@ -215,27 +244,48 @@ bool CDecisionTree::collectStatistics( const CFloatMatrixDesc& matrix, int level
 			nodeStatisticIndex = curStatisticsCashSize;
 			statisticsCache.Add( createStatistic( leaf ) );
 			nodesStatistics.Add( leaf, nodeStatisticIndex );
+			if( statisticsVectors.Size() <= nodeStatisticIndex ) {
+				statisticsVectors.SetSize( nodeStatisticIndex + 1 );
+			}
+			statisticsVectors[nodeStatisticIndex].Empty();
 		} else {
 			nodeStatisticIndex = nodesStatistics.GetValue( pos );
 		}
 
-		statisticsCache[nodeStatisticIndex]->AddVector( i, vector );
+		statisticsVectors[nodeStatisticIndex].Add( i );
 	}
 
-	for( int i = 0; i < statisticsCache.Size(); i++ ) {
-		statisticsCache[i]->Finish();
+	return result;
+}
+
+// Finds the split of the specified node according to the accumulated statistics
+void CDecisionTree::findSplit( const CDecisionTreeNodeStatisticBase& nodeStatistics, int threadCount,
+	CDecisionTreeNodeSplit& nodeSplit ) const
+{
+	nodeSplit.MaxProbability = nodeStatistics.GetPredictions( nodeSplit.Predictions );
+
+	// No split is needed for too similar or too small sets
+	if( ( nodeSplit.Predictions.Size() > 1 && nodeSplit.MaxProbability >= params.ConstNodeThreshold )
+		|| nodeStatistics.GetVectorsCount() < params.MinSplitSize )
+	{
+		nodeSplit.IsFound = false;
+		return;
 	}
 
-	return result;
+	CParams splitParams = params;
+	splitParams.ThreadCount = threadCount;
+	nodeSplit.CriterionValue = DBL_MAX;
+	nodeSplit.IsFound = nodeStatistics.GetSplit( splitParams, nodeSplit.IsDiscrete, nodeSplit.FeatureIndex,
+		nodeSplit.Values, nodeSplit.CriterionValue );
 }
 
-// Splits the specified node according to the accumulated statistics
+// Splits the specified node according to the split found
 // Returns true if new nodes were created when splitting
-bool CDecisionTree::split( const CDecisionTreeNodeStatisticBase& nodeStatistics, int level ) const
+bool CDecisionTree::split( const CDecisionTreeNodeStatisticBase& nodeStatistics, CDecisionTreeNodeSplit& nodeSplit,
+	int level ) const
 {
 	CDecisionTreeNodeBase& node = nodeStatistics.GetNode();
-	CArray<double> predictions;
-	const double maxProbability = nodeStatistics.GetPredictions( predictions );
+	CArray<double>& predictions = nodeSplit.Predictions;
 
 	if( logStream != 0 ) {
 		*logStream << "\nSplit node contains " << nodeStatistics.GetVectorsCount() << " vectors.\n";
@@ -244,51 +294,33 @@ bool CDecisionTree::split( const CDecisionTreeNodeStatisticBase& nodeStatistics,
 		}
 	}
 
-	// Create a constant node for too similar or too small sets
-	if( ( predictions.Size() > 1 && maxProbability >= params.ConstNodeThreshold )
-		|| nodeStatistics.GetVectorsCount() < params.MinSplitSize )
-	{
-		if( logStream != 0 ) {
-			*logStream << "Split result: created const node.\n";
-		}
-
-		CDecisionTreeConstNodeInfo* info  = FINE_DEBUG_NEW CDecisionTreeConstNodeInfo();
-		predictions.MoveTo( info->Predictions );
-		node.SetInfo( info );
-		return false;
-	}
-
-	bool isBestFeatureDiscrete = false;
-	int bestFeature = NotFound;
-	CArray<double> bestSplitValues;
-	double bestCriterionValue = DBL_MAX;
-
-	if( nodeStatistics.GetSplit( params, isBestFeatureDiscrete, bestFeature, bestSplitValues, bestCriterionValue )
+	CArray<double>& bestSplitValues = nodeSplit.Values;
+	if( nodeSplit.IsFound
 		&& nodesCount + bestSplitValues.Size() <= params.MaxNodesCount
 		&& level < params.MaxTreeDepth )
 	{
 		// The new node is NOT a leaf
 
 		if( logStream != 0 ) {
-			*logStream << "Split result: splited by feature: " << bestFeature << " value = " << bestCriterionValue << "\n";
+			*logStream << "Split result: splited by feature: " << nodeSplit.FeatureIndex << " value = " << nodeSplit.CriterionValue << "\n";
 		}
 
 		nodesCount += bestSplitValues.Size();
 
-		if( isBestFeatureDiscrete ) {
+		if( nodeSplit.IsDiscrete ) {
 			CDecisionTreeDiscreteNodeInfo* info = FINE_DEBUG_NEW CDecisionTreeDiscreteNodeInfo();
 			node.SetInfo( info );
-			info->FeatureIndex = bestFeature;
+			info->FeatureIndex = nodeSplit.FeatureIndex;
 			bestSplitValues.MoveTo( info->Values );
 			predictions.MoveTo( info->Predictions );
-			info->Children.SetBufferSize( bestSplitValues.Size() );
+			info->Children.SetBufferSize( info->Values.Size() );
 			for( int i = 0; i < info->Values.Size(); i++ ) {
 				info->Children.Add( createNode() );
 			}
 		} else {
 			CDecisionTreeContinuousNodeInfo* info = FINE_DEBUG_NEW CDecisionTreeContinuousNodeInfo();
 			node.SetInfo( info );
-			info->FeatureIndex = bestFeature;
+			info->FeatureIndex = nodeSplit.FeatureIndex;
 			info->Threshold = bestSplitValues.First();
 			info->Child1 = createNode();
 			info->Child2 = createNode();
@@ -341,7 +373,7 @@ CDecisionTreeNodeStatisticBase* CDecisionTree::createStatistic( CDecisionTreeNod
 {
 	CArray<int> features;
 	generateUsedFeatures( params.RandomSelectedFeaturesCount, classificationProblem->GetFeatureCount(), features );
-	return FINE_DEBUG_NEW CClassificationStatistics( node, *classificationProblem, features );
+	return FINE_DEBUG_NEW CClassificationStatistics( node, *classificationProblem, features, histogram );
 }
 
 } // namespace NeoML
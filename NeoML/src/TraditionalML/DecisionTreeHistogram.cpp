@@ -0,0 +1,139 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <DecisionTreeHistogram.h>
+#include <NeoMathEngine/OpenMP.h>
+
+namespace NeoML {
+
+CDecisionTreeHistogram::CDecisionTreeHistogram( const IProblem& problem, int maxBins, int threadCount )
+{
+	NeoAssert( maxBins > 1 ); // otherwise there can be no split
+
+	const CFloatMatrixDesc matrix = problem.GetMatrix();
+	const int vectorCount = problem.GetVectorCount();
+	const int featureCount = problem.GetFeatureCount();
+
+	CArray< CArray<CFeatureValue> > featureValues; // the values of all continuous features
+	featureValues.SetSize( featureCount );
+	CArray<double> featureWeights; // total weight of all vectors for which the feature is not 0
+	featureWeights.Add( 0.0, featureCount );
+	double totalWeight = 0.0; // total weight of all vectors
+
+	// Adding the non-zero values
+	for( int i = 0; i < vectorCount; i++ ) {
+		CFloatVectorDesc vector;
+		matrix.GetRow( i, vector );
+		const double vectorWeight = problem.GetVectorWeight( i );
+		for( int j = 0; j < vector.Size; j++ ) {
+			if( vector.Values[j] != 0.0 ) {
+				const int index = vector.Indexes == nullptr ? j : vector.Indexes[j];
+				CFeatureValue value;
+				value.Value = vector.Values[j];
+				value.Weight = vectorWeight;
+				featureValues[index].Add( value );
+				featureWeights[index] += vectorWeight;
+			}
+		}
+		totalWeight += vectorWeight;
+	}
+
+	CArray< CArray<float> > featureBinBegins;
+	featureBinBegins.SetSize( featureCount );
+	CArray< CArray<float> > featureBinEnds;
+	featureBinEnds.SetSize( featureCount );
+
+	NEOML_OMP_FOR_NUM_THREADS( threadCount )
+	for( int i = 0; i < featureCount; i++ ) {
+		if( problem.IsDiscreteFeature( i ) ) {
+			// The discrete features are split by the exact values
+			continue;
+		}
+		// Adding the zero values, sorting and merging the same values
+		CArray<CFeatureValue>& values = featureValues[i];
+		CFeatureValue zero;
+		zero.Value = 0;
+		zero.Weight = totalWeight - featureWeights[i];
+		values.Add( zero );
+		values.QuickSort< AscendingByMember<CFeatureValue, float, &CFeatureValue::Value> >();
+		int size = 1;
+		for( int j = 1; j < values.Size(); j++ ) {
+			if( values[j].Value == values[size - 1].Value ) {
+				values[size - 1].Weight += values[j].Weight;
+			} else {
+				values[size++] = values[j];
+			}
+		}
+		values.SetSize( size );
+
+		buildBins( maxBins, values, featureBinBegins[i], featureBinEnds[i] );
+		values.FreeBuffer();
+	}
+
+	featurePos.SetBufferSize( featureCount + 1 );
+	for( int i = 0; i < featureCount; i++ ) {
+		featurePos.Add( binBegins.Size() );
+		binBegins.Add( featureBinBegins[i] );
+		binEnds.Add( featureBinEnds[i] );
+	}
+	featurePos.Add( binBegins.Size() );
+}
+
+int CDecisionTreeHistogram::GetBin( int feature, float value ) const
+{
+	// Look for the first bin which end is not less than the value
+	const float* ends = binEnds.GetPtr() + featurePos[feature];
+	int first = 0;
+	int last = GetBinCount( feature ) - 1;
+	while( first < last ) {
+		const int middle = ( first + last ) / 2;
+		if( ends[middle] < value ) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	return first;
+}
+
+// Splits the sorted unique values into no more than maxBins bins of close weight
+void CDecisionTreeHistogram::buildBins( int maxBins, const CArray<CFeatureValue>& values,
+	CArray<float>& begins, CArray<float>& ends ) const
+{
+	double weight = 0;
+	for( int i = 0; i < values.Size(); i++ ) {
+		weight += values[i].Weight;
+	}
+	const double maxBinWeight = weight / maxBins;
+
+	begins.Add( values.First().Value );
+	ends.Add( values.First().Value );
+	double binWeight = values.First().Weight;
+	for( int i = 1; i < values.Size(); i++ ) {
+		if( binWeight + values[i].Weight > maxBinWeight && begins.Size() < maxBins ) {
+			// Start a new bin
+			begins.Add( values[i].Value );
+			binWeight = 0;
+		}
+		ends.SetSize( begins.Size() );
+		ends.Last() = values[i].Value;
+		binWeight += values[i].Weight;
+	}
+}
+
+} // namespace NeoML
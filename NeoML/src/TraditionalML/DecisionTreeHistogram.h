@@ -0,0 +1,54 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <NeoML/TraditionalML/Problem.h>
+
+namespace NeoML {
+
+// The histograms of the continuous feature values of a problem, shared by the statistics of all tree nodes
+// The values of each feature are split into no more than maxBins bins of close total weight
+class CDecisionTreeHistogram : public IObject {
+public:
+	CDecisionTreeHistogram( const IProblem& problem, int maxBins, int threadCount );
+
+	// Gets the number of bins for the feature (0 for the discrete features)
+	int GetBinCount( int feature ) const { return featurePos[feature + 1] - featurePos[feature]; }
+	// Gets the bin to which the feature value belongs
+	int GetBin( int feature, float value ) const;
+	// Gets the smallest and the largest feature values in the bin
+	float GetBinBegin( int feature, int bin ) const { return binBegins[featurePos[feature] + bin]; }
+	float GetBinEnd( int feature, int bin ) const { return binEnds[featurePos[feature] + bin]; }
+
+protected:
+	// delete prohibited
+	virtual ~CDecisionTreeHistogram() {}
+
+private:
+	// A feature value
+	struct CFeatureValue {
+		float Value;
+		double Weight;
+	};
+
+	CArray<int> featurePos; // the position of the first bin of each feature
+	CArray<float> binBegins; // the smallest feature values in the bins
+	CArray<float> binEnds; // the largest feature values in the bins
+
+	void buildBins( int maxBins, const CArray<CFeatureValue>& values, CArray<float>& begins, CArray<float>& ends ) const;
+};
+
+} // namespace NeoML
@@ -17,6 +17,7 @@ limitations under the License.
 #pragma hdrstop
 
 #include <DecisionTreeNodeClassificationStatistic.h>
+#include <NeoMathEngine/OpenMP.h>
 
 namespace NeoML {
 
@@ -24,10 +25,12 @@ namespace NeoML {
 const int SmallCoef = 4;
 const int BigCoef = 10;
 
-CClassificationStatistics::CClassificationStatistics( CDecisionTreeNodeBase* _node, const IProblem& _problem, const CArray<int>& _usedFeatures ) :
+CClassificationStatistics::CClassificationStatistics( CDecisionTreeNodeBase* _node, const IProblem& _problem,
+		const CArray<int>& _usedFeatures, const CDecisionTreeHistogram* _histogram ) :
 	classCount( _problem.GetClassCount() ),
 	node( _node ),
 	problem( &_problem ),
+	histogram( _histogram ),
 	totalStatistics( _problem.GetClassCount() )
 {
 	_usedFeatures.CopyTo( usedFeatures );
@@ -41,40 +44,69 @@ CClassificationStatistics::CClassificationStatistics( CDecisionTreeNodeBase* _no
 	discretizationIntervals.SetSize( usedFeatures.Size() );
 }
 
-void CClassificationStatistics::AddVector( int index, const CFloatVectorDesc& vector )
+void CClassificationStatistics::AddVectors( const CFloatMatrixDesc& matrix, const CArray<int>& indices, int threadCount )
 {
 	NeoAssert( problem != 0 );
-	const double weight = problem->GetVectorWeight( index );
-	const int classIndex = problem->GetClass( index );
-	for( int i = 0; i < vector.Size; i++ ) {
-		if( vector.Values[i] != 0.0 ) {
-			const int index = vector.Indexes == nullptr ? i : vector.Indexes[i];
-			if( usedFeatureNumber[index] != NotFound ) {
-				addValue( usedFeatureNumber[index], vector.Values[i], 1, classIndex, weight );
-				featureStatistics[usedFeatureNumber[index]].AddVectorSet( 1, classIndex, weight );
+
+	// Each thread processes its own part of the features, so the values of a feature are added in the same order
+	NEOML_OMP_NUM_THREADS( threadCount )
+	{
+		const int threadNumber = OmpGetThreadNum();
+		const int curThreadCount = OmpGetThreadCount();
+		CFloatVectorDesc vector;
+		for( int v = 0; v < indices.Size(); v++ ) {
+			matrix.GetRow( indices[v], vector );
+			const double weight = problem->GetVectorWeight( indices[v] );
+			const int classIndex = problem->GetClass( indices[v] );
+			for( int i = 0; i < vector.Size; i++ ) {
+				if( vector.Values[i] != 0.0 ) {
+					const int index = vector.Indexes == nullptr ? i : vector.Indexes[i];
+					const int featureNumber = usedFeatureNumber[index];
+					if( featureNumber != NotFound && featureNumber % curThreadCount == threadNumber ) {
+						if( isHistogramFeature( featureNumber ) ) {
+							addBinValue( featureNumber, vector.Values[i], 1, classIndex, weight );
+						} else {
+							addValue( featureNumber, vector.Values[i], 1, classIndex, weight );
+						}
+						featureStatistics[featureNumber].AddVectorSet( 1, classIndex, weight );
+					}
+				}
 			}
 		}
 	}
 
-	totalStatistics.AddVectorSet( 1, classIndex, weight );
+	for( int v = 0; v < indices.Size(); v++ ) {
+		totalStatistics.AddVectorSet( 1, problem->GetClass( indices[v] ), problem->GetVectorWeight( indices[v] ) );
+	}
 }
 
-void CClassificationStatistics::Finish()
+void CClassificationStatistics::Finish( int threadCount )
 {
 	// We need also to add zero values for the features
 	const CArray<double>& totalWeights = totalStatistics.Weights();
 	const CArray<int>& totalCounts = totalStatistics.Counts();
 
+	NEOML_OMP_FOR_NUM_THREADS( threadCount )
 	for( int i = 0; i < usedFeatures.Size(); i++ ) {
 		const CArray<double>& weights = featureStatistics[i].Weights();
 		const CArray<int>& counts = featureStatistics[i].Counts();
+		const bool isHistogram = isHistogramFeature( i );
 
 		for( int j = 0; j < classCount; j++ ) {
 			if( totalCounts[j] - counts[j] > 0 ) {
-				addValue( i, 0, totalCounts[j] - counts[j], j, totalWeights[j] - weights[j] );
+				if( isHistogram ) {
+					addBinValue( i, 0, totalCounts[j] - counts[j], j, totalWeights[j] - weights[j] );
+				} else {
+					addValue( i, 0, totalCounts[j] - counts[j], j, totalWeights[j] - weights[j] );
+				}
 			}
 		}
-		mergeIntervals( problem->GetDiscretizationValue( usedFeatures[i] ), discretizationIntervals[i] );
+		if( isHistogram ) {
+			// The bins are already sorted and do not overlap
+			removeEmptyBins( discretizationIntervals[i] );
+		} else {
+			mergeIntervals( problem->GetDiscretizationValue( usedFeatures[i] ), discretizationIntervals[i] );
+		}
 	}
 }
 
@@ -101,21 +133,46 @@ bool CClassificationStatistics::GetSplit( CDecisionTree::CParams param,
 	criterionValue = totalStatistics.CalcCriterion( param.SplitCriterion );
 	featureIndex = NotFound;
 
-	CArray<double> splitValues;
-	for( int i = 0; i < discretizationIntervals.Size(); i++ ) {
-		double splitCriterionValue = 0;
-		const bool isDiscreteFeature = problem->IsDiscreteFeature( usedFeatures[i] );
-		if( isDiscreteFeature ) { 
-			splitCriterionValue = calcDiscreteSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues );
-		} else {
-			splitCriterionValue = calcContinuousSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues );
+	// Each thread finds the best split among its features
+	const int threadCount = param.ThreadCount;
+	CArray<double> threadCriterionValues;
+	threadCriterionValues.Add( criterionValue, threadCount );
+	CArray<int> threadFeatures;
+	threadFeatures.Add( NotFound, threadCount );
+	CArray< CArray<double> > threadValues;
+	threadValues.SetSize( threadCount );
+
+	NEOML_OMP_NUM_THREADS( threadCount )
+	{
+		const int threadNumber = OmpGetThreadNum();
+		int index = 0;
+		int count = 0;
+		CArray<double> splitValues;
+		if( OmpGetTaskIndexAndCount( discretizationIntervals.Size(), index, count ) ) {
+			for( int i = index; i < index + count; i++ ) {
+				double splitCriterionValue = 0;
+				if( problem->IsDiscreteFeature( usedFeatures[i] ) ) {
+					splitCriterionValue = calcDiscreteSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues );
+				} else {
+					splitCriterionValue = calcContinuousSplitCriterion( param, discretizationIntervals[i], totalStatistics, splitValues );
+				}
+
+				if( threadCriterionValues[threadNumber] > splitCriterionValue ) { // the split with a better criterion value is found
+					threadCriterionValues[threadNumber] = splitCriterionValue;
+					threadFeatures[threadNumber] = i;
+					splitValues.CopyTo( threadValues[threadNumber] );
+				}
+			}
 		}
+	}
 
-		if( criterionValue > splitCriterionValue ) { // the split with a better criterion value is found
-			criterionValue = splitCriterionValue;
-			featureIndex = usedFeatures[i];
-			isDiscrete = isDiscreteFeature;
-			splitValues.CopyTo( values );
+	// The threads process the features in ascending order, so the first best feature is chosen as in the serial loop
+	for( int t = 0; t < threadCount; t++ ) {
+		if( threadFeatures[t] != NotFound && criterionValue > threadCriterionValues[t] ) {
+			criterionValue = threadCriterionValues[t];
+			featureIndex = usedFeatures[threadFeatures[t]];
+			isDiscrete = problem->IsDiscreteFeature( featureIndex );
+			threadValues[t].CopyTo( values );
 		}
 	}
 
@@ -168,6 +225,50 @@ void CClassificationStatistics::addValue( int index, double value, int count, in
 	intervals.Add( interval );
 }
 
+// Checks if the feature values are assigned to the histogram bins
+inline bool CClassificationStatistics::isHistogramFeature( int index ) const
+{
+	return histogram != nullptr && histogram->GetBinCount( usedFeatures[index] ) > 0;
+}
+
+// Adds a new value to its histogram bin
+// The intervals of a feature are the histogram bins for each class, ordered by bin
+void CClassificationStatistics::addBinValue( int index, double value, int count, int classIndex, double weight )
+{
+	const int feature = usedFeatures[index];
+	CIntervalArray& intervals = discretizationIntervals[index];
+	if( intervals.IsEmpty() ) {
+		const int binCount = histogram->GetBinCount( feature );
+		intervals.SetSize( binCount * classCount );
+		for( int bin = 0; bin < binCount; bin++ ) {
+			for( int c = 0; c < classCount; c++ ) {
+				CInterval& interval = intervals[bin * classCount + c];
+				interval.Begin = histogram->GetBinBegin( feature, bin );
+				interval.End = histogram->GetBinEnd( feature, bin );
+				interval.Class = c;
+				interval.Count = 0;
+				interval.Weight = 0;
+			}
+		}
+	}
+
+	CInterval& interval = intervals[histogram->GetBin( feature, static_cast<float>( value ) ) * classCount + classIndex];
+	interval.Count += count;
+	interval.Weight += weight;
+}
+
+// Removes the histogram bins without vectors
+void CClassificationStatistics::removeEmptyBins( CIntervalArray& intervals )
+{
+	int newSize = 0;
+	for( int i = 0; i < intervals.Size(); i++ ) {
+		if( intervals[i].Count > 0 ) {
+			intervals[newSize++] = intervals[i];
+		}
+	}
+	intervals.SetSize( newSize );
+}
+
 // Merges the intervals
 void CClassificationStatistics::mergeIntervals( int discretizationValue, CIntervalArray& intervals )
 {
@@ -18,6 +18,7 @@ limitations under the License.
 #include <NeoML/TraditionalML/DecisionTree.h>
 #include <DecisionTreeNodeStatisticBase.h>
 #include <DecisionTreeNodeBase.h>
+#include <DecisionTreeHistogram.h>
 
 namespace NeoML {
 
@@ -132,11 +133,13 @@ inline double CVectorSetClassificationStatistic::CalcCriterion( CDecisionTree::T
 // The statistics accumulated in a node
 class CClassificationStatistics : public CDecisionTreeNodeStatisticBase {
 public:
-	explicit CClassificationStatistics( CDecisionTreeNodeBase* node, const IProblem& problem, const CArray<int>& usedFeatures );
+	// histogram may be null, then the feature values are merged into intervals
+	explicit CClassificationStatistics( CDecisionTreeNodeBase* node, const IProblem& problem, const CArray<int>& usedFeatures,
+		const CDecisionTreeHistogram* histogram );
 
 	// CDecisionTreeNodeStatisticBase interface methods
-	virtual void AddVector( int index, const CFloatVectorDesc& vector );
-	virtual void Finish();
+	virtual void AddVectors( const CFloatMatrixDesc& matrix, const CArray<int>& indices, int threadCount );
+	virtual void Finish( int threadCount );
 	virtual size_t GetSize() const;
 	virtual bool GetSplit( CDecisionTree::CParams param,
 		bool& isDiscrete, int& featureIndex, CArray<double>& values, double& criterioValue ) const;
@@ -159,13 +162,17 @@ private:
 	const int classCount; // the number of classes
 	const CPtr<CDecisionTreeNodeBase> node; // the node for which statistics are accumulated
 	const CPtr<const IProblem> problem; // the problem
+	const CPtr<const CDecisionTreeHistogram> histogram; // the feature histograms (may be null)
 	CArray<int> usedFeatures; // the features used
 	CArray<int> usedFeatureNumber; // the number of the current feature
 	CVectorSetClassificationStatistic totalStatistics; // the whole subset statistics
 	CArray<CVectorSetClassificationStatistic> featureStatistics; // the statistics for each feature
 	CArray<CIntervalArray> discretizationIntervals; // the sampling intervals
 
+	bool isHistogramFeature( int index ) const;
 	void addValue( int index, double value, int count, int classIndex, double weight );
+	void addBinValue( int index, double value, int count, int classIndex, double weight );
+	void removeEmptyBins( CIntervalArray& intervals );
 	void mergeIntervals( int discretizationValue, CIntervalArray& intervals );
 	void mergeOverlappingIntervals( CIntervalArray& intervals );
 	void mergeIntervalsByWeight( int left, int right, int resultIntervalCount, CIntervalArray& intervals );
@@ -19,21 +19,52 @@ limitations under the License.
 
 namespace NeoML {
 
+// The split of a node found by its statistics
+struct CDecisionTreeNodeSplit {
+	CArray<double> Predictions; // the predictions for the node
+	double MaxProbability; // the largest prediction
+	bool IsFound; // the split has been found
+	bool IsDiscrete; // the split is by a discrete feature
+	int FeatureIndex; // the index of the feature by which the node will split
+	CArray<double> Values; // the feature values defining the split
+	double CriterionValue; // the criterion value for the split
+
+	CDecisionTreeNodeSplit() : MaxProbability( 0 ), IsFound( false ), IsDiscrete( false ), FeatureIndex( NotFound ),
+		CriterionValue( 0 ) {}
+};
+
+inline void ArrayMemMoveElement( CDecisionTreeNodeSplit* dest, CDecisionTreeNodeSplit* src )
+{
+	NeoPresume( dest != src );
+	::new( dest ) CDecisionTreeNodeSplit;
+	dest->MaxProbability = src->MaxProbability;
+	dest->IsFound = src->IsFound;
+	dest->IsDiscrete = src->IsDiscrete;
+	dest->FeatureIndex = src->FeatureIndex;
+	dest->CriterionValue = src->CriterionValue;
+	src->Predictions.MoveTo( dest->Predictions );
+	src->Values.MoveTo( dest->Values );
+	src->~CDecisionTreeNodeSplit();
+}
+
 // Statistics accumulated in a node
 class CDecisionTreeNodeStatisticBase {
 public:
 	virtual ~CDecisionTreeNodeStatisticBase() {}
 
-	// Adds a vector to the statistics
-	virtual void AddVector( int index, const CFloatVectorDesc& vector ) = 0;
+	// Adds the vectors with the given indices to the statistics
+	// The features are split between threadCount threads
+	virtual void AddVectors( const CFloatMatrixDesc& matrix, const CArray<int>& indices, int threadCount ) = 0;
 
 	// Finishes accumulating data
-	virtual void Finish() = 0;
+	// The features are split between threadCount threads
+	virtual void Finish( int threadCount ) = 0;
 
 	// Retrieves the size of accumulated data
 	virtual size_t GetSize() const = 0;
 
 	// Gets the optimal split based on the accumulated data
+	// The features are split between param.ThreadCount threads
 	// Returns false if splitting is not possible
 	// featureIndex is the index of the feature by which the node will split
 	// values contains the feature values defining the split
@@ -39,6 +39,16 @@ IGradientBoostRegressionModel::~IGradientBoostRegressionModel()
 {
 }
 
+void IGradientBoostRegressionModel::PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int /* threadCount */ ) const
+{
+	results.SetSize( data.Height );
+	CFloatVectorDesc row;
+	for( int i = 0; i < data.Height; i++ ) {
+		data.GetRow( i, row );
+		results[i] = Predict( row );
+	}
+}
+
 IRegressionTreeNode::~IRegressionTreeNode()
 {
 }
@@ -18,11 +18,16 @@ limitations under the License.
 
 #include <GradientBoostModel.h>
 #include <CompactRegressionTree.h>
+#include <NeoMathEngine/OpenMP.h>
 
 namespace NeoML {
 
 REGISTER_NEOML_MODEL( CGradientBoostModel, GradientBoostModelName )
 
+// The number of rows for which each tree is evaluated before moving on to the next tree
+// The tree nodes and the features of the block stay in cache
+static const int PredictBatchBlockSize = 64;
+
 CGradientBoostModel::CGradientBoostModel( CArray<CGradientBoostEnsemble>& _ensembles, int _valueSize,
 	double _learningRate, CGradientBoost::TLossFunction _lossFunction ) :
 	learningRate( _learningRate ),
@@ -233,6 +238,42 @@ void CGradientBoostModel::ConvertToCompact()
 	}
 }
 
+void CGradientBoostModel::PredictBatchRaw( const CGradientBoostEnsemble& ensemble, double learningRate,
+	const CFloatMatrixDesc& data, int begin, int end, double* results )
+{
+	for( int i = begin; i < end; i++ ) {
+		results[i] = 0;
+	}
+	for( int blockBegin = begin; blockBegin < end; blockBegin += PredictBatchBlockSize ) {
+		const int blockEnd = min( blockBegin + PredictBatchBlockSize, end );
+		for( int i = 0; i < ensemble.Size(); i++ ) {
+			static_cast<const CRegressionTree*>( ensemble[i].Ptr() )->PredictBatch( data, blockBegin, blockEnd, results );
+		}
+	}
+	for( int i = begin; i < end; i++ ) {
+		results[i] *= learningRate;
+	}
+}
+
+void CGradientBoostModel::PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const
+{
+	NeoAssert( ensembles.Size() == 1 && valueSize == 1 );
+	NeoAssert( threadCount > 0 );
+
+	results.SetSize( data.Height );
+	const int curThreadCount = IsOmpRelevant( data.Height,
+		static_cast<int64_t>( data.Height ) * ensembles.First().Size() ) ? threadCount : 1;
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int index = 0;
+		int count = 0;
+		if( OmpGetTaskIndexAndCount( data.Height, index, count ) ) {
+			PredictBatchRaw( ensembles.First(), learningRate, data, index, index + count, results.GetPtr() );
+		}
+	}
+}
+
 // IRegressionModel interface method
 double CGradientBoostModel::Predict( const CFloatVectorDesc& data ) const
 {
@@ -36,6 +36,10 @@ public:
 		const CGradientBoostEnsemble& models, int startPos, double learningRate,
 		const TFeatures& features, CFastArray<double, 1>& predictions );
 
+	// Gets the predictions by the tree ensemble for the [begin, end) rows of the matrix
+	static void PredictBatchRaw( const CGradientBoostEnsemble& ensemble, double learningRate,
+		const CFloatMatrixDesc& data, int begin, int end, double* results );
+
 	// IModel interface methods
 	int GetClassCount() const override { return ( valueSize == 1 && ensembles.Size() == 1 ) ? 2 : valueSize * ensembles.Size(); }
 	bool Classify( const CFloatVectorDesc& data, CClassificationResult& result ) const override;
@@ -50,6 +54,7 @@ public:
 	void CalcFeatureStatistics( int maxFeature, CArray<int>& result ) const override;
 	void CutNumberOfTrees( int numberOfTrees ) override;
 	virtual void ConvertToCompact() override;
+	void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const override;
 
 	// IRegressionModel interface methods
 	double Predict( const CFloatVectorDesc& data ) const override;
@@ -317,7 +317,7 @@ double CGradientBoostQSEnsemble::Predict( const CFloatVectorDesc& data ) const
 		}
 	}
 
-	return calculateScore( data, resultBitvectors, GetTreesCount() - 1 );
+	return calculateScore( data, resultBitvectors.GetPtr(), 1, GetTreesCount() - 1 );
 }
 
 double CGradientBoostQSEnsemble::Predict( const CFloatVectorDesc& data, int lastTreeIndex ) const
@@ -336,7 +336,52 @@ double CGradientBoostQSEnsemble::Predict( const CFloatVectorDesc& data, int last
 		}
 	}
 
-	return calculateScore( data, resultBitvectors, lastTreeIndex );
+	return calculateScore( data, resultBitvectors.GetPtr(), 1, lastTreeIndex );
+}
+
+void CGradientBoostQSEnsemble::PredictBatch( const CFloatMatrixDesc& data, int begin, int end, double* results ) const
+{
+	CFloatVectorDesc rows[QSBatchSize];
+	if( data.Columns != nullptr ) {
+		// The sparse rows have different sets of features, so they are scored one by one
+		for( int i = begin; i < end; i++ ) {
+			data.GetRow( i, rows[0] );
+			results[i] = Predict( rows[0] );
+		}
+		return;
+	}
+
+	// The resulting bit masks of the block documents, one after another; each document has one mask per tree
+	CArray<unsigned __int64> bitvectors;
+	bitvectors.SetSize( GetTreesCount() * QSBatchSize );
+	float values[QSBatchSize];
+
+	for( int blockBegin = begin; blockBegin < end; blockBegin += QSBatchSize ) {
+		const int docCount = min( QSBatchSize, end - blockBegin );
+		for( int doc = 0; doc < QSBatchSize; doc++ ) {
+			// The last block is padded by repeating its last row
+			data.GetRow( blockBegin + min( doc, docCount - 1 ), rows[doc] );
+		}
+		memset( bitvectors.GetPtr(), ~0, bitvectors.Size() * sizeof( unsigned __int64 ) );
+
+		// The features are looked up once for the whole block
+		for( int i = 0; i < usedFeatures.Size(); i++ ) {
+			const int featureIndex = usedFeatures[i];
+			if( featureIndex >= data.Width ) {
+				// The feature is absent from all rows and is skipped, as in Predict
+				continue;
+			}
+			for( int doc = 0; doc < QSBatchSize; doc++ ) {
+				values[doc] = rows[doc].Values[featureIndex];
+			}
+			processFeatureBatch( usedFeaturesOffsets[i], values, bitvectors.GetPtr() );
+		}
+
+		for( int doc = 0; doc < docCount; doc++ ) {
+			results[blockBegin + doc] = calculateScore( rows[doc], bitvectors.GetPtr() + doc * GetTreesCount(), 1,
+				GetTreesCount() - 1 );
+		}
+	}
 }
 
 CArchive& operator<<( CArchive& archive, const CGradientBoostQSEnsemble& block )
@@ -692,6 +737,8 @@ void CGradientBoostQSEnsemble::buildFeatureNodesOffsets( const CArray<int>& feat
 	qsNodes.QuickSort<CQSNodeAscending>( &comparator );
 
 	featureQsNodesOffsets.Empty();
+	usedFeatures.Empty();
+	usedFeaturesOffsets.Empty();
 	for( int i = 0; i < qsNodes.Size(); i++ ) {
 		const int featureIndex = features[treeQsLeavesOffsets[qsNodes[i].Tree] + qsNodes[i].Order];
 		CQSNodeOffset& offset = featureQsNodesOffsets.GetOrCreateValue( featureIndex );
@@ -707,6 +754,11 @@ void CGradientBoostQSEnsemble::buildFeatureNodesOffsets( const CArray<int>& feat
 			offset.Less.End = i;
 		}
 	}
+
+	for( int i = featureQsNodesOffsets.GetFirstPosition(); i != NotFound; i = featureQsNodesOffsets.GetNextPosition( i ) ) {
+		usedFeatures.Add( featureQsNodesOffsets.GetKey( i ) );
+		usedFeaturesOffsets.Add( featureQsNodesOffsets.GetValue( i ) );
+	}
 }
 
 // Mask computation
@@ -736,6 +788,30 @@ void CGradientBoostQSEnsemble::processFeature( int featureIndex, float value, CF
 	}
 }
 
+// Batch mask computation
+// The same as processFeature, but for QSBatchSize documents at once
+// The nodes of the feature are traversed for all the block documents while they are in cache
+void CGradientBoostQSEnsemble::processFeatureBatch( const CQSNodeOffset& offset, const float* values,
+	unsigned __int64* bitvectors ) const
+{
+	for( int doc = 0; doc < QSBatchSize; doc++ ) {
+		const float value = values[doc];
+		unsigned __int64* docBitvectors = bitvectors + doc * GetTreesCount();
+		if( offset.Less.Begin != NotFound ) {
+			for( int i = offset.Less.Begin; i <= offset.Less.End && qsNodes[i].Threshold < value; i++ ) {
+				const CQSNode& node = qsNodes[i];
+				docBitvectors[node.Tree] &= node.Mask;
+			}
+		}
+		if( offset.More.Begin != NotFound ) {
+			for( int i = offset.More.Begin; i <= offset.More.End && qsNodes[i].Threshold >= value; i++ ) {
+				const CQSNode& node = qsNodes[i];
+				docBitvectors[node.Tree] &= node.Mask;
+			}
+		}
+	}
+}
+
 static inline float getFeatureValue( const CFloatVectorDesc& data, int index )
 {
 	float result;
@@ -747,13 +823,15 @@ static inline float getFeatureValue( const CFloatVectorDesc& data, int index )
 // The leaves are numbered left to right (all masks are inverted), so look for the lowest nonzero bit
 // In each bitvector the leaf we need has the index of the lowest nonzero
 // If it is a leaf in the original tree, take its value, if a subtree call its Predict method
-double CGradientBoostQSEnsemble::calculateScore( const CFloatVectorDesc& data, const CFastArray<unsigned __int64, 512>& bitvectors, int lastTreeIndex ) const
+// The bitvector of the ith tree is bitvectors[i * bitvectorsStep]
+double CGradientBoostQSEnsemble::calculateScore( const CFloatVectorDesc& data, const unsigned __int64* bitvectors,
+	int bitvectorsStep, int lastTreeIndex ) const
 {
 	float score = 0.0;
 	int prev = -1;
 	const int end = min( lastTreeIndex, GetTreesCount() - 1 );
 	for( int i = 0; i <= end; i++ ) {
-		const int leafIndex = findLowestBitIndex( bitvectors[i] );
+		const int leafIndex = findLowestBitIndex( bitvectors[i * bitvectorsStep] );
 		const int currentTreeOffset = treeQsLeavesOffsets[i];
 		NeoAssert( prev != currentTreeOffset );
 		prev = currentTreeOffset;
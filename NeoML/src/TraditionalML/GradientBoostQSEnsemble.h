@@ -21,6 +21,7 @@ namespace NeoML {
 
 const int MaxQSLeavesCount = 64; // maximum number of leaves in a subtree that can be optimized
 const int MaxTreesCount = 32767; // maximum supported number of trees in an ensemble
+const int QSBatchSize = 8; // the number of documents scored at once by the batch prediction
 
 const unsigned char PM_Inverted = 1; // the node is inverted
 const unsigned char PM_LeftLeaf = 2; // the left child is a leaf in the optimized subtree
@@ -96,6 +97,10 @@ public:
 	// The prediction method that uses only the trees in the 0 to lastTreeIndex range
 	double Predict( const CFloatVectorDesc& data, int lastTreeIndex ) const;
 
+	// Gets the predictions for the [begin, end) rows of the matrix
+	// The dense rows are processed by blocks of QSBatchSize documents
+	void PredictBatch( const CFloatMatrixDesc& data, int begin, int end, double* results ) const;
+
 	// Gets the number of trees in the ensemble
 	int GetTreesCount() const { return treeQsLeavesOffsets.Size(); };
 
@@ -112,6 +117,9 @@ private:
 	CArray<CQSLeaf> qsLeaves; // the leaves of the i subtree start from treeQsLeavesOffsets[i] index
 	CArray<int> treeQsLeavesOffsets; // offsets to optimized subtree leaves for the specified tree in the ensemble
 	CArray<CSimpleNode> simpleNodes; // the descriptions of the nodes that are not in optimized subtrees
+	// The features used for splitting and their offsets, the same as featureQsNodesOffsets but stored in arrays
+	CArray<int> usedFeatures;
+	CArray<CQSNodeOffset> usedFeaturesOffsets;
 
 	void store( CArchive& archive ) const;
 	void storeQSNode( IQsSerializer& serializer, const CArray<int>& links, const CArray<int>& features,
@@ -128,7 +136,9 @@ private:
 	void buildFeatureNodesOffsets( const CArray<int>& features );
 
 	void processFeature( int feature, float value, CFastArray<unsigned __int64, 512>& bitvectors ) const;
-	double calculateScore( const CFloatVectorDesc& data, const CFastArray<unsigned __int64, 512>& bitvectors, int lastTreeIndex ) const;
+	void processFeatureBatch( const CQSNodeOffset& offset, const float* values, unsigned __int64* bitvectors ) const;
+	double calculateScore( const CFloatVectorDesc& data, const unsigned __int64* bitvectors, int bitvectorsStep,
+		int lastTreeIndex ) const;
 };
 
 } // namespace NeoML
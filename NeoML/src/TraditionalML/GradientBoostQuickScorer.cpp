@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <NeoML/TraditionalML/GradientBoostQuickScorer.h>
 #include <GradientBoostQSEnsemble.h>
+#include <NeoMathEngine/OpenMP.h>
 
 namespace NeoML {
 
@@ -46,6 +47,16 @@ IGradientBoostQSRegressionModel::~IGradientBoostQSRegressionModel()
 {
 }
 
+void IGradientBoostQSRegressionModel::PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int /* threadCount */ ) const
+{
+	results.SetSize( data.Height );
+	CFloatVectorDesc row;
+	for( int i = 0; i < data.Height; i++ ) {
+		data.GetRow( i, row );
+		results[i] = Predict( row );
+	}
+}
+
 // The QuickScorer model
 class CGradientBoostQSModel : public IGradientBoostQSModel, public IGradientBoostQSRegressionModel {
 public:
@@ -64,6 +75,9 @@ public:
 	// IRegressionModel interface method
 	double Predict( const CFloatVectorDesc& data ) const override;
 
+	// IGradientBoostQSRegressionModel interface methods
+	void PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const override;
+
 	// General methods
 	double GetLearningRate() const override { return learningRate; };
 	void Serialize( CArchive& archive ) override;
@@ -103,6 +117,28 @@ double CGradientBoostQSModel::Predict( const CFloatVectorDesc& data ) const
 	return ensembles.First()->Predict( data ) * learningRate;
 }
 
+void CGradientBoostQSModel::PredictBatch( const CFloatMatrixDesc& data, CArray<double>& results, int threadCount ) const
+{
+	NeoAssert( threadCount > 0 );
+
+	results.SetSize( data.Height );
+	const CGradientBoostQSEnsemble& ensemble = *ensembles.First();
+	const int curThreadCount = IsOmpRelevant( data.Height,
+		static_cast<int64_t>( data.Height ) * ensemble.GetTreesCount() ) ? threadCount : 1;
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int index = 0;
+		int count = 0;
+		if( OmpGetTaskIndexAndCount( data.Height, index, count ) ) {
+			ensemble.PredictBatch( data, index, index + count, results.GetPtr() );
+			for( int i = index; i < index + count; i++ ) {
+				results[i] *= learningRate;
+			}
+		}
+	}
+}
+
 bool CGradientBoostQSModel::Classify( const CFloatVectorDesc& data, CClassificationResult& result ) const 
 {
 	if( GetClassCount() == 2 ) {
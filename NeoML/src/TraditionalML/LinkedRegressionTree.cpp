@@ -141,6 +141,15 @@ double CLinkedRegressionTree::Predict( const CFloatVectorDesc& data ) const
 	return predict( data );
 }
 
+void CLinkedRegressionTree::PredictBatch( const CFloatMatrixDesc& data, int begin, int end, double* results ) const
+{
+	CFloatVectorDesc row;
+	for( int i = begin; i < end; i++ ) {
+		data.GetRow( i, row );
+		results[i] += predict( row );
+	}
+}
+
 void CLinkedRegressionTree::Serialize( CArchive& archive )
 {
 #ifdef NEOML_USE_FINEOBJ
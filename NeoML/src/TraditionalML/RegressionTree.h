@@ -37,6 +37,8 @@ public:
 	// Calculate scalar prediction.
 	virtual double Predict( const CFloatVector& features) const = 0;
 	virtual double Predict( const CFloatVectorDesc& features ) const = 0;
+	// Adds the scalar predictions for the [begin, end) rows of the matrix to the results.
+	virtual void PredictBatch( const CFloatMatrixDesc& data, int begin, int end, double* results ) const = 0;
 
 	// Calculates feature usage statistics.
 	virtual void CalcFeatureStatistics( int maxFeature, CArray<int>& result ) const = 0;
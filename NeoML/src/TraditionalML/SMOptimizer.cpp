@@ -23,6 +23,7 @@ limitations under the License.
 #pragma hdrstop
 
 #include <SMOptimizer.h>
+#include <NeoMathEngine/OpenMP.h>
 
 namespace NeoML {
 
@@ -33,6 +34,10 @@ const double CSMOptimizer::Tau = 1e-12;
 //
 // matrixSize is the matrix size 
 // cacheSize is the maximum possible cache size in bytes
+//
+// The columns are evicted in the LRU order, but a column that has been requested again since it was
+// cached gets a second chance: it is moved to the end of the list instead of being evicted.
+// So the columns of the working set are not pushed out by the columns requested only once (e.g. on gradient reconstruction)
 
 class CKernelCache
 {
@@ -56,8 +61,9 @@ private:
 		CList *Prev, *Next;	// a circular list
 		float *Column; // the column data
 		int Length; // Column[0,Length) is cached in this entry
+		bool IsReferenced; // the column has been requested again since it was cached
 
-		CList() { Prev = Next = nullptr; Column = nullptr; Length = 0; }
+		CList() { Prev = Next = nullptr; Column = nullptr; Length = 0; IsReferenced = false; }
 		~CList() { delete[] Column; }
 	};
 	CArray<CList> columns; // the array of matrix columns
@@ -110,6 +116,7 @@ int CKernelCache::GetColumn( int i, float*& data, int len )
 	CList* l = c + i;
 	if( l->Length != 0 ) {
 		lruDelete( l );
+		l->IsReferenced = true;
 	}
 
 	int rest = len - l->Length;
@@ -117,6 +124,12 @@ int CKernelCache::GetColumn( int i, float*& data, int len )
 		while( freeSpace < rest ) {
 			CList* old = lruHead.Next;
 			lruDelete( old );
+			if( old->IsReferenced ) {
+				// give the column a second chance
+				old->IsReferenced = false;
+				lruInsert( old );
+				continue;
+			}
 			if( old->Length != 0 ) {
 				delete[] old->Column;
 				freeSpace += old->Length;
@@ -159,6 +172,7 @@ void CKernelCache::SwapIndices( int i, int j )
 	}
 	swap( c[i].Column, c[j].Column );
 	swap( c[i].Length, c[j].Length );
+	swap( c[i].IsReferenced, c[j].IsReferenced );
 	if( c[i].Length ) {
 		lruInsert( &c[i] );
 	}
@@ -179,18 +193,23 @@ void CKernelCache::SwapIndices( int i, int j )
 				freeSpace += l->Length;
 				l->Column = nullptr;
 				l->Length = 0;
+				l->IsReferenced = false;
 			}
 		}
 	}
 }
 
 // The kernel matrix CKernelMatrix(i, j) = K(i, j) * y_i * y_j
+// The missing column elements are calculated by threadCount threads
 class CKernelMatrix {
 public:
-	CKernelMatrix( const IProblem& data, const CSvmKernel& kernel, int cacheSize );
+	CKernelMatrix( const IProblem& data, const CSvmKernel& kernel, int cacheSize, int threadCount );
 
 	// Gets the pointer to a column
 	const float* GetColumn( int i, int len ) const;
+	// Gets the pointers to two columns
+	// The missing elements of both columns are calculated in one pass over the data
+	void GetColumns( int i, int j, int len, const float*& q_i, const float*& q_j ) const;
 	// Gets the pointer to the diagonal
 	const double* GetDiagonal() const { return d; }
 	// Gets y[i] binary class
@@ -207,11 +226,17 @@ private:
 	float* y; // raw pointer to binary classes
 	CArray<double> diagonal; // the matrix diagonal
 	double* d; // raw pointer to diagonal
+	const int threadCount; // the number of threads used to calculate the columns
+
+	float calculate( int i, int j ) const;
+	float getOrCalculate( int i, int j ) const;
+	int getThreadCount( int begin, int end ) const;
 };
 
-CKernelMatrix::CKernelMatrix( const IProblem& data, const CSvmKernel& kernel, int cacheSize ) :
+CKernelMatrix::CKernelMatrix( const IProblem& data, const CSvmKernel& kernel, int cacheSize, int threadCount ) :
 	kernel(kernel), 
-	cache( data.GetVectorCount(), cacheSize * (1<<20) )
+	cache( data.GetVectorCount(), cacheSize * (1<<20) ),
+	threadCount( threadCount )
 {
 	matrix.SetSize( data.GetVectorCount() );
 	x = matrix.GetPtr();
@@ -228,40 +253,89 @@ CKernelMatrix::CKernelMatrix( const IProblem& data, const CSvmKernel& kernel, in
 	}
 }
 
+// Calculates the matrix element
+inline float CKernelMatrix::calculate( int i, int j ) const
+{
+	if( i == j ) {
+		return static_cast<float>( d[i] );
+	}
+	return static_cast<float>( y[i] * y[j] * kernel.Calculate( x[i], x[j] ) );
+}
+
+// Gets the matrix element from the j column in cache or calculates it
+// The cache matrix is symmetrical so col[i][j] == col[j][i]
+inline float CKernelMatrix::getOrCalculate( int i, int j ) const
+{
+	if( i == j ) {
+		return static_cast<float>( d[i] );
+	}
+	int jColLen;
+	const float* jColData = cache.GetColumn( j, jColLen );
+	if( jColLen > i ) {
+		return jColData[i];
+	}
+	return calculate( i, j );
+}
+
+// The number of threads used to calculate the [begin, end) elements of a column
+inline int CKernelMatrix::getThreadCount( int begin, int end ) const
+{
+	const int count = end - begin;
+	// Each element is a kernel calculation over the whole vector
+	return IsOmpRelevant( count, static_cast<int64_t>( count ) * max( 1, x[begin].Size ) ) ? threadCount : 1;
+}
+
 const float* CKernelMatrix::GetColumn( int i, int len ) const
 {
 	float* column;
-	int start = cache.GetColumn( i, column, len );
+	const int start = cache.GetColumn( i, column, len );
 	if( start < len ) {
-		float y_i = y[i];
-		auto x_i = x[i];
-		auto calcData = [&]( int j ) {
-			// the cache matrix is symmetrical so col[i][j] == col[j][i]
-			int jColLen;
-			float* jColData = cache.GetColumn( j, jColLen );
-			if( jColLen > i ) {
-				column[j] = jColData[i];
-			} else {
-				column[j] = static_cast<float>( y_i * y[j] * kernel.Calculate( x_i, x[j] ) );
+		NEOML_OMP_NUM_THREADS( getThreadCount( start, len ) )
+		{
+			int index = 0;
+			int count = 0;
+			if( OmpGetTaskIndexAndCount( len - start, index, count ) ) {
+				for( int j = start + index; j < start + index + count; ++j ) {
+					column[j] = getOrCalculate( i, j );
+				}
 			}
-		};
+		}
+	}
+	return column;
+}
 
-		// set diagonal element if it's needed
-		if( i >= start && i < len ) {
-			for( int j = start; j < i; ++j ) {
-				calcData( j );
-			}
-			column[i] = static_cast<float>( d[i] );
-			for( int j = i+1; j < len; ++j ) {
-				calcData( j );
-			}
-		} else {
-			for( int j = start; j < len; ++j ) {
-				calcData( j );
+void CKernelMatrix::GetColumns( int i, int j, int len, const float*& q_i, const float*& q_j ) const
+{
+	NeoPresume( i != j );
+	// Both columns fit into cache, so getting the second one does not evict the first
+	float* iColumn;
+	const int iStart = cache.GetColumn( i, iColumn, len );
+	float* jColumn;
+	const int jStart = cache.GetColumn( j, jColumn, len );
+	q_i = iColumn;
+	q_j = jColumn;
+
+	const int start = min( iStart, jStart );
+	if( start >= len ) {
+		return;
+	}
+
+	NEOML_OMP_NUM_THREADS( getThreadCount( start, len ) )
+	{
+		int index = 0;
+		int count = 0;
+		if( OmpGetTaskIndexAndCount( len - start, index, count ) ) {
+			for( int k = start + index; k < start + index + count; ++k ) {
+				// The i and j columns are not filled yet, so their elements are calculated
+				if( k >= iStart ) {
+					iColumn[k] = k == j ? calculate( i, j ) : getOrCalculate( i, k );
+				}
+				if( k >= jStart ) {
+					jColumn[k] = k == i ? calculate( j, i ) : getOrCalculate( j, k );
+				}
 			}
 		}
 	}
-	return column;
 }
 
 void CKernelMatrix::SwapIndices( int i, int j )
@@ -275,13 +349,13 @@ void CKernelMatrix::SwapIndices( int i, int j )
 //---------------------------------------------------------------------------------------------------
 
 CSMOptimizer::CSMOptimizer(const CSvmKernel& kernel, const IProblem& _data,
-		int _maxIter, double _errorWeight, double _tolerance, bool _doShrinking, int cacheSize) :
+		int _maxIter, double _errorWeight, double _tolerance, bool _doShrinking, int threadCount, int cacheSize) :
 	data( &_data ),
 	maxIter( _maxIter ),
 	errorWeight( _errorWeight ),
 	tolerance( _tolerance ),
 	doShrinking( _doShrinking ),
-	kernelMatrix( FINE_DEBUG_NEW CKernelMatrix( _data, kernel, cacheSize ) ),
+	kernelMatrix( FINE_DEBUG_NEW CKernelMatrix( _data, kernel, cacheSize, threadCount ) ),
 	log( nullptr ),
 	vectorCount( data->GetVectorCount() ),
 	y( kernelMatrix->GetBinaryClasses() ),
@@ -459,8 +533,9 @@ bool CSMOptimizer::findMaxViolatingIndices( int& outI, int& outJ ) const
 // The optimal values are calculated analytically
 void CSMOptimizer::optimizeIndices( int i, int j )
 {	
-	const float* q_i = kernelMatrix->GetColumn( i, activeSize );
-	const float* q_j = kernelMatrix->GetColumn( j, activeSize );
+	const float* q_i;
+	const float* q_j;
+	kernelMatrix->GetColumns( i, j, activeSize, q_i, q_j );
 	double c_i = weightsMultErrorWeight[i];
 	double c_j = weightsMultErrorWeight[j];
 	double oldAlpha_i = alpha[i];
@@ -44,9 +44,10 @@ public:
 	// kernel is the SVM kernel function
 	// data contains the training set
 	// tolerance is the required precision
+	// threadCount is the number of threads used to calculate the kernel matrix
 	// cacheSize is the cache size in MB
 	CSMOptimizer(const CSvmKernel& kernel, const IProblem& data, int maxIter, double errorWeight, double tolerance,
-		bool doShrinking, int cacheSize = 200);
+		bool doShrinking, int threadCount = 1, int cacheSize = 200);
 	~CSMOptimizer();
 
 	// Calculates the optimal multipliers for the support vectors
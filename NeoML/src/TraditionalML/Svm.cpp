@@ -52,7 +52,7 @@ CPtr<IModel> CSvm::Train( const IProblem& problem )
 	CSvmKernel kernel( params.KernelType, params.Degree, params.Gamma, params.Coeff0 );
 
 	CSMOptimizer optimizer( kernel, problem, params.MaxIterations, params.ErrorWeight, params.Tolerance,
-		params.DoShrinking );
+		params.DoShrinking, params.ThreadCount );
 	if( log != nullptr ) {
 		optimizer.SetLog( log );
 	}
@@ -40,6 +40,33 @@ inline double power(double base, int times)
 	return ret;
 }
 
+// The dot product of two dense vectors
+// The sum is split into several independent partial sums so that the loop may be vectorized
+static inline double denseDotProduct( const CFloatVectorDesc& x1, const CFloatVectorDesc& x2 )
+{
+	const int size = min( x1.Size, x2.Size );
+	double sum[4] = { 0, 0, 0, 0 };
+	int i = 0;
+	for( ; i + 4 <= size; i += 4 ) {
+		for( int k = 0; k < 4; k++ ) {
+			sum[k] += static_cast<double>( x1.Values[i + k] ) * x2.Values[i + k];
+		}
+	}
+	for( ; i < size; i++ ) {
+		sum[0] += static_cast<double>( x1.Values[i] ) * x2.Values[i];
+	}
+	return ( sum[0] + sum[1] ) + ( sum[2] + sum[3] );
+}
+
+// The dot product that uses the vectorized loop for dense vectors
+static inline double dotProduct( const CFloatVectorDesc& x1, const CFloatVectorDesc& x2 )
+{
+	if( x1.Indexes == nullptr && x2.Indexes == nullptr ) {
+		return denseDotProduct( x1, x2 );
+	}
+	return DotProduct( x1, x2 );
+}
+
 CSvmKernel::CSvmKernel(TKernelType kernelType, int degree, double gamma, double coef0) :
 	kernelType(kernelType), degree(degree), gamma(gamma), coef0(coef0)
 {
@@ -48,13 +75,13 @@ CSvmKernel::CSvmKernel(TKernelType kernelType, int degree, double gamma, double
 // The linear kernel
 double CSvmKernel::linear(const CFloatVectorDesc& x1, const CFloatVectorDesc& x2) const
 {
-	return DotProduct(x1, x2);
+	return dotProduct(x1, x2);
 }
 
 // The polynomial kernel
 double CSvmKernel::poly(const CFloatVectorDesc& x1, const CFloatVectorDesc& x2) const
 {
-	return power(gamma * DotProduct(x1, x2) + coef0, degree);
+	return power(gamma * dotProduct(x1, x2) + coef0, degree);
 }
 
 // The Gaussian kernel
@@ -78,7 +105,7 @@ double CSvmKernel::rbf(const CFloatVectorDesc& x1, const CFloatVectorDesc& x2) c
 // The sigmoid kernel
 double CSvmKernel::sigmoid(const CFloatVectorDesc& x1, const CFloatVectorDesc& x2) const
 {
-	return tanh(gamma * DotProduct(x1, x2) + coef0);
+	return tanh(gamma * dotProduct(x1, x2) + coef0);
 }
 
 double CSvmKernel::Calculate(const CFloatVectorDesc& x1, const CFloatVectorDesc& x2) const
@@ -130,21 +157,27 @@ double CSvmKernel::rbfDenseBySparse( const CFloatVectorDesc& x1, const CFloatVec
 
 double CSvmKernel::rbfDenseByDense( const CFloatVectorDesc& x1, const CFloatVectorDesc& x2 ) const
 {
-	double square = 0;
-	double diff;
+	// Several independent partial sums so that the loop may be vectorized
+	double square[4] = { 0, 0, 0, 0 };
 	const int minSize = min( x1.Size, x2.Size );
 	int i = 0;
+	for( ; i + 4 <= minSize; i += 4 ) {
+		for( int k = 0; k < 4; k++ ) {
+			const double diff = x1.Values[i + k] - x2.Values[i + k];
+			square[k] += diff * diff;
+		}
+	}
 	for( ; i < minSize; ++i ) {
-		diff = x1.Values[i] - x2.Values[i];
-		square += diff * diff;
+		const double diff = x1.Values[i] - x2.Values[i];
+		square[0] += diff * diff;
 	}
 	for( ; i < x1.Size; ++i ) {
-		square += x1.Values[i] * x1.Values[i];
+		square[0] += x1.Values[i] * x1.Values[i];
 	}
 	for( ; i < x2.Size; ++i ) {
-		square += x2.Values[i] * x2.Values[i];
+		square[0] += x2.Values[i] * x2.Values[i];
 	}
-	return exp(-gamma * square);
+	return exp(-gamma * ( ( square[0] + square[1] ) + ( square[2] + square[3] ) ));
 }
 
 double CSvmKernel::rbfSparseBySparse( const CFloatVectorDesc& x1, const CFloatVectorDesc& x2 ) const
@@ -1467,4 +1467,153 @@ TEST_F( CAutoDiffTest, TestLess )
 	for( int i = 0; i < expected.Size(); i++ ) {
 		ASSERT_NEAR( resData[i], expected[i], 1e-4 );
 	}
-}
\ No newline at end of file
+}
+
+// The user-defined operation which only provides the jacobian: result = first * first
+class CTapeSquare : public ITapeOperation {
+public:
+	explicit CTapeSquare( const CDnnBlob& _first ) : first( &_first ) {}
+
+	CPtr<CDnnBlob> Jacobian( const CTapeBlob* var ) const override
+	{
+		const CTapeBlob* tapeBlob = dynamic_cast<const CTapeBlob*>( first.Ptr() );
+		CPtr<CDnnBlob> jacobian = tapeBlob->Tape()->GetOperation( tapeBlob )->Jacobian( var );
+		if( jacobian == 0 ) {
+			return 0;
+		}
+		NeoAssert( jacobian->GetObjectCount() == 1 );
+		MathEngine().VectorEltwiseMultiply( jacobian->GetData(), first->GetData(), jacobian->GetData(), jacobian->GetDataSize() );
+		MathEngine().VectorAdd( jacobian->GetData(), jacobian->GetData(), jacobian->GetData(), jacobian->GetDataSize() );
+		return jacobian;
+	}
+
+private:
+	CPtr<const CDnnBlob> first;
+};
+
+static CPtr<const CDnnBlob> square( const CDnnBlob* first )
+{
+	const CTapeBlob* tapeBlob = dynamic_cast<const CTapeBlob*>( first );
+	CPtr<CTapeBlob> result( new CTapeBlob( tapeBlob->Tape(), MathEngine(), first->GetDesc() ) );
+	MathEngine().VectorEltwiseMultiply( first->GetData(), first->GetData(), result->GetData(), result->GetDataSize() );
+	CPtr<ITapeOperation> operation( new CTapeSquare( *first ) );
+	tapeBlob->Tape()->Add( result, operation );
+	return result.Ptr();
+}
+
+TEST_F( CAutoDiffTest, TestJacobianOnlyOperation )
+{
+	jacobianCommonTestImpl(
+		{ 0.5, 1, 1.5, 2, 2.5, 3, 3.5, 4 },
+		{ 1, 2, 3, 4, 5, 6, 7, 8 },
+		{ 656 },
+		{ 2, 9, 28, 65, 126, 217, 344, 513 },
+		{ 8 },
+		[]( CPtr<const CDnnBlob>& x, CPtr<CDnnBlob>& a, CPtr<CDnnBlob>& b ) {
+			// sum( (x * b) ^ 2 * a + x )
+			return Sum( Add( Mul( square( Mul( x, b ) ), a ), x ), {} );
+		}
+	);
+}
+
+// Calculates the gradient using the jacobian of the whole expression
+static CPtr<CDnnBlob> gradientByJacobian( const CDnnBlob& expression, const CDnnBlob& var )
+{
+	const CTapeBlob* expressionTapeBlob = dynamic_cast<const CTapeBlob*>( &expression );
+	const CTapeBlob* varTapeBlob = dynamic_cast<const CTapeBlob*>( &var );
+	CPtr<CDnnBlob> jacobian = expressionTapeBlob->Tape()->GetOperation( expressionTapeBlob )->Jacobian( varTapeBlob );
+	if( jacobian->GetObjectCount() == 1 ) {
+		return jacobian;
+	}
+	CPtr<CDnnBlob> result = CDnnBlob::CreateBlob( MathEngine(), var.GetDesc() );
+	MathEngine().SumMatrixRows( 1, result->GetData(), jacobian->GetData(), jacobian->GetObjectCount(), jacobian->GetObjectSize() );
+	return result;
+}
+
+// The expression with the dense jacobians: the concatenation and the broadcasting
+static CPtr<const CDnnBlob> denseJacobianExpression( const CPtr<const CDnnBlob>& x, const CPtr<CDnnBlob>& a,
+	const CPtr<CDnnBlob>& b )
+{
+	CObjectArray<CDnnBlob> parts;
+	parts.Add( const_cast<CDnnBlob*>( Mul( x, a ).Ptr() ) );
+	parts.Add( const_cast<CDnnBlob*>( Exp( Neg( x ) ).Ptr() ) );
+	parts.Add( const_cast<CDnnBlob*>( CumSum( Div( x, b ), BD_BatchWidth ).Ptr() ) );
+	CPtr<const CDnnBlob> partsSum = Sum( Concat( parts, BD_BatchLength ), { BD_BatchLength } );
+	CPtr<const CDnnBlob> scaled = Mul( Pow( x, 2.f ), Sum( partsSum, { BD_Channels } ) );
+	return Mean( Log( Add( Abs( scaled ), 1.f ) ), {} );
+}
+
+static void fillRandom( CDnnBlob& blob, CRandom& random, double min, double max )
+{
+	CArray<float> data;
+	for( int i = 0; i < blob.GetDataSize(); i++ ) {
+		data.Add( static_cast<float>( random.Uniform( min, max ) ) );
+	}
+	blob.CopyFrom( data.GetPtr() );
+}
+
+TEST_F( CAutoDiffTest, TestFiniteDifferences )
+{
+	CRandom random( 0x1234 );
+	CGradientTape tape;
+
+	CPtr<CDnnBlob> xBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, 6, 4 );
+	fillRandom( *xBlob, random, -1., 1. );
+	CPtr<const CDnnBlob> x = tape.Variable( *xBlob );
+	CPtr<CDnnBlob> a = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, 6, 4 );
+	fillRandom( *a, random, -1., 1. );
+	CPtr<CDnnBlob> b = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, 1, 4 );
+	fillRandom( *b, random, 1., 2. );
+
+	CPtr<const CDnnBlob> grad = tape.Gradient( *denseJacobianExpression( x, a, b ), *x );
+	ASSERT_TRUE( grad->GetDesc().HasEqualDimensions( x->GetDesc() ) );
+	CArray<float> gradData;
+	gradData.SetSize( grad->GetDataSize() );
+	grad->CopyTo( gradData.GetPtr() );
+
+	CArray<float> xData;
+	xData.SetSize( xBlob->GetDataSize() );
+	xBlob->CopyTo( xData.GetPtr() );
+	const float step = 1e-3f;
+	for( int i = 0; i < xData.Size(); i++ ) {
+		xData[i] += step;
+		xBlob->CopyFrom( xData.GetPtr() );
+		const float plus = denseJacobianExpression( xBlob.Ptr(), a, b )->GetData().GetValue();
+		xData[i] -= 2 * step;
+		xBlob->CopyFrom( xData.GetPtr() );
+		const float minus = denseJacobianExpression( xBlob.Ptr(), a, b )->GetData().GetValue();
+		xData[i] += step;
+		ASSERT_NEAR( ( plus - minus ) / ( 2 * step ), gradData[i], 1e-3 );
+	}
+}
+
+TEST_F( CAutoDiffTest, DISABLED_GradientBenchmark )
+{
+	CRandom random( 0x1234 );
+	const int channels = 8;
+	for( int batchWidth : { 256, 32768 } ) {
+		CGradientTape tape;
+		CPtr<CDnnBlob> xBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, batchWidth, channels );
+		fillRandom( *xBlob, random, -1., 1. );
+		CPtr<const CDnnBlob> x = tape.Variable( *xBlob );
+		CPtr<CDnnBlob> a = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, batchWidth, channels );
+		fillRandom( *a, random, -1., 1. );
+		CPtr<CDnnBlob> b = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, 1, channels );
+		fillRandom( *b, random, 1., 2. );
+
+		CPtr<const CDnnBlob> loss = denseJacobianExpression( x, a, b );
+
+		auto begin = GetTickCount();
+		CPtr<const CDnnBlob> grad = tape.Gradient( *loss, *x );
+		GTEST_LOG_( INFO ) << "Parameters: " << x->GetDataSize() << ", vector-Jacobian products: "
+			<< GetTickCount() - begin << " ms";
+
+		// The jacobians of this expression take O(parameters ^ 2) memory
+		if( x->GetDataSize() <= 2048 ) {
+			begin = GetTickCount();
+			gradientByJacobian( *loss, *x );
+			GTEST_LOG_( INFO ) << "Parameters: " << x->GetDataSize() << ", jacobians: "
+				<< GetTickCount() - begin << " ms";
+		}
+	}
+}
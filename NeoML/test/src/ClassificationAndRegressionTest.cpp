@@ -319,6 +319,35 @@ TEST_F( RandomBinaryClassification4000x20, SvmRbf )
 	TestBinaryClassificationResult();
 }
 
+TEST_F( RandomBinaryClassification4000x20, SvmRbfThreads )
+{
+	CSvm::CParams params( CSvmKernel::KT_RBF );
+	CSvm svmRbf( params );
+	auto begin = GetTickCount();
+	CPtr<IModel> model = svmRbf.Train( *DenseRandomBinaryProblem );
+	GTEST_LOG_( INFO ) << "1 thread train time: " << GetTickCount() - begin;
+	ASSERT_TRUE( model != nullptr );
+
+	for( int threadCount : { 2, 4 } ) {
+		params.ThreadCount = threadCount;
+		CSvm svmRbfThreads( params );
+		begin = GetTickCount();
+		CPtr<IModel> modelThreads = svmRbfThreads.Train( *DenseRandomBinaryProblem );
+		GTEST_LOG_( INFO ) << threadCount << " threads train time: " << GetTickCount() - begin;
+		ASSERT_TRUE( modelThreads != nullptr );
+
+		// The kernel matrix elements do not depend on the number of threads
+		for( int i = 0; i < DenseBinaryTestData->GetVectorCount(); i++ ) {
+			CClassificationResult result;
+			CClassificationResult resultThreads;
+			ASSERT_TRUE( model->Classify( DenseBinaryTestData->GetVector( i ), result ) );
+			ASSERT_TRUE( modelThreads->Classify( DenseBinaryTestData->GetVector( i ), resultThreads ) );
+			ASSERT_EQ( result.PreferredClass, resultThreads.PreferredClass );
+			ASSERT_EQ( result.Probabilities[0].GetValue(), resultThreads.Probabilities[0].GetValue() );
+		}
+	}
+}
+
 TEST_F( RandomBinaryClassification4000x20, DecisionTree )
 {
 	CDecisionTree::CParams param;
@@ -327,6 +356,76 @@ TEST_F( RandomBinaryClassification4000x20, DecisionTree )
 	TestBinaryClassificationResult();
 }
 
+TEST_F( RandomBinaryClassification4000x20, DecisionTreeThreads )
+{
+	CDecisionTree::CParams param;
+	CDecisionTree decisionTree( param );
+	auto begin = GetTickCount();
+	CPtr<IModel> model = decisionTree.Train( *DenseRandomBinaryProblem );
+	GTEST_LOG_( INFO ) << "1 thread train time: " << GetTickCount() - begin;
+	ASSERT_TRUE( model != nullptr );
+
+	for( int threadCount : { 2, 4 } ) {
+		param.ThreadCount = threadCount;
+		CDecisionTree decisionTreeThreads( param );
+		begin = GetTickCount();
+		CPtr<IModel> modelThreads = decisionTreeThreads.Train( *DenseRandomBinaryProblem );
+		GTEST_LOG_( INFO ) << threadCount << " threads train time: " << GetTickCount() - begin;
+		ASSERT_TRUE( modelThreads != nullptr );
+
+		// The splits found do not depend on the number of threads
+		for( int i = 0; i < DenseBinaryTestData->GetVectorCount(); i++ ) {
+			CClassificationResult result;
+			CClassificationResult resultThreads;
+			ASSERT_TRUE( model->Classify( DenseBinaryTestData->GetVector( i ), result ) );
+			ASSERT_TRUE( modelThreads->Classify( DenseBinaryTestData->GetVector( i ), resultThreads ) );
+			ASSERT_EQ( result.PreferredClass, resultThreads.PreferredClass );
+			ASSERT_EQ( result.Probabilities[0].GetValue(), resultThreads.Probabilities[0].GetValue() );
+		}
+	}
+}
+
+TEST_F( RandomBinaryClassification4000x20, DecisionTreeHistogram )
+{
+	CDecisionTree::CParams param;
+	param.SplitMode = CDecisionTree::SM_Histogram;
+	param.MaxBins = 64;
+	CDecisionTree decisionTree( param );
+	TrainBinary( decisionTree );
+	TestBinaryClassificationResult();
+
+	param.ThreadCount = 4;
+	CDecisionTree decisionTreeThreads( param );
+	CPtr<IModel> model = decisionTree.Train( *DenseRandomBinaryProblem );
+	CPtr<IModel> modelThreads = decisionTreeThreads.Train( *DenseRandomBinaryProblem );
+	for( int i = 0; i < DenseBinaryTestData->GetVectorCount(); i++ ) {
+		CClassificationResult result;
+		CClassificationResult resultThreads;
+		ASSERT_TRUE( model->Classify( DenseBinaryTestData->GetVector( i ), result ) );
+		ASSERT_TRUE( modelThreads->Classify( DenseBinaryTestData->GetVector( i ), resultThreads ) );
+		ASSERT_EQ( result.PreferredClass, resultThreads.PreferredClass );
+	}
+}
+
+TEST( DecisionTreeBenchmark, DISABLED_SplitModes )
+{
+	CRandom random( 0x1234 );
+	CPtr<CClassificationRandomProblem> problem = CClassificationRandomProblem::Random( random, 20000, 50, 4 );
+	for( int mode = 0; mode < CDecisionTree::SM_Count; mode++ ) {
+		for( int threadCount : { 1, 4 } ) {
+			CDecisionTree::CParams param;
+			param.SplitMode = static_cast<CDecisionTree::TSplitMode>( mode );
+			param.ThreadCount = threadCount;
+			CDecisionTree decisionTree( param );
+			const auto begin = GetTickCount();
+			CPtr<IModel> model = decisionTree.Train( *problem );
+			GTEST_LOG_( INFO ) << "Split mode " << mode << ", " << threadCount << " threads, train time: "
+				<< GetTickCount() - begin;
+			ASSERT_TRUE( model != nullptr );
+		}
+	}
+}
+
 TEST_F( RandomMultiClassification2000x20, GBTB_Full )
 {
 	CRandom random( 0 );
@@ -536,6 +635,96 @@ TEST_F( RandomBinaryClassification4000x20, CrossValidationDecisionTree )
 	CrossValidate( 10, decisionTree, DenseRandomBinaryProblem, SparseRandomBinaryProblem );
 }
 
+template<class TTrainingModel>
+static void CrossValidateParallel( const typename TTrainingModel::CParams& params, const IProblem* problem )
+{
+	TTrainingModel trainingModel( params );
+	CCrossValidation crossValidation( trainingModel, problem );
+	CCrossValidationResult result;
+	auto begin = GetTickCount();
+	crossValidation.Execute( 10, AccuracyScore, result, true );
+	GTEST_LOG_( INFO ) << "Sequential execution time: " << GetTickCount() - begin;
+
+	CTrainingModelFactory<TTrainingModel> factory( params );
+	for( int threadCount : { 2, 4, 16 } ) {
+		CCrossValidation crossValidationParallel( factory, problem, threadCount );
+		CCrossValidationResult resultParallel;
+		begin = GetTickCount();
+		crossValidationParallel.Execute( 10, AccuracyScore, resultParallel, true );
+		GTEST_LOG_( INFO ) << threadCount << " threads execution time: " << GetTickCount() - begin;
+
+		ASSERT_EQ( result.Models.Size(), resultParallel.Models.Size() );
+		ASSERT_EQ( result.Success.Size(), resultParallel.Success.Size() );
+		ASSERT_EQ( result.Results.Size(), resultParallel.Results.Size() );
+		for( int i = 0; i < result.Success.Size(); i++ ) {
+			ASSERT_TRUE( resultParallel.Models[i] != nullptr );
+			ASSERT_NEAR( result.Success[i], resultParallel.Success[i], 1e-2 );
+		}
+		for( int i = 0; i < result.ModelIndex.Size(); i++ ) {
+			ASSERT_EQ( result.ModelIndex[i], resultParallel.ModelIndex[i] );
+		}
+	}
+}
+
+TEST_F( RandomBinaryClassification4000x20, CrossValidationParallelLinear )
+{
+	CrossValidateParallel<CLinear>( CLinear::CParams( EF_SquaredHinge ), DenseRandomBinaryProblem );
+}
+
+TEST_F( RandomBinaryClassification4000x20, CrossValidationParallelDecisionTree )
+{
+	CrossValidateParallel<CDecisionTree>( CDecisionTree::CParams(), DenseRandomBinaryProblem );
+}
+
+// Fails the training of one fold
+class CFailingFoldFactory : public ITrainingModelFactory {
+public:
+	explicit CFailingFoldFactory( int _failingFold ) : failingFold( _failingFold ), createdCount( 0 ) {}
+
+	ITrainingModel* CreateTrainingModel( int threadCount ) const override
+	{
+		return new CFoldTrainingModel( createdCount++ == failingFold, threadCount );
+	}
+
+private:
+	class CFoldTrainingModel : public ITrainingModel {
+	public:
+		CFoldTrainingModel( bool _fails, int threadCount ) : fails( _fails ), linear( linearParams( threadCount ) ) {}
+
+		CPtr<IModel> Train( const IProblem& problem ) override
+		{
+			if( fails ) {
+				throw std::logic_error( "fold failed" );
+			}
+			return linear.Train( problem );
+		}
+
+	private:
+		const bool fails;
+		CLinear linear;
+
+		static CLinear::CParams linearParams( int threadCount )
+		{
+			CLinear::CParams params( EF_SquaredHinge );
+			params.ThreadCount = threadCount;
+			return params;
+		}
+	};
+
+	const int failingFold;
+	mutable int createdCount;
+};
+
+TEST_F( RandomBinaryClassification4000x20, CrossValidationParallelRethrowsFoldError )
+{
+	for( int threadCount : { 1, 4 } ) {
+		CFailingFoldFactory factory( 6 );
+		CCrossValidation crossValidation( factory, DenseRandomBinaryProblem, threadCount );
+		CCrossValidationResult result;
+		EXPECT_THROW( crossValidation.Execute( 10, AccuracyScore, result, true ), std::logic_error );
+	}
+}
+
 // Test regression
 TEST_F( RandomBinaryRegression4000x20, Linear )
 {
@@ -0,0 +1,203 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+#include <memory>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+// The multihead attention layer uses the fused kernel for the inference on CPU
+// The internal network is used if the softmax output is connected or if the backward pass is performed
+// so it's used as the reference
+
+static CPtr<CDnnBlob> createRandomBlob( IMathEngine& mathEngine, CRandom& random, const CBlobDesc& desc )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::CreateBlob( mathEngine, CT_Float, desc );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+// Builds the network: Q, K, V (and mask) sources -> attention -> sink
+static void buildAttentionTestNet( CDnn& dnn, int headCount, int hiddenSize, int outputSize, bool useMask )
+{
+	const char* sourceNames[] = { "Q", "K", "V", "mask" };
+	CPtr<CMultiheadAttentionLayer> attention = new CMultiheadAttentionLayer( dnn.GetMathEngine() );
+	attention->SetName( "attention" );
+	attention->SetHeadCount( headCount );
+	attention->SetHiddenSize( hiddenSize );
+	attention->SetOutputSize( outputSize );
+	attention->SetUseMask( useMask );
+	for( int i = 0; i < ( useMask ? 4 : 3 ); ++i ) {
+		CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+		source->SetName( sourceNames[i] );
+		dnn.AddLayer( *source );
+		attention->Connect( i, *source );
+	}
+	dnn.AddLayer( *attention );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "output" );
+	sink->Connect( *attention );
+	dnn.AddLayer( *sink );
+}
+
+// Connects the softmax output of the attention which disables the fused implementation
+static void connectSoftmaxOutput( CDnn& dnn )
+{
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "softmax" );
+	sink->Connect( 0, *dnn.GetLayer( "attention" ), 1 );
+	dnn.AddLayer( *sink );
+}
+
+static void setAttentionTestInputs( CDnn& dnn, CRandom& random, int batchSize, int querySize, int keySize,
+	int channels, bool useMask )
+{
+	IMathEngine& mathEngine = dnn.GetMathEngine();
+	CheckCast<CSourceLayer>( dnn.GetLayer( "Q" ) )->SetBlob(
+		createRandomBlob( mathEngine, random, CBlobDesc( { 1, batchSize, querySize, 1, 1, 1, channels } ) ) );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "K" ) )->SetBlob(
+		createRandomBlob( mathEngine, random, CBlobDesc( { 1, batchSize, keySize, 1, 1, 1, channels } ) ) );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "V" ) )->SetBlob(
+		createRandomBlob( mathEngine, random, CBlobDesc( { 1, batchSize, keySize, 1, 1, 1, channels } ) ) );
+	if( useMask ) {
+		CArray<float> maskData;
+		maskData.Add( 0.f, querySize * keySize );
+		for( int i = 0; i < maskData.Size(); ++i ) {
+			// Every query has at least one key which is not masked
+			maskData[i] = ( i % keySize ) != ( i / keySize ) % keySize && random.Next() % 3 == 0 ? 1.f : 0.f;
+		}
+		CPtr<CDnnBlob> mask = CDnnBlob::CreateBlob( mathEngine, CT_Float, CBlobDesc( { 1, 1, 1, 1, querySize, 1, keySize } ) );
+		mask->CopyFrom( maskData.GetPtr() );
+		CheckCast<CSourceLayer>( dnn.GetLayer( "mask" ) )->SetBlob( mask );
+	}
+}
+
+static void getOutput( CDnn& dnn, CArray<float>& result )
+{
+	CPtr<CDnnBlob> output = CheckCast<CSinkLayer>( dnn.GetLayer( "output" ) )->GetBlob();
+	result.SetSize( output->GetDataSize() );
+	output->CopyTo( result.GetPtr() );
+}
+
+static void checkEqual( const CArray<float>& expected, const CArray<float>& actual )
+{
+	ASSERT_EQ( expected.Size(), actual.Size() );
+	for( int i = 0; i < expected.Size(); ++i ) {
+		ASSERT_NEAR( expected[i], actual[i], 1e-4f ) << i;
+	}
+}
+
+TEST( CDnnAttentionTest, FusedSameAsInternalDnn )
+{
+	const int batchSize = 3;
+	// Several query tiles and key blocks of the fused kernel
+	const int querySize = 45;
+	const int keySize = 300;
+	const int channels = 10;
+
+	for( int useMask = 0; useMask < 2; ++useMask ) {
+		CRandom random( 0x789 );
+		CDnn dnn( random, MathEngine() );
+		buildAttentionTestNet( dnn, 4, 32, 12, useMask != 0 );
+		setAttentionTestInputs( dnn, random, batchSize, querySize, keySize, channels, useMask != 0 );
+
+		dnn.RunOnce();
+		CArray<float> actual;
+		getOutput( dnn, actual );
+		// The second run uses the cached weights
+		dnn.RunOnce();
+		CArray<float> secondRun;
+		getOutput( dnn, secondRun );
+		checkEqual( actual, secondRun );
+
+		connectSoftmaxOutput( dnn );
+		dnn.RunOnce();
+		CArray<float> expected;
+		getOutput( dnn, expected );
+		checkEqual( expected, actual );
+	}
+}
+
+TEST( CDnnAttentionTest, TransformerFusedSameAsInternalDnn )
+{
+	const int batchSize = 2;
+	const int listSize = 40;
+	const int channels = 16;
+
+	CRandom random( 0x987 );
+	CDnn dnn( random, MathEngine() );
+	CPtr<CSourceLayer> source = Source( dnn, "source" );
+	CPtr<CTransformerEncoderLayer> transformer = TransformerEncoder( 4, 16, 0.f, 24, AF_ReLU )( "transformer", source.Ptr() );
+	CPtr<CSinkLayer> sink = Sink( transformer.Ptr(), "output" );
+	CPtr<CSourceLayer> label = Source( dnn, "label" );
+	EuclideanLoss()( "loss", transformer.Ptr(), label.Ptr() );
+
+	source->SetBlob( createRandomBlob( MathEngine(), random, CBlobDesc( { 1, batchSize, listSize, 1, 1, 1, channels } ) ) );
+	label->SetBlob( createRandomBlob( MathEngine(), random, CBlobDesc( { 1, batchSize, listSize, 1, 1, 1, channels } ) ) );
+
+	// The inference uses the fused attention
+	dnn.RunOnce();
+	CArray<float> actual;
+	getOutput( dnn, actual );
+
+	// The backward pass needs the internal network
+	dnn.RunAndBackwardOnce();
+	CArray<float> expected;
+	getOutput( dnn, expected );
+	checkEqual( expected, actual );
+}
+
+// Compares the time and the memory of the attention over the long sequences
+TEST( CDnnAttentionTest, DISABLED_Benchmark )
+{
+	const int headCount = 2;
+	const int hiddenSize = 64;
+	const int runCount = 3;
+
+	for( int sequenceLength = 128; sequenceLength <= 4096; sequenceLength *= 2 ) {
+		for( int isFused = 1; isFused >= 0; --isFused ) {
+			std::unique_ptr<IMathEngine> mathEngine( CreateCpuMathEngine( 1, 0 ) );
+			CRandom random( 0x654 );
+			CDnn dnn( random, *mathEngine );
+			buildAttentionTestNet( dnn, headCount, hiddenSize, hiddenSize, false );
+			if( isFused == 0 ) {
+				connectSoftmaxOutput( dnn );
+			}
+			setAttentionTestInputs( dnn, random, 1, sequenceLength, sequenceLength, hiddenSize, false );
+			dnn.RunOnce();
+
+			const unsigned long long begin = GetTickCount();
+			for( int i = 0; i < runCount; ++i ) {
+				dnn.RunOnce();
+			}
+			const unsigned long long time = GetTickCount() - begin;
+
+			GTEST_LOG_( INFO ) << "Sequence length " << sequenceLength
+				<< ( isFused != 0 ? ", fused: " : ", internal network: " ) << time / runCount << " ms, peak memory "
+				<< mathEngine->GetPeakMemoryUsage() / 1024 << " KB";
+		}
+	}
+}
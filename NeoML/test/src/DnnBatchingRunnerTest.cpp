@@ -0,0 +1,212 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+#include <NeoML/Dnn/DnnBatchingRunner.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static void buildBatchingTestNet( CDnn& dnn, int hiddenSize, int outputSize )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	CPtr<CFullyConnectedLayer> hidden = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	hidden->SetName( "hidden" );
+	hidden->SetNumberOfElements( hiddenSize );
+	hidden->Connect( *source );
+	dnn.AddLayer( *hidden );
+
+	CPtr<CReLULayer> relu = new CReLULayer( dnn.GetMathEngine() );
+	relu->SetName( "relu" );
+	relu->Connect( *hidden );
+	dnn.AddLayer( *relu );
+
+	CPtr<CFullyConnectedLayer> output = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	output->SetName( "output" );
+	output->SetNumberOfElements( outputSize );
+	output->Connect( *relu );
+	dnn.AddLayer( *output );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *output );
+	dnn.AddLayer( *sink );
+}
+
+static CPtr<CDnnBlob> createBatchingTestInput( IMathEngine& mathEngine, CRandom& random, int batchWidth, int size )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::CreateDataBlob( mathEngine, CT_Float, 1, batchWidth, size );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+static void initBatchingTestNet( CDnn& dnn, CRandom& random, int inputSize )
+{
+	// Initializes the parameters
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob(
+		createBatchingTestInput( dnn.GetMathEngine(), random, 1, inputSize ) );
+	dnn.RunOnce();
+}
+
+TEST( CDnnBatchingRunnerTest, SameResult )
+{
+	const int inputSize = 20;
+	const int threadCount = 6;
+	const int requestCount = 20;
+	CRandom random( 0x456 );
+	CDnn dnn( random, MathEngine() );
+	buildBatchingTestNet( dnn, 32, 5 );
+	initBatchingTestNet( dnn, random, inputSize );
+
+	// The expected results are calculated by a copy of the network, one request at a time
+	CRandom cloneRandom( 0x654 );
+	std::unique_ptr<CDnn> expectedDnn( dnn.CreateInferenceClone( cloneRandom ) );
+
+	std::vector<std::vector<CPtr<CDnnBlob>>> inputs( threadCount );
+	for( int i = 0; i < threadCount; ++i ) {
+		for( int j = 0; j < requestCount; ++j ) {
+			inputs[i].push_back( createBatchingTestInput( MathEngine(), random, 1 + ( i + j ) % 3, inputSize ) );
+		}
+	}
+
+	CArray<CString> sources = { "source" };
+	CArray<CString> sinks = { "sink" };
+	std::vector<std::vector<CPtr<CDnnBlob>>> results( threadCount );
+	{
+		CDnnBatchingRunner runner( dnn, sources, sinks, 8, 1000 );
+		std::vector<std::thread> threads;
+		for( int i = 0; i < threadCount; ++i ) {
+			threads.emplace_back( [&runner, &inputs, &results, i]() {
+				for( size_t j = 0; j < inputs[i].size(); ++j ) {
+					CObjectArray<CDnnBlob> requestInputs;
+					requestInputs.Add( inputs[i][j] );
+					CObjectArray<CDnnBlob> requestOutputs;
+					runner.Run( requestInputs, requestOutputs );
+					results[i].push_back( requestOutputs[0] );
+				}
+			} );
+		}
+		for( auto& thread : threads ) {
+			thread.join();
+		}
+		EXPECT_EQ( threadCount * requestCount, runner.GetRequestCount() );
+		EXPECT_GE( runner.GetRequestCount(), runner.GetBatchCount() );
+
+		CArray<int> histogram;
+		runner.GetLatencyHistogram( histogram );
+		int total = 0;
+		for( int i = 0; i < histogram.Size(); ++i ) {
+			total += histogram[i];
+		}
+		EXPECT_EQ( runner.GetRequestCount(), total );
+		EXPECT_LE( runner.GetLatencyPercentile( 50 ), runner.GetLatencyPercentile( 99 ) );
+	}
+
+	CPtr<CSourceLayer> source = CheckCast<CSourceLayer>( expectedDnn->GetLayer( "source" ) );
+	CPtr<CSinkLayer> sink = CheckCast<CSinkLayer>( expectedDnn->GetLayer( "sink" ) );
+	for( int i = 0; i < threadCount; ++i ) {
+		ASSERT_EQ( inputs[i].size(), results[i].size() );
+		for( size_t j = 0; j < inputs[i].size(); ++j ) {
+			source->SetBlob( inputs[i][j] );
+			expectedDnn->RunOnce();
+			CArray<float> expected;
+			expected.SetSize( sink->GetBlob()->GetDataSize() );
+			sink->GetBlob()->CopyTo( expected.GetPtr() );
+
+			ASSERT_EQ( expected.Size(), results[i][j]->GetDataSize() );
+			CArray<float> actual;
+			actual.SetSize( expected.Size() );
+			results[i][j]->CopyTo( actual.GetPtr() );
+			for( int k = 0; k < expected.Size(); ++k ) {
+				EXPECT_NEAR( expected[k], actual[k], 1e-4f ) << i << " " << j << " " << k;
+			}
+		}
+	}
+}
+
+// Runs the requests from several client threads and logs the latency and the throughput
+static void runBatchingBenchmark( CDnn& dnn, CRandom& random, const char* name, int maxBatchSize, int maxWait,
+	int clientCount, int requestCount, int inputSize )
+{
+	std::vector<CPtr<CDnnBlob>> inputs;
+	for( int i = 0; i < clientCount; ++i ) {
+		inputs.push_back( createBatchingTestInput( dnn.GetMathEngine(), random, 1, inputSize ) );
+	}
+
+	CArray<CString> sources = { "source" };
+	CArray<CString> sinks = { "sink" };
+	CDnnBatchingRunner runner( dnn, sources, sinks, maxBatchSize, maxWait );
+	std::vector<std::vector<double>> latencies( clientCount );
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for( int i = 0; i < clientCount; ++i ) {
+		threads.emplace_back( [&runner, &inputs, &latencies, requestCount, i]() {
+			CObjectArray<CDnnBlob> requestInputs;
+			requestInputs.Add( inputs[i] );
+			CObjectArray<CDnnBlob> requestOutputs;
+			for( int j = 0; j < requestCount; ++j ) {
+				const auto requestStart = std::chrono::steady_clock::now();
+				runner.Run( requestInputs, requestOutputs );
+				latencies[i].push_back( std::chrono::duration<double, std::micro>(
+					std::chrono::steady_clock::now() - requestStart ).count() );
+			}
+		} );
+	}
+	for( auto& thread : threads ) {
+		thread.join();
+	}
+	const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+	std::vector<double> allLatencies;
+	for( int i = 0; i < clientCount; ++i ) {
+		allLatencies.insert( allLatencies.end(), latencies[i].begin(), latencies[i].end() );
+	}
+	std::sort( allLatencies.begin(), allLatencies.end() );
+	const size_t total = allLatencies.size();
+	GTEST_LOG_( INFO ) << name << ": p50 " << allLatencies[total / 2] << " us, p99 " << allLatencies[total * 99 / 100]
+		<< " us, throughput " << total / seconds << " requests/s, average batch "
+		<< static_cast<double>( runner.GetRequestCount() ) / runner.GetBatchCount()
+		<< ", histogram p50 < " << runner.GetLatencyPercentile( 50 ) << " us, p99 < " << runner.GetLatencyPercentile( 99 ) << " us";
+	EXPECT_EQ( static_cast<int>( total ), runner.GetRequestCount() );
+}
+
+TEST( CDnnBatchingRunnerTest, DISABLED_Benchmark )
+{
+	const int inputSize = 256;
+	CRandom random( 0x789 );
+	CDnn dnn( random, MathEngine() );
+	buildBatchingTestNet( dnn, 1024, 16 );
+	initBatchingTestNet( dnn, random, inputSize );
+
+	runBatchingBenchmark( dnn, random, "Per request", 1, 0, 16, 50, inputSize );
+	runBatchingBenchmark( dnn, random, "Batched", 16, 500, 16, 50, inputSize );
+}
@@ -0,0 +1,329 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+#include <NeoML/Dnn/DnnDistributed.h>
+
+#include <chrono>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static const int InputSize = 32;
+static const int ClassCount = 4;
+static const int BatchSize = 16;
+
+// Builds a chain of fully connected layers with a cross-entropy loss
+static void buildFcNet( CDnn& dnn, int hiddenSize, int depth )
+{
+	CPtr<CSourceLayer> data = new CSourceLayer( dnn.GetMathEngine() );
+	data->SetName( "data" );
+	dnn.AddLayer( *data );
+
+	CPtr<CSourceLayer> label = new CSourceLayer( dnn.GetMathEngine() );
+	label->SetName( "label" );
+	dnn.AddLayer( *label );
+
+	CBaseLayer* prev = data;
+	for( int i = 0; i < depth; ++i ) {
+		CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( dnn.GetMathEngine() );
+		fc->SetName( CString( "fc" ) + Str( i ) );
+		fc->SetNumberOfElements( hiddenSize );
+		fc->Connect( *prev );
+		dnn.AddLayer( *fc );
+
+		CPtr<CReLULayer> relu = new CReLULayer( dnn.GetMathEngine() );
+		relu->SetName( CString( "relu" ) + Str( i ) );
+		relu->Connect( *fc );
+		dnn.AddLayer( *relu );
+		prev = relu;
+	}
+
+	CPtr<CFullyConnectedLayer> output = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	output->SetName( "output" );
+	output->SetNumberOfElements( ClassCount );
+	output->Connect( *prev );
+	dnn.AddLayer( *output );
+
+	CPtr<CCrossEntropyLossLayer> loss = new CCrossEntropyLossLayer( dnn.GetMathEngine() );
+	loss->SetName( "loss" );
+	loss->Connect( 0, *output );
+	loss->Connect( 1, *label );
+	dnn.AddLayer( *loss );
+}
+
+// Stores the network to the file that is used to create the distributed models
+static void storeFcNet( const char* fileName, int hiddenSize, int depth )
+{
+	CRandom random( 0x543 );
+	CDnn dnn( random, MathEngine() );
+	buildFcNet( dnn, hiddenSize, depth );
+
+	CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+	CArchive archive( &file, CArchive::SD_Storing );
+	archive.Serialize( dnn );
+}
+
+// Generates the random batches; the same data is given to all the threads if the seed is shared
+class CRandomFcDataset : public IDistributedDataset {
+public:
+	CRandomFcDataset() : step( 0 ), isShared( false ) {}
+
+	void NextStep( bool shared ) { step++; isShared = shared; }
+	void SetInputBatch( CDnn& dnn, int thread ) override;
+
+private:
+	int step;
+	bool isShared;
+};
+
+void CRandomFcDataset::SetInputBatch( CDnn& dnn, int thread )
+{
+	CRandom random( step * 1000 + ( isShared ? 0 : thread + 1 ) );
+
+	CPtr<CDnnBlob> data = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float, 1, BatchSize, InputSize );
+	CArray<float> dataBuffer;
+	dataBuffer.SetSize( data->GetDataSize() );
+	for( int i = 0; i < dataBuffer.Size(); ++i ) {
+		dataBuffer[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	data->CopyFrom( dataBuffer.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "data" ) )->SetBlob( data );
+
+	CPtr<CDnnBlob> label = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Int, 1, BatchSize, 1 );
+	CArray<int> labelBuffer;
+	labelBuffer.SetSize( label->GetDataSize() );
+	for( int i = 0; i < labelBuffer.Size(); ++i ) {
+		labelBuffer[i] = random.UniformInt( 0, ClassCount - 1 );
+	}
+	label->CopyFrom( labelBuffer.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "label" ) )->SetBlob( label );
+}
+
+// Generates the batches in advance, so that the next batch may be generated while the models are trained
+class CPreparedFcDataset : public IDistributedDataset {
+public:
+	CPreparedFcDataset( int _workerCount ) : workerCount( _workerCount ), step( 0 ) {}
+
+	// Generates the batches for the given step
+	void Prepare( int step );
+	// Switches to the batches of the given step
+	void SetStep( int _step ) { step = _step; }
+	void SetInputBatch( CDnn& dnn, int thread ) override;
+
+private:
+	const int workerCount;
+	int step;
+	// The data and the labels of both steps that may be used at the same time
+	CArray<float> data[2];
+	CArray<int> labels[2];
+};
+
+void CPreparedFcDataset::Prepare( int _step )
+{
+	CRandom random( _step );
+	CArray<float>& stepData = data[_step % 2];
+	stepData.SetSize( workerCount * BatchSize * InputSize );
+	for( int i = 0; i < stepData.Size(); ++i ) {
+		stepData[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	CArray<int>& stepLabels = labels[_step % 2];
+	stepLabels.SetSize( workerCount * BatchSize );
+	for( int i = 0; i < stepLabels.Size(); ++i ) {
+		stepLabels[i] = random.UniformInt( 0, ClassCount - 1 );
+	}
+}
+
+void CPreparedFcDataset::SetInputBatch( CDnn& dnn, int thread )
+{
+	CPtr<CDnnBlob> dataBlob = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float, 1, BatchSize, InputSize );
+	dataBlob->CopyFrom( data[step % 2].GetPtr() + thread * dataBlob->GetDataSize() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "data" ) )->SetBlob( dataBlob );
+
+	CPtr<CDnnBlob> labelBlob = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Int, 1, BatchSize, 1 );
+	labelBlob->CopyFrom( labels[step % 2].GetPtr() + thread * labelBlob->GetDataSize() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "label" ) )->SetBlob( labelBlob );
+}
+
+TEST( CDnnDistributedTest, WeightsAreSynchronized )
+{
+	const char* fileName = "test_distributed";
+	// Many small parameter blobs are averaged in one bucket, the large ones are averaged separately
+	storeFcNet( fileName, 600, 3 );
+
+	CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+	CArchive archive( &file, CArchive::SD_Loading );
+	const int workerCount = 3;
+	CDistributedTraining distributed( archive, workerCount );
+
+	CRandomFcDataset dataset;
+	for( int step = 0; step < 3; ++step ) {
+		dataset.NextStep( false );
+		distributed.RunAndLearnOnce( dataset );
+	}
+
+	CArray<float> losses;
+	distributed.GetLastLoss( "loss", losses );
+	ASSERT_EQ( workerCount, losses.Size() );
+	EXPECT_NE( losses[0], losses[1] );
+
+	// After the weights are averaged the models give the same loss on the same data
+	dataset.NextStep( true );
+	distributed.RunAndLearnOnce( dataset );
+	distributed.GetLastLoss( "loss", losses );
+	for( int i = 1; i < losses.Size(); ++i ) {
+		EXPECT_EQ( losses[0], losses[i] );
+	}
+}
+
+TEST( CDnnDistributedTest, AdaptiveSolverStaysSynchronized )
+{
+	const char* fileName = "test_distributed";
+	storeFcNet( fileName, 64, 2 );
+
+	const char* solverFileName = "test_distributed_solver";
+	{
+		CRandom random( 0x543 );
+		CDnn dnn( random, MathEngine() );
+		CPtr<CDnnSolver> solver = new CDnnAdaptiveGradientSolver( MathEngine() );
+		solver->SetLearningRate( 0.01f );
+		CArchiveFile file( solverFileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		SerializeSolver( archive, dnn, solver );
+	}
+
+	for( int mode = 0; mode < 2; ++mode ) {
+		const bool isAveragingGradients = mode == 0;
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		const int workerCount = 4;
+		CDistributedTraining distributed( archive, workerCount );
+
+		CArchiveFile solverFile( solverFileName, CArchive::load, GetPlatformEnv() );
+		CArchive solverArchive( &solverFile, CArchive::SD_Loading );
+		distributed.SetSolver( solverArchive );
+		distributed.SetAveragingGradients( isAveragingGradients );
+
+		CRandomFcDataset dataset;
+		for( int step = 0; step < 5; ++step ) {
+			dataset.NextStep( false );
+			distributed.RunAndLearnOnce( dataset );
+		}
+
+		// Both modes keep the weights equal; the gradient averaging also keeps the solver history equal
+		CArray<float> losses;
+		for( int step = 0; step < 2; ++step ) {
+			dataset.NextStep( true );
+			distributed.RunAndLearnOnce( dataset );
+			distributed.GetLastLoss( "loss", losses );
+			for( int i = 1; i < losses.Size(); ++i ) {
+				EXPECT_EQ( losses[0], losses[i] );
+			}
+		}
+	}
+}
+
+TEST( CDnnDistributedTest, AveragingModeIsSerialized )
+{
+	const char* solverFileName = "test_distributed_solver";
+	CRandom random( 0x543 );
+	CDnn dnn( random, MathEngine() );
+	{
+		CPtr<CDnnSolver> solver = new CDnnAdaptiveGradientSolver( MathEngine() );
+		// The weights are averaged by default
+		EXPECT_FALSE( solver->IsAveragingGradients() );
+		solver->SetAveragingGradients( true );
+		CArchiveFile file( solverFileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		SerializeSolver( archive, dnn, solver );
+	}
+
+	CPtr<CDnnSolver> solver;
+	CArchiveFile file( solverFileName, CArchive::load, GetPlatformEnv() );
+	CArchive archive( &file, CArchive::SD_Loading );
+	SerializeSolver( archive, dnn, solver );
+	EXPECT_TRUE( solver->IsAveragingGradients() );
+}
+
+TEST( CDnnDistributedTest, DISABLED_ScalingPerformance )
+{
+	const char* fileName = "test_distributed";
+	storeFcNet( fileName, 128, 8 );
+
+	const int stepCount = 20;
+	for( int workerCount = 1; workerCount <= 16; workerCount *= 2 ) {
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		CDistributedTraining distributed( archive, workerCount );
+
+		CRandomFcDataset dataset;
+		dataset.NextStep( false );
+		distributed.RunAndLearnOnce( dataset );
+
+		auto start = std::chrono::steady_clock::now();
+		for( int step = 0; step < stepCount; ++step ) {
+			dataset.NextStep( false );
+			distributed.RunAndLearnOnce( dataset );
+		}
+		const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+		GTEST_LOG_( INFO ) << "Workers: " << workerCount << ", step: " << 1000 * seconds / stepCount << " ms, "
+			<< static_cast<int>( workerCount * stepCount * BatchSize / seconds ) << " samples/sec";
+	}
+}
+
+TEST( CDnnDistributedTest, DISABLED_PipelinedPerformance )
+{
+	const char* fileName = "test_distributed";
+	storeFcNet( fileName, 128, 8 );
+
+	const int stepCount = 20;
+	for( int workerCount = 1; workerCount <= 4; workerCount *= 2 ) {
+		for( int pipelined = 0; pipelined < 2; ++pipelined ) {
+			CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+			CArchive archive( &file, CArchive::SD_Loading );
+			CDistributedTraining distributed( archive, workerCount );
+
+			CPreparedFcDataset dataset( workerCount );
+			dataset.Prepare( 0 );
+			distributed.RunAndLearnOnce( dataset );
+
+			auto start = std::chrono::steady_clock::now();
+			if( pipelined == 0 ) {
+				for( int step = 1; step <= stepCount; ++step ) {
+					dataset.Prepare( step );
+					dataset.SetStep( step );
+					distributed.RunAndLearnOnce( dataset );
+				}
+			} else {
+				// The next batch is generated while the current one is processed
+				dataset.Prepare( 1 );
+				for( int step = 1; step <= stepCount; ++step ) {
+					dataset.SetStep( step );
+					distributed.StartRunAndLearnOnce( dataset );
+					dataset.Prepare( step + 1 );
+					distributed.Wait();
+				}
+			}
+			const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+			GTEST_LOG_( INFO ) << "Workers: " << workerCount << ( pipelined == 0 ? ", sequential" : ", pipelined" )
+				<< ": " << stepCount / seconds << " steps/sec";
+		}
+	}
+}
@@ -0,0 +1,202 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+#include <memory>
+#include <thread>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+// Builds a network with two inputs: conv -> batch norm -> relu -> fc for the image and lstm for the sequence
+// The lstm is a composite layer, so the parameters of the internal layers are shared too
+static void buildCloneTestNet( CDnn& dnn, int channels, int fcSize, int lstmSize )
+{
+	CPtr<CSourceLayer> image = new CSourceLayer( dnn.GetMathEngine() );
+	image->SetName( "image" );
+	dnn.AddLayer( *image );
+
+	CPtr<CConvLayer> conv = new CConvLayer( dnn.GetMathEngine() );
+	conv->SetName( "conv" );
+	conv->SetFilterCount( channels );
+	conv->SetFilterHeight( 3 );
+	conv->SetFilterWidth( 3 );
+	conv->SetPaddingHeight( 1 );
+	conv->SetPaddingWidth( 1 );
+	conv->Connect( *image );
+	dnn.AddLayer( *conv );
+
+	CPtr<CBatchNormalizationLayer> batchNorm = new CBatchNormalizationLayer( dnn.GetMathEngine() );
+	batchNorm->SetName( "batchNorm" );
+	batchNorm->SetChannelBased( true );
+	batchNorm->Connect( *conv );
+	dnn.AddLayer( *batchNorm );
+
+	CPtr<CReLULayer> relu = new CReLULayer( dnn.GetMathEngine() );
+	relu->SetName( "relu" );
+	relu->Connect( *batchNorm );
+	dnn.AddLayer( *relu );
+
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( fcSize );
+	fc->Connect( *relu );
+	dnn.AddLayer( *fc );
+
+	CPtr<CSinkLayer> imageSink = new CSinkLayer( dnn.GetMathEngine() );
+	imageSink->SetName( "imageSink" );
+	imageSink->Connect( *fc );
+	dnn.AddLayer( *imageSink );
+
+	CPtr<CSourceLayer> sequence = new CSourceLayer( dnn.GetMathEngine() );
+	sequence->SetName( "sequence" );
+	dnn.AddLayer( *sequence );
+
+	CPtr<CLstmLayer> lstm = new CLstmLayer( dnn.GetMathEngine() );
+	lstm->SetName( "lstm" );
+	lstm->SetHiddenSize( lstmSize );
+	lstm->Connect( *sequence );
+	dnn.AddLayer( *lstm );
+
+	CPtr<CSinkLayer> sequenceSink = new CSinkLayer( dnn.GetMathEngine() );
+	sequenceSink->SetName( "sequenceSink" );
+	sequenceSink->Connect( *lstm );
+	dnn.AddLayer( *sequenceSink );
+}
+
+static CPtr<CDnnBlob> createRandomBlob( IMathEngine& mathEngine, CRandom& random, const CBlobDesc& desc )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::CreateBlob( mathEngine, CT_Float, desc );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+static void setCloneTestInputs( CDnn& dnn, const CPtr<CDnnBlob>& image, const CPtr<CDnnBlob>& sequence )
+{
+	CheckCast<CSourceLayer>( dnn.GetLayer( "image" ) )->SetBlob( image );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "sequence" ) )->SetBlob( sequence );
+}
+
+static void getCloneTestOutputs( CDnn& dnn, CArray<float>& result )
+{
+	const char* sinks[] = { "imageSink", "sequenceSink" };
+	result.DeleteAll();
+	for( int i = 0; i < 2; ++i ) {
+		CPtr<CDnnBlob> blob = CheckCast<CSinkLayer>( dnn.GetLayer( sinks[i] ) )->GetBlob();
+		const int offset = result.Size();
+		result.SetSize( offset + blob->GetDataSize() );
+		blob->CopyTo( result.GetPtr() + offset );
+	}
+}
+
+// The amount of memory allocated by the math engine
+static size_t getUsedMemory( const IMathEngine& mathEngine )
+{
+	return SIZE_MAX - mathEngine.GetFreeMemorySize();
+}
+
+TEST( CDnnInferenceCloneTest, SameResult )
+{
+	const int cloneCount = 4;
+	CRandom random( 0x345 );
+	CDnn dnn( random, MathEngine() );
+	buildCloneTestNet( dnn, 8, 32, 16 );
+
+	CPtr<CDnnBlob> image = createRandomBlob( MathEngine(), random, CBlobDesc( { 1, 2, 1, 6, 6, 1, 3 } ) );
+	CPtr<CDnnBlob> sequence = createRandomBlob( MathEngine(), random, CBlobDesc( { 5, 2, 1, 1, 1, 1, 7 } ) );
+	setCloneTestInputs( dnn, image, sequence );
+	// Initializes the parameters
+	dnn.RunOnce();
+
+	CArray<float> expected;
+	getCloneTestOutputs( dnn, expected );
+
+	std::vector<std::unique_ptr<CRandom>> randoms;
+	std::vector<std::unique_ptr<CDnn>> clones;
+	for( int i = 0; i < cloneCount; ++i ) {
+		randoms.emplace_back( new CRandom( i ) );
+		clones.emplace_back( dnn.CreateInferenceClone( *randoms.back() ) );
+		EXPECT_TRUE( clones.back()->HasSharedParams() );
+		EXPECT_FALSE( clones.back()->IsLearningEnabled() );
+		setCloneTestInputs( *clones.back(), image, sequence );
+	}
+
+	// The clones are run in parallel
+	std::vector<CArray<float>> results( cloneCount );
+	std::vector<std::thread> threads;
+	for( int i = 0; i < cloneCount; ++i ) {
+		threads.emplace_back( [&clones, &results, i]() {
+			for( int run = 0; run < 3; ++run ) {
+				clones[i]->RunOnce();
+			}
+			getCloneTestOutputs( *clones[i], results[i] );
+		} );
+	}
+	for( auto& thread : threads ) {
+		thread.join();
+	}
+
+	for( int i = 0; i < cloneCount; ++i ) {
+		ASSERT_EQ( expected.Size(), results[i].Size() );
+		for( int j = 0; j < expected.Size(); ++j ) {
+			EXPECT_NEAR( expected[j], results[i][j], 1e-4f ) << i << " " << j;
+		}
+	}
+}
+
+TEST( CDnnInferenceCloneTest, MemoryIsFlat )
+{
+	std::unique_ptr<IMathEngine> mathEngine( CreateCpuMathEngine( 1, 0 ) );
+	CRandom random( 0x543 );
+	CDnn dnn( random, *mathEngine );
+	// The fully connected layer has 2 MB of weights
+	buildCloneTestNet( dnn, 8, 2048, 16 );
+
+	CPtr<CDnnBlob> image = createRandomBlob( *mathEngine, random, CBlobDesc( { 1, 1, 1, 8, 8, 1, 3 } ) );
+	CPtr<CDnnBlob> sequence = createRandomBlob( *mathEngine, random, CBlobDesc( { 2, 1, 1, 1, 1, 1, 7 } ) );
+	setCloneTestInputs( dnn, image, sequence );
+	dnn.RunOnce();
+	const size_t paramSize = CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetWeightsData()->GetDataSize()
+		* sizeof( float );
+
+	const int cloneCount = 8;
+	std::vector<std::unique_ptr<CRandom>> randoms;
+	std::vector<std::unique_ptr<CDnn>> clones;
+	std::vector<size_t> usedMemory;
+	for( int i = 0; i < cloneCount; ++i ) {
+		randoms.emplace_back( new CRandom( i ) );
+		clones.emplace_back( dnn.CreateInferenceClone( *randoms.back() ) );
+		setCloneTestInputs( *clones.back(), image, sequence );
+		clones.back()->RunOnce();
+		mathEngine->CleanUp();
+		usedMemory.push_back( getUsedMemory( *mathEngine ) );
+	}
+
+	// Every clone allocates only its runtime blobs, which are much smaller than the parameters
+	const size_t memoryPerClone = ( usedMemory.back() - usedMemory.front() ) / ( cloneCount - 1 );
+	GTEST_LOG_( INFO ) << "Parameters: " << paramSize << " bytes, memory per clone: " << memoryPerClone << " bytes";
+	EXPECT_LT( memoryPerClone, paramSize / 10 );
+
+	clones.clear();
+}
@@ -84,6 +84,7 @@ static void setSpecificParams( CBaseLayer& )
 {
 }
 
+
 template <typename T>
 static void serializeToFile( const CString& layerName )
 {
@@ -2376,3 +2377,124 @@ GTEST_TEST( SerializeFromFile, TransformerEncoderLayerSerialization )
 {
 	checkSerializeLayer<CTransformerEncoderLayer>( "NeoMLDnnTransformerEncoderLayer" );
 }
+
+// ====================================================================================================================
+
+// CQuantizedFullyConnectedLayer
+
+#ifdef GENERATE_SERIALIZATION_FILES
+
+static void setSpecificParams( CQuantizedFullyConnectedLayer& layer )
+{
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( MathEngine() );
+	fc->SetNumberOfElements( TestIntValue );
+	fc->SetWeightsData( generateBlob( TestIntValue, 1, 1, 1, TestSize ) );
+	fc->SetFreeTermData( generateBlob( 1, 1, 1, 1, TestIntValue ) );
+	layer.SetWeights( *fc );
+	layer.SetInputScale( TestFloatValue );
+}
+
+GTEST_TEST( SerializeToFile, QuantizedFullyConnectedLayerSerialization )
+{
+	serializeToFile<CQuantizedFullyConnectedLayer>( "NeoMLDnnQuantizedFullyConnectedLayer" );
+}
+
+#endif // GENERATE_SERIALIZATION_FILES
+
+template<>
+inline void checkSpecificParams<CQuantizedFullyConnectedLayer>( CQuantizedFullyConnectedLayer& layer )
+{
+	EXPECT_EQ( TestIntValue, layer.GetNumberOfElements() );
+	EXPECT_EQ( TestSize, layer.GetInputSize() );
+	EXPECT_NEAR( TestFloatValue, layer.GetInputScale(), 1e-6f );
+}
+
+GTEST_TEST( SerializeFromFile, QuantizedFullyConnectedLayerSerialization )
+{
+	checkSerializeLayer<CQuantizedFullyConnectedLayer>( "NeoMLDnnQuantizedFullyConnectedLayer" );
+}
+
+// ====================================================================================================================
+
+// CQuantizedConvLayer
+
+#ifdef GENERATE_SERIALIZATION_FILES
+
+static void setSpecificParams( CQuantizedConvLayer& layer )
+{
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetFilterCount( TestIntValue );
+	conv->SetFilterHeight( 2 );
+	conv->SetFilterWidth( 3 );
+	conv->SetStrideHeight( 2 );
+	conv->SetPaddingWidth( 1 );
+	conv->SetDilationHeight( 2 );
+	conv->SetFilterData( generateBlob( TestIntValue, 2, 3, 1, TestSize ) );
+	conv->SetFreeTermData( generateBlob( 1, 1, 1, 1, TestIntValue ) );
+	layer.SetWeights( *conv );
+	layer.SetInputScale( TestFloatValue );
+}
+
+GTEST_TEST( SerializeToFile, QuantizedConvLayerSerialization )
+{
+	serializeToFile<CQuantizedConvLayer>( "NeoMLDnnQuantizedConvLayer" );
+}
+
+#endif // GENERATE_SERIALIZATION_FILES
+
+template<>
+inline void checkSpecificParams<CQuantizedConvLayer>( CQuantizedConvLayer& layer )
+{
+	EXPECT_EQ( TestIntValue, layer.GetFilterCount() );
+	EXPECT_EQ( 2, layer.GetFilterHeight() );
+	EXPECT_EQ( 3, layer.GetFilterWidth() );
+	EXPECT_EQ( 2, layer.GetStrideHeight() );
+	EXPECT_EQ( 1, layer.GetStrideWidth() );
+	EXPECT_EQ( 0, layer.GetPaddingHeight() );
+	EXPECT_EQ( 1, layer.GetPaddingWidth() );
+	EXPECT_EQ( 2, layer.GetDilationHeight() );
+	EXPECT_EQ( 1, layer.GetDilationWidth() );
+	EXPECT_NEAR( TestFloatValue, layer.GetInputScale(), 1e-6f );
+}
+
+GTEST_TEST( SerializeFromFile, QuantizedConvLayerSerialization )
+{
+	checkSerializeLayer<CQuantizedConvLayer>( "NeoMLDnnQuantizedConvLayer" );
+}
+
+// ====================================================================================================================
+
+// CPrefetchSourceLayer
+
+#ifdef GENERATE_SERIALIZATION_FILES
+
+static void setSpecificParams( CPrefetchSourceLayer& layer )
+{
+	layer.SetBatchSize( TestIntValue );
+	layer.SetQueueSize( 3 );
+	layer.SetThreadCount( 2 );
+	layer.SetShuffle( true, 0x1234 );
+}
+
+GTEST_TEST( SerializeToFile, PrefetchSourceLayerSerialization )
+{
+	serializeToFile<CPrefetchSourceLayer>( "NeoMLDnnPrefetchSourceLayer" );
+}
+
+#endif // GENERATE_SERIALIZATION_FILES
+
+template<>
+inline void checkSpecificParams<CPrefetchSourceLayer>( CPrefetchSourceLayer& layer )
+{
+	EXPECT_EQ( TestIntValue, layer.GetBatchSize() );
+	EXPECT_EQ( 3, layer.GetQueueSize() );
+	EXPECT_EQ( 2, layer.GetThreadCount() );
+	EXPECT_TRUE( layer.IsShuffled() );
+	EXPECT_EQ( 0x1234u, layer.GetShuffleSeed() );
+	EXPECT_TRUE( layer.GetReader() == nullptr );
+}
+
+GTEST_TEST( SerializeFromFile, PrefetchSourceLayerSerialization )
+{
+	checkSerializeLayer<CPrefetchSourceLayer>( "NeoMLDnnPrefetchSourceLayer" );
+}
@@ -0,0 +1,162 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static CBaseLayer* addConv( CDnn& dnn, const char* name, CBaseLayer& input, int channels )
+{
+	CPtr<CConvLayer> conv = new CConvLayer( dnn.GetMathEngine() );
+	conv->SetName( name );
+	conv->SetFilterCount( channels );
+	conv->SetFilterHeight( 3 );
+	conv->SetFilterWidth( 3 );
+	conv->SetPaddingHeight( 1 );
+	conv->SetPaddingWidth( 1 );
+	conv->Connect( input );
+	dnn.AddLayer( *conv );
+	return conv;
+}
+
+static CBaseLayer* addReLU( CDnn& dnn, const char* name, CBaseLayer& input )
+{
+	CPtr<CReLULayer> relu = new CReLULayer( dnn.GetMathEngine() );
+	relu->SetName( name );
+	relu->Connect( input );
+	dnn.AddLayer( *relu );
+	return relu;
+}
+
+// Builds a chain of convolutions with a residual connection
+static void buildResidualNet( CDnn& dnn, int channels )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	CBaseLayer* relu1 = addReLU( dnn, "relu1", *addConv( dnn, "conv1", *source, channels ) );
+	CBaseLayer* relu2 = addReLU( dnn, "relu2", *addConv( dnn, "conv2", *relu1, channels ) );
+	CBaseLayer* conv3 = addConv( dnn, "conv3", *relu2, channels );
+
+	CPtr<CEltwiseSumLayer> sum = new CEltwiseSumLayer( dnn.GetMathEngine() );
+	sum->SetName( "sum" );
+	sum->Connect( 0, *conv3 );
+	sum->Connect( 1, *relu1 );
+	dnn.AddLayer( *sum );
+
+	CBaseLayer* relu4 = addReLU( dnn, "relu4", *addConv( dnn, "conv4", *sum, channels ) );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *relu4 );
+	dnn.AddLayer( *sink );
+}
+
+static void setInput( CDnn& dnn, CRandom& random, int size, int channels )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::Create2DImageBlob( dnn.GetMathEngine(), CT_Float, 1, 2, size, size, channels );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( blob );
+}
+
+static void runAndGetResult( CDnn& dnn, CArray<float>& result )
+{
+	dnn.RunOnce();
+	CPtr<CDnnBlob> blob = CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob();
+	result.SetSize( blob->GetDataSize() );
+	blob->CopyTo( result.GetPtr() );
+}
+
+static void checkEqual( const CArray<float>& expected, const CArray<float>& actual )
+{
+	ASSERT_EQ( expected.Size(), actual.Size() );
+	for( int i = 0; i < expected.Size(); ++i ) {
+		ASSERT_NEAR( expected[i], actual[i], 1e-5f ) << i;
+	}
+}
+
+TEST( CDnnMemoryPlannerTest, SameResult )
+{
+	const int size = 16;
+	const int channels = 8;
+	CRandom random( 0x123 );
+	CDnn dnn( random, MathEngine() );
+	buildResidualNet( dnn, channels );
+	setInput( dnn, random, size, channels );
+
+	CArray<float> expected;
+	runAndGetResult( dnn, expected );
+
+	dnn.EnableMemoryPlanning( true );
+	EXPECT_EQ( 0, dnn.GetPlannedMemorySize() );
+	for( int run = 0; run < 3; ++run ) {
+		CArray<float> actual;
+		runAndGetResult( dnn, actual );
+		checkEqual( expected, actual );
+	}
+
+	// 5 outputs are planned (the ReLU layers work in place), but at most 3 of them are alive at once
+	const size_t blobSize = 2 * size * size * channels * sizeof( float );
+	EXPECT_LT( 0, dnn.GetPlannedMemorySize() );
+	EXPECT_GE( 3 * blobSize, dnn.GetPlannedMemorySize() );
+	GTEST_LOG_( INFO ) << "Planned memory: " << dnn.GetPlannedMemorySize()
+		<< ", math engine peak memory: " << MathEngine().GetPeakMemoryUsage();
+
+	dnn.EnableMemoryPlanning( false );
+	EXPECT_EQ( 0, dnn.GetPlannedMemorySize() );
+	CArray<float> actual;
+	runAndGetResult( dnn, actual );
+	checkEqual( expected, actual );
+}
+
+TEST( CDnnMemoryPlannerTest, Replan )
+{
+	const int channels = 4;
+	CRandom random( 0x321 );
+	CDnn dnn( random, MathEngine() );
+	dnn.EnableMemoryPlanning( true );
+	buildResidualNet( dnn, channels );
+	setInput( dnn, random, 8, channels );
+	CArray<float> result;
+	runAndGetResult( dnn, result );
+	const size_t smallPlan = dnn.GetPlannedMemorySize();
+
+	// The input size changes, the network is planned again
+	setInput( dnn, random, 16, channels );
+	runAndGetResult( dnn, result );
+	EXPECT_LT( smallPlan, dnn.GetPlannedMemorySize() );
+
+	dnn.EnableMemoryPlanning( false );
+	CArray<float> expected;
+	runAndGetResult( dnn, expected );
+	checkEqual( expected, result );
+
+	// The network changes, the network is planned again
+	dnn.EnableMemoryPlanning( true );
+	addReLU( dnn, "relu5", *dnn.GetLayer( "relu4" ) );
+	dnn.GetLayer( "sink" )->Connect( "relu5" );
+	runAndGetResult( dnn, result );
+	checkEqual( expected, result );
+}
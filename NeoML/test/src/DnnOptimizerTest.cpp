@@ -0,0 +1,204 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static CPtr<CBatchNormalizationLayer> addBatchNorm( CDnn& dnn, CRandom& random, const CString& name,
+	CBaseLayer& input, int size )
+{
+	CPtr<CBatchNormalizationLayer> batchNorm = new CBatchNormalizationLayer( dnn.GetMathEngine() );
+	batchNorm->SetName( name );
+	batchNorm->SetChannelBased( true );
+	batchNorm->Connect( input );
+	dnn.AddLayer( *batchNorm );
+
+	// The final params are gamma and beta
+	CPtr<CDnnBlob> params = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float, 1, 2, size );
+	CArray<float> buffer;
+	buffer.SetSize( params->GetDataSize() );
+	for( int i = 0; i < size; ++i ) {
+		buffer[i] = static_cast<float>( random.Uniform( 0.5, 1.5 ) );
+		buffer[size + i] = static_cast<float>( random.Uniform( -0.5, 0.5 ) );
+	}
+	params->CopyFrom( buffer.GetPtr() );
+	batchNorm->SetFinalParams( params );
+	return batchNorm;
+}
+
+// Builds conv -> bn -> relu -> conv -> bn -> hswish -> conv -> sigmoid -> fc -> bn
+// The second convolution has the filter count supported by the JIT convolution
+static void buildNet( CDnn& dnn, CRandom& random, int channels, int classes )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	const int filterCounts[] = { channels, 8, channels };
+	CPtr<CBaseLayer> activations[] = { new CReLULayer( dnn.GetMathEngine() ),
+		new CHSwishLayer( dnn.GetMathEngine() ), new CSigmoidLayer( dnn.GetMathEngine() ) };
+
+	CBaseLayer* input = source;
+	for( int i = 0; i < 3; ++i ) {
+		CPtr<CConvLayer> conv = new CConvLayer( dnn.GetMathEngine() );
+		conv->SetName( CString( "conv" ) + Str( i ) );
+		conv->SetFilterCount( filterCounts[i] );
+		conv->SetFilterHeight( 3 );
+		conv->SetFilterWidth( 3 );
+		conv->SetPaddingHeight( 1 );
+		conv->SetPaddingWidth( 1 );
+		conv->Connect( *input );
+		dnn.AddLayer( *conv );
+		input = conv;
+
+		if( i < 2 ) {
+			input = addBatchNorm( dnn, random, CString( "bn" ) + Str( i ), *input, filterCounts[i] );
+		}
+
+		activations[i]->SetName( CString( "activation" ) + Str( i ) );
+		activations[i]->Connect( *input );
+		dnn.AddLayer( *activations[i] );
+		input = activations[i];
+	}
+
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( classes );
+	fc->SetZeroFreeTerm( true );
+	fc->Connect( *input );
+	dnn.AddLayer( *fc );
+
+	CPtr<CBatchNormalizationLayer> batchNorm = addBatchNorm( dnn, random, "bn2", *fc, classes );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *batchNorm );
+	dnn.AddLayer( *sink );
+}
+
+static void runAndGetResult( CDnn& dnn, CArray<float>& result )
+{
+	dnn.RunOnce();
+	CPtr<CDnnBlob> blob = CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob();
+	result.SetSize( blob->GetDataSize() );
+	blob->CopyTo( result.GetPtr() );
+}
+
+TEST( CDnnOptimizerTest, FusedResult )
+{
+	const int size = 10;
+	const int channels = 5;
+	const int classes = 7;
+	CRandom random( 0x123 );
+	CDnn dnn( random, MathEngine() );
+	buildNet( dnn, random, channels, classes );
+
+	CPtr<CDnnBlob> input = CDnnBlob::Create2DImageBlob( MathEngine(), CT_Float, 1, 3, size, size, channels );
+	CArray<float> inputBuffer;
+	inputBuffer.SetSize( input->GetDataSize() );
+	for( int i = 0; i < inputBuffer.Size(); ++i ) {
+		inputBuffer[i] = static_cast<float>( random.Uniform( -2, 2 ) );
+	}
+	input->CopyFrom( inputBuffer.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( input );
+
+	CArray<float> expected;
+	runAndGetResult( dnn, expected );
+
+	CDnnOptimizer optimizer( dnn );
+	EXPECT_EQ( 3, optimizer.FoldBatchNormalization() );
+	EXPECT_EQ( 3, optimizer.FuseActivations() );
+	// Nothing is left to merge
+	EXPECT_EQ( 0, optimizer.Optimize() );
+
+	CArray<const char*> layers;
+	dnn.GetLayerList( layers );
+	EXPECT_EQ( 6, layers.Size() );
+	EXPECT_EQ( AF_ReLU, CheckCast<CConvLayer>( dnn.GetLayer( "conv0" ) )->GetActivation() );
+	EXPECT_EQ( AF_HSwish, CheckCast<CConvLayer>( dnn.GetLayer( "conv1" ) )->GetActivation() );
+	EXPECT_EQ( AF_Sigmoid, CheckCast<CConvLayer>( dnn.GetLayer( "conv2" ) )->GetActivation() );
+	EXPECT_EQ( CString( "fc" ), CString( dnn.GetLayer( "sink" )->GetInputName( 0 ) ) );
+
+	CArray<float> actual;
+	runAndGetResult( dnn, actual );
+	ASSERT_EQ( expected.Size(), actual.Size() );
+	for( int i = 0; i < expected.Size(); ++i ) {
+		EXPECT_NEAR( expected[i], actual[i], 1e-3f * max( 1.f, fabsf( expected[i] ) ) ) << i;
+	}
+
+	// The fused activation is serialized with the convolution
+	const char* fileName = "test_optimizer";
+	{
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+	CDnn loaded( random, MathEngine() );
+	{
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( loaded );
+	}
+	CheckCast<CSourceLayer>( loaded.GetLayer( "source" ) )->SetBlob( input );
+
+	CArray<float> loadedResult;
+	runAndGetResult( loaded, loadedResult );
+	ASSERT_EQ( actual.Size(), loadedResult.Size() );
+	for( int i = 0; i < actual.Size(); ++i ) {
+		EXPECT_EQ( actual[i], loadedResult[i] ) << i;
+	}
+}
+
+TEST( CDnnOptimizerTest, SharedOutputIsNotFused )
+{
+	CRandom random( 0x321 );
+	CDnn dnn( random, MathEngine() );
+
+	CPtr<CSourceLayer> source = new CSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetName( "conv" );
+	conv->SetFilterCount( 4 );
+	conv->Connect( *source );
+	dnn.AddLayer( *conv );
+
+	CPtr<CReLULayer> relu = new CReLULayer( MathEngine() );
+	relu->SetName( "relu" );
+	relu->Connect( *conv );
+	dnn.AddLayer( *relu );
+
+	// The convolution output is used by another layer too
+	CPtr<CSinkLayer> convSink = new CSinkLayer( MathEngine() );
+	convSink->SetName( "convSink" );
+	convSink->Connect( *conv );
+	dnn.AddLayer( *convSink );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( MathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *relu );
+	dnn.AddLayer( *sink );
+
+	CDnnOptimizer optimizer( dnn );
+	EXPECT_EQ( 0, optimizer.Optimize() );
+	EXPECT_TRUE( dnn.HasLayer( "relu" ) );
+	EXPECT_EQ( AF_Linear, conv->GetActivation() );
+}
@@ -0,0 +1,170 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+#include <chrono>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+// Builds an inception-like network: several independent convolution branches merged by concatenation
+static void buildBranchedNet( CDnn& dnn, int branchCount, int branchDepth, int channels )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	CPtr<CConcatChannelsLayer> concat = new CConcatChannelsLayer( dnn.GetMathEngine() );
+	concat->SetName( "concat" );
+	dnn.AddLayer( *concat );
+
+	for( int branch = 0; branch < branchCount; ++branch ) {
+		CBaseLayer* prev = source;
+		for( int depth = 0; depth < branchDepth; ++depth ) {
+			CPtr<CConvLayer> conv = new CConvLayer( dnn.GetMathEngine() );
+			conv->SetName( CString( "conv" ) + Str( branch ) + "_" + Str( depth ) );
+			conv->SetFilterCount( channels );
+			conv->SetFilterHeight( 3 );
+			conv->SetFilterWidth( 3 );
+			conv->SetPaddingHeight( 1 );
+			conv->SetPaddingWidth( 1 );
+			conv->Connect( *prev );
+			dnn.AddLayer( *conv );
+
+			CPtr<CReLULayer> relu = new CReLULayer( dnn.GetMathEngine() );
+			relu->SetName( CString( "relu" ) + Str( branch ) + "_" + Str( depth ) );
+			relu->Connect( *conv );
+			dnn.AddLayer( *relu );
+			prev = relu;
+		}
+		concat->Connect( branch, *prev );
+	}
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *concat );
+	dnn.AddLayer( *sink );
+}
+
+static CPtr<CDnnBlob> createInput( IMathEngine& mathEngine, CRandom& random, int batch, int size, int channels )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::Create2DImageBlob( mathEngine, CT_Float, 1, batch, size, size, channels );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+static void getSinkData( CDnn& dnn, CArray<float>& result )
+{
+	CPtr<CDnnBlob> blob = CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob();
+	result.SetSize( blob->GetDataSize() );
+	blob->CopyTo( result.GetPtr() );
+}
+
+static void checkParallelRun( int batch, int size, int channels, int threadCount )
+{
+	CRandom random( 0x123 );
+	CDnn dnn( random, MathEngine() );
+	buildBranchedNet( dnn, 4, 3, channels );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( createInput( MathEngine(), random, batch, size, channels ) );
+
+	dnn.RunOnce();
+	CArray<float> expected;
+	getSinkData( dnn, expected );
+
+	dnn.SetParallelThreadCount( threadCount );
+	EXPECT_EQ( threadCount, dnn.GetParallelThreadCount() );
+	for( int run = 0; run < 3; ++run ) {
+		dnn.RunOnce();
+		CArray<float> actual;
+		getSinkData( dnn, actual );
+		ASSERT_EQ( expected.Size(), actual.Size() );
+		for( int i = 0; i < expected.Size(); ++i ) {
+			ASSERT_NEAR( expected[i], actual[i], 1e-4f ) << i;
+		}
+	}
+}
+
+TEST( CDnnParallelRunTest, SameResult )
+{
+	checkParallelRun( 2, 8, 8, 4 );
+}
+
+TEST( CDnnParallelRunTest, SameResultReuseMemory )
+{
+	// The outputs are larger than the memory reuse threshold, so the intermediate blobs are released on the fly
+	checkParallelRun( 2, 48, 16, 3 );
+}
+
+TEST( CDnnParallelRunTest, Rebuild )
+{
+	CRandom random( 0x321 );
+	CDnn dnn( random, MathEngine() );
+	dnn.SetParallelThreadCount( 2 );
+	buildBranchedNet( dnn, 2, 1, 4 );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( createInput( MathEngine(), random, 1, 4, 4 ) );
+	dnn.RunOnce();
+
+	// Add one more branch after the first run
+	CPtr<CConvLayer> conv = new CConvLayer( MathEngine() );
+	conv->SetName( "extra" );
+	conv->SetFilterCount( 4 );
+	conv->Connect( "source" );
+	dnn.AddLayer( *conv );
+	dnn.GetLayer( "concat" )->Connect( 2, *conv );
+	dnn.RunOnce();
+
+	CArray<float> parallel;
+	getSinkData( dnn, parallel );
+	EXPECT_EQ( 1 * 4 * 4 * 12, parallel.Size() );
+
+	dnn.SetParallelThreadCount( 1 );
+	dnn.RunOnce();
+	CArray<float> sequential;
+	getSinkData( dnn, sequential );
+	ASSERT_EQ( sequential.Size(), parallel.Size() );
+	for( int i = 0; i < sequential.Size(); ++i ) {
+		ASSERT_NEAR( sequential[i], parallel[i], 1e-4f ) << i;
+	}
+}
+
+TEST( CDnnParallelRunTest, DISABLED_Performance )
+{
+	const int runCount = 5;
+	CRandom random( 0x456 );
+	CDnn dnn( random, MathEngine() );
+	buildBranchedNet( dnn, 8, 4, 16 );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( createInput( MathEngine(), random, 1, 32, 16 ) );
+
+	for( int threadCount = 1; threadCount <= 8; threadCount *= 2 ) {
+		dnn.SetParallelThreadCount( threadCount );
+		dnn.RunOnce();
+		auto start = std::chrono::steady_clock::now();
+		for( int run = 0; run < runCount; ++run ) {
+			dnn.RunOnce();
+		}
+		auto finish = std::chrono::steady_clock::now();
+		GTEST_LOG_( INFO ) << "Threads: " << threadCount << ", RunOnce latency: "
+			<< std::chrono::duration<double, std::milli>( finish - start ).count() / runCount << " ms";
+	}
+}
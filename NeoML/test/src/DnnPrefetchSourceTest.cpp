@@ -0,0 +1,330 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+#include <RandomProblem.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+// Passes the object index as the only output
+class CIndexDataReader : public IDnnDataReader {
+public:
+	CIndexDataReader( int _objectCount, int _errorIndex = NotFound ) :
+		objectCount( _objectCount ), errorIndex( _errorIndex ) {}
+
+	int GetObjectCount() const override { return objectCount; }
+	void GetObjectDescs( CArray<CBlobDesc>& descs ) const override { descs.SetSize( 1 ); descs[0] = CBlobDesc( CT_Int ); }
+	void ReadObject( int index, void* const* data ) override
+	{
+		if( index == errorIndex ) {
+			throw std::runtime_error( "read error" );
+		}
+		*static_cast<int*>( data[0] ) = index;
+	}
+
+private:
+	const int objectCount;
+	const int errorIndex;
+};
+
+// Reads the objects of the other reader, waiting for the given time before each object
+class CSlowDataReader : public IDnnDataReader {
+public:
+	CSlowDataReader( IDnnDataReader* _reader, int _delayMicroseconds ) :
+		reader( _reader ), delay( _delayMicroseconds ) {}
+
+	int GetObjectCount() const override { return reader->GetObjectCount(); }
+	void GetObjectDescs( CArray<CBlobDesc>& descs ) const override { reader->GetObjectDescs( descs ); }
+	void ReadObject( int index, void* const* data ) override
+	{
+		std::this_thread::sleep_for( delay );
+		reader->ReadObject( index, data );
+	}
+
+private:
+	const CPtr<IDnnDataReader> reader;
+	const std::chrono::microseconds delay;
+};
+
+static CPtr<CSinkLayer> addPrefetchTestSink( CDnn& dnn, const char* name, CBaseLayer& layer, int outputNumber )
+{
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( name );
+	sink->Connect( 0, layer, outputNumber );
+	dnn.AddLayer( *sink );
+	return sink;
+}
+
+// Reads the indices passed by the layer during the given number of runs
+static void getPrefetchedIndices( CPrefetchSourceLayer& source, int runCount, CArray<int>& indices )
+{
+	CRandom random;
+	CDnn dnn( random, MathEngine() );
+	dnn.AddLayer( source );
+	CPtr<CSinkLayer> sink = addPrefetchTestSink( dnn, "sink", source, 0 );
+
+	indices.DeleteAll();
+	CArray<int> batch;
+	for( int i = 0; i < runCount; ++i ) {
+		dnn.RunOnce();
+		batch.SetSize( sink->GetBlob()->GetDataSize() );
+		sink->GetBlob()->CopyTo( batch.GetPtr() );
+		for( int j = 0; j < batch.Size(); ++j ) {
+			indices.Add( batch[j] );
+		}
+	}
+	dnn.DeleteLayer( source );
+}
+
+static CPtr<CPrefetchSourceLayer> createIndexSource( int objectCount, int batchSize, int threadCount, bool isShuffled )
+{
+	CPtr<CPrefetchSourceLayer> source = new CPrefetchSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	source->SetReader( new CIndexDataReader( objectCount ) );
+	source->SetBatchSize( batchSize );
+	source->SetQueueSize( 3 );
+	source->SetThreadCount( threadCount );
+	source->SetShuffle( isShuffled, 0x42 );
+	return source;
+}
+
+TEST( CPrefetchSourceLayerTest, SameAsProblemSource )
+{
+	const int batchSize = 7;
+	CRandom random( 0x123 );
+	CPtr<CClassificationRandomProblem> problem = CClassificationRandomProblem::Random( random, 30, 10, 3 );
+
+	CDnn dnn( random, MathEngine() );
+	CPtr<CProblemSourceLayer> expectedSource = new CProblemSourceLayer( MathEngine() );
+	expectedSource->SetName( "expected" );
+	expectedSource->SetProblem( problem.Ptr() );
+	expectedSource->SetBatchSize( batchSize );
+	dnn.AddLayer( *expectedSource );
+
+	CPtr<CPrefetchSourceLayer> source = new CPrefetchSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	source->SetReader( new CProblemDataReader( problem.Ptr() ) );
+	source->SetBatchSize( batchSize );
+	source->SetThreadCount( 3 );
+	dnn.AddLayer( *source );
+
+	const char* const expectedNames[] = { "expectedData", "expectedLabels", "expectedWeights" };
+	const char* const names[] = { "data", "labels", "weights" };
+	CObjectArray<CSinkLayer> expectedSinks;
+	CObjectArray<CSinkLayer> sinks;
+	for( int i = 0; i < 3; ++i ) {
+		expectedSinks.Add( addPrefetchTestSink( dnn, expectedNames[i], *expectedSource, i ) );
+		sinks.Add( addPrefetchTestSink( dnn, names[i], *source, i ) );
+	}
+
+	// The batches cross the epoch boundary
+	for( int run = 0; run < 10; ++run ) {
+		dnn.RunOnce();
+		for( int i = 0; i < 3; ++i ) {
+			CArray<float> expected;
+			expected.SetSize( expectedSinks[i]->GetBlob()->GetDataSize() );
+			expectedSinks[i]->GetBlob()->CopyTo( expected.GetPtr() );
+			CArray<float> actual;
+			ASSERT_EQ( expected.Size(), sinks[i]->GetBlob()->GetDataSize() );
+			actual.SetSize( expected.Size() );
+			sinks[i]->GetBlob()->CopyTo( actual.GetPtr() );
+			for( int j = 0; j < expected.Size(); ++j ) {
+				EXPECT_EQ( expected[j], actual[j] ) << run << " " << i << " " << j;
+			}
+		}
+	}
+}
+
+TEST( CPrefetchSourceLayerTest, Shuffle )
+{
+	const int objectCount = 40;
+	const int epochCount = 4;
+
+	CArray<int> indices;
+	getPrefetchedIndices( *createIndexSource( objectCount, 8, 3, true ), epochCount * objectCount / 8, indices );
+	ASSERT_EQ( epochCount * objectCount, indices.Size() );
+
+	// Each epoch passes all the objects in its own order
+	CArray<int> firstEpoch;
+	for( int epoch = 0; epoch < epochCount; ++epoch ) {
+		CArray<int> epochIndices;
+		for( int i = 0; i < objectCount; ++i ) {
+			epochIndices.Add( indices[epoch * objectCount + i] );
+		}
+		if( epoch == 0 ) {
+			epochIndices.CopyTo( firstEpoch );
+		} else {
+			bool isSameOrder = true;
+			for( int i = 0; i < objectCount; ++i ) {
+				isSameOrder = isSameOrder && epochIndices[i] == firstEpoch[i];
+			}
+			EXPECT_FALSE( isSameOrder ) << epoch;
+		}
+		epochIndices.QuickSort<Ascending<int>>();
+		for( int i = 0; i < objectCount; ++i ) {
+			ASSERT_EQ( i, epochIndices[i] ) << epoch;
+		}
+	}
+
+	// The order depends only on the seed, not on the number of threads
+	CArray<int> oneThreadIndices;
+	getPrefetchedIndices( *createIndexSource( objectCount, 8, 1, true ), epochCount * objectCount / 8, oneThreadIndices );
+	ASSERT_EQ( indices.Size(), oneThreadIndices.Size() );
+	for( int i = 0; i < indices.Size(); ++i ) {
+		EXPECT_EQ( indices[i], oneThreadIndices[i] ) << i;
+	}
+}
+
+TEST( CPrefetchSourceLayerTest, NoShuffle )
+{
+	const int objectCount = 10;
+	CArray<int> indices;
+	getPrefetchedIndices( *createIndexSource( objectCount, 4, 2, false ), 6, indices );
+	ASSERT_EQ( 24, indices.Size() );
+	for( int i = 0; i < indices.Size(); ++i ) {
+		EXPECT_EQ( i % objectCount, indices[i] ) << i;
+	}
+}
+
+TEST( CPrefetchSourceLayerTest, ReaderError )
+{
+	CPtr<CPrefetchSourceLayer> source = createIndexSource( 10, 4, 2, false );
+	source->SetReader( new CIndexDataReader( 10, 5 ) );
+
+	CRandom random;
+	CDnn dnn( random, MathEngine() );
+	dnn.AddLayer( *source );
+	addPrefetchTestSink( dnn, "sink", *source, 0 );
+
+	dnn.RunOnce();
+	EXPECT_ANY_THROW( dnn.RunOnce() );
+	// The next batch is read as usual
+	dnn.RunOnce();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void buildPrefetchTrainingNet( CDnn& dnn, CBaseLayer& data, CBaseLayer& labels, int labelsOutput, int classCount )
+{
+	CPtr<CFullyConnectedLayer> hidden = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	hidden->SetName( "hidden" );
+	hidden->SetNumberOfElements( 1024 );
+	hidden->Connect( data );
+	dnn.AddLayer( *hidden );
+
+	CPtr<CReLULayer> relu = new CReLULayer( dnn.GetMathEngine() );
+	relu->SetName( "relu" );
+	relu->Connect( *hidden );
+	dnn.AddLayer( *relu );
+
+	CPtr<CFullyConnectedLayer> output = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	output->SetName( "output" );
+	output->SetNumberOfElements( classCount );
+	output->Connect( *relu );
+	dnn.AddLayer( *output );
+
+	CPtr<CCrossEntropyLossLayer> loss = new CCrossEntropyLossLayer( dnn.GetMathEngine() );
+	loss->SetName( "loss" );
+	loss->Connect( 0, *output );
+	loss->Connect( 1, labels, labelsOutput );
+	dnn.AddLayer( *loss );
+}
+
+// Trains the network reading each batch right before the step; returns the number of steps per second
+static double runSyncTraining( IDnnDataReader& reader, int batchSize, int classCount, int stepCount )
+{
+	CRandom random( 0x321 );
+	CDnn dnn( random, MathEngine() );
+	CPtr<CSourceLayer> data = Source( dnn, "data" );
+	CPtr<CSourceLayer> labels = Source( dnn, "labels" );
+	buildPrefetchTrainingNet( dnn, *data, *labels, 0, classCount );
+
+	CArray<CBlobDesc> descs;
+	reader.GetObjectDescs( descs );
+	CPtr<CDnnBlob> dataBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, batchSize, descs[0].ObjectSize() );
+	CPtr<CDnnBlob> labelsBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Int, 1, batchSize, 1 );
+	CArray<float> dataBuffer;
+	dataBuffer.SetSize( dataBlob->GetDataSize() );
+	CArray<int> labelsBuffer;
+	labelsBuffer.SetSize( batchSize );
+	float weight = 0;
+
+	int next = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for( int step = 0; step < stepCount; ++step ) {
+		for( int i = 0; i < batchSize; ++i ) {
+			void* objectData[] = { dataBuffer.GetPtr() + i * descs[0].ObjectSize(), labelsBuffer.GetPtr() + i, &weight };
+			reader.ReadObject( next, objectData );
+			next = ( next + 1 ) % reader.GetObjectCount();
+		}
+		dataBlob->CopyFrom( dataBuffer.GetPtr() );
+		labelsBlob->CopyFrom( labelsBuffer.GetPtr() );
+		data->SetBlob( dataBlob );
+		labels->SetBlob( labelsBlob );
+		dnn.RunAndLearnOnce();
+	}
+	return stepCount / std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// Trains the network on the batches read in the background; returns the number of steps per second
+static double runPrefetchTraining( IDnnDataReader& reader, int batchSize, int classCount, int stepCount,
+	int queueSize, int threadCount )
+{
+	CRandom random( 0x321 );
+	CDnn dnn( random, MathEngine() );
+	CPtr<CPrefetchSourceLayer> source = new CPrefetchSourceLayer( MathEngine() );
+	source->SetName( "source" );
+	source->SetReader( &reader );
+	source->SetBatchSize( batchSize );
+	source->SetQueueSize( queueSize );
+	source->SetThreadCount( threadCount );
+	dnn.AddLayer( *source );
+	buildPrefetchTrainingNet( dnn, *source, *source, 1, classCount );
+
+	// The first step starts the threads
+	dnn.RunAndLearnOnce();
+	const auto start = std::chrono::steady_clock::now();
+	for( int step = 1; step < stepCount; ++step ) {
+		dnn.RunAndLearnOnce();
+	}
+	return ( stepCount - 1 ) / std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+TEST( CPrefetchSourceLayerTest, DISABLED_TrainingBenchmark )
+{
+	const int classCount = 10;
+	const int batchSize = 32;
+	const int stepCount = 50;
+	CRandom random( 0x987 );
+	CPtr<CClassificationRandomProblem> problem = CClassificationRandomProblem::Random( random, 1000, 512, classCount );
+	// About 3 ms per batch
+	CPtr<IDnnDataReader> reader = new CSlowDataReader( new CProblemDataReader( problem.Ptr(), CT_Int ), 100 );
+
+	GTEST_LOG_( INFO ) << "Synchronous reading: " << runSyncTraining( *reader, batchSize, classCount, stepCount ) << " steps/s";
+	GTEST_LOG_( INFO ) << "Prefetching, 2 batches, 1 thread: "
+		<< runPrefetchTraining( *reader, batchSize, classCount, stepCount, 2, 1 ) << " steps/s";
+	GTEST_LOG_( INFO ) << "Prefetching, 3 batches, 1 thread: "
+		<< runPrefetchTraining( *reader, batchSize, classCount, stepCount, 3, 1 ) << " steps/s";
+	GTEST_LOG_( INFO ) << "Prefetching, 4 batches, 4 threads: "
+		<< runPrefetchTraining( *reader, batchSize, classCount, stepCount, 4, 4 ) << " steps/s";
+}
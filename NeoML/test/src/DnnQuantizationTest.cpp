@@ -0,0 +1,148 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+// Builds conv -> relu -> conv -> relu -> fc
+static void buildNet( CDnn& dnn, int channels, int classes )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	CBaseLayer* input = source;
+	for( int i = 0; i < 2; ++i ) {
+		CPtr<CConvLayer> conv = new CConvLayer( dnn.GetMathEngine() );
+		conv->SetName( CString( "conv" ) + Str( i ) );
+		conv->SetFilterCount( channels );
+		conv->SetFilterHeight( 3 );
+		conv->SetFilterWidth( 3 );
+		conv->SetPaddingHeight( 1 );
+		conv->SetPaddingWidth( 1 );
+		conv->SetStrideWidth( i + 1 );
+		conv->Connect( *input );
+		dnn.AddLayer( *conv );
+
+		CPtr<CReLULayer> relu = new CReLULayer( dnn.GetMathEngine() );
+		relu->SetName( CString( "relu" ) + Str( i ) );
+		relu->Connect( *conv );
+		dnn.AddLayer( *relu );
+		input = relu;
+	}
+
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( classes );
+	fc->Connect( *input );
+	dnn.AddLayer( *fc );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *fc );
+	dnn.AddLayer( *sink );
+}
+
+static void setInput( CDnn& dnn, CRandom& random, int size, int channels )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::Create2DImageBlob( dnn.GetMathEngine(), CT_Float, 1, 4, size, size, channels );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( blob );
+}
+
+static void runAndGetResult( CDnn& dnn, CArray<float>& result )
+{
+	dnn.RunOnce();
+	CPtr<CDnnBlob> blob = CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob();
+	result.SetSize( blob->GetDataSize() );
+	blob->CopyTo( result.GetPtr() );
+}
+
+TEST( CDnnQuantizerTest, QuantizedResult )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		return;
+	}
+
+	const int size = 12;
+	const int channels = 8;
+	const int classes = 10;
+	CRandom random( 0x345 );
+	CDnn dnn( random, MathEngine() );
+	buildNet( dnn, channels, classes );
+
+	CDnnQuantizer quantizer( dnn );
+	for( int batch = 0; batch < 4; ++batch ) {
+		setInput( dnn, random, size, channels );
+		quantizer.Calibrate();
+	}
+	// The calibration doesn't change the network
+	CArray<const char*> layers;
+	dnn.GetLayerList( layers );
+	EXPECT_EQ( 7, layers.Size() );
+
+	CArray<float> expected;
+	runAndGetResult( dnn, expected );
+
+	EXPECT_EQ( 3, quantizer.Quantize() );
+	EXPECT_EQ( "NeoMLDnnQuantizedConvLayer", GetLayerClass( *dnn.GetLayer( "conv0" ) ) );
+	EXPECT_EQ( "NeoMLDnnQuantizedConvLayer", GetLayerClass( *dnn.GetLayer( "conv1" ) ) );
+	EXPECT_EQ( "NeoMLDnnQuantizedFullyConnectedLayer", GetLayerClass( *dnn.GetLayer( "fc" ) ) );
+
+	CArray<float> actual;
+	runAndGetResult( dnn, actual );
+	ASSERT_EQ( expected.Size(), actual.Size() );
+	float maxAbs = 0;
+	for( int i = 0; i < expected.Size(); ++i ) {
+		maxAbs = max( maxAbs, fabsf( expected[i] ) );
+	}
+	for( int i = 0; i < expected.Size(); ++i ) {
+		EXPECT_NEAR( expected[i], actual[i], 0.05f * maxAbs ) << i;
+	}
+
+	// The quantized network is serialized as usual
+	const char* fileName = "test_quantization";
+	{
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+	CDnn loaded( random, MathEngine() );
+	{
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( loaded );
+	}
+	CheckCast
+<CSourceLayer>( loaded.GetLayer( "source" ) )->SetBlob(
+		CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->GetBlob() );
+
+	CArray<float> loadedResult;
+	runAndGetResult( loaded, loadedResult );
+	ASSERT_EQ( actual.Size(), loadedResult.Size() );
+	for( int i = 0; i < actual.Size(); ++i ) {
+		EXPECT_EQ( actual[i], loadedResult[i] ) << i;
+	}
+}
@@ -0,0 +1,302 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+// The LSTM and GRU layers process the whole sequence at once on CPU
+// The same layer wrapped into another recurrent layer runs its internal network step by step
+// so the wrapped layer is used as the reference
+
+static CPtr<CDnnBlob> createRandomBlob( IMathEngine& mathEngine, CRandom& random, const CBlobDesc& desc )
+{
+	CPtr<CDnnBlob> blob = CDnnBlob::CreateBlob( mathEngine, CT_Float, desc );
+	CArray<float> data;
+	data.SetSize( blob->GetDataSize() );
+	for( int i = 0; i < data.Size(); ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+	blob->CopyFrom( data.GetPtr() );
+	return blob;
+}
+
+// Builds the network: source -> fc -> recurrent layer -> euclidean loss for each output
+static void buildRecurrentTestNet( CDnn& dnn, CRecurrentLayer& layer, int outputCount, bool isWrapped,
+	bool isReverse, int fcSize )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	CPtr<CFullyConnectedLayer> fc = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	fc->SetName( "fc" );
+	fc->SetNumberOfElements( fcSize );
+	fc->Connect( *source );
+	dnn.AddLayer( *fc );
+
+	CPtr<CRecurrentLayer> recurrent = &layer;
+	if( isWrapped ) {
+		recurrent = new CRecurrentLayer( dnn.GetMathEngine() );
+		recurrent->SetName( "wrapper" );
+		recurrent->AddLayer( layer );
+		recurrent->SetInputMapping( layer );
+		for( int i = 0; i < outputCount; ++i ) {
+			recurrent->SetOutputMapping( i, layer, i );
+		}
+	}
+	recurrent->SetReverseSequence( isReverse );
+	recurrent->Connect( *fc );
+	dnn.AddLayer( *recurrent );
+
+	for( int i = 0; i < outputCount; ++i ) {
+		CPtr<CSourceLayer> label = new CSourceLayer( dnn.GetMathEngine() );
+		label->SetName( CString( "label" ) + Str( i ) );
+		dnn.AddLayer( *label );
+
+		CPtr<CEuclideanLossLayer> loss = new CEuclideanLossLayer( dnn.GetMathEngine() );
+		loss->SetName( CString( "loss" ) + Str( i ) );
+		loss->Connect( 0, *recurrent, i );
+		loss->Connect( 1, *label );
+		dnn.AddLayer( *loss );
+
+		CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+		sink->SetName( CString( "sink" ) + Str( i ) );
+		sink->Connect( 0, *recurrent, i );
+		dnn.AddLayer( *sink );
+	}
+
+	CPtr<CDnnSimpleGradientSolver> solver = new CDnnSimpleGradientSolver( dnn.GetMathEngine() );
+	solver->SetLearningRate( 0.05f );
+	dnn.SetSolver( solver );
+}
+
+static void setRecurrentTestInputs( CDnn& dnn, const CPtr<CDnnBlob>& input, const CObjectArray<CDnnBlob>& labels )
+{
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( input );
+	for( int i = 0; i < labels.Size(); ++i ) {
+		CheckCast<CSourceLayer>( dnn.GetLayer( CString( "label" ) + Str( i ) ) )->SetBlob( labels[i] );
+	}
+}
+
+static void checkEqualBlobs( const CDnnBlob& expected, const CDnnBlob& actual, float tolerance )
+{
+	ASSERT_TRUE( expected.HasEqualDimensions( &actual ) );
+	CArray<float> expectedData;
+	expectedData.SetSize( expected.GetDataSize() );
+	expected.CopyTo( expectedData.GetPtr() );
+	CArray<float> actualData;
+	actualData.SetSize( actual.GetDataSize() );
+	actual.CopyTo( actualData.GetPtr() );
+	for( int i = 0; i < expectedData.Size(); ++i ) {
+		ASSERT_NEAR( expectedData[i], actualData[i], tolerance ) << i;
+	}
+}
+
+static void checkEqualOutputs( CDnn& expected, CDnn& actual, int outputCount )
+{
+	for( int i = 0; i < outputCount; ++i ) {
+		const CString sinkName = CString( "sink" ) + Str( i );
+		checkEqualBlobs( *CheckCast<CSinkLayer>( expected.GetLayer( sinkName ) )->GetBlob(),
+			*CheckCast<CSinkLayer>( actual.GetLayer( sinkName ) )->GetBlob(), 1e-4f );
+	}
+}
+
+static void copyRecurrentTestWeights( const CLstmLayer& from, CLstmLayer& to )
+{
+	to.SetInputWeightsData( from.GetInputWeightsData() );
+	to.SetInputFreeTermData( from.GetInputFreeTermData() );
+	to.SetRecurWeightsData( from.GetRecurWeightsData() );
+	to.SetRecurFreeTermData( from.GetRecurFreeTermData() );
+}
+
+static void copyRecurrentTestWeights( const CGruLayer& from, CGruLayer& to )
+{
+	to.SetMainWeightsData( from.GetMainWeightsData() );
+	to.SetMainFreeTermData( from.GetMainFreeTermData() );
+	to.SetGateWeightsData( from.GetGateWeightsData() );
+	to.SetGateFreeTermData( from.GetGateFreeTermData() );
+}
+
+static void checkEqualRecurrentTestWeights( const CLstmLayer& expected, const CLstmLayer& actual )
+{
+	checkEqualBlobs( *expected.GetInputWeightsData(), *actual.GetInputWeightsData(), 1e-4f );
+	checkEqualBlobs( *expected.GetInputFreeTermData(), *actual.GetInputFreeTermData(), 1e-4f );
+	checkEqualBlobs( *expected.GetRecurWeightsData(), *actual.GetRecurWeightsData(), 1e-4f );
+	checkEqualBlobs( *expected.GetRecurFreeTermData(), *actual.GetRecurFreeTermData(), 1e-4f );
+}
+
+static void checkEqualRecurrentTestWeights( const CGruLayer& expected, const CGruLayer& actual )
+{
+	checkEqualBlobs( *expected.GetMainWeightsData(), *actual.GetMainWeightsData(), 1e-4f );
+	checkEqualBlobs( *expected.GetMainFreeTermData(), *actual.GetMainFreeTermData(), 1e-4f );
+	checkEqualBlobs( *expected.GetGateWeightsData(), *actual.GetGateWeightsData(), 1e-4f );
+	checkEqualBlobs( *expected.GetGateFreeTermData(), *actual.GetGateFreeTermData(), 1e-4f );
+}
+
+static void setRandomFreeTerms( CLstmLayer& layer, CRandom& random )
+{
+	const CBlobDesc desc = layer.GetInputFreeTermData()->GetDesc();
+	layer.SetInputFreeTermData( createRandomBlob( MathEngine(), random, desc ) );
+	layer.SetRecurFreeTermData( createRandomBlob( MathEngine(), random, desc ) );
+}
+
+static void setRandomFreeTerms( CGruLayer& layer, CRandom& random )
+{
+	layer.SetMainFreeTermData( createRandomBlob( MathEngine(), random, layer.GetMainFreeTermData()->GetDesc() ) );
+	layer.SetGateFreeTermData( createRandomBlob( MathEngine(), random, layer.GetGateFreeTermData()->GetDesc() ) );
+}
+
+// Trains the layer processing the whole sequence and the wrapped layer and compares the results
+template<class T>
+static void recurrentSameAsInternalDnnTestImpl( int outputCount, bool isReverse )
+{
+	const int sequenceLength = 7;
+	const int batchSize = 3;
+	const int inputSize = 5;
+	const int fcSize = 6;
+	const int hiddenSize = 4;
+
+	CRandom random( 0x123 );
+	CDnn dnn( random, MathEngine() );
+	CPtr<T> layer = new T( MathEngine() );
+	layer->SetName( "recurrent" );
+	layer->SetHiddenSize( hiddenSize );
+	buildRecurrentTestNet( dnn, *layer, outputCount, false, isReverse, fcSize );
+
+	CRandom expectedRandom( 0x123 );
+	CDnn expectedDnn( expectedRandom, MathEngine() );
+	CPtr<T> expectedLayer = new T( MathEngine() );
+	expectedLayer->SetName( "recurrent" );
+	expectedLayer->SetHiddenSize( hiddenSize );
+	buildRecurrentTestNet( expectedDnn, *expectedLayer, outputCount, true, isReverse, fcSize );
+
+	CPtr<CDnnBlob> input = createRandomBlob( MathEngine(), random,
+		CBlobDesc( { sequenceLength, batchSize, 1, 1, 1, 1, inputSize } ) );
+	CObjectArray<CDnnBlob> labels;
+	for( int i = 0; i < outputCount; ++i ) {
+		labels.Add( createRandomBlob( MathEngine(), random,
+			CBlobDesc( { sequenceLength, batchSize, 1, 1, 1, 1, hiddenSize } ) ) );
+	}
+	setRecurrentTestInputs( dnn, input, labels );
+	setRecurrentTestInputs( expectedDnn, input, labels );
+
+	// Initializes the parameters
+	dnn.RunOnce();
+	expectedDnn.RunOnce();
+	setRandomFreeTerms( *layer, random );
+	copyRecurrentTestWeights( *layer, *expectedLayer );
+	CheckCast<CFullyConnectedLayer>( expectedDnn.GetLayer( "fc" ) )->SetWeightsData(
+		CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetWeightsData() );
+
+	for( int i = 0; i < 5; ++i ) {
+		dnn.RunAndLearnOnce();
+		expectedDnn.RunAndLearnOnce();
+		checkEqualOutputs( expectedDnn, dnn, outputCount );
+	}
+
+	checkEqualRecurrentTestWeights( *expectedLayer, *layer );
+	checkEqualBlobs( *CheckCast<CFullyConnectedLayer>( expectedDnn.GetLayer( "fc" ) )->GetWeightsData(),
+		*CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc" ) )->GetWeightsData(), 1e-4f );
+
+	// The state is kept between the runs if the automatic restart is off
+	dnn.SetAutoRestartMode( false );
+	expectedDnn.SetAutoRestartMode( false );
+	for( int i = 0; i < 2; ++i ) {
+		dnn.RunOnce();
+		expectedDnn.RunOnce();
+		checkEqualOutputs( expectedDnn, dnn, outputCount );
+	}
+}
+
+TEST( CDnnRecurrentTest, LstmSameAsInternalDnn )
+{
+	recurrentSameAsInternalDnnTestImpl<CLstmLayer>( 2, false );
+	// Only the main output is connected
+	recurrentSameAsInternalDnnTestImpl<CLstmLayer>( 1, false );
+}
+
+TEST( CDnnRecurrentTest, ReverseLstmSameAsInternalDnn )
+{
+	recurrentSameAsInternalDnnTestImpl<CLstmLayer>( 2, true );
+}
+
+TEST( CDnnRecurrentTest, GruSameAsInternalDnn )
+{
+	recurrentSameAsInternalDnnTestImpl<CGruLayer>( 1, false );
+}
+
+TEST( CDnnRecurrentTest, ReverseGruSameAsInternalDnn )
+{
+	recurrentSameAsInternalDnnTestImpl<CGruLayer>( 1, true );
+}
+
+// Compares the time of processing the long sequences at once and step by step
+template<class T>
+static void recurrentPerformanceTestImpl( const char* name )
+{
+	const int sequenceLength = 500;
+	const int batchSize = 8;
+	const int inputSize = 128;
+	const int hiddenSize = 128;
+	const int runCount = 5;
+
+	for( int isWrapped = 0; isWrapped < 2; ++isWrapped ) {
+		CRandom random( 0x456 );
+		CDnn dnn( random, MathEngine() );
+		CPtr<T> layer = new T( MathEngine() );
+		layer->SetHiddenSize( hiddenSize );
+		buildRecurrentTestNet( dnn, *layer, 1, isWrapped != 0, false, inputSize );
+
+		CPtr<CDnnBlob> input = createRandomBlob( MathEngine(), random,
+			CBlobDesc( { sequenceLength, batchSize, 1, 1, 1, 1, inputSize } ) );
+		CObjectArray<CDnnBlob> labels;
+		labels.Add( createRandomBlob( MathEngine(), random,
+			CBlobDesc( { sequenceLength, batchSize, 1, 1, 1, 1, hiddenSize } ) ) );
+		setRecurrentTestInputs( dnn, input, labels );
+		dnn.RunAndLearnOnce();
+
+		unsigned long long begin = GetTickCount();
+		for( int i = 0; i < runCount; ++i ) {
+			dnn.RunOnce();
+		}
+		const unsigned long long inferenceTime = GetTickCount() - begin;
+
+		begin = GetTickCount();
+		for( int i = 0; i < runCount; ++i ) {
+			dnn.RunAndLearnOnce();
+		}
+		const unsigned long long trainTime = GetTickCount() - begin;
+
+		GTEST_LOG_( INFO ) << name << ( isWrapped != 0 ? " step by step" : " whole sequence" )
+			<< ": inference " << static_cast<double>( runCount ) * sequenceLength * batchSize * 1000 / max( inferenceTime, 1ULL )
+			<< " objects/s, training " << static_cast<double>( runCount ) * sequenceLength * batchSize * 1000 / max( trainTime, 1ULL )
+			<< " objects/s";
+	}
+}
+
+TEST( CDnnRecurrentTest, DISABLED_LstmPerformance )
+{
+	recurrentPerformanceTestImpl<CLstmLayer>( "LSTM" );
+}
+
+TEST( CDnnRecurrentTest, DISABLED_GruPerformance )
+{
+	recurrentPerformanceTestImpl<CGruLayer>( "GRU" );
+}
@@ -167,6 +167,26 @@ static void checkSerializedNet( const CString& fileName )
 	}
 
 	checkNet( inputBlobs, outputBlobs, cnn, fileName );
+
+	// Check the mappable layout
+	{
+		CString mappableFileName = "test_archive.mappable";
+		{
+			CDnnBlobMappableLayout mappableLayout;
+			CArchiveFile archiveFile( mappableFileName, CArchive::store, GetPlatformEnv() );
+			CArchive archive( &archiveFile, CArchive::SD_Storing );
+			archive.Serialize( cnn );
+		}
+
+		{
+			// The blobs use the mapped data after the file is closed
+			CMappedFile mappedFile( mappableFileName );
+			CArchive archive( &mappedFile, CArchive::SD_Loading );
+			archive.Serialize( cnn );
+		}
+	}
+
+	checkNet( inputBlobs, outputBlobs, cnn, fileName );
 }
 
 // Checks serialization of the old versions of CDnn
@@ -223,3 +243,168 @@ INSTANTIATE_TEST_CASE_P(CDnnSerializationTestInstantiation, CDnnSerializationTes
 		)
 	)
 );
+
+// ====================================================================================================================
+
+static void buildWideFcNet( CDnn& dnn, int inputSize, int hiddenSize, int depth )
+{
+	CPtr<CSourceLayer> data = Source( dnn, "data" );
+	CBaseLayer* prev = data;
+	for( int i = 0; i < depth; ++i ) {
+		prev = FullyConnected( hiddenSize )( "fc" + Str( i ), prev );
+	}
+	Sink( prev, "sink" );
+
+	CPtr<CDnnBlob> input = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float, 1, 4, inputSize );
+	input->Fill( 0.5f );
+	data->SetBlob( input );
+	dnn.RunOnce();
+}
+
+static CPtr<CDnnBlob> runWideFcNet( CDnn& dnn )
+{
+	CPtr<CSourceLayer> data = CheckCast<CSourceLayer>( dnn.GetLayer( "data" ) );
+	if( data->GetBlob() == nullptr ) {
+		const int inputSize = CheckCast<CFullyConnectedLayer>( dnn.GetLayer( "fc0" ) )->GetWeightsData()->GetObjectSize();
+		CPtr<CDnnBlob> input = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float, 1, 4, inputSize );
+		input->Fill( 0.5f );
+		data->SetBlob( input );
+	}
+	dnn.RunOnce();
+	return CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob()->GetCopy();
+}
+
+// Checks that the network loaded from the mapped file works the same as the one loaded as usual
+TEST_F( CDnnSerializationTest, MappedFileLoading )
+{
+	const char* fileName = "test_archive.mappable";
+	const char* oldLayoutFileName = "test_archive.old_layout";
+	CRandom random( 0x321 );
+	CDnn dnn( random, MathEngine() );
+	buildWideFcNet( dnn, 100, 64, 3 );
+	CPtr<CDnnBlob> expected = runWideFcNet( dnn );
+	{
+		CDnnBlobMappableLayout mappableLayout;
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+	{
+		CArchiveFile file( oldLayoutFileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+
+	for( const char* loadedFileName : { fileName, oldLayoutFileName } ) {
+		// Mapped file
+		CRandom mappedRandom( 0x321 );
+		CDnn mappedDnn( mappedRandom, MathEngine() );
+		{
+			CMappedFile file( loadedFileName );
+			CArchive archive( &file, CArchive::SD_Loading );
+			archive.Serialize( mappedDnn );
+		}
+		compareOutputBlobs( expected, runWideFcNet( mappedDnn ), loadedFileName );
+
+		// Usual file
+		CRandom fileRandom( 0x321 );
+		CDnn fileDnn( fileRandom, MathEngine() );
+		{
+			CArchiveFile file( loadedFileName, CArchive::load, GetPlatformEnv() );
+			CArchive archive( &file, CArchive::SD_Loading );
+			archive.Serialize( fileDnn );
+		}
+		compareOutputBlobs( expected, runWideFcNet( fileDnn ), loadedFileName );
+	}
+
+	// The changes of the mapped parameters are not written to the file
+	{
+		CRandom mappedRandom( 0x321 );
+		CDnn mappedDnn( mappedRandom, MathEngine() );
+		{
+			CMappedFile file( fileName );
+			CArchive archive( &file, CArchive::SD_Loading );
+			archive.Serialize( mappedDnn );
+		}
+		CPtr<CFullyConnectedLayer> fc = CheckCast<CFullyConnectedLayer>( mappedDnn.GetLayer( "fc0" ) );
+		CPtr<CDnnBlob> weights = fc->GetWeightsData();
+		weights->Fill( 0.f );
+		fc->SetWeightsData( weights );
+		runWideFcNet( mappedDnn );
+	}
+	CRandom mappedRandom( 0x321 );
+	CDnn mappedDnn( mappedRandom, MathEngine() );
+	{
+		CMappedFile file( fileName );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( mappedDnn );
+	}
+	compareOutputBlobs( expected, runWideFcNet( mappedDnn ), fileName );
+}
+
+#if FINE_PLATFORM( FINE_LINUX )
+// The resident set size of the process, in megabytes
+static double getResidentSetSize()
+{
+	long pages = 0;
+	FILE* statm = fopen( "/proc/self/statm", "r" );
+	if( statm != nullptr ) {
+		long size = 0;
+		if( fscanf( statm, "%ld %ld", &size, &pages ) != 2 ) {
+			pages = 0;
+		}
+		fclose( statm );
+	}
+	return static_cast<double>( pages ) * sysconf( _SC_PAGESIZE ) / ( 1024 * 1024 );
+}
+#else
+static double getResidentSetSize()
+{
+	return 0;
+}
+#endif
+
+// Compares the load time and the memory used by the usual and the mapped loading of a large network
+TEST_F( CDnnSerializationTest, DISABLED_MappedFileLoadingBenchmark )
+{
+	if( MathEngine().GetType() != MET_Cpu ) {
+		GTEST_LOG_( INFO ) << "Skipped: the mapped data is used directly only on CPU";
+		return;
+	}
+
+	const char* fileName = "test_archive.mappable";
+	{
+		// 4 layers of 2048 x 2048 weights, 64 MB
+		CRandom random( 0x321 );
+		CDnn dnn( random, MathEngine() );
+		buildWideFcNet( dnn, 2048, 2048, 4 );
+		CDnnBlobMappableLayout mappableLayout;
+		CArchiveFile file( fileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		archive.Serialize( dnn );
+	}
+
+	{
+		CRandom random( 0x321 );
+		CDnn dnn( random, MathEngine() );
+		const double rss = getResidentSetSize();
+		const auto begin = GetTickCount();
+		CArchiveFile file( fileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( dnn );
+		GTEST_LOG_( INFO ) << "Usual load time: " << GetTickCount() - begin << " ms, RSS growth: "
+			<< getResidentSetSize() - rss << " MB";
+	}
+
+	{
+		CRandom random( 0x321 );
+		CDnn dnn( random, MathEngine() );
+		const double rss = getResidentSetSize();
+		const auto begin = GetTickCount();
+		CMappedFile file( fileName );
+		CArchive archive( &file, CArchive::SD_Loading );
+		archive.Serialize( dnn );
+		GTEST_LOG_( INFO ) << "Mapped load time: " << GetTickCount() - begin << " ms, RSS growth: "
+			<< getResidentSetSize() - rss << " MB";
+	}
+}
@@ -532,6 +532,191 @@ TEST( CDnnSolverTest, NadamL2 )
 	testSolver( adam, expected );
 }
 
+// ====================================================================================================================
+// AMSGrad and decoupled weight decay.
+
+TEST( CDnnSolverTest, AdamAmsGradL2 )
+{
+	CArray<CArray<float>> expected;
+	expected.SetSize( 5 );
+	expected[0] = { -0.000000f, 0.400000f, -0.199999f, -0.200000f };
+	expected[1] = { 0.432752f, -0.074623f, -0.573310f, 0.264507f };
+	expected[2] = { 0.676469f, -0.480192f, -0.664667f, 0.627721f };
+	expected[3] = { 0.707804f, -0.762204f, -0.563971f, 0.826359f };
+	expected[4] = { 0.602236f, -0.897642f, -0.371729f, 0.865556f };
+	CPtr<CDnnAdaptiveGradientSolver> adam = new CDnnAdaptiveGradientSolver( MathEngine() );
+	adam->SetL1Regularization( 0 );
+	adam->SetL2Regularization( 0.5f );
+	adam->SetMomentDecayRate( 0.9f );
+	adam->SetSecondMomentDecayRate( 0.999f );
+	adam->SetEpsilon( 1e-8f );
+	adam->SetLearningRate( 0.5f );
+	adam->EnableAmsGrad( true );
+
+	testSolver( adam, expected );
+}
+
+TEST( CDnnSolverTest, AdamDecoupledWeightDecay )
+{
+	CArray<CArray<float>> expected;
+	expected.SetSize( 5 );
+	expected[0] = { 0.055339f, 0.313039f, -0.239527f, -0.128850f };
+	expected[1] = { 0.537735f, -0.209306f, -0.705834f, 0.382659f };
+	expected[2] = { 0.977047f, -0.665204f, -1.136656f, 0.829803f };
+	expected[3] = { 1.377098f, -1.079582f, -1.529375f, 1.236619f };
+	expected[4] = { 1.736057f, -1.451371f, -1.881766f, 1.601636f };
+	CPtr<CDnnAdaptiveGradientSolver> adam = new CDnnAdaptiveGradientSolver( MathEngine() );
+	adam->SetL1Regularization( 0.1f );
+	adam->SetL2Regularization( 0.5f );
+	adam->SetMomentDecayRate( 0.9f );
+	adam->SetSecondMomentDecayRate( 0.999f );
+	adam->SetEpsilon( 1e-8f );
+	adam->SetLearningRate( 0.5f );
+	adam->EnableDecoupledWeightDecay( true );
+
+	testSolver( adam, expected );
+}
+
+TEST( CDnnSolverTest, NadamAmsGradL2 )
+{
+	CArray<CArray<float>> expected;
+	expected.SetSize( 5 );
+	expected[0] = { -0.681726f, 0.529541f, 0.111822f, -0.964008f };
+	expected[1] = { -0.825902f, 0.341368f, 0.003389f, -1.186084f };
+	expected[2] = { -0.963771f, 0.189185f, -0.092676f, -1.411075f };
+	expected[3] = { -1.107379f, 0.052502f, -0.184331f, -1.658277f };
+	expected[4] = { -1.265272f, -0.074576f, -0.272888f, -1.943230f };
+	CPtr<CDnnNesterovGradientSolver> adam = new CDnnNesterovGradientSolver( MathEngine() );
+	adam->SetL1Regularization( 0 );
+	adam->SetL2Regularization( 0.5f );
+	adam->SetMomentDecayRate( 0.9f );
+	adam->SetSecondMomentDecayRate( 0.999f );
+	adam->SetEpsilon( 1e-8f );
+	adam->SetLearningRate( 0.5f );
+	adam->EnableAmsGrad( true );
+
+	testSolver( adam, expected );
+}
+
+// ====================================================================================================================
+// Lamb.
+
+TEST( CDnnSolverTest, Lamb )
+{
+	CArray<CArray<float>> expected;
+	expected.SetSize( 5 );
+	expected[0] = { -0.436928f, 0.833228f, 0.238777f, -0.635076f };
+	expected[1] = { -0.379585f, 0.773337f, 0.182706f, -0.576458f };
+	expected[2] = { -0.327471f, 0.719222f, 0.131592f, -0.523343f };
+	expected[3] = { -0.280050f, 0.670136f, 0.085002f, -0.475089f };
+	expected[4] = { -0.236813f, 0.625471f, 0.042479f, -0.431137f };
+	CPtr<CDnnLambGradientSolver> lamb = new CDnnLambGradientSolver( MathEngine() );
+	lamb->SetL2Regularization( 0.5f );
+	lamb->SetMomentDecayRate( 0.9f );
+	lamb->SetSecondMomentDecayRate( 0.999f );
+	lamb->SetEpsilon( 1e-6f );
+	lamb->SetLearningRate( 0.1f );
+
+	testSolver( lamb, expected );
+}
+
+TEST( CDnnSolverTest, NvLambWeightDecayClip )
+{
+	CArray<CArray<float>> expected;
+	expected.SetSize( 5 );
+	expected[0] = { -0.480300f, 0.879144f, 0.280877f, -0.679721f };
+	expected[1] = { -0.460526f, 0.858491f, 0.261542f, -0.659507f };
+	expected[2] = { -0.440721f, 0.837924f, 0.242118f, -0.639321f };
+	expected[3] = { -0.420899f, 0.817405f, 0.222644f, -0.619151f };
+	expected[4] = { -0.401066f, 0.796917f, 0.203139f, -0.598990f };
+	CPtr<CDnnLambGradientSolver> lamb = new CDnnLambGradientSolver( MathEngine() );
+	lamb->SetL2Regularization( 0.5f );
+	lamb->SetMomentDecayRate( 0.9f );
+	lamb->SetSecondMomentDecayRate( 0.999f );
+	lamb->SetEpsilon( 1e-6f );
+	lamb->SetLearningRate( 0.1f );
+	lamb->SetUseNVLamb( true );
+	lamb->SetWeightDecayClip( 0.1f );
+
+	testSolver( lamb, expected );
+}
+
+TEST( CDnnSolverTest, LambNoTrustRatio )
+{
+	CArray<CArray<float>> expected;
+	expected.SetSize( 5 );
+	expected[0] = { -0.158829f, 0.538813f, -0.031171f, -0.348813f };
+	expected[1] = { 0.271120f, 0.089848f, -0.451620f, 0.090652f };
+	expected[2] = { 0.739576f, -0.396672f, -0.911050f, 0.568147f };
+	expected[3] = { 1.212442f, -0.886701f, -1.375343f, 1.049602f };
+	expected[4] = { 1.664201f, -1.354764f, -1.818958f, 1.509520f };
+	CPtr<CDnnLambGradientSolver> lamb = new CDnnLambGradientSolver( MathEngine() );
+	lamb->SetL2Regularization( 0.5f );
+	lamb->SetMomentDecayRate( 0.9f );
+	lamb->SetSecondMomentDecayRate( 0.999f );
+	lamb->SetEpsilon( 1e-6f );
+	lamb->SetLearningRate( 0.1f );
+	lamb->SetUseTrustRatio( false );
+
+	testSolver( lamb, expected );
+}
+
+// ====================================================================================================================
+// Solver step benchmark.
+
+// Measures the time of the solver steps on a network with several large fully connected layers
+static void benchmarkSolverStep( const char* name, CDnnSolver* solver )
+{
+	CRandom random( 0x1234 );
+	CDnn dnn( random, MathEngine() );
+	CSourceLayer* data = Source( dnn, "data" );
+	CSourceLayer* label = Source( dnn, "label" );
+	CFullyConnectedLayer* fc = FullyConnected( 1024 )( data );
+	fc = FullyConnected( 1024 )( fc );
+	fc = FullyConnected( 1024 )( fc );
+	fc = FullyConnected( 10 )( fc );
+	CrossEntropyLoss()( fc, label );
+	dnn.SetSolver( solver );
+
+	CPtr<CDnnBlob> dataBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, 1, 256 );
+	CREATE_FILL_FLOAT_ARRAY( dataValues, -1.f, 1.f, dataBlob->GetDataSize(), random )
+	dataBlob->CopyFrom( dataValues.GetPtr() );
+	data->SetBlob( dataBlob );
+	CPtr<CDnnBlob> labelBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Int, 1, 1, 1 );
+	labelBlob->GetData<int>().SetValue( 3 );
+	label->SetBlob( labelBlob );
+
+	const int stepCount = 20;
+	unsigned long long total = 0;
+	for( int i = 0; i < stepCount; ++i ) {
+		dnn.RunAndBackwardOnce();
+		const unsigned long long begin = GetTickCount();
+		solver->Train();
+		total += GetTickCount() - begin;
+	}
+	GTEST_LOG_( INFO ) << name << ": " << total << " ms per " << stepCount << " steps";
+}
+
+TEST( CDnnSolverTest, DISABLED_SolverStepBenchmark )
+{
+	benchmarkSolverStep( "Sgd", new CDnnSimpleGradientSolver( MathEngine() ) );
+
+	benchmarkSolverStep( "Adam", new CDnnAdaptiveGradientSolver( MathEngine() ) );
+
+	CPtr<CDnnAdaptiveGradientSolver> amsGrad = new CDnnAdaptiveGradientSolver( MathEngine() );
+	amsGrad->EnableAmsGrad( true );
+	amsGrad->SetL2Regularization( 0.01f );
+	benchmarkSolverStep( "AMSGrad with L2", amsGrad );
+
+	benchmarkSolverStep( "Nadam", new CDnnNesterovGradientSolver( MathEngine() ) );
+
+	benchmarkSolverStep( "Lamb", new CDnnLambGradientSolver( MathEngine() ) );
+
+	CPtr<CDnnLambGradientSolver> nvLamb = new CDnnLambGradientSolver( MathEngine() );
+	nvLamb->SetUseNVLamb( true );
+	benchmarkSolverStep( "NVLamb", nvLamb );
+}
+
 static void checkBlobEquality( CDnnBlob& firstBlob, CDnnBlob& secondBlob )
 {
 	ASSERT_TRUE( firstBlob.HasEqualDimensions( &secondBlob ) );
@@ -811,3 +996,212 @@ TEST( CDnnLambGradientSolverTest, Serialization4 )
 	lamb->SetWeightDecayClip( 2.5f );
 	solverSerializationTestImpl( lamb.Ptr(), true );
 }
+
+// ====================================================================================================================
+// Sparse update of the lookup tables.
+
+// Builds the network with an embeddings table trained by the solver
+static CMultichannelLookupLayer* buildLookupNet( CDnn& dnn, int vocabularySize, int vectorSize )
+{
+	CSourceLayer* ids = Source( dnn, "ids" );
+	CSourceLayer* label = Source( dnn, "label" );
+	CMultichannelLookupLayer* lookup = Embeddings( vocabularySize, vectorSize )( ids );
+	CFullyConnectedLayer* fc = FullyConnected( 4 )( lookup );
+	CrossEntropyLoss()( fc, label );
+	return lookup;
+}
+
+// Sets the ids of the embeddings used on the next step
+static void setLookupIds( CDnn& dnn, const CArray<int>& ids )
+{
+	CArray<int> labels;
+	for( int i = 0; i < ids.Size(); ++i ) {
+		labels.Add( ids[i] % 4 );
+	}
+	CPtr<CDnnBlob> idsBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Int, 1, ids.Size(), 1 );
+	idsBlob->CopyFrom( ids.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "ids" ) )->SetBlob( idsBlob );
+	CPtr<CDnnBlob> labelBlob = CDnnBlob::CreateDataBlob( MathEngine(), CT_Int, 1, labels.Size(), 1 );
+	labelBlob->CopyFrom( labels.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "label" ) )->SetBlob( labelBlob );
+}
+
+static void getEmbeddings( const CMultichannelLookupLayer* lookup, CArray<float>& embeddings )
+{
+	embeddings.SetSize( lookup->GetEmbeddings( 0 )->GetDataSize() );
+	lookup->GetEmbeddings( 0 )->CopyTo( embeddings.GetPtr() );
+}
+
+// If the same rows are used on every step, the sparse update is the same as the dense one
+static void checkSparseUpdateSameRows( CDnnSolver* denseSolver, CDnnSolver* sparseSolver )
+{
+	const int vocabularySize = 20;
+	const int vectorSize = 5;
+	sparseSolver->EnableSparseUpdate( true );
+
+	CRandom denseRandom( 0x1234 );
+	CDnn denseDnn( denseRandom, MathEngine() );
+	CMultichannelLookupLayer* denseLookup = buildLookupNet( denseDnn, vocabularySize, vectorSize );
+	denseDnn.SetSolver( denseSolver );
+
+	CRandom sparseRandom( 0x1234 );
+	CDnn sparseDnn( sparseRandom, MathEngine() );
+	CMultichannelLookupLayer* sparseLookup = buildLookupNet( sparseDnn, vocabularySize, vectorSize );
+	sparseDnn.SetSolver( sparseSolver );
+
+	const CArray<int> ids = { 7, 1, 3, 3, 8, 9 };
+	setLookupIds( denseDnn, ids );
+	setLookupIds( sparseDnn, ids );
+	for( int step = 0; step < 5; ++step ) {
+		denseDnn.RunAndLearnOnce();
+		sparseDnn.RunAndLearnOnce();
+	}
+
+	CArray<float> denseEmbeddings;
+	getEmbeddings( denseLookup, denseEmbeddings );
+	CArray<float> sparseEmbeddings;
+	getEmbeddings( sparseLookup, sparseEmbeddings );
+	for( int i = 0; i < denseEmbeddings.Size(); ++i ) {
+		EXPECT_NEAR( denseEmbeddings[i], sparseEmbeddings[i], 1e-5f ) << i;
+	}
+}
+
+TEST( CDnnSolverTest, SparseUpdateSameRows )
+{
+	checkSparseUpdateSameRows( new CDnnAdaptiveGradientSolver( MathEngine() ),
+		new CDnnAdaptiveGradientSolver( MathEngine() ) );
+	checkSparseUpdateSameRows( new CDnnNesterovGradientSolver( MathEngine() ),
+		new CDnnNesterovGradientSolver( MathEngine() ) );
+
+	CPtr<CDnnAdaptiveGradientSolver> denseAmsGrad = new CDnnAdaptiveGradientSolver( MathEngine() );
+	denseAmsGrad->EnableAmsGrad( true );
+	CPtr<CDnnAdaptiveGradientSolver> sparseAmsGrad = new CDnnAdaptiveGradientSolver( MathEngine() );
+	sparseAmsGrad->EnableAmsGrad( true );
+	checkSparseUpdateSameRows( denseAmsGrad, sparseAmsGrad );
+}
+
+// The rows not used on the step keep their values with the sparse update and change with the dense one
+static void checkSparseUpdateUnusedRows( CDnnSolver* solver, bool isSparse )
+{
+	solver->EnableSparseUpdate( isSparse );
+	CRandom random( 0x1234 );
+	CDnn dnn( random, MathEngine() );
+	CMultichannelLookupLayer* lookup = buildLookupNet( dnn, 10, 3 );
+	dnn.SetSolver( solver );
+
+	setLookupIds( dnn, { 1, 2, 2 } );
+	dnn.RunAndLearnOnce();
+	dnn.RunAndLearnOnce();
+	CArray<float> before;
+	getEmbeddings( lookup, before );
+
+	setLookupIds( dnn, { 5, 6 } );
+	dnn.RunAndLearnOnce();
+	CArray<float> after;
+	getEmbeddings( lookup, after );
+
+	for( int row = 0; row < 10; ++row ) {
+		const bool isUsed = row == 5 || row == 6;
+		// The moments of the rows 1 and 2 are not zero after the first steps
+		const bool isChanged = isUsed || ( !isSparse && ( row == 1 || row == 2 ) );
+		for( int i = row * 3; i < row * 3 + 3; ++i ) {
+			EXPECT_EQ( isChanged, before[i] != after[i] ) << row;
+		}
+	}
+}
+
+TEST( CDnnSolverTest, SparseUpdateUnusedRows )
+{
+	checkSparseUpdateUnusedRows( new CDnnAdaptiveGradientSolver( MathEngine() ), false );
+	checkSparseUpdateUnusedRows( new CDnnAdaptiveGradientSolver( MathEngine() ), true );
+	checkSparseUpdateUnusedRows( new CDnnNesterovGradientSolver( MathEngine() ), false );
+	checkSparseUpdateUnusedRows( new CDnnNesterovGradientSolver( MathEngine() ), true );
+}
+
+// The rows of the accumulated gradients are serialized with the solver
+TEST( CDnnSolverTest, SparseUpdateSerialization )
+{
+	CPtr<CDnnAdaptiveGradientSolver> firstSolver = new CDnnAdaptiveGradientSolver( MathEngine() );
+	firstSolver->EnableSparseUpdate( true );
+	CRandom random( 0x1234 );
+	CDnn firstDnn( random, MathEngine() );
+	CMultichannelLookupLayer* firstLookup = buildLookupNet( firstDnn, 30, 4 );
+	firstDnn.SetSolver( firstSolver );
+
+	const CArray<int> firstIds = { 0, 3, 4 };
+	const CArray<int> secondIds = { 10, 11, 3 };
+	const CArray<int> thirdIds = { 20, 29, 4 };
+	setLookupIds( firstDnn, firstIds );
+	firstDnn.RunAndBackwardOnce();
+	firstSolver->Train();
+	// The gradients of two steps are accumulated
+	setLookupIds( firstDnn, secondIds );
+	firstDnn.RunAndBackwardOnce();
+	setLookupIds( firstDnn, thirdIds );
+	firstDnn.RunAndBackwardOnce();
+
+	CString archiveFileName = "test_sparse_solver";
+	{
+		CArchiveFile file( archiveFileName, CArchive::store, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Storing );
+		firstDnn.SerializeCheckpoint( archive );
+	}
+	CDnn secondDnn( random, MathEngine() );
+	{
+		CArchiveFile file( archiveFileName, CArchive::load, GetPlatformEnv() );
+		CArchive archive( &file, CArchive::SD_Loading );
+		secondDnn.SerializeCheckpoint( archive );
+	}
+	ASSERT_TRUE( secondDnn.GetSolver()->IsSparseUpdateEnabled() );
+	CMultichannelLookupLayer* secondLookup = CheckCast<CMultichannelLookupLayer>(
+		secondDnn.GetLayer( firstLookup->GetName() ).Ptr() );
+
+	firstSolver->Train();
+	secondDnn.GetSolver()->Train();
+	for( int step = 0; step < 2; ++step ) {
+		setLookupIds( firstDnn, secondIds );
+		setLookupIds( secondDnn, secondIds );
+		firstDnn.RunAndLearnOnce();
+		secondDnn.RunAndLearnOnce();
+	}
+
+	CArray<float> firstEmbeddings;
+	getEmbeddings( firstLookup, firstEmbeddings );
+	CArray<float> secondEmbeddings;
+	getEmbeddings( secondLookup, secondEmbeddings );
+	for( int i = 0; i < firstEmbeddings.Size(); ++i ) {
+		EXPECT_FLOAT_EQ( firstEmbeddings[i], secondEmbeddings[i] ) << i;
+	}
+}
+
+// Measures the training step time for different vocabulary sizes with a fixed number of the used rows
+TEST( CDnnSolverTest, DISABLED_SparseUpdateBenchmark )
+{
+	const int vectorSize = 16;
+	const int batchSize = 256;
+	const int stepCount = 5;
+	for( int vocabularySize = 10000; vocabularySize <= 1000000; vocabularySize *= 10 ) {
+		for( int isSparse = 0; isSparse < 2; ++isSparse ) {
+			CPtr<CDnnAdaptiveGradientSolver> solver = new CDnnAdaptiveGradientSolver( MathEngine() );
+			solver->EnableSparseUpdate( isSparse != 0 );
+			CRandom random( 0x1234 );
+			CDnn dnn( random, MathEngine() );
+			buildLookupNet( dnn, vocabularySize, vectorSize );
+			dnn.SetSolver( solver );
+
+			CArray<int> ids;
+			for( int i = 0; i < batchSize; ++i ) {
+				ids.Add( random.UniformInt( 0, vocabularySize - 1 ) );
+			}
+			setLookupIds( dnn, ids );
+			dnn.RunAndLearnOnce();
+
+			const unsigned long long begin = GetTickCount();
+			for( int step = 0; step < stepCount; ++step ) {
+				dnn.RunAndLearnOnce();
+			}
+			GTEST_LOG_( INFO ) << ( isSparse != 0 ? "Sparse" : "Dense" ) << " Adam, vocabulary " << vocabularySize
+				<< ": " << ( GetTickCount() - begin ) << " ms per " << stepCount << " steps";
+		}
+	}
+}
@@ -0,0 +1,275 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <TestFixture.h>
+#include <NeoML/Dnn/DnnStreamingRunner.h>
+
+#include <chrono>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static const int StreamingTestOutputSize = 4;
+
+// source -> recurrent -> fully connected -> sink
+static void buildStreamingTestNet( CDnn& dnn, CBaseLayer* recurrent )
+{
+	CPtr<CSourceLayer> source = new CSourceLayer( dnn.GetMathEngine() );
+	source->SetName( "source" );
+	dnn.AddLayer( *source );
+
+	recurrent->SetName( "recurrent" );
+	recurrent->Connect( *source );
+	dnn.AddLayer( *recurrent );
+
+	CPtr<CFullyConnectedLayer> output = new CFullyConnectedLayer( dnn.GetMathEngine() );
+	output->SetName( "output" );
+	output->SetNumberOfElements( StreamingTestOutputSize );
+	output->Connect( *recurrent );
+	dnn.AddLayer( *output );
+
+	CPtr<CSinkLayer> sink = new CSinkLayer( dnn.GetMathEngine() );
+	sink->SetName( "sink" );
+	sink->Connect( *output );
+	dnn.AddLayer( *sink );
+}
+
+static void fillStreamingTestData( CRandom& random, CArray<float>& data, int size )
+{
+	data.SetSize( size );
+	for( int i = 0; i < size; ++i ) {
+		data[i] = static_cast<float>( random.Uniform( -1, 1 ) );
+	}
+}
+
+// Processes the whole sequences of the streams at once
+static void runWholeSequences( CDnn& dnn, const CArray<float>& input, int sequenceLength, int streamCount,
+	int inputSize, CArray<float>& output )
+{
+	CPtr<CDnnBlob> inputBlob = CDnnBlob::CreateDataBlob( dnn.GetMathEngine(), CT_Float,
+		sequenceLength, streamCount, inputSize );
+	inputBlob->CopyFrom( input.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( inputBlob );
+	dnn.RunOnce();
+
+	CPtr<CDnnBlob> outputBlob = CheckCast<CSinkLayer>( dnn.GetLayer( "sink" ) )->GetBlob();
+	output.SetSize( outputBlob->GetDataSize() );
+	outputBlob->CopyTo( output.GetPtr() );
+}
+
+// Passes the chunks [positions[i], positions[i] + length) of the given streams into the runner
+// and checks the result with the one for the whole sequences
+static void checkStreamingStep( CDnnStreamingRunner& runner, const CArray<int>& streams, const CArray<int>& streamIndices,
+	const CArray<int>& positions, int length, const CArray<float>& input, const CArray<float>& expected,
+	int streamCount, int inputSize )
+{
+	const int width = streams.Size();
+	CArray<float> chunk;
+	chunk.SetSize( length * width * inputSize );
+	for( int t = 0; t < length; ++t ) {
+		for( int j = 0; j < width; ++j ) {
+			const int pos = ( positions[streamIndices[j]] + t ) * streamCount + streamIndices[j];
+			const float* src = input.GetPtr() + pos * inputSize;
+			::memcpy( chunk.GetPtr() + ( t * width + j ) * inputSize, src, inputSize * sizeof( float ) );
+		}
+	}
+	CObjectArray<CDnnBlob> inputs;
+	inputs.Add( CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, length, width, inputSize ) );
+	inputs[0]->CopyFrom( chunk.GetPtr() );
+
+	CObjectArray<CDnnBlob> outputs;
+	runner.Step( streams, inputs, outputs );
+	ASSERT_EQ( 1, outputs.Size() );
+	ASSERT_EQ( length * width * StreamingTestOutputSize, outputs[0]->GetDataSize() );
+
+	CArray<float> result;
+	result.SetSize( outputs[0]->GetDataSize() );
+	outputs[0]->CopyTo( result.GetPtr() );
+	for( int t = 0; t < length; ++t ) {
+		for( int j = 0; j < width; ++j ) {
+			const int pos = ( positions[streamIndices[j]] + t ) * streamCount + streamIndices[j];
+			for( int k = 0; k < StreamingTestOutputSize; ++k ) {
+				EXPECT_NEAR( expected[pos * StreamingTestOutputSize + k],
+					result[( t * width + j ) * StreamingTestOutputSize + k], 1e-4f );
+			}
+		}
+	}
+}
+
+static void streamingSameAsWholeSequenceTestImpl( CBaseLayer* recurrent )
+{
+	const int inputSize = 6;
+	const int sequenceLength = 11;
+	const int streamCount = 5;
+	CRandom random( 0x8FA );
+	CDnn dnn( random, MathEngine() );
+	buildStreamingTestNet( dnn, recurrent );
+
+	CArray<float> input;
+	fillStreamingTestData( random, input, sequenceLength * streamCount * inputSize );
+	// Also initializes the parameters of the network
+	CArray<float> expected;
+	runWholeSequences( dnn, input, sequenceLength, streamCount, inputSize, expected );
+
+	CArray<CString> sources = { "source" };
+	CArray<CString> sinks = { "sink" };
+	CDnnStreamingRunner runner( dnn, sources, sinks );
+	EXPECT_FALSE( dnn.GetAutoRestartMode() );
+
+	// The streams are opened one per step, so the state tables grow
+	// and the chunks of different length are passed for the different subsets of the streams
+	CArray<int> streamIds;
+	CArray<int> positions;
+	for( int step = 0; ; ++step ) {
+		if( streamIds.Size() < streamCount ) {
+			streamIds.Add( runner.OpenStream() );
+			positions.Add( 0 );
+		}
+		const int length = 1 + step % 3;
+		CArray<int> streams;
+		CArray<int> streamIndices;
+		bool isFinished = true;
+		// The streams are passed in the reverse order on the odd steps
+		for( int i = 0; i < streamIds.Size(); ++i ) {
+			const int index = step % 2 == 0 ? i : streamIds.Size() - 1 - i;
+			isFinished = isFinished && positions[index] == sequenceLength;
+			if( positions[index] + length <= sequenceLength && ( index + step / 3 ) % 3 != 0 ) {
+				streams.Add( streamIds[index] );
+				streamIndices.Add( index );
+			}
+		}
+		if( isFinished && streamIds.Size() == streamCount ) {
+			break;
+		}
+		if( streams.IsEmpty() ) {
+			continue;
+		}
+		checkStreamingStep( runner, streams, streamIndices, positions, length, input, expected, streamCount, inputSize );
+		for( int i = 0; i < streamIndices.Size(); ++i ) {
+			positions[streamIndices[i]] += length;
+		}
+	}
+	EXPECT_EQ( streamCount, runner.GetStreamCount() );
+}
+
+TEST( CDnnStreamingRunnerTest, LstmSameAsWholeSequence )
+{
+	CPtr<CLstmLayer> lstm = new CLstmLayer( MathEngine() );
+	lstm->SetHiddenSize( 7 );
+	streamingSameAsWholeSequenceTestImpl( lstm );
+}
+
+TEST( CDnnStreamingRunnerTest, LstmCompatibilitySameAsWholeSequence )
+{
+	CPtr<CLstmLayer> lstm = new CLstmLayer( MathEngine() );
+	lstm->SetHiddenSize( 7 );
+	lstm->SetCompatibilityMode( true );
+	streamingSameAsWholeSequenceTestImpl( lstm );
+}
+
+TEST( CDnnStreamingRunnerTest, GruSameAsWholeSequence )
+{
+	CPtr<CGruLayer> gru = new CGruLayer( MathEngine() );
+	gru->SetHiddenSize( 7 );
+	streamingSameAsWholeSequenceTestImpl( gru );
+}
+
+TEST( CDnnStreamingRunnerTest, ReopenedStreamStartsFromEmptyState )
+{
+	const int inputSize = 6;
+	const int sequenceLength = 4;
+	CRandom random( 0x3C1 );
+	CDnn dnn( random, MathEngine() );
+	CPtr<CLstmLayer> lstm = new CLstmLayer( MathEngine() );
+	lstm->SetHiddenSize( 7 );
+	buildStreamingTestNet( dnn, lstm );
+
+	CArray<float> input;
+	fillStreamingTestData( random, input, sequenceLength * inputSize );
+	CArray<float> expected;
+	runWholeSequences( dnn, input, sequenceLength, 1, inputSize, expected );
+
+	CArray<CString> sources = { "source" };
+	CArray<CString> sinks = { "sink" };
+	{
+		CDnnStreamingRunner runner( dnn, sources, sinks );
+		CArray<int> streams = { runner.OpenStream() };
+		CArray<int> streamIndices = { 0 };
+		CArray<int> positions = { 0 };
+		checkStreamingStep( runner, streams, streamIndices, positions, sequenceLength, input, expected, 1, inputSize );
+
+		// The id is reused and the state of the previous stream is lost
+		runner.CloseStream( streams[0] );
+		EXPECT_EQ( 0, runner.GetStreamCount() );
+		EXPECT_EQ( streams[0], runner.OpenStream() );
+		for( int i = 0; i < sequenceLength; ++i ) {
+			positions[0] = i;
+			checkStreamingStep( runner, streams, streamIndices, positions, 1, input, expected, 1, inputSize );
+		}
+	}
+	EXPECT_TRUE( dnn.GetAutoRestartMode() );
+}
+
+// Measures the time of a step with the same number of streams for the different number of the open streams
+TEST( CDnnStreamingRunnerTest, DISABLED_Benchmark )
+{
+	const int inputSize = 64;
+	const int stepStreamCount = 256;
+	const int stepCount = 50;
+	CRandom random( 0x71D );
+	CDnn dnn( random, MathEngine() );
+	CPtr<CLstmLayer> lstm = new CLstmLayer( MathEngine() );
+	lstm->SetHiddenSize( 128 );
+	buildStreamingTestNet( dnn, lstm );
+
+	CArray<float> data;
+	fillStreamingTestData( random, data, stepStreamCount * inputSize );
+	CObjectArray<CDnnBlob> inputs;
+	inputs.Add( CDnnBlob::CreateDataBlob( MathEngine(), CT_Float, 1, stepStreamCount, inputSize ) );
+	inputs[0]->CopyFrom( data.GetPtr() );
+	CheckCast<CSourceLayer>( dnn.GetLayer( "source" ) )->SetBlob( inputs[0] );
+	dnn.RunOnce();
+
+	CArray<CString> sources = { "source" };
+	CArray<CString> sinks = { "sink" };
+	const int openStreamCounts[] = { stepStreamCount, 16 * stepStreamCount };
+	for( int openStreamCount : openStreamCounts ) {
+		CDnnStreamingRunner runner( dnn, sources, sinks );
+		for( int i = 0; i < openStreamCount; ++i ) {
+			runner.OpenStream();
+		}
+		// Each step takes every n-th stream, so all the open streams are processed in turn
+		const int stride = openStreamCount / stepStreamCount;
+		CArray<int> streams;
+		streams.SetSize( stepStreamCount );
+		CObjectArray<CDnnBlob> outputs;
+		std::chrono::steady_clock::time_point start;
+		for( int step = -1; step < stepCount; ++step ) {
+			if( step == 0 ) {
+				start = std::chrono::steady_clock::now();
+			}
+			for( int i = 0; i < stepStreamCount; ++i ) {
+				streams[i] = i * stride + ( step + stride ) % stride;
+			}
+			runner.Step( streams, inputs, outputs );
+		}
+		const auto time = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start );
+		GTEST_LOG_( INFO ) << openStreamCount << " open streams: " << time.count() / stepCount << " us per step of "
+			<< stepStreamCount << " streams";
+	}
+}
@@ -145,4 +145,95 @@ TEST( CGradientBoostingTest, IterativeRegressionTest )
 		params.TreeBuilder = type;
 		regressionTest( train.Ptr(), test.Ptr(), params );
 	}
-}
\ No newline at end of file
+}
+
+template<typename TModel>
+static void predictBatchTest( const TModel& model, const CFloatMatrixDesc& matrix )
+{
+	for( int threadCount : { 1, 4 } ) {
+		CArray<double> results;
+		model.PredictBatch( matrix, results, threadCount );
+		ASSERT_EQ( matrix.Height, results.Size() );
+		for( int i = 0; i < matrix.Height; i++ ) {
+			ASSERT_EQ( model.Predict( matrix.GetRow( i ) ), results[i] );
+		}
+	}
+}
+
+TEST( CGradientBoostingTest, PredictBatchTest )
+{
+	CRandom rand( 42 );
+	auto train = CRegressionRandomProblem::Random( rand, 2000, 20, 10 );
+	// The number of vectors is not a multiple of the block size
+	auto test = CRegressionRandomProblem::Random( rand, 1003, 20, 10 );
+	auto sparseTest = test->CreateSparse();
+
+	CGradientBoost::CParams params;
+	params.LossFunction = CGradientBoost::LF_L2;
+	params.IterationsCount = 50;
+	// The trees with more than 64 leaves are only partially optimized by QuickScorer
+	params.MaxTreeDepth = 8;
+	for( auto representation : { GBMR_Linked, GBMR_Compact, GBMR_QuickScorer } ) {
+		params.Representation = representation;
+		CGradientBoost boosting( params );
+		CPtr<IRegressionModel> model = boosting.TrainRegression( *train );
+		if( representation == GBMR_QuickScorer ) {
+			const IGradientBoostQSRegressionModel* qsModel = CheckCast<IGradientBoostQSRegressionModel>( model.Ptr() );
+			predictBatchTest( *qsModel, test->GetMatrix() );
+			predictBatchTest( *qsModel, sparseTest->GetMatrix() );
+		} else {
+			const IGradientBoostRegressionModel* gbModel = CheckCast<IGradientBoostRegressionModel>( model.Ptr() );
+			predictBatchTest( *gbModel, test->GetMatrix() );
+			predictBatchTest( *gbModel, sparseTest->GetMatrix() );
+		}
+	}
+}
+
+// Measures the number of documents per second scored by Predict and by PredictBatch
+template<typename TModel>
+static void predictBatchBenchmark( const TModel& model, const CFloatMatrixDesc& matrix, const char* name )
+{
+	const int runCount = 10;
+	CArray<double> results;
+	results.SetSize( matrix.Height );
+
+	auto begin = GetTickCount();
+	for( int run = 0; run < runCount; run++ ) {
+		for( int i = 0; i < matrix.Height; i++ ) {
+			results[i] = model.Predict( matrix.GetRow( i ) );
+		}
+	}
+	const double vectorTime = max( 1, static_cast<int>( GetTickCount() - begin ) ) / 1000.;
+
+	begin = GetTickCount();
+	for( int run = 0; run < runCount; run++ ) {
+		model.PredictBatch( matrix, results, 1 );
+	}
+	const double batchTime = max( 1, static_cast<int>( GetTickCount() - begin ) ) / 1000.;
+
+	GTEST_LOG_( INFO ) << name << ": Predict " << static_cast<int>( runCount * matrix.Height / vectorTime )
+		<< " docs/sec, PredictBatch " << static_cast<int>( runCount * matrix.Height / batchTime ) << " docs/sec";
+}
+
+TEST( CGradientBoostingTest, DISABLED_PredictBatchBenchmark )
+{
+	CRandom rand( 42 );
+	auto train = CRegressionRandomProblem::Random( rand, 5000, 50, 10 );
+	auto test = CRegressionRandomProblem::Random( rand, 20000, 50, 10 );
+
+	CGradientBoost::CParams params;
+	params.LossFunction = CGradientBoost::LF_L2;
+	params.IterationsCount = 300;
+	params.MaxTreeDepth = 6;
+	params.TreeBuilder = GBTB_FastHist;
+
+	params.Representation = GBMR_Compact;
+	CGradientBoost boosting( params );
+	CPtr<IRegressionModel> model = boosting.TrainRegression( *train );
+	predictBatchBenchmark( *CheckCast<IGradientBoostRegressionModel>( model.Ptr() ), test->GetMatrix(), "GBMR_Compact" );
+
+	params.Representation = GBMR_QuickScorer;
+	CGradientBoost qsBoosting( params );
+	model = qsBoosting.TrainRegression( *train );
+	predictBatchBenchmark( *CheckCast<IGradientBoostQSRegressionModel>( model.Ptr() ), test->GetMatrix(), "GBMR_QuickScorer" );
+}
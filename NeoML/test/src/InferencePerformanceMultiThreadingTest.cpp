@@ -82,11 +82,15 @@ public:
 	static CPtr<CDnnBlob> LoadBlob( const CString& fileName, IMathEngine& mathEngine );
 
 	static ResultType Run( const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine );
+	// Runs the network after merging its layers with CDnnOptimizer
+	static ResultType RunOptimized( const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine );
 
 	static CRandom& GetRandom() { return random; }
 
 private:
 	static CRandom random;
+
+	static ResultType run( const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine, bool optimize );
 };
 
 CRandom CDnnInferencePerformanceTest::random;
@@ -136,10 +140,25 @@ static void checkResults( const CPtr<CDnnBlob>& actualBlob, const CPtr<CDnnBlob>
 
 ResultType CDnnInferencePerformanceTest::Run( 
 	const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine )
+{
+	return run( param, mathEngine, false );
+}
+
+ResultType CDnnInferencePerformanceTest::RunOptimized(
+	const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine )
+{
+	return run( param, mathEngine, true );
+}
+
+ResultType CDnnInferencePerformanceTest::run(
+	const CDnnInferencePerformanceTestParam& param, IMathEngine& mathEngine, bool optimize )
 {
 	CDnn cnn( GetRandom(), mathEngine );
 	
 	LoadCnn( param, cnn );
+	if( optimize ) {
+		CDnnOptimizer( cnn ).Optimize();
+	}
 
 	cnn.RunOnce();
 
@@ -255,6 +274,29 @@ TEST_P( CDnnInferencePerformanceTest, LocalMathEngine )
 	}
 }
 
+TEST_P( CDnnInferencePerformanceTest, DISABLED_FusedVersusUnfused )
+{
+	const auto& param = GetParam();
+
+	auto& mathEngine = MathEngine();
+
+	try {
+		// The runs are sequential so the timings are not affected by each other
+		const bool useavg = ( param.TimeType == TTimeType::TT_Average );
+		const char* names[] = { "unfused", "fused" };
+		ResultType counters[] = { Run( param, mathEngine ), RunOptimized( param, mathEngine ) };
+		for( int i = 0; i < 2; ++i ) {
+			for( const auto& counter : *counters[i] ) {
+				GTEST_LOG_( INFO ) << param.Name << " " << names[i] << " " << counter.Name << ": " <<
+					( useavg ? counter.Value / param.RunCount : counter.Value );
+			}
+		}
+	} catch( std::exception& e ) {
+		GTEST_LOG_( ERROR ) << e.what();
+		throw;
+	}
+}
+
 INSTANTIATE_TEST_CASE_P( CDnnInferencePerformanceTestInstantiation, CDnnInferencePerformanceTest,
 	::testing::Values(
 		CDnnInferencePerformanceTestParam(
@@ -336,6 +336,10 @@ public:
 
 //------------------------------------------------------------------------------------------------------------
 
+// The quantized matrix stores each row as signed 8-bit values packed into the integers
+// Returns the number of integers in a row of the given width; the row is padded with zeros
+inline int QuantizedMatrixRowSize( int width ) { return ( width + 15 ) / 16 * 4; }
+
 // The class provides basic linear algebra operations
 class NEOMATHENGINE_API IBlasEngine : public IVectorMathEngine {
 public:
@@ -483,6 +487,14 @@ public:
 		int firstWidth, const CConstFloatHandle& secondHandle, int secondHeight, const CFloatHandle& resultHandle,
 		int resultBufferSize) = 0;
 
+	// Multiplies a matrix by a quantized matrix, transposed; the result will be of firstHeight * secondHeight size
+	// The first matrix is quantized on the fly: q = round( x / firstScale ) saturated to [-127, 127]
+	// The second matrix contains the signed 8-bit values packed into the integers (see QuantizedMatrixRowSize);
+	// its i-th row is quantized with the secondScalesHandle[i] scale
+	virtual void MultiplyMatrixByTransposedQuantizedMatrix( const CConstFloatHandle& firstHandle, int firstHeight,
+		int firstWidth, float firstScale, const CConstIntHandle& secondHandle, const CConstFloatHandle& secondScalesHandle,
+		int secondHeight, const CFloatHandle& resultHandle ) = 0;
+
 	// Operations on sparse matrices
 
 	// result = first * T(second). The result will be of firstHeight * secondHeight size
@@ -588,6 +600,31 @@ struct CRleImage {
 	CRleStroke Lines[1];
 };
 
+//------------------------------------------------------------------------------------------------------------
+// Adaptive gradient optimizers
+
+// The settings of one step of the adaptive gradient optimizers (Adam, AMSGrad, Nadam, LAMB)
+struct CAdaptiveGradientStep {
+	float MomentDecayRate;			// the moment decay rate
+	float SecondMomentDecayRate;	// the second moment decay rate
+	float Epsilon;					// added to the square root of the second moment
+	float GradientMult;				// the gradient is multiplied by this value before regularization
+	float RegL1;					// L1 regularization threshold (0 if not used)
+	float RegL2;					// L2 regularization multiplier (0 if not used)
+	bool IsDecoupledWeightDecay;	// the regularization is added to the update instead of the gradient
+	float UpdateGradientMult;		// the gradient multiplier in the update numerator
+	float UpdateMomentMult;			// the moment multiplier in the update numerator
+	float SecondMomentMult;			// the second moment is multiplied by this value before the square root
+	float Rate;						// the update is multiplied by this value and added to the parameters
+
+	CAdaptiveGradientStep() :
+		MomentDecayRate( 0.9f ), SecondMomentDecayRate( 0.99f ), Epsilon( 1e-6f ), GradientMult( 1.f ),
+		RegL1( 0.f ), RegL2( 0.f ), IsDecoupledWeightDecay( false ), UpdateGradientMult( 0.f ),
+		UpdateMomentMult( 1.f ), SecondMomentMult( 1.f ), Rate( -1.f )
+	{
+	}
+};
+
 //------------------------------------------------------------------------------------------------------------
 
 // Neural network-specific operations
@@ -650,11 +687,25 @@ public:
 
 	virtual void BlobConvolution( const CConvolutionDesc& desc, const CFloatHandle& source,
 		const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& result ) = 0;
+	// Calculates the convolution and applies the activation function to the result
+	// Supported activations: AF_Linear, AF_ReLU, AF_Sigmoid and AF_HSwish
+	// The CPU engine applies the activation while the result is in cache (ReLU is applied in registers by the JIT code);
+	// the Sigmoid and HSwish after the JIT convolution and all the activations on GPU are applied by a separate pass
+	// activationParam is the upper threshold for AF_ReLU (0 means no threshold) and is ignored for the others
+	virtual void BlobConvolutionWithActivation( const CConvolutionDesc& desc, const CFloatHandle& source,
+		const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& result,
+		TActivationFunction activation, float activationParam ) = 0;
 	virtual void BlobConvolutionBackward( const CConvolutionDesc& desc, const CFloatHandle& outputDiff,
 		const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& inputDiff ) = 0;
 	virtual void BlobConvolutionLearnAdd( const CConvolutionDesc& desc, const CFloatHandle& input,
 		const CFloatHandle& outputDiff, const CFloatHandle& filterDiff,
 		const CFloatHandle* freeTermDiff, bool isFreeTermDiffFromInput ) = 0;
+	// Calculates the convolution with the quantized filter
+	// The source is quantized on the fly with sourceScale
+	// The filter is stored as the quantized matrix with one row per filter (see MultiplyMatrixByTransposedQuantizedMatrix)
+	virtual void QuantizedBlobConvolution( const CConvolutionDesc& desc, const CConstFloatHandle& source, float sourceScale,
+		const CConstIntHandle& filter, const CConstFloatHandle& filterScales, const CConstFloatHandle* freeTerm,
+		const CFloatHandle& result ) = 0;
 
 	// Calculates channelwise convolution
 	// You can pass 0 for the freeTerm parameter, and the free terms will be 0
@@ -885,6 +936,95 @@ public:
 		TActivationFunction activation, const CConstFloatHandle& mask, const CConstFloatHandle& u, const CConstFloatHandle& h,
 		const CConstFloatHandle& hDiff, const CFloatHandle& uDiff ) = 0;
 
+	// LSTM implementation
+	// Pay attention that functions below emulate only recurrent part of the layer
+	// the gates on the step t are
+	//    (main, forget, input, reset) = wx + h_(t-1) * T(u)
+	// and the result is
+	//    c_t = sigmoid(forget) * c_(t-1) + sigmoid(input) * tanh(main)
+	//    h_t = sigmoid(reset) * tanh(c_t)
+	// where
+	//    wx - user input (x), processed by fully connected layer (w) with all the free terms. Size: seqLen x batchSize x 4*objSize
+	//    u - recurrent weights. Size: 4*objSize x objSize
+	//    initialH, initialC - (optional, may be null) the state before the first step. Size: batchSize x objSize
+
+	// Inference
+	// Calculates h and c based on wx, u and the initial state
+	// gates will contain the activated gates needed for backward (may be the same as wx). Size: seqLen x batchSize x 4*objSize
+	virtual void LstmRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& wx, const CConstFloatHandle& u, const CConstFloatHandle& initialH,
+		const CConstFloatHandle& initialC, const CFloatHandle& gates, const CFloatHandle& h, const CFloatHandle& c ) = 0;
+	// Backward
+	// Calculates gatesDiff (the diff of the gates before activation) based on u, initialC, gates, c, hDiff and cDiff
+	// cDiff is optional (may be null)
+	// The diffs of h and c are propagated to the previous steps but not to the initial state
+	virtual void LstmRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& u, const CConstFloatHandle& initialC, const CConstFloatHandle& gates,
+		const CConstFloatHandle& c, const CConstFloatHandle& hDiff, const CConstFloatHandle& cDiff,
+		const CFloatHandle& gatesDiff ) = 0;
+
+	// GRU implementation
+	// Pay attention that functions below emulate only recurrent part of the layer
+	// the result is
+	//    (update, reset) = sigmoid( gateWx + h_(t-1) * T(gateU) )
+	//    main = tanh( mainWx + ( reset * h_(t-1) ) * T(mainU) )
+	//    h_t = ( 1 - update ) * main + update * h_(t-1)
+	// where
+	//    gateWx - user input (x), processed by the gate fully connected layer with the free term. Size: seqLen x batchSize x 2*objSize
+	//    mainWx - user input (x), processed by the main fully connected layer with the free term. Size: seqLen x batchSize x objSize
+	//    gateU, mainU - recurrent weights. Size: 2*objSize x objSize and objSize x objSize
+	//    initialH - (optional, may be null) the state before the first step. Size: batchSize x objSize
+
+	// Inference
+	// Calculates h based on gateWx, mainWx, gateU, mainU and the initial state
+	// gates and main will contain the activated values needed for backward (may be the same as gateWx and mainWx)
+	// resetH will contain reset * h_(t-1) needed for learning. Size: seqLen x batchSize x objSize
+	virtual void GruRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& gateWx, const CConstFloatHandle& mainWx, const CConstFloatHandle& gateU,
+		const CConstFloatHandle& mainU, const CConstFloatHandle& initialH, const CFloatHandle& gates,
+		const CFloatHandle& main, const CFloatHandle& resetH, const CFloatHandle& h ) = 0;
+	// Backward
+	// Calculates gateDiff and mainDiff (the diffs before activation) based on gateU, mainU, initialH, gates, main, h and hDiff
+	// The diff of h is propagated to the previous steps but not to the initial state
+	virtual void GruRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& gateU, const CConstFloatHandle& mainU, const CConstFloatHandle& initialH,
+		const CConstFloatHandle& gates, const CConstFloatHandle& main, const CConstFloatHandle& h,
+		const CConstFloatHandle& hDiff, const CFloatHandle& gateDiff, const CFloatHandle& mainDiff ) = 0;
+
+	// Scaled dot-product attention (inference only)
+	// For every object of the batch and every head calculates
+	//    result = softmax( multiplier * query * T(key) - 1e9 * mask ) * value
+	// where
+	//    query - Size: batchSize x querySize x headCount x headSize
+	//    key, value - Size: batchSize x keySize x headCount x headSize
+	//    mask - (optional, may be null) 1.f means that the key is ignored for the query. Size: querySize x keySize
+	//    result - Size: batchSize x querySize x headCount x headSize
+	// The whole querySize x keySize attention matrix is never stored:
+	// the keys are processed by blocks and the softmax normalization is updated after each block
+	virtual void ScaledDotProductAttention( int batchSize, int headCount, int querySize, int keySize, int headSize,
+		float multiplier, const CConstFloatHandle& query, const CConstFloatHandle& key, const CConstFloatHandle& value,
+		const CConstFloatHandle& mask, const CFloatHandle& result ) = 0;
+
+	// The adaptive gradient optimizer step for several parameter blobs at once
+	// Every element of every blob is processed in one pass:
+	//    g = GradientMult * diff + RegL2 * param + clamp( param, -RegL1, RegL1 )
+	//    moment = MomentDecayRate * moment + ( 1 - MomentDecayRate ) * g
+	//    secondMoment = SecondMomentDecayRate * secondMoment + ( 1 - SecondMomentDecayRate ) * g * g
+	//    secondMomentMax = max( secondMomentMax, secondMoment )
+	//    update = ( UpdateGradientMult * g + UpdateMomentMult * moment ) / ( sqrt( SecondMomentMult * secondMomentMax ) + Epsilon )
+	//    param = param + Rate * update
+	// If IsDecoupledWeightDecay the regularization terms are added to the update instead of g
+	// where
+	//    sizes - the number of elements in each of the count blobs
+	//    secondMomentMaxes - (optional, may be null) the AMSGrad maximums; if null, secondMoment is used in the update
+	//    updates - (optional, may be null) if not null, the update is stored there and the parameters are not changed
+	//    normSquares - (optional, may be null) the squared L2 norms of diff, update and param (before the step)
+	//        for each blob. Size: count x 3
+	virtual void AdaptiveGradientStep( const CAdaptiveGradientStep& step, int count, const int* sizes,
+		const CConstFloatHandle* diffs, const CFloatHandle* params, const CFloatHandle* moments,
+		const CFloatHandle* secondMoments, const CFloatHandle* secondMomentMaxes, const CFloatHandle* updates,
+		const CFloatHandle& normSquares ) = 0;
+
 	// Local responce normalization (Lrn)
 	// For more details see CLrnLayer comments
 	virtual CLrnDesc* InitLrn( const CBlobDesc& source, int windowSize, float bias, float alpha, float beta ) = 0;
@@ -1087,6 +1227,8 @@ NEOMATHENGINE_API IGpuMathEngineManager* CreateGpuMathEngineManager();
 
 // Creates `count` cpu MathEngines connected via distributed communicator object
 NEOMATHENGINE_API void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count );
+// The same, each MathEngine uses `threadCount` threads
+NEOMATHENGINE_API void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count, int threadCount );
 // Creates `count` gpu MathEngines connected via distributed communicator object
 // i-th MathEngine placed on gpu with number devs[i]
 NEOMATHENGINE_API void CreateDistributedCudaMathEngines( IMathEngine** mathEngines, int devsCount, const int* cudaDevs );
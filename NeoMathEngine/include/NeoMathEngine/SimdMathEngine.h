@@ -27,6 +27,12 @@ typedef void ( *SgemmFunc )( bool transA, bool transB,
 	float* cPtr, size_t cRowSize,
 	size_t m, size_t n, size_t k );
 
+// Multiplies the quantized matrices: c[i][j] = sum( a[i][k] * b[j][k] ) for the signed 8-bit values
+// The rows of a and b are rowSize bytes long, rowSize is a multiple of 16
+typedef void ( *QuantizedGemmFunc )( const signed char* aPtr, size_t aHeight,
+	const signed char* bPtr, size_t bHeight, size_t rowSize,
+	int* cPtr, size_t cRowSize );
+
 class ISimdMathEngine : public CCrtAllocatedObject {
 public:
 	virtual ~ISimdMathEngine() = default;
@@ -37,10 +43,16 @@ public:
 		int strideHeight, int strideWidth, int dilationHeight, int dilationWidth, const CBlobDesc& filter,
         const CBlobDesc& result ) const = 0;
 
+	// Only AF_Linear and AF_ReLU activations are supported
+	// activationParam is the upper threshold for AF_ReLU (0 means no threshold)
 	virtual void BlobConvolution( const CConvolutionDesc& convDesc, const float* source,
-		const float* filter, const float* freeTerm, float* result ) const = 0;
+		const float* filter, const float* freeTerm, float* result,
+		TActivationFunction activation, float activationParam ) const = 0;
 
 	virtual SgemmFunc GetSgemmFunction() const = 0;
+
+	// Returns nullptr if the quantized multiplication is not supported by the CPU
+	virtual QuantizedGemmFunc GetQuantizedGemmFunction() const = 0;
 };
 
 }
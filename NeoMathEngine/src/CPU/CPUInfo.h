@@ -159,6 +159,15 @@ struct CCPUInfo {
 		return AvxAndFmaAreAvailable;
 	}
 
+	static bool IsAvx2Available()
+	{
+		Regs regs;
+		callCpuIdEx( regs, 7, 0 );
+
+		// Check avx2 bit in EBX
+		return ( regs.ebx & ( 1 << 5 ) ) != 0;
+	}
+
 	static bool IsAvx512Available()
 	{
 		Regs regs;
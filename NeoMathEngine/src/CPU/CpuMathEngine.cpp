@@ -56,11 +56,16 @@ CCpuMathEngine::CCpuMathEngine( int _threadCount, size_t _memoryLimit ) :
 	stackAllocator( new CDeviceStackAllocator( *memoryPool, memoryAlignment ) ),
 	dllLoader( CDllLoader::AVX_DLL ),
 	simdMathEngine( nullptr ),
-	customSgemmFunction( nullptr )
+	customSgemmFunction( nullptr ),
+	quantizedGemmFunction( nullptr ),
+	// The Winograd algorithm is less precise than the other convolution algorithms,
+	// so it is used only if the NEOML_ENABLE_WINOGRAD_CONVOLUTION environment variable is set
+	useWinogradConvolution( getenv( "NEOML_ENABLE_WINOGRAD_CONVOLUTION" ) != nullptr )
 {
 #ifdef NEOML_USE_AVX
 	if( dllLoader.IsLoaded( CDllLoader::AVX_DLL ) ) {
 		simdMathEngine = unique_ptr<ISimdMathEngine>( CDllLoader::avxDll->CreateSimdMathEngine( this, threadCount ) );
+		quantizedGemmFunction = simdMathEngine->GetQuantizedGemmFunction();
 		// Don't use custom sgemm function when we are compiled with MKL and when we are on Intel CPU.
 		if( CPUArch == CCPUInfo::TCpuArch::Intel ) {
 #ifndef NEOML_USE_MKL
@@ -90,8 +95,14 @@ void CCpuMathEngine::SetReuseMemoryMode( bool enable )
 
 CMemoryHandle CCpuMathEngine::HeapAlloc( size_t size )
 {
+	// The free buffers of the current thread are taken without locking
+	CMemoryHandle result = memoryPool->TryAllocThreadLocal( size );
+	if( !result.IsNull() ) {
+		return result;
+	}
+
 	std::lock_guard<std::mutex> lock( mutex );
-	CMemoryHandle result = memoryPool->Alloc( size );
+	result = memoryPool->Alloc( size );
 	if( result.IsNull() ) {
 		THROW_MEMORY_EXCEPTION;
 	}
@@ -102,6 +113,10 @@ void CCpuMathEngine::HeapFree( const CMemoryHandle& handle )
 {
 	ASSERT_EXPR( handle.GetMathEngine() == this );
 
+	if( memoryPool->TryFreeThreadLocal( handle ) ) {
+		return;
+	}
+
 	std::lock_guard<std::mutex> lock( mutex );
 	memoryPool->Free( handle );
 }
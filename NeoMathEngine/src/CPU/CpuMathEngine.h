@@ -317,6 +317,9 @@ public:
 		const CFloatHandle& resultHandle, int resultRowSize, int resultBufferSize) override;
 	void MultiplyMatrixByTransposedMatrix(int batchSize, const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
 		const CConstFloatHandle& secondHandle, int secondHeight, const CFloatHandle& resultHandle, int resultBufferSize) override;
+	void MultiplyMatrixByTransposedQuantizedMatrix( const CConstFloatHandle& firstHandle, int firstHeight,
+		int firstWidth, float firstScale, const CConstIntHandle& secondHandle, const CConstFloatHandle& secondScalesHandle,
+		int secondHeight, const CFloatHandle& resultHandle ) override;
 	void MultiplySparseMatrixByTransposedMatrix( int firstHeight, int firstWidth, int secondHeight,
 		const CSparseMatrixDesc& firstDesc, const CConstFloatHandle& secondHandle, const CFloatHandle& resultHandle ) override;
 	void MultiplyTransposedMatrixBySparseMatrixAndAdd( int firstHeight, int firstWidth, int secondWidth,
@@ -390,11 +393,17 @@ public:
 	void BlobConvolution( const CConvolutionDesc& desc,
 		const CFloatHandle& source, const CFloatHandle& filter, const CFloatHandle* freeTerm,
 		const CFloatHandle& result ) override;
+	void BlobConvolutionWithActivation( const CConvolutionDesc& desc,
+		const CFloatHandle& source, const CFloatHandle& filter, const CFloatHandle* freeTerm,
+		const CFloatHandle& result, TActivationFunction activation, float activationParam ) override;
 	void BlobConvolutionBackward( const CConvolutionDesc& desc, const CFloatHandle& outputDiff,
 		const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& inputDiff ) override;
 	void BlobConvolutionLearnAdd( const CConvolutionDesc& desc,
 	 const CFloatHandle& input, const CFloatHandle& outputDiff, const CFloatHandle& filterDiff,
 		const CFloatHandle* freeTermDiff, bool isFreeTermDiffFromInput ) override;
+	void QuantizedBlobConvolution( const CConvolutionDesc& desc, const CConstFloatHandle& source, float sourceScale,
+		const CConstIntHandle& filter, const CConstFloatHandle& filterScales, const CConstFloatHandle* freeTerm,
+		const CFloatHandle& result ) override;
 	CChannelwiseConvolutionDesc* InitBlobChannelwiseConvolution( const CBlobDesc& input,
 		int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
 		const CBlobDesc& filter, const CBlobDesc* freeTerm, const CBlobDesc& output ) override;
@@ -504,6 +513,28 @@ public:
 	void IndRnnRecurrentLearn( bool reverse, int sequenceLength, int batchSize, int objectSize, TActivationFunction activation,
 		const CConstFloatHandle& mask, const CConstFloatHandle& u, const CConstFloatHandle& h, const CConstFloatHandle& hDiff,
 		const CFloatHandle& uDiff ) override;
+	void LstmRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& wx, const CConstFloatHandle& u, const CConstFloatHandle& initialH,
+		const CConstFloatHandle& initialC, const CFloatHandle& gates, const CFloatHandle& h, const CFloatHandle& c ) override;
+	void LstmRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& u, const CConstFloatHandle& initialC, const CConstFloatHandle& gates,
+		const CConstFloatHandle& c, const CConstFloatHandle& hDiff, const CConstFloatHandle& cDiff,
+		const CFloatHandle& gatesDiff ) override;
+	void GruRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& gateWx, const CConstFloatHandle& mainWx, const CConstFloatHandle& gateU,
+		const CConstFloatHandle& mainU, const CConstFloatHandle& initialH, const CFloatHandle& gates,
+		const CFloatHandle& main, const CFloatHandle& resetH, const CFloatHandle& h ) override;
+	void GruRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& gateU, const CConstFloatHandle& mainU, const CConstFloatHandle& initialH,
+		const CConstFloatHandle& gates, const CConstFloatHandle& main, const CConstFloatHandle& h,
+		const CConstFloatHandle& hDiff, const CFloatHandle& gateDiff, const CFloatHandle& mainDiff ) override;
+	void ScaledDotProductAttention( int batchSize, int headCount, int querySize, int keySize, int headSize,
+		float multiplier, const CConstFloatHandle& query, const CConstFloatHandle& key, const CConstFloatHandle& value,
+		const CConstFloatHandle& mask, const CFloatHandle& result ) override;
+	void AdaptiveGradientStep( const CAdaptiveGradientStep& step, int count, const int* sizes,
+		const CConstFloatHandle* diffs, const CFloatHandle* params, const CFloatHandle* moments,
+		const CFloatHandle* secondMoments, const CFloatHandle* secondMomentMaxes, const CFloatHandle* updates,
+		const CFloatHandle& normSquares ) override;
 	CLrnDesc* InitLrn( const CBlobDesc& source, int windowSize, float bias, float alpha, float beta ) override;
 	void Lrn( const CLrnDesc& desc, const CConstFloatHandle& input, const CFloatHandle& invSum,
 		const CFloatHandle& invSumBeta, const CFloatHandle& outputHandle ) override;
@@ -539,12 +570,15 @@ private:
 	CDllLoader dllLoader; // loading library for simd instructions
 	std::unique_ptr<const ISimdMathEngine> simdMathEngine; // interface for using simd instructions
 	SgemmFunc customSgemmFunction; // Used when it is availabled and is faster then default sgemm
+	QuantizedGemmFunc quantizedGemmFunction; // the simd multiplication of the quantized matrices (may be null)
+	bool useWinogradConvolution; // the Winograd algorithm is used for the 3*3 convolutions
 
 	IMathEngine& mathEngine() { IMathEngine* engine = this; return *engine; }
 
 	void blob3dConvolution1x1x1( const CBlobDesc& source, const CBlobDesc& filter, const CBlobDesc& result,
 		int strideHeight, int strideWidth, int strideDepth,
-		const float* sourceData, const float* filterData, const float* freeTermData, float* resultData );
+		const float* sourceData, const float* filterData, const float* freeTermData, float* resultData,
+		TActivationFunction activation, float activationParam );
 	void blob3dConvolution1x1x1Backward( const CCommon3dConvolutionDesc& desc, const float* outputDiffData,
 		const float* filterData, const CFloatHandle* freeTermData, float* inputDiffData );
 	void blob3dConvolution1x1x1LearnAdd( const CCommon3dConvolutionDesc& desc, const CFloatHandle& inputData,
@@ -587,6 +621,10 @@ private:
 		int firstWidth, const CConstFloatHandle& secondHandle, int secondHeight, const CFloatHandle& resultHandle );
 	void multiplyMatrixByTransposedMatrixAndAdd( const float* first, int firstHeight, int firstWidth, int firstRowSize,
 		const float* second, int secondHeight, int secondRowSize, float* result, int resultRowSize );
+	void quantizeMatrix( const float* matrix, int height, int width, int rowSize, float scale, signed char* result );
+	void multiplyQuantizedMatrixByTransposedMatrix( const signed char* first, int firstHeight,
+		const signed char* second, int secondHeight, int rowSize, float firstScale, const float* secondScales,
+		int* temp, float* result );
 
 	template<class T>
 	void blobMergeByDimCommon( int dimNum, const CBlobDesc* from, const CTypedMemoryHandle<T>* fromData, int fromCount,
@@ -620,9 +658,16 @@ private:
 		int batch, int resultStart, int resultCount, float* result );
 	void fillTempData( const float* sourceData, float* filterData, const CCpuConvolutionDesc& desc, int start, int count );
 	void blobConvolutionForwardAlgo0( const CCpuConvolutionDesc& desc, const float* sourceData,
-		const float* filterData, const CFloatHandle* freeTermData, float* resultData );
+		const float* filterData, const CFloatHandle* freeTermData, float* resultData,
+		TActivationFunction activation, float activationParam );
 	void blobConvolutionForwardAlgo1( const CCpuConvolutionDesc& desc, const float* sourceData,
-		const float* filterData, const CFloatHandle* freeTermData, float* resultData );
+		const float* filterData, const CFloatHandle* freeTermData, float* resultData,
+		TActivationFunction activation, float activationParam );
+	void updateWinogradFilter( const CCpuConvolutionDesc& desc, const float* filterData );
+	void blobConvolutionForwardWinograd( const CCpuConvolutionDesc& desc, const float* sourceData,
+		const float* filterData, const float* freeTermData, float* resultData,
+		TActivationFunction activation, float activationParam );
+	void applyConvolutionActivation( float* data, int dataSize, TActivationFunction activation, float activationParam );
 	void backwardConvolutionAddFilterToOutput( const CCpuConvolutionDesc& desc, const CFloatHandle& temp,
 		const CFloatHandle* freeTerm, const CFloatHandle& output );
 	void backwardDilationConvolutionAddFilterToOutput( const CCpuConvolutionDesc& desc, const CFloatHandle& temp,
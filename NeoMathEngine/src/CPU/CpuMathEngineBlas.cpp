@@ -898,6 +898,86 @@ void CCpuMathEngine::MultiplyMatrixByTransposedMatrix( int batchSize, const CCon
 	}
 }
 
+void CCpuMathEngine::quantizeMatrix( const float* matrix, int height, int width, int rowSize, float scale,
+	signed char* result )
+{
+	const int resultRowSize = QuantizedMatrixRowSize( width ) * sizeof( int );
+	const float multiplier = 1.f / scale;
+	for( int i = 0; i < height; ++i ) {
+		for( int j = 0; j < width; ++j ) {
+			const float value = roundf( matrix[j] * multiplier );
+			result[j] = static_cast<signed char>( max( -127.f, min( 127.f, value ) ) );
+		}
+		for( int j = width; j < resultRowSize; ++j ) {
+			result[j] = 0;
+		}
+		matrix += rowSize;
+		result += resultRowSize;
+	}
+}
+
+void CCpuMathEngine::multiplyQuantizedMatrixByTransposedMatrix( const signed char* first, int firstHeight,
+	const signed char* second, int secondHeight, int rowSize, float firstScale, const float* secondScales,
+	int* temp, float* result )
+{
+	if( quantizedGemmFunction != nullptr ) {
+		quantizedGemmFunction( first, firstHeight, second, secondHeight, rowSize, temp, secondHeight );
+	} else {
+		for( int i = 0; i < firstHeight; ++i ) {
+			const signed char* secondRow = second;
+			for( int j = 0; j < secondHeight; ++j ) {
+				int sum = 0;
+				for( int k = 0; k < rowSize; ++k ) {
+					sum += first[k] * secondRow[k];
+				}
+				temp[i * secondHeight + j] = sum;
+				secondRow += rowSize;
+			}
+			first += rowSize;
+		}
+	}
+
+	for( int i = 0; i < firstHeight; ++i ) {
+		for( int j = 0; j < secondHeight; ++j ) {
+			result[j] = firstScale * secondScales[j] * temp[j];
+		}
+		temp += secondHeight;
+		result += secondHeight;
+	}
+}
+
+void CCpuMathEngine::MultiplyMatrixByTransposedQuantizedMatrix( const CConstFloatHandle& firstHandle, int firstHeight,
+	int firstWidth, float firstScale, const CConstIntHandle& secondHandle, const CConstFloatHandle& secondScalesHandle,
+	int secondHeight, const CFloatHandle& resultHandle )
+{
+	ASSERT_EXPR( firstScale > 0 );
+
+	const float* first = GetRaw( firstHandle );
+	const signed char* second = reinterpret_cast<const signed char*>( GetRaw( secondHandle ) );
+	const float* secondScales = GetRaw( secondScalesHandle );
+	float* result = GetRaw( resultHandle );
+
+	const int rowSize = QuantizedMatrixRowSize( firstWidth );
+	CIntHandleStackVar quantizedFirst( mathEngine(), firstHeight * rowSize );
+	CIntHandleStackVar temp( mathEngine(), firstHeight * secondHeight );
+	signed char* quantizedFirstPtr = reinterpret_cast<signed char*>( GetRaw( quantizedFirst.GetHandle() ) );
+	int* tempPtr = GetRaw( temp.GetHandle() );
+
+	const int curThreadCount = IsOmpRelevant( firstHeight, firstWidth * firstHeight * secondHeight ) ? threadCount : 1;
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( firstHeight, start, count ) ) {
+			signed char* quantizedRows = quantizedFirstPtr + start * rowSize * sizeof( int );
+			quantizeMatrix( first + start * firstWidth, count, firstWidth, firstWidth, firstScale, quantizedRows );
+			multiplyQuantizedMatrixByTransposedMatrix( quantizedRows, count, second, secondHeight,
+				rowSize * sizeof( int ), firstScale, secondScales, tempPtr + start * secondHeight,
+				result + start * secondHeight );
+		}
+	}
+}
+
 void CCpuMathEngine::batchMultiplyTransposedMatrixByMatrix( int batchSize,
 	const float* first, int firstHeight, int firstWidth,
 	const float* second, int secondWidth,
@@ -20,6 +20,7 @@ limitations under the License.
 #include <CpuMathEnginePrivate.h>
 #include <MemoryHandleInternal.h>
 #include <MathEngineCommon.h>
+#include <cmath>
 
 namespace NeoML {
 
@@ -943,6 +944,597 @@ void CCpuMathEngine::IndRnnRecurrentLearn( bool reverse, int sequenceLength, int
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// LSTM and GRU
+
+static inline float sigmoidFunc( float value )
+{
+	return 1.f / ( 1.f + expf( -value ) );
+}
+
+// The same formula as in VectorTanh, it's faster than tanhf
+static inline float tanhFunc( float value )
+{
+	return -1.f + 2.f / ( 1.f + expf( -2.f * value ) );
+}
+
+// Calculates the gates and the state of one LSTM step for one object
+// recur and prevC may be null if it's the first step without the initial state
+static inline void lstmStep( const float* wx, const float* recur, const float* prevC, float* gates, float* c, float* h,
+	int objectSize )
+{
+	for( int i = 0; i < objectSize; ++i ) {
+		float main = wx[i];
+		float forget = wx[objectSize + i];
+		float input = wx[2 * objectSize + i];
+		float reset = wx[3 * objectSize + i];
+		if( recur != nullptr ) {
+			main += recur[i];
+			forget += recur[objectSize + i];
+			input += recur[2 * objectSize + i];
+			reset += recur[3 * objectSize + i];
+		}
+		main = tanhFunc( main );
+		forget = sigmoidFunc( forget );
+		input = sigmoidFunc( input );
+		reset = sigmoidFunc( reset );
+
+		const float newC = prevC == nullptr ? input * main : forget * prevC[i] + input * main;
+		gates[i] = main;
+		gates[objectSize + i] = forget;
+		gates[2 * objectSize + i] = input;
+		gates[3 * objectSize + i] = reset;
+		c[i] = newC;
+		h[i] = reset * tanhFunc( newC );
+	}
+}
+
+void CCpuMathEngine::LstmRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+	const CConstFloatHandle& wx, const CConstFloatHandle& u, const CConstFloatHandle& initialH,
+	const CConstFloatHandle& initialC, const CFloatHandle& gates, const CFloatHandle& h, const CFloatHandle& c )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( objectSize >= 1 );
+	ASSERT_EXPR( wx.GetMathEngine() == this );
+	ASSERT_EXPR( u.GetMathEngine() == this );
+	ASSERT_EXPR( initialH.IsNull() || initialH.GetMathEngine() == this );
+	ASSERT_EXPR( initialC.IsNull() || initialC.GetMathEngine() == this );
+	ASSERT_EXPR( gates.GetMathEngine() == this );
+	ASSERT_EXPR( h.GetMathEngine() == this );
+	ASSERT_EXPR( c.GetMathEngine() == this );
+
+	const int gatesSize = 4 * objectSize;
+	// The product of the previous h and the recurrent weights
+	CFloatHandleStackVar recur( *this, batchSize * gatesSize );
+	float* recurPtr = GetRaw( recur.GetHandle() );
+
+	const int curThreadCount = IsOmpRelevant( batchSize, batchSize * gatesSize ) ? threadCount : 1;
+
+	CConstFloatHandle prevH = initialH;
+	CConstFloatHandle prevC = initialC;
+	for( int step = 0; step < sequenceLength; ++step ) {
+		const int pos = reverse ? sequenceLength - 1 - step : step;
+		if( !prevH.IsNull() ) {
+			MultiplyMatrixByTransposedMatrix( prevH, batchSize, objectSize, objectSize, u, gatesSize, objectSize,
+				recur.GetHandle(), gatesSize, batchSize * gatesSize );
+		}
+
+		const float* wxPtr = GetRaw( wx + pos * batchSize * gatesSize );
+		const float* stepRecur = prevH.IsNull() ? nullptr : recurPtr;
+		const float* prevCPtr = prevC.IsNull() ? nullptr : GetRaw( prevC );
+		float* gatesPtr = GetRaw( gates + pos * batchSize * gatesSize );
+		float* cPtr = GetRaw( c + pos * batchSize * objectSize );
+		float* hPtr = GetRaw( h + pos * batchSize * objectSize );
+
+		NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+		for( int b = 0; b < batchSize; ++b ) {
+			lstmStep( wxPtr + b * gatesSize, stepRecur == nullptr ? nullptr : stepRecur + b * gatesSize,
+				prevCPtr == nullptr ? nullptr : prevCPtr + b * objectSize, gatesPtr + b * gatesSize,
+				cPtr + b * objectSize, hPtr + b * objectSize, objectSize );
+		}
+
+		prevH = h + pos * batchSize * objectSize;
+		prevC = c + pos * batchSize * objectSize;
+	}
+}
+
+// Calculates the diff of the gates of one LSTM step for one object
+// Replaces the diffs of h and c from the next step with the diff of c for the previous step
+// and the diff of the result h which should be multiplied by the recurrent weights
+static inline void lstmStepBackward( const float* gates, const float* c, const float* prevC, const float* hDiff,
+	const float* cDiff, float* nextHDiff, float* nextCDiff, float* gatesDiff, int objectSize )
+{
+	for( int i = 0; i < objectSize; ++i ) {
+		const float main = gates[i];
+		const float forget = gates[objectSize + i];
+		const float input = gates[2 * objectSize + i];
+		const float reset = gates[3 * objectSize + i];
+
+		const float totalHDiff = hDiff[i] + nextHDiff[i];
+		const float tanhC = tanhFunc( c[i] );
+		float totalCDiff = totalHDiff * reset * ( 1.f - tanhC * tanhC ) + nextCDiff[i];
+		if( cDiff != nullptr ) {
+			totalCDiff += cDiff[i];
+		}
+
+		gatesDiff[i] = totalCDiff * input * ( 1.f - main * main );
+		gatesDiff[objectSize + i] = prevC == nullptr ? 0.f : totalCDiff * prevC[i] * forget * ( 1.f - forget );
+		gatesDiff[2 * objectSize + i] = totalCDiff * main * input * ( 1.f - input );
+		gatesDiff[3 * objectSize + i] = totalHDiff * tanhC * reset * ( 1.f - reset );
+		nextCDiff[i] = totalCDiff * forget;
+	}
+}
+
+void CCpuMathEngine::LstmRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+	const CConstFloatHandle& u, const CConstFloatHandle& initialC, const CConstFloatHandle& gates,
+	const CConstFloatHandle& c, const CConstFloatHandle& hDiff, const CConstFloatHandle& cDiff,
+	const CFloatHandle& gatesDiff )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( objectSize >= 1 );
+	ASSERT_EXPR( u.GetMathEngine() == this );
+	ASSERT_EXPR( initialC.IsNull() || initialC.GetMathEngine() == this );
+	ASSERT_EXPR( gates.GetMathEngine() == this );
+	ASSERT_EXPR( c.GetMathEngine() == this );
+	ASSERT_EXPR( hDiff.GetMathEngine() == this );
+	ASSERT_EXPR( cDiff.IsNull() || cDiff.GetMathEngine() == this );
+	ASSERT_EXPR( gatesDiff.GetMathEngine() == this );
+
+	const int gatesSize = 4 * objectSize;
+	const int stateSize = batchSize * objectSize;
+	// The diffs of h and c received from the next step
+	CFloatHandleStackVar nextDiff( *this, 2 * stateSize );
+	VectorFill( nextDiff.GetHandle(), 0.f, 2 * stateSize );
+	float* nextHDiffPtr = GetRaw( nextDiff.GetHandle() );
+	float* nextCDiffPtr = nextHDiffPtr + stateSize;
+
+	const int curThreadCount = IsOmpRelevant( batchSize, batchSize * gatesSize ) ? threadCount : 1;
+
+	for( int step = sequenceLength - 1; step >= 0; --step ) {
+		const int pos = reverse ? sequenceLength - 1 - step : step;
+		const int prevPos = reverse ? pos + 1 : pos - 1;
+
+		const float* gatesPtr = GetRaw( gates + pos * batchSize * gatesSize );
+		const float* cPtr = GetRaw( c + pos * stateSize );
+		const float* prevCPtr = step > 0 ? GetRaw( c + prevPos * stateSize )
+			: ( initialC.IsNull() ? nullptr : GetRaw( initialC ) );
+		const float* hDiffPtr = GetRaw( hDiff + pos * stateSize );
+		const float* cDiffPtr = cDiff.IsNull() ? nullptr : GetRaw( cDiff + pos * stateSize );
+		float* gatesDiffPtr = GetRaw( gatesDiff + pos * batchSize * gatesSize );
+
+		NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+		for( int b = 0; b < batchSize; ++b ) {
+			lstmStepBackward( gatesPtr + b * gatesSize, cPtr + b * objectSize,
+				prevCPtr == nullptr ? nullptr : prevCPtr + b * objectSize, hDiffPtr + b * objectSize,
+				cDiffPtr == nullptr ? nullptr : cDiffPtr + b * objectSize, nextHDiffPtr + b * objectSize,
+				nextCDiffPtr + b * objectSize, gatesDiffPtr + b * gatesSize, objectSize );
+		}
+
+		if( step > 0 ) {
+			MultiplyMatrixByMatrix( 1, gatesDiff + pos * batchSize * gatesSize, batchSize, gatesSize, u, objectSize,
+				nextDiff.GetHandle(), stateSize );
+		}
+	}
+}
+
+// Calculates the gates of one GRU step for one object and the product of the reset gate and the previous h
+// recur and prevH may be null if it's the first step without the initial state
+static inline void gruGatesStep( const float* gateWx, const float* recur, const float* prevH, float* gates,
+	float* resetH, int objectSize )
+{
+	for( int i = 0; i < objectSize; ++i ) {
+		float update = gateWx[i];
+		float reset = gateWx[objectSize + i];
+		if( recur != nullptr ) {
+			update += recur[i];
+			reset += recur[objectSize + i];
+		}
+		update = sigmoidFunc( update );
+		reset = sigmoidFunc( reset );
+		gates[i] = update;
+		gates[objectSize + i] = reset;
+		resetH[i] = prevH == nullptr ? 0.f : reset * prevH[i];
+	}
+}
+
+// Calculates the main gate and the result of one GRU step for one object
+static inline void gruMainStep( const float* mainWx, const float* recur, const float* gates, const float* prevH,
+	float* main, float* h, int objectSize )
+{
+	for( int i = 0; i < objectSize; ++i ) {
+		const float value = tanhFunc( recur == nullptr ? mainWx[i] : mainWx[i] + recur[i] );
+		const float update = gates[i];
+		main[i] = value;
+		h[i] = prevH == nullptr ? ( 1.f - update ) * value : ( 1.f - update ) * value + update * prevH[i];
+	}
+}
+
+void CCpuMathEngine::GruRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+	const CConstFloatHandle& gateWx, const CConstFloatHandle& mainWx, const CConstFloatHandle& gateU,
+	const CConstFloatHandle& mainU, const CConstFloatHandle& initialH, const CFloatHandle& gates,
+	const CFloatHandle& main, const CFloatHandle& resetH, const CFloatHandle& h )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( objectSize >= 1 );
+	ASSERT_EXPR( gateWx.GetMathEngine() == this );
+	ASSERT_EXPR( mainWx.GetMathEngine() == this );
+	ASSERT_EXPR( gateU.GetMathEngine() == this );
+	ASSERT_EXPR( mainU.GetMathEngine() == this );
+	ASSERT_EXPR( initialH.IsNull() || initialH.GetMathEngine() == this );
+	ASSERT_EXPR( gates.GetMathEngine() == this );
+	ASSERT_EXPR( main.GetMathEngine() == this );
+	ASSERT_EXPR( resetH.GetMathEngine() == this );
+	ASSERT_EXPR( h.GetMathEngine() == this );
+
+	const int gatesSize = 2 * objectSize;
+	const int stateSize = batchSize * objectSize;
+	// The products of the recurrent weights
+	CFloatHandleStackVar recur( *this, batchSize * gatesSize );
+	float* recurPtr = GetRaw( recur.GetHandle() );
+
+	const int curThreadCount = IsOmpRelevant( batchSize, batchSize * gatesSize ) ? threadCount : 1;
+
+	CConstFloatHandle prevH = initialH;
+	for( int step = 0; step < sequenceLength; ++step ) {
+		const int pos = reverse ? sequenceLength - 1 - step : step;
+		const float* prevHPtr = prevH.IsNull() ? nullptr : GetRaw( prevH );
+		const float* stepRecur = prevH.IsNull() ? nullptr : recurPtr;
+
+		if( !prevH.IsNull() ) {
+			MultiplyMatrixByTransposedMatrix( prevH, batchSize, objectSize, objectSize, gateU, gatesSize, objectSize,
+				recur.GetHandle(), gatesSize, batchSize * gatesSize );
+		}
+		const float* gateWxPtr = GetRaw( gateWx + pos * batchSize * gatesSize );
+		float* gatesPtr = GetRaw( gates + pos * batchSize * gatesSize );
+		float* resetHPtr = GetRaw( resetH + pos * stateSize );
+		NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+		for( int b = 0; b < batchSize; ++b ) {
+			gruGatesStep( gateWxPtr + b * gatesSize, stepRecur == nullptr ? nullptr : stepRecur + b * gatesSize,
+				prevHPtr == nullptr ? nullptr : prevHPtr + b * objectSize, gatesPtr + b * gatesSize,
+				resetHPtr + b * objectSize, objectSize );
+		}
+
+		if( !prevH.IsNull() ) {
+			MultiplyMatrixByTransposedMatrix( resetH + pos * stateSize, batchSize, objectSize, objectSize,
+				mainU, objectSize, objectSize, recur.GetHandle(), objectSize, stateSize );
+		}
+		const float* mainWxPtr = GetRaw( mainWx + pos * stateSize );
+		float* mainPtr = GetRaw( main + pos * stateSize );
+		float* hPtr = GetRaw( h + pos * stateSize );
+		NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+		for( int b = 0; b < batchSize; ++b ) {
+			gruMainStep( mainWxPtr + b * objectSize, stepRecur == nullptr ? nullptr : stepRecur + b * objectSize,
+				gatesPtr + b * gatesSize, prevHPtr == nullptr ? nullptr : prevHPtr + b * objectSize,
+				mainPtr + b * objectSize, hPtr + b * objectSize, objectSize );
+		}
+
+		prevH = h + pos * stateSize;
+	}
+}
+
+// Calculates the diff of the main gate and the update gate of one GRU step for one object
+// Replaces the diff of h from the next step with the part of the diff for the previous h which goes through the update gate
+static inline void gruMainStepBackward( const float* gates, const float* main, const float* prevH, const float* hDiff,
+	float* nextHDiff, float* gateDiff, float* mainDiff, int objectSize )
+{
+	for( int i = 0; i < objectSize; ++i ) {
+		const float update = gates[i];
+		const float value = main[i];
+		const float totalHDiff = hDiff[i] + nextHDiff[i];
+		const float updateDiff = prevH == nullptr ? -totalHDiff * value : totalHDiff * ( prevH[i] - value );
+		mainDiff[i] = totalHDiff * ( 1.f - update ) * ( 1.f - value * value );
+		gateDiff[i] = updateDiff * update * ( 1.f - update );
+		nextHDiff[i] = totalHDiff * update;
+	}
+}
+
+// Calculates the diff of the reset gate of one GRU step for one object
+// resetHDiff is the diff of the product of the reset gate and the previous h
+static inline void gruResetStepBackward( const float* gates, const float* prevH, const float* resetHDiff,
+	float* nextHDiff, float* gateDiff, int objectSize )
+{
+	for( int i = 0; i < objectSize; ++i ) {
+		const float reset = gates[objectSize + i];
+		gateDiff[objectSize + i] = resetHDiff[i] * prevH[i] * reset * ( 1.f - reset );
+		nextHDiff[i] += resetHDiff[i] * reset;
+	}
+}
+
+void CCpuMathEngine::GruRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+	const CConstFloatHandle& gateU, const CConstFloatHandle& mainU, const CConstFloatHandle& initialH,
+	const CConstFloatHandle& gates, const CConstFloatHandle& main, const CConstFloatHandle& h,
+	const CConstFloatHandle& hDiff, const CFloatHandle& gateDiff, const CFloatHandle& mainDiff )
+{
+	ASSERT_EXPR( sequenceLength >= 1 );
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( objectSize >= 1 );
+	ASSERT_EXPR( gateU.GetMathEngine() == this );
+	ASSERT_EXPR( mainU.GetMathEngine() == this );
+	ASSERT_EXPR( initialH.IsNull() || initialH.GetMathEngine() == this );
+	ASSERT_EXPR( gates.GetMathEngine() == this );
+	ASSERT_EXPR( main.GetMathEngine() == this );
+	ASSERT_EXPR( h.GetMathEngine() == this );
+	ASSERT_EXPR( hDiff.GetMathEngine() == this );
+	ASSERT_EXPR( gateDiff.GetMathEngine() == this );
+	ASSERT_EXPR( mainDiff.GetMathEngine() == this );
+
+	const int gatesSize = 2 * objectSize;
+	const int stateSize = batchSize * objectSize;
+	// The diff of h received from the next step and the diff of the product of the reset gate and the previous h
+	CFloatHandleStackVar buffer( *this, 2 * stateSize );
+	VectorFill( buffer.GetHandle(), 0.f, stateSize );
+	float* nextHDiffPtr = GetRaw( buffer.GetHandle() );
+	float* resetHDiffPtr = nextHDiffPtr + stateSize;
+
+	const int curThreadCount = IsOmpRelevant( batchSize, batchSize * gatesSize ) ? threadCount : 1;
+
+	for( int step = sequenceLength - 1; step >= 0; --step ) {
+		const int pos = reverse ? sequenceLength - 1 - step : step;
+		const int prevPos = reverse ? pos + 1 : pos - 1;
+
+		const float* gatesPtr = GetRaw( gates + pos * batchSize * gatesSize );
+		const float* mainPtr = GetRaw( main + pos * stateSize );
+		const float* prevHPtr = step > 0 ? GetRaw( h + prevPos * stateSize )
+			: ( initialH.IsNull() ? nullptr : GetRaw( initialH ) );
+		const float* hDiffPtr = GetRaw( hDiff + pos * stateSize );
+		float* gateDiffPtr = GetRaw( gateDiff + pos * batchSize * gatesSize );
+		float* mainDiffPtr = GetRaw( mainDiff + pos * stateSize );
+
+		NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+		for( int b = 0; b < batchSize; ++b ) {
+			gruMainStepBackward( gatesPtr + b * gatesSize, mainPtr + b * objectSize,
+				prevHPtr == nullptr ? nullptr : prevHPtr + b * objectSize, hDiffPtr + b * objectSize,
+				nextHDiffPtr + b * objectSize, gateDiffPtr + b * gatesSize, mainDiffPtr + b * objectSize, objectSize );
+		}
+
+		if( prevHPtr == nullptr ) {
+			// The reset gate is not used without the previous h
+			for( int b = 0; b < batchSize; ++b ) {
+				vectorFill( gateDiffPtr + b * gatesSize + objectSize, 0.f, objectSize );
+			}
+			continue;
+		}
+
+		multiplyMatrixByMatrix( mainDiffPtr, batchSize, objectSize, objectSize, GetRaw( mainU ), objectSize, objectSize,
+			resetHDiffPtr, objectSize );
+		NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+		for( int b = 0; b < batchSize; ++b ) {
+			gruResetStepBackward( gatesPtr + b * gatesSize, prevHPtr + b * objectSize, resetHDiffPtr + b * objectSize,
+				nextHDiffPtr + b * objectSize, gateDiffPtr + b * gatesSize, objectSize );
+		}
+
+		if( step > 0 ) {
+			multiplyMatrixByMatrixAndAdd( gateDiffPtr, batchSize, gatesSize, gatesSize, GetRaw( gateU ), objectSize,
+				objectSize, nextHDiffPtr, objectSize );
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scaled dot-product attention
+
+// The number of queries processed by one task
+static const int AttentionQueryTileSize = 32;
+// The number of keys processed at once
+static const int AttentionKeyBlockSize = 256;
+// The value added to the attention weights of the masked keys (the same as in CMultiheadAttentionLayer)
+static const float AttentionMaskValue = -1e9f;
+
+// Applies the scale and the mask to the block of the attention weights,
+// then replaces them with the exponents and updates the softmax maximums and sums
+// Returns the multipliers for the results accumulated on the previous blocks in the correction array
+static void attentionSoftmaxBlock( float* weights, int queryCount, int keyCount, float multiplier,
+	const float* mask, int maskRowSize, float* maxValues, float* sums, float* correction )
+{
+	for( int i = 0; i < queryCount; ++i ) {
+		float* row = weights + i * keyCount;
+		float maxValue = maxValues[i];
+		for( int j = 0; j < keyCount; ++j ) {
+			row[j] *= multiplier;
+			if( mask != nullptr ) {
+				row[j] += AttentionMaskValue * mask[i * maskRowSize + j];
+			}
+			maxValue = max( maxValue, row[j] );
+		}
+
+		float sum = 0;
+		for( int j = 0; j < keyCount; ++j ) {
+			row[j] = expf( row[j] - maxValue );
+			sum += row[j];
+		}
+		correction[i] = expf( maxValues[i] - maxValue );
+		sums[i] = sums[i] * correction[i] + sum;
+		maxValues[i] = maxValue;
+	}
+}
+
+void CCpuMathEngine::ScaledDotProductAttention( int batchSize, int headCount, int querySize, int keySize, int headSize,
+	float multiplier, const CConstFloatHandle& query, const CConstFloatHandle& key, const CConstFloatHandle& value,
+	const CConstFloatHandle& mask, const CFloatHandle& result )
+{
+	ASSERT_EXPR( batchSize >= 1 );
+	ASSERT_EXPR( headCount >= 1 );
+	ASSERT_EXPR( querySize >= 1 );
+	ASSERT_EXPR( keySize >= 1 );
+	ASSERT_EXPR( headSize >= 1 );
+	ASSERT_EXPR( query.GetMathEngine() == this );
+	ASSERT_EXPR( key.GetMathEngine() == this );
+	ASSERT_EXPR( value.GetMathEngine() == this );
+	ASSERT_EXPR( mask.IsNull() || mask.GetMathEngine() == this );
+	ASSERT_EXPR( result.GetMathEngine() == this );
+
+	// The heads are interleaved in the rows of all the matrices
+	const int rowSize = headCount * headSize;
+	const int queryTileCount = ( querySize + AttentionQueryTileSize - 1 ) / AttentionQueryTileSize;
+	const int taskCount = batchSize * headCount * queryTileCount;
+
+	const float* queryPtr = GetRaw( query );
+	const float* keyPtr = GetRaw( key );
+	const float* valuePtr = GetRaw( value );
+	const float* maskPtr = mask.IsNull() ? nullptr : GetRaw( mask );
+	float* resultPtr = GetRaw( result );
+
+	// The temporary data of one thread: the block of the attention weights, the accumulated result,
+	// the softmax maximums, sums and corrections for every query in the tile
+	const int weightsSize = AttentionQueryTileSize * AttentionKeyBlockSize;
+	const int accumulatorSize = AttentionQueryTileSize * headSize;
+	const int tempSize = weightsSize + accumulatorSize + 3 * AttentionQueryTileSize;
+	const int64_t operationCount = static_cast<int64_t>( batchSize ) * headCount * querySize * keySize * headSize;
+	const int curThreadCount = IsOmpRelevant( taskCount, operationCount ) ? threadCount : 1;
+	CFloatHandleStackVar temp( mathEngine(), curThreadCount * tempSize );
+	float* tempRaw = GetRaw( temp.GetHandle() );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		float* weights = tempRaw + OmpGetThreadNum() * tempSize;
+		float* accumulator = weights + weightsSize;
+		float* maxValues = accumulator + accumulatorSize;
+		float* sums = maxValues + AttentionQueryTileSize;
+		float* correction = sums + AttentionQueryTileSize;
+
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( taskCount, start, count ) ) {
+			for( int task = start; task < start + count; ++task ) {
+				const int queryStart = ( task % queryTileCount ) * AttentionQueryTileSize;
+				const int queryCount = min( AttentionQueryTileSize, querySize - queryStart );
+				const int head = ( task / queryTileCount ) % headCount;
+				const int batch = task / queryTileCount / headCount;
+
+				const float* queryTile = queryPtr + ( batch * querySize + queryStart ) * rowSize + head * headSize;
+				const float* keyHead = keyPtr + batch * keySize * rowSize + head * headSize;
+				const float* valueHead = valuePtr + batch * keySize * rowSize + head * headSize;
+
+				vectorFill( accumulator, 0.f, queryCount * headSize );
+				vectorFill( maxValues, -FLT_MAX, queryCount );
+				vectorFill( sums, 0.f, queryCount );
+
+				for( int keyStart = 0; keyStart < keySize; keyStart += AttentionKeyBlockSize ) {
+					const int keyCount = min( AttentionKeyBlockSize, keySize - keyStart );
+					multiplyMatrixByTransposedMatrix( queryTile, queryCount, headSize, rowSize,
+						keyHead + keyStart * rowSize, keyCount, rowSize, weights, keyCount );
+					attentionSoftmaxBlock( weights, queryCount, keyCount, multiplier,
+						maskPtr == nullptr ? nullptr : maskPtr + queryStart * keySize + keyStart, keySize,
+						maxValues, sums, correction );
+					for( int i = 0; i < queryCount; ++i ) {
+						vectorMultiply( accumulator + i * headSize, accumulator + i * headSize, correction[i], headSize );
+					}
+					multiplyMatrixByMatrixAndAdd( weights, queryCount, keyCount, keyCount,
+						valueHead + keyStart * rowSize, headSize, rowSize, accumulator, headSize );
+				}
+
+				float* resultTile = resultPtr + ( batch * querySize + queryStart ) * rowSize + head * headSize;
+				for( int i = 0; i < queryCount; ++i ) {
+					vectorMultiply( accumulator + i * headSize, resultTile + i * rowSize, 1.f / sums[i], headSize );
+				}
+			}
+		}
+	}
+}
+
+// The maximum number of elements processed by one thread task of the adaptive gradient step
+static const int AdaptiveGradientStepTaskSize = 16384;
+
+// The number of elements of the temporary update buffer used to calculate the update norm
+static const int AdaptiveGradientStepBufferSize = 512;
+
+// The adaptive gradient step for a part of a parameter blob
+// If normSquares is not null the squared L2 norms of diff, update and param (before the step) are written into it
+static void adaptiveGradientStepPart( const CAdaptiveGradientStep& step, int size, const float* diff, float* param,
+	float* moment, float* secondMoment, float* secondMomentMax, float* update, float* normSquares )
+{
+	if( normSquares == nullptr ) {
+		vectorAdaptiveGradientStep( step, diff, param, moment, secondMoment, secondMomentMax, update, size );
+		return;
+	}
+
+	normSquares[0] = 0.f;
+	normSquares[1] = 0.f;
+	normSquares[2] = 0.f;
+	float updateBuffer[AdaptiveGradientStepBufferSize];
+	for( int start = 0; start < size; start += AdaptiveGradientStepBufferSize ) {
+		const int partSize = min( AdaptiveGradientStepBufferSize, size - start );
+		float diffNorm = 0.f;
+		float updateNorm = 0.f;
+		float paramNorm = 0.f;
+		vectorDotProduct( diff + start, diff + start, partSize, &diffNorm );
+		vectorDotProduct( param + start, param + start, partSize, &paramNorm );
+
+		float* partUpdate = update == nullptr ? updateBuffer : update + start;
+		vectorAdaptiveGradientStep( step, diff + start, param + start, moment + start, secondMoment + start,
+			secondMomentMax == nullptr ? nullptr : secondMomentMax + start, partUpdate, partSize );
+		vectorDotProduct( partUpdate, partUpdate, partSize, &updateNorm );
+		if( update == nullptr ) {
+			vectorMultiply( partUpdate, partUpdate, step.Rate, partSize );
+			vectorAdd( param + start, partUpdate, param + start, partSize );
+		}
+
+		normSquares[0] += diffNorm;
+		normSquares[1] += updateNorm;
+		normSquares[2] += paramNorm;
+	}
+}
+
+void CCpuMathEngine::AdaptiveGradientStep( const CAdaptiveGradientStep& step, int count, const int* sizes,
+	const CConstFloatHandle* diffs, const CFloatHandle* params, const CFloatHandle* moments,
+	const CFloatHandle* secondMoments, const CFloatHandle* secondMomentMaxes, const CFloatHandle* updates,
+	const CFloatHandle& normSquares )
+{
+	ASSERT_EXPR( count >= 0 );
+	ASSERT_EXPR( normSquares.IsNull() || normSquares.GetMathEngine() == this );
+
+	// Every blob is split into tasks of at most AdaptiveGradientStepTaskSize elements
+	std::vector<int> taskBlobs;
+	std::vector<int> taskStarts;
+	int64_t totalSize = 0;
+	for( int i = 0; i < count; ++i ) {
+		ASSERT_EXPR( sizes[i] >= 0 );
+		ASSERT_EXPR( diffs[i].GetMathEngine() == this );
+		ASSERT_EXPR( params[i].GetMathEngine() == this );
+		ASSERT_EXPR( moments[i].GetMathEngine() == this );
+		ASSERT_EXPR( secondMoments[i].GetMathEngine() == this );
+		ASSERT_EXPR( secondMomentMaxes == nullptr || secondMomentMaxes[i].GetMathEngine() == this );
+		ASSERT_EXPR( updates == nullptr || updates[i].GetMathEngine() == this );
+		for( int start = 0; start < sizes[i]; start += AdaptiveGradientStepTaskSize ) {
+			taskBlobs.push_back( i );
+			taskStarts.push_back( start );
+		}
+		totalSize += sizes[i];
+	}
+
+	const int taskCount = static_cast<int>( taskBlobs.size() );
+	// The norms of every task are summed up after the step so that the result doesn't depend on the thread count
+	std::vector<float> taskNormSquares( normSquares.IsNull() ? 0 : 3 * taskCount );
+	const int curThreadCount = IsOmpRelevant( taskCount, totalSize ) ? threadCount : 1;
+
+	NEOML_OMP_FOR_NUM_THREADS( curThreadCount )
+	for( int task = 0; task < taskCount; ++task ) {
+		const int blob = taskBlobs[task];
+		const int start = taskStarts[task];
+		const int size = min( AdaptiveGradientStepTaskSize, sizes[blob] - start );
+		float* secondMomentMax = secondMomentMaxes == nullptr ? nullptr : GetRaw( secondMomentMaxes[blob] ) + start;
+		float* update = updates == nullptr ? nullptr : GetRaw( updates[blob] ) + start;
+		adaptiveGradientStepPart( step, size, GetRaw( diffs[blob] ) + start, GetRaw( params[blob] ) + start,
+			GetRaw( moments[blob] ) + start, GetRaw( secondMoments[blob] ) + start, secondMomentMax, update,
+			normSquares.IsNull() ? nullptr : taskNormSquares.data() + 3 * task );
+	}
+
+	if( !normSquares.IsNull() ) {
+		float* result = GetRaw( normSquares );
+		for( int i = 0; i < 3 * count; ++i ) {
+			result[i] = 0.f;
+		}
+		for( int task = 0; task < taskCount; ++task ) {
+			for( int i = 0; i < 3; ++i ) {
+				result[3 * taskBlobs[task] + i] += taskNormSquares[3 * task + i];
+			}
+		}
+	}
+}
+
 template<class T>
 static inline void SpaceToDepthFunc( const T* source, int dataRowCount, int dataRowWidth,
 	int blockChannels, int blockSize, bool isForward, T* result, int threadCount )
@@ -617,7 +617,7 @@ void CCpuMathEngine::Blob3dConvolution( const C3dConvolutionDesc& convDesc, cons
 
 	if( desc.PaddingHeight == 0 && desc.PaddingWidth == 0 && desc.PaddingDepth == 0 && desc.Filter.ObjectSize() == desc.Filter.Channels() ) {
 		blob3dConvolution1x1x1( desc.Source, desc.Filter, desc.Result, desc.StrideHeight, desc.StrideWidth, desc.StrideDepth,
-			sourceDataRaw, filterDataRaw, freeTermDataRaw, resultDataRaw );
+			sourceDataRaw, filterDataRaw, freeTermDataRaw, resultDataRaw, AF_Linear, 0.f );
 	} else {
 		blob3dConvolution( desc, sourceDataRaw, filterDataRaw, freeTermData, resultDataRaw );
 	}
@@ -34,30 +34,64 @@ enum TConvAlgo {
 	CA_2,		// work with the data directly (only for stride = 1 and padding = 0)
 				// most efficient when the image is large and especially when it has many channels
 				
-	CA_1x1		// for convolution with a 1*1 filter, no padding and dilation (both 2D and 3D)
+	CA_1x1,		// for convolution with a 1*1 filter, no padding and dilation (both 2D and 3D)
+	CA_Winograd	// the Winograd F(4x4, 3x3) algorithm for a 3*3 filter with stride 1 and no dilation (forward only)
 };
 
 const int BlobConvolutionCacheSize = 256 * 1024;
 
+// The Winograd F(4x4, 3x3) algorithm splits the result into 4*4 tiles, each calculated from a 6*6 tile of the source
+// In the transformed space the convolution is an element-wise product summed over the channels
+const int WinogradTileSize = 6;
+const int WinogradResultTileSize = 4;
+const int WinogradTileElementCount = WinogradTileSize * WinogradTileSize;
+// The Winograd algorithm multiplies the matrices of the size (tile count) x (channels) by (channels) x (filters),
+// it is faster than the other algorithms only if these matrices are large enough
+const int WinogradMinChannelCount = 64;
+const int WinogradMinTileCount = 48;
+
 // Convolution descriptor
 struct CCpuConvolutionDesc : public CCommonConvolutionDesc {
 	TConvAlgo ForwardAlgo;
 	TConvAlgo BackwardAlgo;
 	unique_ptr<CConvolutionDesc> SimdConvolutionDesc;
-
-	CCpuConvolutionDesc( unique_ptr<CConvolutionDesc>& simdConvolutionDesc, const CBlobDesc& source, const CBlobDesc& result, const CBlobDesc& filter,
-			int paddingHeight, int paddingWidth, int strideHeight, int strideWidth, int dilationHeight, int dilationWidth ) :
+	// The filter transformed for the Winograd algorithm (WinogradTileElementCount x FilterCount x Channels)
+	// and the copy of the filter it was calculated from
+	unique_ptr<CFloatHandleVar> WinogradFilter;
+	unique_ptr<CFloatHandleVar> WinogradFilterSource;
+	mutable bool IsWinogradFilterValid; // false until the filter is transformed for the first time
+
+	CCpuConvolutionDesc( IMathEngine& mathEngine, bool useWinograd, const CBlobDesc& source, const CBlobDesc& result,
+			const CBlobDesc& filter, int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
+			int dilationHeight, int dilationWidth ) :
 		CCommonConvolutionDesc( source, result, filter, paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth ),
-		ForwardAlgo( getActualForwardAlgo() ),
+		ForwardAlgo( useWinograd && isWinogradAvailable() ? CA_Winograd : getActualForwardAlgo() ),
 		BackwardAlgo( getActualBackwardAlgo() ),
-		SimdConvolutionDesc( std::move( simdConvolutionDesc ) )
+		IsWinogradFilterValid( false )
 	{
+		if( ForwardAlgo == CA_Winograd ) {
+			WinogradFilter.reset( new CFloatHandleVar( mathEngine,
+				WinogradTileElementCount * filter.ObjectCount() * filter.ObjectSize() / ( filter.Height() * filter.Width() ) ) );
+			WinogradFilterSource.reset( new CFloatHandleVar( mathEngine, filter.BlobSize() ) );
+		}
 	}
 
+	bool isWinogradAvailable() const;
 	TConvAlgo getActualForwardAlgo() const;
 	TConvAlgo getActualBackwardAlgo() const;
 };
 
+// Checks if the Winograd algorithm may be used and is faster than the other algorithms
+inline bool CCpuConvolutionDesc::isWinogradAvailable() const
+{
+	return Filter.Height() == 3 && Filter.Width() == 3
+		&& StrideHeight == 1 && StrideWidth == 1 && DilationHeight == 1 && DilationWidth == 1
+		&& Filter.Depth() * Filter.Channels() >= WinogradMinChannelCount
+		&& Filter.ObjectCount() >= WinogradMinChannelCount
+		&& Result.ObjectCount() * ( ( Result.Height() + WinogradResultTileSize - 1 ) / WinogradResultTileSize )
+			* ( ( Result.Width() + WinogradResultTileSize - 1 ) / WinogradResultTileSize ) >= WinogradMinTileCount;
+}
+
 // Gets the algorithm to be used for this convolution
 inline TConvAlgo CCpuConvolutionDesc::getActualForwardAlgo() const
 {
@@ -130,14 +164,13 @@ CConvolutionDesc* CCpuMathEngine::InitBlobConvolution( const CBlobDesc& source,
 	ASSERT_EXPR( result.Channels() == filter.BatchWidth() );
 	ASSERT_EXPR( result.Depth() == 1 );
 
-	unique_ptr<CConvolutionDesc> simdConvolutionDesc;
-	if( simdMathEngine != nullptr ) {
-		simdConvolutionDesc = unique_ptr<CConvolutionDesc>( simdMathEngine->InitBlobConvolution( source, paddingHeight, paddingWidth,
+	CCpuConvolutionDesc* desc = new CCpuConvolutionDesc( mathEngine(), useWinogradConvolution, source, result, filter,
+		paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth );
+	// The JIT convolution is not needed if the Winograd algorithm is selected
+	if( simdMathEngine != nullptr && desc->ForwardAlgo != CA_Winograd ) {
+		desc->SimdConvolutionDesc = unique_ptr<CConvolutionDesc>( simdMathEngine->InitBlobConvolution( source, paddingHeight, paddingWidth,
 			strideHeight, strideWidth, dilationHeight, dilationWidth, filter, result ) );
 	}
-
-	CCpuConvolutionDesc* desc = new CCpuConvolutionDesc( simdConvolutionDesc, source, result, filter,
-		paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth );
 	return desc;
 }
 
@@ -390,8 +423,41 @@ inline int ceilTo( int val, int discret )
 	return ( val / discret ) * discret;
 }
 
+// Applies the activation to the part of the convolution result which has just been calculated
+// Is called inside the OMP blocks while the data is still in cache
+void CCpuMathEngine::applyConvolutionActivation( float* data, int dataSize, TActivationFunction activation,
+	float activationParam )
+{
+	switch( activation ) {
+		case AF_Linear:
+			break;
+		case AF_ReLU:
+			if( activationParam > 0 ) {
+				vectorReLU( data, data, dataSize, activationParam );
+			} else {
+				vectorReLU( data, data, dataSize );
+			}
+			break;
+		case AF_Sigmoid:
+		{
+			CFloatHandle dataHandle( CMemoryHandleInternal::CreateMemoryHandle( this, data ) );
+			VectorSigmoid( dataHandle, dataHandle, dataSize );
+			break;
+		}
+		case AF_HSwish:
+		{
+			CFloatHandle dataHandle( CMemoryHandleInternal::CreateMemoryHandle( this, data ) );
+			VectorHSwish( dataHandle, dataHandle, dataSize );
+			break;
+		}
+		default:
+			ASSERT_EXPR( false );
+	}
+}
+
 void CCpuMathEngine::blobConvolutionForwardAlgo0( const CCpuConvolutionDesc& desc, const float* sourceData,
-	const float* filterData, const CFloatHandle* freeTermData, float* resultData )
+	const float* filterData, const CFloatHandle* freeTermData, float* resultData,
+	TActivationFunction activation, float activationParam )
 {
 	const int resultItemCount = desc.Result.ObjectCount() * desc.Result.Width() * desc.Result.Height();
 	const int curThreadCount = IsOmpRelevant( resultItemCount, static_cast< int64_t >( desc.Result.BlobSize() ) * desc.Filter.ObjectSize() ) ? threadCount : 1;
@@ -426,6 +492,7 @@ void CCpuMathEngine::blobConvolutionForwardAlgo0( const CCpuConvolutionDesc& des
 					addVectorToMatrixRows( resultDataPtr, resultDataPtr, size, filterObjectCount, filterObjectCount, 
 						filterObjectCount, GetRaw( *freeTermData ) );
 				}
+				applyConvolutionActivation( resultDataPtr, size * filterObjectCount, activation, activationParam );
 
 				index += size;
 			}
@@ -434,7 +501,8 @@ void CCpuMathEngine::blobConvolutionForwardAlgo0( const CCpuConvolutionDesc& des
 }
 
 void CCpuMathEngine::blobConvolutionForwardAlgo1( const CCpuConvolutionDesc& desc, const float* sourceData,
-	const float* filterData, const CFloatHandle* freeTermData, float* resultData )
+	const float* filterData, const CFloatHandle* freeTermData, float* resultData,
+	TActivationFunction activation, float activationParam )
 {
 	float* freeTermDataRaw = freeTermData == nullptr ? nullptr : GetRaw( *freeTermData );
 
@@ -496,6 +564,8 @@ void CCpuMathEngine::blobConvolutionForwardAlgo1( const CCpuConvolutionDesc& des
 						filter.ObjectSize(), filterData, filter.BatchWidth(), filter.ObjectSize(), outputTransposedPtr,
 						filter.BatchWidth() );
 				}
+				applyConvolutionActivation( outputTransposedPtr, result.Height() * resultCount * outputChannels,
+					activation, activationParam );
 
 				// Transpose the result
 				transposeResult( desc, outputTransposedPtr, batch, resultStart, resultCount, resultData );
@@ -504,8 +574,275 @@ void CCpuMathEngine::blobConvolutionForwardAlgo1( const CCpuConvolutionDesc& des
 	}
 }
 
+// The 1D transformations of the Winograd algorithm
+// Each of them is applied to the vectors of the given size, placed with the given step
+// The vectors are processed in chunks copied to the local arrays, so that the compiler could vectorize the calculations
+const int WinogradTransformChunkSize = 16;
+
+// B^T * d, from 6 source vectors to 6
+static void winogradSourceTransform( const float* source, int sourceStep, float* result, int resultStep, int size )
+{
+	float s[WinogradTileSize][WinogradTransformChunkSize] = {};
+	float r[WinogradTileSize][WinogradTransformChunkSize];
+	for( int start = 0; start < size; start += WinogradTransformChunkSize ) {
+		const int count = min( WinogradTransformChunkSize, size - start );
+		for( int k = 0; k < WinogradTileSize; ++k ) {
+			dataCopy( s[k], source + k * sourceStep + start, count );
+		}
+		for( int i = 0; i < WinogradTransformChunkSize; ++i ) {
+			r[0][i] = 4 * s[0][i] - 5 * s[2][i] + s[4][i];
+			r[1][i] = s[3][i] + s[4][i] - 4 * ( s[1][i] + s[2][i] );
+			r[2][i] = s[4][i] - s[3][i] + 4 * ( s[1][i] - s[2][i] );
+			r[3][i] = s[4][i] - s[2][i] + 2 * ( s[3][i] - s[1][i] );
+			r[4][i] = s[4][i] - s[2][i] - 2 * ( s[3][i] - s[1][i] );
+			r[5][i] = 4 * s[1][i] - 5 * s[3][i] + s[5][i];
+		}
+		for( int k = 0; k < WinogradTileSize; ++k ) {
+			dataCopy( result + k * resultStep + start, r[k], count );
+		}
+	}
+}
+
+// G * g, from 3 filter vectors to 6
+static void winogradFilterTransform( const float* filter, int filterStep, float* result, int resultStep, int size )
+{
+	float f[3][WinogradTransformChunkSize] = {};
+	float r[WinogradTileSize][WinogradTransformChunkSize];
+	for( int start = 0; start < size; start += WinogradTransformChunkSize ) {
+		const int count = min( WinogradTransformChunkSize, size - start );
+		for( int k = 0; k < 3; ++k ) {
+			dataCopy( f[k], filter + k * filterStep + start, count );
+		}
+		for( int i = 0; i < WinogradTransformChunkSize; ++i ) {
+			r[0][i] = f[0][i] / 4;
+			r[1][i] = -( f[0][i] + f[1][i] + f[2][i] ) / 6;
+			r[2][i] = -( f[0][i] - f[1][i] + f[2][i] ) / 6;
+			r[3][i] = f[0][i] / 24 + f[1][i] / 12 + f[2][i] / 6;
+			r[4][i] = f[0][i] / 24 - f[1][i] / 12 + f[2][i] / 6;
+			r[5][i] = f[2][i];
+		}
+		for( int k = 0; k < WinogradTileSize; ++k ) {
+			dataCopy( result + k * resultStep + start, r[k], count );
+		}
+	}
+}
+
+// A^T * m, from 6 vectors of the product to 4 result vectors
+static void winogradResultTransform( const float* product, int productStep, float* result, int resultStep, int size )
+{
+	float m[WinogradTileSize][WinogradTransformChunkSize] = {};
+	float r[WinogradResultTileSize][WinogradTransformChunkSize];
+	for( int start = 0; start < size; start += WinogradTransformChunkSize ) {
+		const int count = min( WinogradTransformChunkSize, size - start );
+		for( int k = 0; k < WinogradTileSize; ++k ) {
+			dataCopy( m[k], product + k * productStep + start, count );
+		}
+		for( int i = 0; i < WinogradTransformChunkSize; ++i ) {
+			const float sum12 = m[1][i] + m[2][i];
+			const float diff12 = m[1][i] - m[2][i];
+			const float sum34 = m[3][i] + m[4][i];
+			const float diff34 = m[3][i] - m[4][i];
+			r[0][i] = m[0][i] + sum12 + sum34;
+			r[1][i] = diff12 + 2 * diff34;
+			r[2][i] = sum12 + 4 * sum34;
+			r[3][i] = diff12 + 8 * diff34 + m[5][i];
+		}
+		for( int k = 0; k < WinogradResultTileSize; ++k ) {
+			dataCopy( result + k * resultStep + start, r[k], count );
+		}
+	}
+}
+
+// Copies the source tile with the given top left corner, the pixels outside of the image are filled with zeros
+static void fillWinogradSourceTile( const CCpuConvolutionDesc& desc, const float* sourceData, int object,
+	int top, int left, float* tile )
+{
+	const CBlobDesc& source = desc.Source;
+	const int channelCount = source.Depth() * source.Channels();
+	const int tileRowSize = WinogradTileSize * channelCount;
+	const int startX = max( 0, left );
+	const int endX = min( source.Width(), left + WinogradTileSize );
+
+	for( int row = 0; row < WinogradTileSize; ++row ) {
+		float* tileRow = tile + row * tileRowSize;
+		const int y = top + row;
+		if( y < 0 || y >= source.Height() || startX >= endX ) {
+			vectorFill( tileRow, 0.f, tileRowSize );
+			continue;
+		}
+		if( startX > left ) {
+			vectorFill( tileRow, 0.f, ( startX - left ) * channelCount );
+		}
+		dataCopy( tileRow + ( startX - left ) * channelCount,
+			sourceData + ( ( object * source.Height() + y ) * source.Width() + startX ) * channelCount,
+			( endX - startX ) * channelCount );
+		if( endX < left + WinogradTileSize ) {
+			vectorFill( tileRow + ( endX - left ) * channelCount, 0.f, ( left + WinogradTileSize - endX ) * channelCount );
+		}
+	}
+}
+
+// Transforms the filter for the Winograd algorithm (G * g * G^T)
+// The filter may be changed in place (by the solver, by SetFilterData, by another network sharing it)
+// so the cached transformation is checked against the copy of the filter on every run
+void CCpuMathEngine::updateWinogradFilter( const CCpuConvolutionDesc& desc, const float* filterData )
+{
+	const int filterSize = desc.Filter.BlobSize();
+	float* filterCopy = GetRaw( desc.WinogradFilterSource->GetHandle() );
+	if( desc.IsWinogradFilterValid && memcmp( filterCopy, filterData, filterSize * sizeof( float ) ) == 0 ) {
+		return;
+	}
+	dataCopy( filterCopy, filterData, filterSize );
+	desc.IsWinogradFilterValid = true;
+
+	const int filterCount = desc.Filter.ObjectCount();
+	const int channelCount = desc.Filter.Depth() * desc.Filter.Channels();
+	const int tempSize = WinogradTileSize * 3 * channelCount;
+	float* transformedFilter = GetRaw( desc.WinogradFilter->GetHandle() );
+
+	const int curThreadCount = IsOmpRelevant( filterCount, filterSize ) ? threadCount : 1;
+	CFloatHandleStackVar temp( mathEngine(), curThreadCount * tempSize );
+	float* tempRaw = GetRaw( temp.GetHandle() );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		float* tempPtr = tempRaw + OmpGetThreadNum() * tempSize;
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( filterCount, start, count ) ) {
+			for( int filter = start; filter < start + count; ++filter ) {
+				const float* filterPtr = filterData + filter * desc.Filter.ObjectSize();
+				// G * g
+				for( int column = 0; column < 3; ++column ) {
+					winogradFilterTransform( filterPtr + column * channelCount, 3 * channelCount,
+						tempPtr + column * channelCount, 3 * channelCount, channelCount );
+				}
+				// ( G * g ) * G^T
+				for( int row = 0; row < WinogradTileSize; ++row ) {
+					winogradFilterTransform( tempPtr + row * 3 * channelCount, channelCount,
+						transformedFilter + ( row * WinogradTileSize * filterCount + filter ) * channelCount,
+						filterCount * channelCount, channelCount );
+				}
+			}
+		}
+	}
+}
+
+void CCpuMathEngine::blobConvolutionForwardWinograd( const CCpuConvolutionDesc& desc, const float* sourceData,
+	const float* filterData, const float* freeTermData, float* resultData,
+	TActivationFunction activation, float activationParam )
+{
+	updateWinogradFilter( desc, filterData );
+	const float* transformedFilter = GetRaw( desc.WinogradFilter->GetHandle() );
+
+	const CBlobDesc& result = desc.Result;
+	const int channelCount = desc.Source.Depth() * desc.Source.Channels();
+	const int filterCount = desc.Filter.ObjectCount();
+	const int tileRowCount = ( result.Height() + WinogradResultTileSize - 1 ) / WinogradResultTileSize;
+	const int tileColumnCount = ( result.Width() + WinogradResultTileSize - 1 ) / WinogradResultTileSize;
+	const int objectTileCount = tileRowCount * tileColumnCount;
+	const int tileCount = result.ObjectCount() * objectTileCount;
+
+	const int curThreadCount = IsOmpRelevant( tileCount,
+		static_cast<int64_t>( result.BlobSize() ) * desc.Filter.ObjectSize() ) ? threadCount : 1;
+	// The tiles are processed in blocks: the block is transformed, multiplied by the filter for every tile element
+	// and transformed back while it is in cache
+	const int blockTileCount = max( 1, min( BlobConvolutionCacheSize / ( WinogradTileElementCount * ( channelCount + filterCount ) ),
+		( tileCount + curThreadCount - 1 ) / curThreadCount ) );
+	const int sourceBlockSize = WinogradTileElementCount * blockTileCount * channelCount;
+	const int productBlockSize = WinogradTileElementCount * blockTileCount * filterCount;
+	const int tileTempSize = 2 * WinogradTileElementCount * channelCount
+		+ ( WinogradResultTileSize * WinogradTileSize + WinogradResultTileSize * WinogradResultTileSize ) * filterCount;
+	const int threadTempSize = sourceBlockSize + productBlockSize + tileTempSize;
+
+	CFloatHandleStackVar temp( mathEngine(), curThreadCount * threadTempSize );
+	float* tempRaw = GetRaw( temp.GetHandle() );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		float* sourceBlock = tempRaw + OmpGetThreadNum() * threadTempSize;
+		float* productBlock = sourceBlock + sourceBlockSize;
+		float* sourceTile = productBlock + productBlockSize;
+		float* sourceTemp = sourceTile + WinogradTileElementCount * channelCount;
+		float* resultTemp = sourceTemp + WinogradTileElementCount * channelCount;
+		float* resultTile = resultTemp + WinogradResultTileSize * WinogradTileSize * filterCount;
+
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( tileCount, start, count ) ) {
+			for( int blockStart = start; blockStart < start + count; blockStart += blockTileCount ) {
+				const int blockSize = min( blockTileCount, start + count - blockStart );
+
+				// The source block is stored as WinogradTileElementCount x blockTileCount x channelCount
+				for( int i = 0; i < blockSize; ++i ) {
+					const int object = ( blockStart + i ) / objectTileCount;
+					const int tile = ( blockStart + i ) % objectTileCount;
+					fillWinogradSourceTile( desc, sourceData, object,
+						( tile / tileColumnCount ) * WinogradResultTileSize - desc.PaddingHeight,
+						( tile % tileColumnCount ) * WinogradResultTileSize - desc.PaddingWidth, sourceTile );
+					// d * B
+					for( int row = 0; row < WinogradTileSize; ++row ) {
+						winogradSourceTransform( sourceTile + row * WinogradTileSize * channelCount, channelCount,
+							sourceTemp + row * WinogradTileSize * channelCount, channelCount, channelCount );
+					}
+					// B^T * ( d * B )
+					for( int column = 0; column < WinogradTileSize; ++column ) {
+						winogradSourceTransform( sourceTemp + column * channelCount, WinogradTileSize * channelCount,
+							sourceBlock + ( column * blockTileCount + i ) * channelCount,
+							WinogradTileSize * blockTileCount * channelCount, channelCount );
+					}
+				}
+
+				for( int element = 0; element < WinogradTileElementCount; ++element ) {
+					multiplyMatrixByTransposedMatrix( sourceBlock + element * blockTileCount * channelCount,
+						blockSize, channelCount, channelCount, transformedFilter + element * filterCount * channelCount,
+						filterCount, channelCount, productBlock + element * blockTileCount * filterCount, filterCount );
+				}
+
+				for( int i = 0; i < blockSize; ++i ) {
+					// A^T * m
+					for( int column = 0; column < WinogradTileSize; ++column ) {
+						winogradResultTransform( productBlock + ( column * blockTileCount + i ) * filterCount,
+							WinogradTileSize * blockTileCount * filterCount, resultTemp + column * filterCount,
+							WinogradTileSize * filterCount, filterCount );
+					}
+					// ( A^T * m ) * A
+					for( int row = 0; row < WinogradResultTileSize; ++row ) {
+						winogradResultTransform( resultTemp + row * WinogradTileSize * filterCount, filterCount,
+							resultTile + row * WinogradResultTileSize * filterCount, filterCount, filterCount );
+					}
+					const int resultTileSize = WinogradResultTileSize * WinogradResultTileSize;
+					if( freeTermData != nullptr ) {
+						addVectorToMatrixRows( resultTile, resultTile, resultTileSize, filterCount, filterCount,
+							filterCount, freeTermData );
+					}
+					applyConvolutionActivation( resultTile, resultTileSize * filterCount, activation, activationParam );
+
+					// Only the part of the tile inside of the result is stored
+					const int object = ( blockStart + i ) / objectTileCount;
+					const int tile = ( blockStart + i ) % objectTileCount;
+					const int top = ( tile / tileColumnCount ) * WinogradResultTileSize;
+					const int left = ( tile % tileColumnCount ) * WinogradResultTileSize;
+					const int width = min( WinogradResultTileSize, result.Width() - left );
+					for( int row = 0; row < min( WinogradResultTileSize, result.Height() - top ); ++row ) {
+						dataCopy( resultData + ( ( object * result.Height() + top + row ) * result.Width() + left ) * filterCount,
+							resultTile + row * WinogradResultTileSize * filterCount, width * filterCount );
+					}
+				}
+			}
+		}
+	}
+}
+
 void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CFloatHandle& source,
 	const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& result )
+{
+	BlobConvolutionWithActivation( convDesc, source, filter, freeTerm, result, AF_Linear, 0.f );
+}
+
+void CCpuMathEngine::BlobConvolutionWithActivation( const CConvolutionDesc& convDesc, const CFloatHandle& source,
+	const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& result,
+	TActivationFunction activation, float activationParam )
 {
 	const float* sourceRaw = GetRaw( source );
 	const float* filterRaw = GetRaw( filter );
@@ -514,8 +851,28 @@ void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CF
 
 	const CCpuConvolutionDesc& desc = static_cast<const CCpuConvolutionDesc&>( convDesc );
 
+	// Used by the JIT convolution for the activations it can't apply to the registers
+	auto applyActivationToResult = [&]() {
+		const int resultSize = desc.Result.BlobSize();
+		const int curThreadCount = IsOmpRelevant( resultSize, resultSize ) ? threadCount : 1;
+		NEOML_OMP_NUM_THREADS( curThreadCount )
+		{
+			int start;
+			int count;
+			if( OmpGetTaskIndexAndCount( resultSize, start, count ) ) {
+				applyConvolutionActivation( resultRaw + start, count, activation, activationParam );
+			}
+		}
+	};
+
 	if( desc.SimdConvolutionDesc != nullptr ) {
-		simdMathEngine->BlobConvolution( *desc.SimdConvolutionDesc, sourceRaw, filterRaw, freeTermRaw, resultRaw );
+		// The JIT code applies ReLU to the registers before storing them, the other activations are a separate pass
+		const bool isJitActivation = activation == AF_Linear || activation == AF_ReLU;
+		simdMathEngine->BlobConvolution( *desc.SimdConvolutionDesc, sourceRaw, filterRaw, freeTermRaw, resultRaw,
+			isJitActivation ? activation : AF_Linear, activationParam );
+		if( !isJitActivation ) {
+			applyActivationToResult();
+		}
 		return;
 	}
 
@@ -531,9 +888,9 @@ void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CF
 			const int64_t algo1DataSize = static_cast<int64_t>( desc.Result.Width() ) * desc.Result.Height() * desc.Filter.ObjectSize() + desc.Result.ObjectSize();
 
 			if( min( desc.Result.ObjectCount(), algo1ThreadCount ) * algo1DataSize <= algo0ThreadCount * BlobConvolutionCacheSize ) {
-				blobConvolutionForwardAlgo1( desc, sourceRaw, filterRaw, freeTerm, resultRaw );
+				blobConvolutionForwardAlgo1( desc, sourceRaw, filterRaw, freeTerm, resultRaw, activation, activationParam );
 			} else {
-				blobConvolutionForwardAlgo0( desc, sourceRaw, filterRaw, freeTerm, resultRaw );
+				blobConvolutionForwardAlgo0( desc, sourceRaw, filterRaw, freeTerm, resultRaw, activation, activationParam );
 			}
 			break;
 		}
@@ -542,14 +899,78 @@ void CCpuMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const CF
 				bool needsFlatten = desc.Source.Depth() != 1;
 
 				blob3dConvolution1x1x1( needsFlatten ? flatten( desc.Source ) : desc.Source, needsFlatten ? flatten( desc.Filter ) : desc.Filter,
-					desc.Result, desc.StrideHeight, desc.StrideWidth, 1, sourceRaw, filterRaw, freeTermRaw, resultRaw );
+					desc.Result, desc.StrideHeight, desc.StrideWidth, 1, sourceRaw, filterRaw, freeTermRaw, resultRaw,
+					activation, activationParam );
 				break;
 			}
+		case CA_Winograd:
+			blobConvolutionForwardWinograd( desc, sourceRaw, filterRaw, freeTermRaw, resultRaw, activation, activationParam );
+			break;
 		default:
 			ASSERT_EXPR( false );
 	}
 }
 
+void CCpuMathEngine::QuantizedBlobConvolution( const CConvolutionDesc& convDesc, const CConstFloatHandle& source,
+	float sourceScale, const CConstIntHandle& filter, const CConstFloatHandle& filterScales,
+	const CConstFloatHandle* freeTerm, const CFloatHandle& result )
+{
+	ASSERT_EXPR( sourceScale > 0 );
+
+	const CCpuConvolutionDesc& desc = static_cast<const CCpuConvolutionDesc&>( convDesc );
+	const float* sourceData = GetRaw( source );
+	const signed char* filterData = reinterpret_cast<const signed char*>( GetRaw( filter ) );
+	const float* filterScalesData = GetRaw( filterScales );
+	const float* freeTermData = freeTerm != nullptr ? GetRaw( *freeTerm ) : nullptr;
+	float* resultData = GetRaw( result );
+
+	// The same scheme as in blobConvolutionForwardAlgo0
+	// The temporary matrix is quantized before multiplying by the filter
+	const int filterObjectCount = desc.Filter.ObjectCount();
+	const int filterObjectSize = desc.Filter.ObjectSize();
+	const int quantizedRowSize = QuantizedMatrixRowSize( filterObjectSize );
+	const int resultItemCount = desc.Result.ObjectCount() * desc.Result.Width() * desc.Result.Height();
+	const int curThreadCount = IsOmpRelevant( resultItemCount, static_cast< int64_t >( desc.Result.BlobSize() ) * filterObjectSize ) ? threadCount : 1;
+	const int cacheItemCount = max( 1, min( ceilTo( BlobConvolutionCacheSize / filterObjectSize, 16 ), resultItemCount / curThreadCount ) );
+	const int threadTempSize = cacheItemCount * ( filterObjectSize + filterObjectCount );
+
+	CFloatHandleStackVar tempData( mathEngine(), curThreadCount * threadTempSize );
+	CIntHandleStackVar quantizedData( mathEngine(), curThreadCount * cacheItemCount * quantizedRowSize );
+	float* tempDataRaw = GetRaw( tempData.GetHandle() );
+	int* quantizedDataRaw = GetRaw( quantizedData.GetHandle() );
+
+	NEOML_OMP_NUM_THREADS( curThreadCount )
+	{
+		float* tempDataPtr = tempDataRaw + OmpGetThreadNum() * threadTempSize;
+		int* productPtr = reinterpret_cast<int*>( tempDataPtr + cacheItemCount * filterObjectSize );
+		signed char* quantizedDataPtr = reinterpret_cast<signed char*>( quantizedDataRaw
+			+ OmpGetThreadNum() * cacheItemCount * quantizedRowSize );
+
+		int start;
+		int count;
+		if( OmpGetTaskIndexAndCount( resultItemCount, start, count ) ) {
+			int index = 0;
+			while( index < count ) {
+				const int size = min( count - index, cacheItemCount );
+
+				fillTempData( sourceData, tempDataPtr, desc, start + index, size );
+				quantizeMatrix( tempDataPtr, size, filterObjectSize, filterObjectSize, sourceScale, quantizedDataPtr );
+
+				float* resultDataPtr = resultData + ( start + index ) * filterObjectCount;
+				multiplyQuantizedMatrixByTransposedMatrix( quantizedDataPtr, size, filterData, filterObjectCount,
+					quantizedRowSize * sizeof( int ), sourceScale, filterScalesData, productPtr, resultDataPtr );
+
+				if( freeTermData != nullptr ) {
+					addVectorToMatrixRows( resultDataPtr, resultDataPtr, size, filterObjectCount, filterObjectCount,
+						filterObjectCount, freeTermData );
+				}
+
+				index += size;
+			}
+		}
+	}
+}
+
 void CCpuMathEngine::backwardConvolutionAddFilterToOutput( const CCpuConvolutionDesc& desc, const CFloatHandle& temp,
 	const CFloatHandle* freeTermData, const CFloatHandle& outputData )
 {
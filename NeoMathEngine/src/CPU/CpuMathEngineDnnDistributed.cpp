@@ -45,6 +45,10 @@ void CMultiThreadDistributedCommunicator::barrier()
     }
 }
 
+// The chunks of the reduced data are aligned to the cache line so that the threads don't write to the same line
+static const int AllReduceChunkAlignment = 16;
+
+// Each thread reduces its own chunk of the data (reduce-scatter) and copies the result to all the threads (all-gather)
 void CMultiThreadDistributedCommunicator::AllReduce( const CFloatHandle& handle, int size )
 {
     collectHandles( handle );
@@ -53,18 +57,30 @@ void CMultiThreadDistributedCommunicator::AllReduce( const CFloatHandle& handle,
     barrier();
 
     int perThread = ( size + n_threads - 1 ) / n_threads;
-    float buf;
-    for( int i = thread * perThread; i < min( ( thread + 1 ) * perThread, size ); i++ ){
-        buf = 0;
+    perThread = ( perThread + AllReduceChunkAlignment - 1 ) / AllReduceChunkAlignment * AllReduceChunkAlignment;
+    const int start = min( thread * perThread, size );
+    const int count = min( perThread, size - start );
+    if( count > 0 ){
+        float* result = handles[thread] + start;
         for( int j = 0; j < n_threads; j++ ){
-            buf += handles[j][i];
+            if( j != thread ){
+                const float* other = handles[j] + start;
+                for( int i = 0; i < count; i++ ){
+                    result[i] += other[i];
+                }
+            }
+        }
+        const float multiplier = 1.f / n_threads;
+        for( int i = 0; i < count; i++ ){
+            result[i] *= multiplier;
         }
-        buf /= n_threads;
         for( int j = 0; j < n_threads; j++ ){
-            handles[j][i] = buf;
+            if( j != thread ){
+                memcpy( handles[j] + start, result, count * sizeof( float ) );
+            }
         }
     }
-    
+
     barrier();
 }
 
@@ -83,10 +99,15 @@ void CMultiThreadDistributedCommunicator::Broadcast( const CFloatHandle& handle,
 }
 
 void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count )
+{
+    CreateDistributedCpuMathEngines( mathEngines, count, 1 );
+}
+
+void CreateDistributedCpuMathEngines( IMathEngine** mathEngines, int count, int threadCount )
 {
     auto comm = std::make_shared<CMultiThreadDistributedCommunicator>( count );
     for( int i = 0; i < count; i++ ){
-        mathEngines[i] = CreateCpuMathEngine( 1, 0 );
+        mathEngines[i] = CreateCpuMathEngine( threadCount, 0 );
         static_cast<CCpuMathEngine*>( mathEngines[i] )->SetDistributedCommunicator( comm, {i, count} );
     }
 }
@@ -32,7 +32,8 @@ namespace NeoML {
 
 void CCpuMathEngine::blob3dConvolution1x1x1( const CBlobDesc& source, const CBlobDesc& filter, const CBlobDesc& result,
 	int strideHeight, int strideWidth, int strideDepth,
-	const float* sourceData, const float* filterData, const float* freeTermData, float* resultData )
+	const float* sourceData, const float* filterData, const float* freeTermData, float* resultData,
+	TActivationFunction activation, float activationParam )
 {
 	static constexpr int goodDenominatorFirst = 8;
 	static constexpr int goodDenominatorSecond = 12;
@@ -62,6 +63,7 @@ void CCpuMathEngine::blob3dConvolution1x1x1( const CBlobDesc& source, const CBlo
 						geomCount, channels, channels,
 						filterData, newChannels, channels,
 						outputDataPtr, newChannels);
+					applyConvolutionActivation( outputDataPtr, geomCount * newChannels, activation, activationParam );
 				}
 			}
 		} else {
@@ -87,6 +89,11 @@ void CCpuMathEngine::blob3dConvolution1x1x1( const CBlobDesc& source, const CBlo
 						geomSize, channels, channels,
 						filterData + channelStart * channels, channelCount, channels,
 						resultData + channelStart, newChannels);
+					if( activation != AF_Linear ) {
+						for( float* res = resultPtr; res < resultEnd; res += newChannels ) {
+							applyConvolutionActivation( res, channelCount, activation, activationParam );
+						}
+					}
 				}
 			}
 		}
@@ -125,6 +132,7 @@ void CCpuMathEngine::blob3dConvolution1x1x1( const CBlobDesc& source, const CBlo
 					geomCount, channels, channels,
 					filterData, newChannels, channels,
 					outputDataPtr, newChannels);
+				applyConvolutionActivation( outputDataPtr, geomCount * newChannels, activation, activationParam );
 			}
 		}
 	}
@@ -18,6 +18,7 @@ limitations under the License.
 #pragma once
 
 #include <NeoMathEngine/NeoMathEngineDefs.h>
+#include <NeoMathEngine/NeoMathEngine.h>
 
 #ifdef NEOML_USE_NEON
 
@@ -746,6 +747,133 @@ inline void vectorMinMax( const float* first, float* result, const float minValu
 	}
 }
 
+//------------------------------------------------------------------------------------------------------------
+// Adaptive gradient optimizers
+
+// The settings of CAdaptiveGradientStep in NEON registers
+struct CAdaptiveGradientStepNeon {
+	float32x4_t MomentDecayRate;
+	float32x4_t OpMomentDecayRate;
+	float32x4_t SecondMomentDecayRate;
+	float32x4_t OpSecondMomentDecayRate;
+	float32x4_t Epsilon;
+	float32x4_t GradientMult;
+	float32x4_t RegL1;
+	float32x4_t MinusRegL1;
+	float32x4_t RegL2;
+	float32x4_t GradientRegMult;
+	float32x4_t UpdateRegMult;
+	float32x4_t UpdateGradientMult;
+	float32x4_t UpdateMomentMult;
+	float32x4_t SecondMomentMult;
+	float32x4_t Rate;
+
+	explicit CAdaptiveGradientStepNeon( const CAdaptiveGradientStep& step ) :
+		MomentDecayRate( vdupq_n_f32( step.MomentDecayRate ) ),
+		OpMomentDecayRate( vdupq_n_f32( 1.f - step.MomentDecayRate ) ),
+		SecondMomentDecayRate( vdupq_n_f32( step.SecondMomentDecayRate ) ),
+		OpSecondMomentDecayRate( vdupq_n_f32( 1.f - step.SecondMomentDecayRate ) ),
+		Epsilon( vdupq_n_f32( step.Epsilon ) ),
+		GradientMult( vdupq_n_f32( step.GradientMult ) ),
+		RegL1( vdupq_n_f32( step.RegL1 ) ),
+		MinusRegL1( vdupq_n_f32( -step.RegL1 ) ),
+		RegL2( vdupq_n_f32( step.RegL2 ) ),
+		GradientRegMult( vdupq_n_f32( step.IsDecoupledWeightDecay ? 0.f : 1.f ) ),
+		UpdateRegMult( vdupq_n_f32( step.IsDecoupledWeightDecay ? 1.f : 0.f ) ),
+		UpdateGradientMult( vdupq_n_f32( step.UpdateGradientMult ) ),
+		UpdateMomentMult( vdupq_n_f32( step.UpdateMomentMult ) ),
+		SecondMomentMult( vdupq_n_f32( step.SecondMomentMult ) ),
+		Rate( vdupq_n_f32( step.Rate ) )
+	{
+	}
+};
+
+// Calculates the adaptive gradient step for 4 elements, returns the update
+// secondMomentMax is used only if useMax is true
+inline float32x4_t adaptiveGradientStepNeon( const CAdaptiveGradientStepNeon& step, const float32x4_t& diff,
+	const float32x4_t& param, float32x4_t& moment, float32x4_t& secondMoment, float32x4_t& secondMomentMax, bool useMax )
+{
+	// The regularization is added either to the gradient or to the update
+	const float32x4_t regularization = MultiplyAndAddNeon( vmaxq_f32( step.MinusRegL1, vminq_f32( step.RegL1, param ) ),
+		step.RegL2, param );
+	const float32x4_t gradient = MultiplyAndAddNeon( vmulq_f32( step.GradientMult, diff ),
+		step.GradientRegMult, regularization );
+
+	moment = MultiplyAndAddNeon( vmulq_f32( step.MomentDecayRate, moment ), step.OpMomentDecayRate, gradient );
+	secondMoment = MultiplyAndAddNeon( vmulq_f32( step.SecondMomentDecayRate, secondMoment ),
+		step.OpSecondMomentDecayRate, vmulq_f32( gradient, gradient ) );
+	float32x4_t denominator = secondMoment;
+	if( useMax ) {
+		secondMomentMax = vmaxq_f32( secondMomentMax, secondMoment );
+		denominator = secondMomentMax;
+	}
+	CSqrtNeon sqrtObj;
+	denominator = vaddq_f32( sqrtObj.Execute( vmulq_f32( step.SecondMomentMult, denominator ) ), step.Epsilon );
+
+	const float32x4_t numerator = MultiplyAndAddNeon( vmulq_f32( step.UpdateGradientMult, gradient ),
+		step.UpdateMomentMult, moment );
+	return MultiplyAndAddNeon( DivideNeon( numerator, denominator ), step.UpdateRegMult, regularization );
+}
+
+// The adaptive gradient step for a part of a parameter blob (see IDnnEngine::AdaptiveGradientStep)
+// secondMomentMax and update may be null
+inline void vectorAdaptiveGradientStep( const CAdaptiveGradientStep& step, const float* diff, float* param,
+	float* moment, float* secondMoment, float* secondMomentMax, float* update, int vectorSize )
+{
+	const CAdaptiveGradientStepNeon neonStep( step );
+	const bool useMax = secondMomentMax != nullptr;
+	float32x4_t secondMomentMaxNeon = vdupq_n_f32( 0.f );
+
+	int count = GetCount4( vectorSize );
+	for( int i = 0; i < count; ++i ) {
+		const float32x4_t paramNeon = LoadNeon4( param );
+		float32x4_t momentNeon = LoadNeon4( moment );
+		float32x4_t secondMomentNeon = LoadNeon4( secondMoment );
+		if( useMax ) {
+			secondMomentMaxNeon = LoadNeon4( secondMomentMax );
+		}
+		const float32x4_t updateNeon = adaptiveGradientStepNeon( neonStep, LoadNeon4( diff ), paramNeon,
+			momentNeon, secondMomentNeon, secondMomentMaxNeon, useMax );
+		StoreNeon4( momentNeon, moment );
+		StoreNeon4( secondMomentNeon, secondMoment );
+		if( useMax ) {
+			StoreNeon4( secondMomentMaxNeon, secondMomentMax );
+			secondMomentMax += 4;
+		}
+		if( update != nullptr ) {
+			StoreNeon4( updateNeon, update );
+			update += 4;
+		} else {
+			StoreNeon4( MultiplyAndAddNeon( paramNeon, neonStep.Rate, updateNeon ), param );
+		}
+		diff += 4;
+		param += 4;
+		moment += 4;
+		secondMoment += 4;
+	}
+
+	if( vectorSize > 0 ) {
+		const float32x4_t paramNeon = LoadNeon( param, vectorSize );
+		float32x4_t momentNeon = LoadNeon( moment, vectorSize );
+		float32x4_t secondMomentNeon = LoadNeon( secondMoment, vectorSize );
+		if( useMax ) {
+			secondMomentMaxNeon = LoadNeon( secondMomentMax, vectorSize );
+		}
+		const float32x4_t updateNeon = adaptiveGradientStepNeon( neonStep, LoadNeon( diff, vectorSize ), paramNeon,
+			momentNeon, secondMomentNeon, secondMomentMaxNeon, useMax );
+		StoreNeon( momentNeon, moment, vectorSize );
+		StoreNeon( secondMomentNeon, secondMoment, vectorSize );
+		if( useMax ) {
+			StoreNeon( secondMomentMaxNeon, secondMomentMax, vectorSize );
+		}
+		if( update != nullptr ) {
+			StoreNeon( updateNeon, update, vectorSize );
+		} else {
+			StoreNeon( MultiplyAndAddNeon( paramNeon, neonStep.Rate, updateNeon ), param, vectorSize );
+		}
+	}
+}
+
 } // namespace NeoML
 
 #endif
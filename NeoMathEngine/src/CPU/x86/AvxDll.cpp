@@ -23,6 +23,7 @@ limitations under the License.
 #include <AvxDll.h>
 #include <CPUInfo.h>
 
+#include <cstdlib>
 #include <string>
 
 static std::string getModuleDir()
@@ -137,7 +138,10 @@ bool CAvxDll::isAvxAvailable()
 	return false;
 #endif
 
-	static bool res = CCPUInfo::IsAvxAndFmaAvailable() && !CCPUInfo::IsAvx512Available();
+	// The DLL isn't used on the AVX-512 hosts unless NEOML_ENABLE_AVX512 is set
+	// Its AVX-512 code paths are chosen in runtime (see NEOML_DISABLE_AVX512)
+	static bool res = CCPUInfo::IsAvxAndFmaAvailable()
+		&& ( !CCPUInfo::IsAvx512Available() || getenv( "NEOML_ENABLE_AVX512" ) != nullptr );
 	return res;
 }
 
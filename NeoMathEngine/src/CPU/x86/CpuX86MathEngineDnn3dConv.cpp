@@ -33,7 +33,8 @@ namespace NeoML {
 
 void CCpuMathEngine::blob3dConvolution1x1x1(  const CBlobDesc& source, const CBlobDesc& filter, const CBlobDesc& result,
 	int strideHeight, int strideWidth, int strideDepth,
-	const float* sourceData, const float* filterData, const float* freeTermData, float* resultData )
+	const float* sourceData, const float* filterData, const float* freeTermData, float* resultData,
+	TActivationFunction activation, float activationParam )
 {
 	static constexpr int goodDenominatorFirst = 2;
 	static constexpr int goodDenominatorSecond = 2;
@@ -63,6 +64,7 @@ void CCpuMathEngine::blob3dConvolution1x1x1(  const CBlobDesc& source, const CBl
 						geomCount, channels, channels,
 						filterData, newChannels, channels,
 						outputDataPtr, newChannels);
+					applyConvolutionActivation( outputDataPtr, geomCount * newChannels, activation, activationParam );
 				}
 			}
 		} else {
@@ -88,6 +90,11 @@ void CCpuMathEngine::blob3dConvolution1x1x1(  const CBlobDesc& source, const CBl
 						geomSize, channels, channels,
 						filterData + channelStart * channels, channelCount, channels,
 						resultData + channelStart, newChannels);
+					if( activation != AF_Linear ) {
+						for( float* res = resultPtr; res < resultEnd; res += newChannels ) {
+							applyConvolutionActivation( res, channelCount, activation, activationParam );
+						}
+					}
 				}
 			}
 		}
@@ -126,6 +133,7 @@ void CCpuMathEngine::blob3dConvolution1x1x1(  const CBlobDesc& source, const CBl
 					geomCount, channels, channels,
 					filterData, newChannels, channels,
 					outputDataPtr, newChannels);
+				applyConvolutionActivation( outputDataPtr, geomCount * newChannels, activation, activationParam );
 		}
 	}
 }
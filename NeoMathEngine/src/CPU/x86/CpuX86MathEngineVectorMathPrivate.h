@@ -18,6 +18,7 @@ limitations under the License.
 #pragma once
 
 #include <NeoMathEngine/NeoMathEngineDefs.h>
+#include <NeoMathEngine/NeoMathEngine.h>
 
 #ifdef NEOML_USE_SSE
 
@@ -884,6 +885,135 @@ inline void vectorMinMax( const float* first, float* result, const float minValu
 	}
 }
 
+//------------------------------------------------------------------------------------------------------------
+// Adaptive gradient optimizers
+
+// The settings of CAdaptiveGradientStep in SSE registers
+struct CAdaptiveGradientStepSse {
+	__m128 MomentDecayRate;
+	__m128 OpMomentDecayRate;
+	__m128 SecondMomentDecayRate;
+	__m128 OpSecondMomentDecayRate;
+	__m128 Epsilon;
+	__m128 GradientMult;
+	__m128 RegL1;
+	__m128 MinusRegL1;
+	__m128 RegL2;
+	__m128 GradientRegMult;
+	__m128 UpdateRegMult;
+	__m128 UpdateGradientMult;
+	__m128 UpdateMomentMult;
+	__m128 SecondMomentMult;
+	__m128 Rate;
+
+	explicit CAdaptiveGradientStepSse( const CAdaptiveGradientStep& step ) :
+		MomentDecayRate( _mm_set_ps1( step.MomentDecayRate ) ),
+		OpMomentDecayRate( _mm_set_ps1( 1.f - step.MomentDecayRate ) ),
+		SecondMomentDecayRate( _mm_set_ps1( step.SecondMomentDecayRate ) ),
+		OpSecondMomentDecayRate( _mm_set_ps1( 1.f - step.SecondMomentDecayRate ) ),
+		Epsilon( _mm_set_ps1( step.Epsilon ) ),
+		GradientMult( _mm_set_ps1( step.GradientMult ) ),
+		RegL1( _mm_set_ps1( step.RegL1 ) ),
+		MinusRegL1( _mm_set_ps1( -step.RegL1 ) ),
+		RegL2( _mm_set_ps1( step.RegL2 ) ),
+		GradientRegMult( _mm_set_ps1( step.IsDecoupledWeightDecay ? 0.f : 1.f ) ),
+		UpdateRegMult( _mm_set_ps1( step.IsDecoupledWeightDecay ? 1.f : 0.f ) ),
+		UpdateGradientMult( _mm_set_ps1( step.UpdateGradientMult ) ),
+		UpdateMomentMult( _mm_set_ps1( step.UpdateMomentMult ) ),
+		SecondMomentMult( _mm_set_ps1( step.SecondMomentMult ) ),
+		Rate( _mm_set_ps1( step.Rate ) )
+	{
+	}
+};
+
+// Calculates the adaptive gradient step for 4 elements, returns the update
+// secondMomentMax is used only if useMax is true
+inline __m128 adaptiveGradientStepSse( const CAdaptiveGradientStepSse& step, const __m128& diff, const __m128& param,
+	__m128& moment, __m128& secondMoment, __m128& secondMomentMax, bool useMax )
+{
+	// The regularization is added either to the gradient or to the update
+	const __m128 regularization = _mm_add_ps( _mm_mul_ps( step.RegL2, param ),
+		_mm_min_ps( _mm_max_ps( param, step.MinusRegL1 ), step.RegL1 ) );
+	const __m128 gradient = _mm_add_ps( _mm_mul_ps( step.GradientMult, diff ),
+		_mm_mul_ps( step.GradientRegMult, regularization ) );
+
+	moment = _mm_add_ps( _mm_mul_ps( step.MomentDecayRate, moment ), _mm_mul_ps( step.OpMomentDecayRate, gradient ) );
+	secondMoment = _mm_add_ps( _mm_mul_ps( step.SecondMomentDecayRate, secondMoment ),
+		_mm_mul_ps( step.OpSecondMomentDecayRate, _mm_mul_ps( gradient, gradient ) ) );
+	__m128 denominator = secondMoment;
+	if( useMax ) {
+		secondMomentMax = _mm_max_ps( secondMomentMax, secondMoment );
+		denominator = secondMomentMax;
+	}
+	denominator = _mm_add_ps( _mm_sqrt_ps( _mm_mul_ps( step.SecondMomentMult, denominator ) ), step.Epsilon );
+
+	const __m128 numerator = _mm_add_ps( _mm_mul_ps( step.UpdateGradientMult, gradient ),
+		_mm_mul_ps( step.UpdateMomentMult, moment ) );
+	return _mm_add_ps( _mm_div_ps( numerator, denominator ), _mm_mul_ps( step.UpdateRegMult, regularization ) );
+}
+
+// The adaptive gradient step for a part of a parameter blob (see IDnnEngine::AdaptiveGradientStep)
+// secondMomentMax and update may be null
+inline void vectorAdaptiveGradientStep( const CAdaptiveGradientStep& step, const float* diff, float* param,
+	float* moment, float* secondMoment, float* secondMomentMax, float* update, int vectorSize )
+{
+	const CAdaptiveGradientStepSse sseStep( step );
+	const bool useMax = secondMomentMax != nullptr;
+	__m128 secondMomentMaxSse = _mm_setzero_ps();
+
+	int sseSize;
+	int nonSseSize;
+	checkSse( vectorSize, sseSize, nonSseSize );
+
+	for( int i = 0; i < sseSize; ++i ) {
+		const __m128 paramSse = _mm_loadu_ps( param );
+		__m128 momentSse = _mm_loadu_ps( moment );
+		__m128 secondMomentSse = _mm_loadu_ps( secondMoment );
+		if( useMax ) {
+			secondMomentMaxSse = _mm_loadu_ps( secondMomentMax );
+		}
+		const __m128 updateSse = adaptiveGradientStepSse( sseStep, _mm_loadu_ps( diff ), paramSse,
+			momentSse, secondMomentSse, secondMomentMaxSse, useMax );
+		_mm_storeu_ps( moment, momentSse );
+		_mm_storeu_ps( secondMoment, secondMomentSse );
+		if( useMax ) {
+			_mm_storeu_ps( secondMomentMax, secondMomentMaxSse );
+			secondMomentMax += 4;
+		}
+		if( update != nullptr ) {
+			_mm_storeu_ps( update, updateSse );
+			update += 4;
+		} else {
+			_mm_storeu_ps( param, _mm_add_ps( paramSse, _mm_mul_ps( sseStep.Rate, updateSse ) ) );
+		}
+		diff += 4;
+		param += 4;
+		moment += 4;
+		secondMoment += 4;
+	}
+
+	if( nonSseSize > 0 ) {
+		const __m128 paramSse = LoadSse( param, nonSseSize );
+		__m128 momentSse = LoadSse( moment, nonSseSize );
+		__m128 secondMomentSse = LoadSse( secondMoment, nonSseSize );
+		if( useMax ) {
+			secondMomentMaxSse = LoadSse( secondMomentMax, nonSseSize );
+		}
+		const __m128 updateSse = adaptiveGradientStepSse( sseStep, LoadSse( diff, nonSseSize ), paramSse,
+			momentSse, secondMomentSse, secondMomentMaxSse, useMax );
+		StoreSse( momentSse, moment, nonSseSize );
+		StoreSse( secondMomentSse, secondMoment, nonSseSize );
+		if( useMax ) {
+			StoreSse( secondMomentMaxSse, secondMomentMax, nonSseSize );
+		}
+		if( update != nullptr ) {
+			StoreSse( updateSse, update, nonSseSize );
+		} else {
+			StoreSse( _mm_add_ps( paramSse, _mm_mul_ps( sseStep.Rate, updateSse ) ), param, nonSseSize );
+		}
+	}
+}
+
 } // namespace NeoML
 
 #endif
@@ -17,6 +17,14 @@ limitations under the License.
 
 #include <immintrin.h>
 
+// The DLL is compiled for AVX, the functions with this attribute may use AVX-512F
+// They may only be called if the CPU supports it (see CCPUInfo::IsAvx512Available)
+#if defined( __GNUC__ ) || defined( __clang__ )
+#define AVX512_TARGET __attribute__( ( target( "avx512f" ) ) )
+#else
+#define AVX512_TARGET
+#endif
+
 #define PERMUTE2( p1, p0 ) ( ( p0 << 0 ) + ( p1 << 4 ) )
 #define PERMUTE4( p3, p2, p1, p0 ) ( ( p0 << 0 ) + ( p1 << 2 ) + ( p2 << 4 ) + ( p3 << 6 ) )
 #define PERMUTE8( p7, p6, p5, p4, p3, p2, p1, p0 ) _mm256_set_epi32( p7, p6, p5, p4, p3, p2, p1, p0 )
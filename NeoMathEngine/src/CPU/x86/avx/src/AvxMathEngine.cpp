@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <NeoMathEngine/SimdMathEngine.h>
 #include <BlobConvolution.h>
+#include <CPUInfo.h>
 
 namespace NeoML {
 
@@ -28,64 +29,106 @@ void AvxMultiplyMatrix( bool transA, bool transB,
 	float* cPtr, size_t cRowSize,
 	size_t m, size_t n, size_t k );
 
+void Avx512MultiplyMatrix( bool transA, bool transB,
+	IMathEngine *engine,
+	const float* aPtr, size_t aRowSize,
+	const float* bPtr, size_t bRowSize,
+	float* cPtr, size_t cRowSize,
+	size_t m, size_t n, size_t k );
+
+void AvxMultiplyQuantizedMatrix( const signed char* aPtr, size_t aHeight,
+	const signed char* bPtr, size_t bHeight, size_t rowSize,
+	int* cPtr, size_t cRowSize );
+
 struct CAvxConvolutionDesc : public CConvolutionDesc {
 	~CAvxConvolutionDesc() override {}
 
 	CAvxConvolutionDesc( IMathEngine* mathEngine, const CBlobDesc& source, const CBlobDesc& result, const CBlobDesc& filter,
-		int paddingHeight, int paddingWidth, int strideHeight, int strideWidth, int dilationHeight, int dilationWidth );
+		int paddingHeight, int paddingWidth, int strideHeight, int strideWidth, int dilationHeight, int dilationWidth,
+		bool useAvx512 );
 
 	std::unique_ptr<CBlobConvolutionBase> BlobConvolution;
 };
 
 CAvxConvolutionDesc::CAvxConvolutionDesc( IMathEngine* mathEngine, const CBlobDesc& source, const CBlobDesc& result, const CBlobDesc& filter,
-	int paddingHeight, int paddingWidth, int strideHeight, int strideWidth, int dilationHeight, int dilationWidth ) :
+	int paddingHeight, int paddingWidth, int strideHeight, int strideWidth, int dilationHeight, int dilationWidth,
+	bool useAvx512 ) :
 	BlobConvolution( CBlobConvolutionFabric::GetProperInstance( mathEngine,
 		filter.BatchWidth(), filter.Channels() * filter.Depth(), filter.Height(), filter.Width(), source.Height(), source.Width(), 
 		paddingHeight, paddingWidth, strideHeight, strideWidth,
-		dilationHeight, dilationWidth, result.Height(), result.Width(), result.ObjectCount() ) )
+		dilationHeight, dilationWidth, result.Height(), result.Width(), result.ObjectCount(), useAvx512 ) )
 {
 }
 
 class CAvxMathEngine : public ISimdMathEngine {
 public:
-	CAvxMathEngine( IMathEngine* _mathEngine, int _threadCount ) : mathEngine( _mathEngine ), threadCount( _threadCount ) {}
+	CAvxMathEngine( IMathEngine* _mathEngine, int _threadCount );
 
 	CConvolutionDesc* InitBlobConvolution( const CBlobDesc& source, int paddingHeight, int paddingWidth,
 		int strideHeight, int strideWidth, int dilationHeight, int dilationWidth, const CBlobDesc& filter,
 		const CBlobDesc& result ) const override;
 
 	void BlobConvolution( const CConvolutionDesc& convDesc, const float* source,
-		const float* filter, const float* freeTerm, float* result ) const override;
+		const float* filter, const float* freeTerm, float* result,
+		TActivationFunction activation, float activationParam ) const override;
 
 	SgemmFunc GetSgemmFunction() const override;
 
+	QuantizedGemmFunc GetQuantizedGemmFunction() const override;
+
 private:
 	IMathEngine* mathEngine;
 	int threadCount;
+	// The AVX-512 code is used for the matrix multiplication and the convolutions
+	bool useAvx512;
+	// The generic JIT convolution is used for the filter counts without the specialized code
+	bool useGenericConvolution;
 };
 
+CAvxMathEngine::CAvxMathEngine( IMathEngine* _mathEngine, int _threadCount ) :
+	mathEngine( _mathEngine ),
+	threadCount( _threadCount ),
+	// The NEOML_DISABLE_AVX512 environment variable falls back to the AVX code (used for the benchmarks)
+	// It is checked for each new math engine
+	useAvx512( CCPUInfo::IsAvx512Available() && getenv( "NEOML_DISABLE_AVX512" ) == nullptr ),
+	// The NEOML_DISABLE_GENERIC_CONVOLUTION environment variable falls back to the matrix multiplication
+	useGenericConvolution( getenv( "NEOML_DISABLE_GENERIC_CONVOLUTION" ) == nullptr )
+{
+}
+
 CConvolutionDesc* CAvxMathEngine::InitBlobConvolution( const CBlobDesc& source, int paddingHeight, int paddingWidth,
 	int strideHeight, int strideWidth, int dilationHeight, int dilationWidth, const CBlobDesc& filter,
 	const CBlobDesc& result ) const
 {
-	if( CBlobConvolutionFabric::IsBlobConvolutionAvailable( filter.BatchWidth() , filter.Height(), filter.Width() ) ) {
-		return new CAvxConvolutionDesc( mathEngine, source, result, filter, paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth );
+	if( CBlobConvolutionFabric::IsBlobConvolutionAvailable( filter.BatchWidth() , filter.Height(), filter.Width() )
+		|| ( useGenericConvolution && CBlobConvolutionFabric::IsGenericBlobConvolutionAvailable( filter.BatchWidth(),
+			filter.Height(), filter.Width(), filter.Channels() * filter.Depth() ) ) )
+	{
+		return new CAvxConvolutionDesc( mathEngine, source, result, filter, paddingHeight, paddingWidth, strideHeight, strideWidth, dilationHeight, dilationWidth,
+			useAvx512 );
 	}
 	return nullptr;
 }
 
 void CAvxMathEngine::BlobConvolution( const CConvolutionDesc& convDesc, const float* source,
-	const float* filter, const float* freeTerm, float* result ) const
+	const float* filter, const float* freeTerm, float* result,
+	TActivationFunction activation, float activationParam ) const
 {
 	const CAvxConvolutionDesc& desc = static_cast<const CAvxConvolutionDesc&>( convDesc );
 	
-	desc.BlobConvolution->ProcessConvolution( threadCount, source, filter, freeTerm, result );
+	desc.BlobConvolution->ProcessConvolution( threadCount, source, filter, freeTerm, result, activation, activationParam );
 
 }
 
 SgemmFunc CAvxMathEngine::GetSgemmFunction() const
 {
-	return AvxMultiplyMatrix;
+	return useAvx512 ? Avx512MultiplyMatrix : AvxMultiplyMatrix;
+}
+
+QuantizedGemmFunc CAvxMathEngine::GetQuantizedGemmFunction() const
+{
+	static const bool isAvx2Available = CCPUInfo::IsAvx2Available();
+	return isAvx2Available ? AvxMultiplyQuantizedMatrix : nullptr;
 }
 
 extern "C"
@@ -0,0 +1,113 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <common.h>
+#pragma hdrstop
+
+#include <NeoMathEngine/SimdMathEngine.h>
+
+namespace NeoML {
+
+// This file is compiled with AVX2 enabled; the functions may only be called if the CPU supports it
+
+static inline int horizontalSum( __m256i acc )
+{
+	__m128i sum = _mm_add_epi32( _mm256_castsi256_si128( acc ), _mm256_extracti128_si256( acc, 1 ) );
+	sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtsi128_si32( sum );
+}
+
+// Loads 16 signed 8-bit values extended to 16 bits
+static inline __m256i load16( const signed char* ptr )
+{
+	return _mm256_cvtepi8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( ptr ) ) );
+}
+
+// Calculates the 2 * 4 block of the result
+// The values are extended to 16 bits and multiplied with vpmaddwd, so the sums don't saturate
+static inline void multiplyBlock2x4( const signed char* a, const signed char* b, size_t rowSize, int* c, size_t cRowSize )
+{
+	__m256i acc00 = _mm256_setzero_si256();
+	__m256i acc01 = _mm256_setzero_si256();
+	__m256i acc02 = _mm256_setzero_si256();
+	__m256i acc03 = _mm256_setzero_si256();
+	__m256i acc10 = _mm256_setzero_si256();
+	__m256i acc11 = _mm256_setzero_si256();
+	__m256i acc12 = _mm256_setzero_si256();
+	__m256i acc13 = _mm256_setzero_si256();
+	for( size_t k = 0; k < rowSize; k += 16 ) {
+		const __m256i a0 = load16( a + k );
+		const __m256i a1 = load16( a + rowSize + k );
+		const __m256i b0 = load16( b + k );
+		const __m256i b1 = load16( b + rowSize + k );
+		const __m256i b2 = load16( b + 2 * rowSize + k );
+		const __m256i b3 = load16( b + 3 * rowSize + k );
+		acc00 = _mm256_add_epi32( acc00, _mm256_madd_epi16( a0, b0 ) );
+		acc01 = _mm256_add_epi32( acc01, _mm256_madd_epi16( a0, b1 ) );
+		acc02 = _mm256_add_epi32( acc02, _mm256_madd_epi16( a0, b2 ) );
+		acc03 = _mm256_add_epi32( acc03, _mm256_madd_epi16( a0, b3 ) );
+		acc10 = _mm256_add_epi32( acc10, _mm256_madd_epi16( a1, b0 ) );
+		acc11 = _mm256_add_epi32( acc11, _mm256_madd_epi16( a1, b1 ) );
+		acc12 = _mm256_add_epi32( acc12, _mm256_madd_epi16( a1, b2 ) );
+		acc13 = _mm256_add_epi32( acc13, _mm256_madd_epi16( a1, b3 ) );
+	}
+	c[0] = horizontalSum( acc00 );
+	c[1] = horizontalSum( acc01 );
+	c[2] = horizontalSum( acc02 );
+	c[3] = horizontalSum( acc03 );
+	c[cRowSize] = horizontalSum( acc10 );
+	c[cRowSize + 1] = horizontalSum( acc11 );
+	c[cRowSize + 2] = horizontalSum( acc12 );
+	c[cRowSize + 3] = horizontalSum( acc13 );
+}
+
+// Calculates one element of the result
+static inline int multiplyRows( const signed char* a, const signed char* b, size_t rowSize )
+{
+	__m256i acc = _mm256_setzero_si256();
+	for( size_t k = 0; k < rowSize; k += 16 ) {
+		acc = _mm256_add_epi32( acc, _mm256_madd_epi16( load16( a + k ), load16( b + k ) ) );
+	}
+	return horizontalSum( acc );
+}
+
+void AvxMultiplyQuantizedMatrix( const signed char* aPtr, size_t aHeight,
+	const signed char* bPtr, size_t bHeight, size_t rowSize,
+	int* cPtr, size_t cRowSize )
+{
+	const size_t aBlockHeight = aHeight / 2 * 2;
+	const size_t bBlockHeight = bHeight / 4 * 4;
+	for( size_t i = 0; i < aBlockHeight; i += 2 ) {
+		const signed char* a = aPtr + i * rowSize;
+		int* c = cPtr + i * cRowSize;
+		for( size_t j = 0; j < bBlockHeight; j += 4 ) {
+			multiplyBlock2x4( a, bPtr + j * rowSize, rowSize, c + j, cRowSize );
+		}
+		for( size_t j = bBlockHeight; j < bHeight; j++ ) {
+			c[j] = multiplyRows( a, bPtr + j * rowSize, rowSize );
+			c[cRowSize + j] = multiplyRows( a + rowSize, bPtr + j * rowSize, rowSize );
+		}
+	}
+	if( aBlockHeight < aHeight ) {
+		const signed char* a = aPtr + aBlockHeight * rowSize;
+		int* c = cPtr + aBlockHeight * cRowSize;
+		for( size_t j = 0; j < bHeight; j++ ) {
+			c[j] = multiplyRows( a, bPtr + j * rowSize, rowSize );
+		}
+	}
+}
+
+} // namespace NeoML
@@ -31,7 +31,9 @@ using reg64_t = Xbyak::Reg64;
 class CBlobConvolutionBase : public CCrtAllocatedObject {
 public:
     virtual ~CBlobConvolutionBase() = default;
-    virtual void ProcessConvolution( int threadCount, const float* sourceData, const float* filterData, const float* freeTermData, float* resultData ) = 0;
+    // Only AF_Linear and AF_ReLU activations are supported, activationParam is the ReLU upper threshold (0 means no threshold)
+    virtual void ProcessConvolution( int threadCount, const float* sourceData, const float* filterData, const float* freeTermData,
+        float* resultData, TActivationFunction activation, float activationParam ) = 0;
 };
 
 template<int FltCnt>
@@ -41,11 +43,12 @@ public:
         IMathEngine* mathEngine,
         int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
         int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
-        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt );
+        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, bool useAvx512 );
     ~CBlobConvolution() override = default;
 
     void ProcessConvolution( int threadCount,
-        const float* sourceData, const float* filterData, const float* freeTermData, float* resultData ) override;
+        const float* sourceData, const float* filterData, const float* freeTermData, float* resultData,
+        TActivationFunction activation, float activationParam ) override;
 
 private:
     struct CSize {
@@ -57,6 +60,8 @@ private:
     static const int WideBatchKernelWidth;
     static const int NarrowBatchKernelHeight;
     static const int NarrowBatchKernelWidth;
+    // The width of the batch processing with the zmm registers, 0 if there is no AVX-512 code for this filter count
+    static const int Avx512WideBatchKernelWidth;
 
     // Class wich handles generation and running JIT code for convolution.
     class CJitConvolution : public Xbyak::CodeGenerator {
@@ -68,7 +73,16 @@ private:
 
         static constexpr unsigned int NumFloatInYmm = 8;
         static constexpr unsigned int SizeOfYmm = NumFloatInYmm * sizeof( float );
+        static constexpr unsigned int NumFloatInZmm = 16;
+        static constexpr unsigned int SizeOfZmm = NumFloatInZmm * sizeof( float );
     private:
+        // The code uses zmm registers instead of ymm (see CBlobConvolution::UseAvx512)
+        const bool useZmm;
+        const unsigned int numFloatInVector;
+        // The constants used by the activation (see fillActivationConstants)
+        Xbyak::Label labelActivationZero;
+        Xbyak::Label labelActivationThreshold;
+
         // Passed to 'Run()' function as arguments
         const reg64_t regUseNarrowProcessing = Param1;
         const reg64_t regSrcPtr = Param2;
@@ -99,6 +113,11 @@ private:
 
         // Initialize result registers with data from freeTerm (if it isn't nullptr)
         void initResRegs( size_t stepCount, size_t stepSize );
+        // Apply the activation to the result registers before flushing
+        // Memory operands are used for the constants because all the registers may be occupied by the result
+        void applyActivation( CBlobConvolution<FltCnt>& bc, size_t regCount );
+        // Emit the constants of the activation once after the code of the kernel
+        void fillActivationConstants( CBlobConvolution<FltCnt>& bc );
         // Flush result registers
         // 'fillKernel' will be called for filling of kernel in main loop
         // 'callBeforeFlush' will be called before flushing of result registers. It can be captured labda function.
@@ -108,6 +127,10 @@ private:
             size_t windowIndex, bool useNarrowProcessing = false, std::function<void()>* callBeforeFlush = nullptr );
 
         void circularShift( Xbyak::Ymm* dst, Xbyak::Ymm* src, Xbyak::Ymm* temp = nullptr ) {}
+
+        // The vector register of the size used by the code
+        Xbyak::Xmm vectorReg( int index ) const
+            { return useZmm ? Xbyak::Xmm( Xbyak::Zmm( index ) ) : Xbyak::Xmm( Xbyak::Ymm( index ) ); }
     };
 
     IMathEngine* mathEngine;
@@ -126,7 +149,12 @@ private:
     const int ResH;
     const int ResW;
     const int ResObjCnt;
+    // The JIT code uses the AVX-512 instructions
+    const bool UseAvx512;
     bool jitIsInited;
+    // The activation which is compiled into the JIT code
+    TActivationFunction activation;
+    float reluThreshold;
 
     // For some cases we will use FltCnt, rounded up to nearest integer multiple of 8
     static constexpr int FltCntM8 = ( FltCnt + 8 - 1 ) / 8 * 8;
@@ -197,14 +225,177 @@ const int CBlobConvolution<FltCnt>::NarrowBatchKernelHeight = INT_MAX;
 template<int FltCnt>
 const int CBlobConvolution<FltCnt>::NarrowBatchKernelWidth = INT_MAX;
 
+template<int FltCnt>
+const int CBlobConvolution<FltCnt>::Avx512WideBatchKernelWidth = 0;
+
+// The convolution for any filter count, filter size, stride and dilation
+// The filters are split into the blocks of several vector registers. The JIT code calculates one block
+// for several neighboring result pixels at once; the last vector of the last block is stored by mask.
+// The JIT code processes a chunk of the result pixels: a row, or several rows if they may be processed as one
+// (the 1x1 convolutions with stride 1). The padding is never read: the filter rows outside the source are skipped
+// by the caller, the result pixels near the left and right borders are calculated one by one over the filter columns
+// inside the source
+class CBlobConvolutionGeneric : public CBlobConvolutionBase {
+public:
+    CBlobConvolutionGeneric(
+        IMathEngine* mathEngine, int filterCount,
+        int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
+        int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
+        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, bool useAvx512 );
+    ~CBlobConvolutionGeneric() override = default;
+
+    void ProcessConvolution( int threadCount,
+        const float* sourceData, const float* filterData, const float* freeTermData, float* resultData,
+        TActivationFunction activation, float activationParam ) override;
+
+private:
+    // The filters processed together
+    struct CFilterBlock {
+        // The index of the first filter of the block
+        int Offset;
+        // The number of vector registers for one result pixel
+        int VectorCount;
+        // The maximum number of result pixels processed at once
+        int PixelCount;
+    };
+
+    // Generates and runs the code which calculates a chunk of the result
+    // There is a separate function for each filter block
+    class CJitConvolution : public Xbyak::CodeGenerator {
+    public:
+        CJitConvolution( const CBlobConvolutionGeneric& bc, int chunkSize );
+
+        // srcPtr points to the beginning of the source row under the first filter row of the chunk,
+        // fltPtr points to that filter row of the block, filterRowCount rows are processed
+        void Run( int blockIndex, int filterRowCount, const float* srcPtr, const float* fltPtr,
+            const float* freeTermPtr, float* resPtr );
+
+    private:
+        // The loop over channels for one filter pixel, shared by all the kernels of the same size
+        struct CChannelLoop {
+            int PixelCount;
+            int VectorCount;
+            Xbyak::Label Label;
+        };
+
+        const CBlobConvolutionGeneric& bc;
+        const bool useZmm;
+        const int vectorRegCount;
+        const int chunkSize;
+        // The offsets of the functions for the filter blocks, one for each number of the filter rows
+        std::vector<std::vector<size_t>> blockCodeOffsets;
+        std::vector<std::unique_ptr<CChannelLoop>> channelLoops;
+        // The mask for the store of the last vector (ymm only), the ReLU threshold
+        Xbyak::Label labelStoreMask;
+        Xbyak::Label labelThreshold;
+
+        // Passed to 'Run()' function as arguments
+        const reg64_t regSrcPtr = Param1;
+        const reg64_t regFltPtr = Param2;
+        const reg64_t regFreeTermPtr = Param3;
+        const reg64_t regResPtr = Param4;
+
+        // Used in kernels:
+        const reg64_t regTempSrcPtr = Xbyak::util::r10;
+        const reg64_t regTempFltPtr = Xbyak::util::r11;
+        const reg64_t regNumSteps = Xbyak::util::r12;
+        const reg64_t regChCnt = Xbyak::util::rax;
+        // The loop over the filter rows
+        const reg64_t regFltRowCount = Xbyak::util::r13;
+        const reg64_t regFltRowCounter = Xbyak::util::r14;
+        const reg64_t regRowSrcPtr = Xbyak::util::r15;
+        const reg64_t regRowFltPtr = Xbyak::util::rbx;
+
+        void prologue();
+        void epilogue();
+        // Calculates the chunk for the filter block
+        void fillBlock( const CFilterBlock& block );
+        // Calculates pixelCount result pixels of the filter block over the filter columns [firstColumn, lastColumn)
+        // srcOffset and resOffset are the offsets in floats of the first pixel from regSrcPtr and regResPtr
+        void fillKernel( const CFilterBlock& block, int pixelCount, int srcOffset, int resOffset,
+            int firstColumn, int lastColumn );
+        void fillChannelLoop( CChannelLoop& loop );
+        Xbyak::Label& getChannelLoop( int pixelCount, int vectorCount );
+        void applyActivation( int regCount, int zeroRegIndex, int thresholdRegIndex );
+        void fillConstants();
+
+        // Register layout: the accumulators [pixel][vector] go first, then the filter vectors,
+        // the last register holds the broadcasted source value
+        Xbyak::Xmm vectorReg( int index ) const
+            { return useZmm ? Xbyak::Xmm( Xbyak::Zmm( index ) ) : Xbyak::Xmm( Xbyak::Ymm( index ) ); }
+    };
+
+    IMathEngine* mathEngine;
+
+    const int FltCnt;
+    const int ChCnt;
+    const int FltH;
+    const int FltW;
+    const int SrcH;
+    const int SrcW;
+    const int PaddingH;
+    const int PaddingW;
+    const int StrideH;
+    const int StrideW;
+    const int DilationH;
+    const int DilationW;
+    const int ResH;
+    const int ResW;
+    const int ResObjCnt;
+    // The JIT code uses the AVX-512 instructions
+    const bool UseAvx512;
+    // The number of floats in a vector register
+    const int VectorSize;
+    // FltCnt rounded up to the multiple of VectorSize
+    const int FltCntAligned;
+    // All the result pixels of an object may be processed as one row
+    const bool IsFlat;
+    // The number of result pixels processed by one call of the JIT code
+    const int ChunkSize;
+    // The number of chunks in one object
+    const int ChunkCount;
+    // The last chunk of the object may be smaller
+    const int LastChunkSize;
+    // The distance between the source rows
+    const int SrcLineStride;
+
+    std::vector<CFilterBlock> filterBlocks;
+    // The activation which is compiled into the JIT code
+    TActivationFunction activation;
+    float reluThreshold;
+    std::unique_ptr<CJitConvolution> jitCode;
+    // The code for the last chunk if it is smaller
+    std::unique_ptr<CJitConvolution> lastChunkJitCode;
+    // The rearranged filter and the copy of the filter it has been made of
+    // The filter is rearranged again only if it has changed since the previous call
+    CFloatHandleVar rearrangedFilter;
+    CFloatHandleVar filterCopy;
+    bool isFilterValid;
+
+    static constexpr size_t AvxAlignment = 32;
+    // The size of the chunk for the flat processing, the multiple of all the pixel counts
+    static constexpr int FlatChunkSize = 96;
+
+    void fillFilterBlocks();
+    // Gets the range of the filter rows inside the source for the result row
+    void getFilterRows( int resultRow, int& firstRow, int& lastRow ) const;
+    // Gets the range of the filter columns inside the source for the result pixel of the chunk
+    void getFilterColumns( int chunkPixel, int& firstColumn, int& lastColumn ) const;
+    // Rearranges the filter to [block][pixel][channel][block width] and the free term to [FltCntAligned], both padded with zeros
+    const float* rearrangeFilter( const float* filterData );
+    const float* rearrangeFreeTerm( const float* freeTermData, CFloatHandleStackVar& freeTermTempBuffer ) const;
+};
+
 class CBlobConvolutionFabric : public CCrtAllocatedObject {
 public:
     static bool IsBlobConvolutionAvailable( int FltCnt, int FltH, int FltW );
+    // Checks if CBlobConvolutionGeneric is faster than the convolution via the matrix multiplication
+    static bool IsGenericBlobConvolutionAvailable( int FltCnt, int FltH, int FltW, int ChCnt );
     static std::unique_ptr<CBlobConvolutionBase> GetProperInstance(
         IMathEngine* mathEngine, int FltCnt,
         int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
         int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
-        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt );
+        int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, bool useAvx512 );
 };
 
 } // namespace NeoML
@@ -218,4 +409,5 @@ public:
 #include <BlobConvolution_jit_FltCnt_16.inl>
 #include <BlobConvolution_jit_FltCnt_18.inl>
 #include <BlobConvolution_jit_FltCnt_24.inl>
-#include <BlobConvolution_jit_FltCnt_32.inl>
\ No newline at end of file
+#include <BlobConvolution_jit_FltCnt_32.inl>
+#include <BlobConvolutionGeneric.inl>
\ No newline at end of file
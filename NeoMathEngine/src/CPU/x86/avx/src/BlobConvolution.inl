@@ -33,57 +33,71 @@ bool CBlobConvolutionFabric::IsBlobConvolutionAvailable( int FltCnt, int FltH, i
     return false;
 }
 
+bool CBlobConvolutionFabric::IsGenericBlobConvolutionAvailable( int FltCnt, int FltH, int FltW, int ChCnt )
+{
+    // Every register block streams through the whole filter for every chunk of the result.
+    // When the filter doesn't fit into the cache the matrix multiplication is faster
+    const int MaxFilterSize = 1 << 20;
+    return static_cast<long long>( FltCnt ) * FltH * FltW * ChCnt <= MaxFilterSize;
+}
+
 std::unique_ptr<CBlobConvolutionBase> CBlobConvolutionFabric::GetProperInstance(
     IMathEngine* mathEngine, int filterCount,
     int channelCount, int filterHeight, int filterWidth, int sourceHeight, int sourceWidth,
     int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
-    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt )
+    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, bool useAvx512 )
 {
-    switch( filterCount ) {
+    // The specialized code also requires odd filter sizes
+    const int specializedFilterCount = IsBlobConvolutionAvailable( filterCount, filterHeight, filterWidth ) ? filterCount : 0;
+    switch( specializedFilterCount ) {
     case 32:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<32>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     case 24:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<24>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     case 18:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<18>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     case 16:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<16>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     case 8:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<8>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     case 6:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<6>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     case 3:
         return std::unique_ptr<CBlobConvolutionBase>(
             new CBlobConvolution<3>(
                 mathEngine, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
                 paddingHeight, paddingWidth, strideHeight, strideWidth,
-                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt ) );
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     default:
-        return nullptr;
+        return std::unique_ptr<CBlobConvolutionBase>(
+            new CBlobConvolutionGeneric(
+                mathEngine, filterCount, channelCount, filterHeight, filterWidth, sourceHeight, sourceWidth,
+                paddingHeight, paddingWidth, strideHeight, strideWidth,
+                dilationHeight, dilationWidth, resultHeight, resultWidth, resObjCnt, useAvx512 ) );
     }
 }
 
@@ -93,7 +107,7 @@ template<int FltCnt>
 CBlobConvolution<FltCnt>::CBlobConvolution(
     IMathEngine* _mathEngine, int channelCount, int filterHeight, int filterWidth,
     int sourceHeight, int sourceWidth, int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
-    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt ) :
+    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, bool useAvx512 ) :
     mathEngine( _mathEngine ),
     ChCnt( channelCount ),
     FltH( filterHeight ),
@@ -109,7 +123,10 @@ CBlobConvolution<FltCnt>::CBlobConvolution(
     ResH( resultHeight ),
     ResW( resultWidth ),
     ResObjCnt( resObjCnt ),
+    UseAvx512( useAvx512 && Avx512WideBatchKernelWidth > 0 ),
     jitIsInited( false ),
+    activation( AF_Linear ),
+    reluThreshold( 0 ),
     src( nullptr ),
     flt( nullptr ),
     freeTerm( nullptr ),
@@ -129,9 +146,10 @@ CBlobConvolution<FltCnt>::CBlobConvolution(
 }
 
 template<int FltCnt>
-void CBlobConvolution<FltCnt>::ProcessConvolution(
-    int threadCount, const float* sourceData, const float* filterData, const float* freeTermData, float* resultData )
+void CBlobConvolution<FltCnt>::ProcessConvolution( int threadCount, const float* sourceData, const float* filterData,
+    const float* freeTermData, float* resultData, TActivationFunction _activation, float activationParam )
 {
+    ASSERT_EXPR( _activation == AF_Linear || _activation == AF_ReLU );
     CFloatHandleStackVar filterTempBuffer( *mathEngine, FltW * FltH * FltCntM8 * ChCnt );
     CFloatHandleStackVar freeTermTempBuffer( *mathEngine, FltCntM8 );
 
@@ -141,7 +159,11 @@ void CBlobConvolution<FltCnt>::ProcessConvolution(
     freeTerm = rearrangeFreeTerm( freeTermData, freeTermTempBuffer );
     res = resultData;
 
-    if( !jitIsInited ) {
+    const float threshold = _activation == AF_ReLU ? activationParam : 0.f;
+    if( !jitIsInited || activation != _activation || reluThreshold != threshold ) {
+        // The activation is compiled into the code, regenerate it if the activation has changed
+        activation = _activation;
+        reluThreshold = threshold;
         initJitCodes();
         jitIsInited = true;
     }
@@ -207,7 +229,7 @@ void CBlobConvolution<FltCnt>::ProcessConvolution(
 template<int FltCnt>
 inline typename CBlobConvolution<FltCnt>::CSize CBlobConvolution<FltCnt>::getWideBatchProcessSize()
 {
-    return { WideBatchKernelHeight, WideBatchKernelWidth };
+    return { WideBatchKernelHeight, UseAvx512 ? Avx512WideBatchKernelWidth : WideBatchKernelWidth };
 }
 
 template<int FltCnt>
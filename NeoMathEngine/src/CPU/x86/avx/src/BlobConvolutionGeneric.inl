@@ -0,0 +1,546 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+namespace NeoML {
+
+CBlobConvolutionGeneric::CBlobConvolutionGeneric(
+    IMathEngine* _mathEngine, int filterCount, int channelCount, int filterHeight, int filterWidth,
+    int sourceHeight, int sourceWidth, int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
+    int dilationHeight, int dilationWidth, int resultHeight, int resultWidth, int resObjCnt, bool useAvx512 ) :
+    mathEngine( _mathEngine ),
+    FltCnt( filterCount ),
+    ChCnt( channelCount ),
+    FltH( filterHeight ),
+    FltW( filterWidth ),
+    SrcH( sourceHeight ),
+    SrcW( sourceWidth ),
+    PaddingH( paddingHeight ),
+    PaddingW( paddingWidth ),
+    StrideH( strideHeight ),
+    StrideW( strideWidth ),
+    DilationH( dilationHeight ),
+    DilationW( dilationWidth ),
+    ResH( resultHeight ),
+    ResW( resultWidth ),
+    ResObjCnt( resObjCnt ),
+    UseAvx512( useAvx512 ),
+    VectorSize( useAvx512 ? 16 : 8 ),
+    FltCntAligned( ( filterCount + VectorSize - 1 ) / VectorSize * VectorSize ),
+    // The source pixels of the neighboring rows follow each other, all the filter rows are inside the source
+    IsFlat( filterWidth == 1 && strideWidth == 1 && paddingWidth == 0 && strideHeight == 1 && paddingHeight == 0 ),
+    ChunkSize( IsFlat ? min( FlatChunkSize, resultHeight * resultWidth ) : resultWidth ),
+    ChunkCount( IsFlat ? ( resultHeight * resultWidth + ChunkSize - 1 ) / ChunkSize : resultHeight ),
+    LastChunkSize( IsFlat ? resultHeight * resultWidth - ( ChunkCount - 1 ) * ChunkSize : resultWidth ),
+    SrcLineStride( sourceWidth * channelCount ),
+    activation( AF_Linear ),
+    reluThreshold( 0 ),
+    rearrangedFilter( *_mathEngine, filterHeight * filterWidth * channelCount * FltCntAligned ),
+    filterCopy( *_mathEngine, filterCount * filterHeight * filterWidth * channelCount ),
+    isFilterValid( false )
+{
+    fillFilterBlocks();
+}
+
+void CBlobConvolutionGeneric::ProcessConvolution( int threadCount, const float* sourceData, const float* filterData,
+    const float* freeTermData, float* resultData, TActivationFunction _activation, float activationParam )
+{
+    ASSERT_EXPR( _activation == AF_Linear || _activation == AF_ReLU );
+    CFloatHandleStackVar freeTermTempBuffer( *mathEngine, FltCntAligned );
+
+    const float* flt = rearrangeFilter( filterData );
+    const float* freeTerm = rearrangeFreeTerm( freeTermData, freeTermTempBuffer );
+
+    const float threshold = _activation == AF_ReLU ? activationParam : 0.f;
+    if( jitCode == nullptr || activation != _activation || reluThreshold != threshold ) {
+        // The activation is compiled into the code, regenerate it if the activation has changed
+        activation = _activation;
+        reluThreshold = threshold;
+        jitCode.reset( new CJitConvolution( *this, ChunkSize ) );
+        if( LastChunkSize != ChunkSize ) {
+            lastChunkJitCode.reset( new CJitConvolution( *this, LastChunkSize ) );
+        }
+    }
+
+    const int SrcObjSize = SrcH * SrcLineStride;
+    const int FltBlockRowSize = FltW * ChCnt * VectorSize;
+    const int ResObjSize = ResH * ResW * FltCnt;
+    const int ResChunkStride = ChunkSize * FltCnt;
+    const int ChunkTotalCount = ResObjCnt * ChunkCount;
+    const int curThreadCount = IsOmpRelevant( ChunkTotalCount, ChunkTotalCount * ChunkSize * FltCnt * FltW * FltH * ChCnt ) ? threadCount : 1;
+
+    NEOML_OMP_NUM_THREADS( curThreadCount )
+    {
+        // Index of the first chunk in whole result array
+        int firstChunkIdx;
+        // Count of chunks for current thread
+        int chunkCount;
+        if( OmpGetTaskIndexAndCount( ChunkTotalCount, firstChunkIdx, chunkCount ) ) {
+            // The filter blocks are processed one by one, so that the block stays in the cache
+            for( int blockIdx = 0; blockIdx < static_cast<int>( filterBlocks.size() ); blockIdx++ ) {
+                const CFilterBlock& block = filterBlocks[blockIdx];
+                const float* fltPtr = flt + block.Offset * FltH * FltW * ChCnt;
+                for( int chunkIdx = firstChunkIdx; chunkIdx < firstChunkIdx + chunkCount; chunkIdx++ ) {
+                    const int objIdx = chunkIdx / ChunkCount;
+                    const int objChunkIdx = chunkIdx % ChunkCount;
+                    const float* srcPtr = sourceData + objIdx * SrcObjSize;
+                    float* resPtr = resultData + objIdx * ResObjSize + objChunkIdx * ResChunkStride;
+                    int firstRow = 0;
+                    int lastRow = FltH;
+                    if( IsFlat ) {
+                        srcPtr += objChunkIdx * ChunkSize * ChCnt;
+                    } else {
+                        getFilterRows( objChunkIdx, firstRow, lastRow );
+                        if( firstRow < lastRow ) {
+                            srcPtr += ( objChunkIdx * StrideH - PaddingH + firstRow * DilationH ) * SrcLineStride;
+                        }
+                    }
+                    const float* fltRowPtr = fltPtr + firstRow * FltBlockRowSize * block.VectorCount;
+                    if( objChunkIdx == ChunkCount - 1 && lastChunkJitCode != nullptr ) {
+                        lastChunkJitCode->Run( blockIdx, lastRow - firstRow, srcPtr, fltRowPtr, freeTerm, resPtr );
+                    } else {
+                        jitCode->Run( blockIdx, lastRow - firstRow, srcPtr, fltRowPtr, freeTerm, resPtr );
+                    }
+                }
+            }
+        }
+    }
+}
+
+void CBlobConvolutionGeneric::fillFilterBlocks()
+{
+    // The ymm code has 16 registers: up to 12 accumulators, 3 filter vectors and the source
+    // The zmm code has 32 registers: up to 24 accumulators, 4 filter vectors and the source
+    const int maxBlockSize = UseAvx512 ? 4 : 3;
+    const int accumulatorCount = UseAvx512 ? 24 : 12;
+    // More pixels don't speed up the calculation, only make the row tail longer
+    const int maxPixelCount = 12;
+
+    // The vectors are distributed evenly between the blocks
+    const int vectorCount = FltCntAligned / VectorSize;
+    const int blockCount = ( vectorCount + maxBlockSize - 1 ) / maxBlockSize;
+    int offset = 0;
+    for( int i = 0; i < blockCount; i++ ) {
+        CFilterBlock block;
+        block.Offset = offset;
+        block.VectorCount = vectorCount / blockCount + ( i < vectorCount % blockCount ? 1 : 0 );
+        block.PixelCount = min( maxPixelCount, accumulatorCount / block.VectorCount );
+        filterBlocks.push_back( block );
+        offset += block.VectorCount * VectorSize;
+    }
+}
+
+// The range is empty if the filter window is in the padding
+static inline void getFilterRange( int windowStart, int filterSize, int dilation, int sourceSize, int& first, int& last )
+{
+    first = windowStart < 0 ? ( -windowStart + dilation - 1 ) / dilation : 0;
+    last = windowStart + ( filterSize - 1 ) * dilation < sourceSize ? filterSize
+        : ( windowStart < sourceSize ? ( sourceSize - 1 - windowStart ) / dilation + 1 : 0 );
+    last = max( first, min( last, filterSize ) );
+}
+
+void CBlobConvolutionGeneric::getFilterRows( int resultRow, int& firstRow, int& lastRow ) const
+{
+    getFilterRange( resultRow * StrideH - PaddingH, FltH, DilationH, SrcH, firstRow, lastRow );
+}
+
+void CBlobConvolutionGeneric::getFilterColumns( int chunkPixel, int& firstColumn, int& lastColumn ) const
+{
+    if( IsFlat ) {
+        firstColumn = 0;
+        lastColumn = FltW;
+        return;
+    }
+    getFilterRange( chunkPixel * StrideW - PaddingW, FltW, DilationW, SrcW, firstColumn, lastColumn );
+}
+
+const float* CBlobConvolutionGeneric::rearrangeFilter( const float* filterData )
+{
+    // Initial packing: Filter[FltCnt] Pixel[FltH * FltW] Channel[ChCnt]
+    // Result packing: Block[filterBlocks.size()] Pixel[FltH * FltW] Channel[ChCnt] Filter[block width]
+    // The JIT code reads the filter of a block sequentially
+    float* resFilter = static_cast< float* >( mathEngine->GetBuffer( rearrangedFilter.GetHandle(), 0, rearrangedFilter.Size() * sizeof( float ), false ) );
+    ASSERT_EXPR( reinterpret_cast< uintptr_t >( resFilter ) % AvxAlignment == 0 );
+    float* copy = static_cast< float* >( mathEngine->GetBuffer( filterCopy.GetHandle(), 0, filterCopy.Size() * sizeof( float ), false ) );
+    if( isFilterValid && memcmp( copy, filterData, filterCopy.Size() * sizeof( float ) ) == 0 ) {
+        return resFilter;
+    }
+    memcpy( copy, filterData, filterCopy.Size() * sizeof( float ) );
+    isFilterValid = true;
+
+    const int filterSize = FltH * FltW * ChCnt;
+    for( const CFilterBlock& block : filterBlocks ) {
+        const int blockWidth = block.VectorCount * VectorSize;
+        const int filterCount = min( blockWidth, FltCnt - block.Offset );
+        const float* srcFilter = filterData + block.Offset * filterSize;
+        float* resBlock = resFilter + block.Offset * filterSize;
+        for( int i = 0; i < filterSize; i++ ) {
+            for( int f = 0; f < filterCount; f++ ) {
+                resBlock[f] = srcFilter[f * filterSize + i];
+            }
+            for( int f = filterCount; f < blockWidth; f++ ) {
+                resBlock[f] = 0;
+            }
+            resBlock += blockWidth;
+        }
+    }
+    return resFilter;
+}
+
+const float* CBlobConvolutionGeneric::rearrangeFreeTerm( const float* freeTermData, CFloatHandleStackVar& freeTermTempBuffer ) const
+{
+    // The free term is always present in the buffer, the JIT code initializes the result with it
+    float* resFreeTerm = static_cast< float* >( mathEngine->GetBuffer( freeTermTempBuffer.GetHandle(), 0, freeTermTempBuffer.Size() * sizeof( float ), false ) );
+    for( int f = 0; f < FltCntAligned; f++ ) {
+        resFreeTerm[f] = freeTermData != nullptr && f < FltCnt ? freeTermData[f] : 0;
+    }
+    return resFreeTerm;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CBlobConvolutionGeneric::CJitConvolution::CJitConvolution( const CBlobConvolutionGeneric& _bc, int _chunkSize ) :
+    // The code size depends on the filter count and the filter size
+    Xbyak::CodeGenerator( 64 << 10, Xbyak::AutoGrow ),
+    bc( _bc ),
+    useZmm( _bc.UseAvx512 ),
+    vectorRegCount( _bc.UseAvx512 ? 32 : 16 ),
+    chunkSize( _chunkSize )
+{
+    using namespace Xbyak;
+
+    for( const CFilterBlock& block : bc.filterBlocks ) {
+        // The entry points only set the number of the filter rows
+        Label labelBlock;
+        blockCodeOffsets.emplace_back();
+        for( int rowCount = 0; rowCount <= bc.FltH; rowCount++ ) {
+            blockCodeOffsets.back().push_back( getSize() );
+            prologue();
+            mov( regFltRowCount, rowCount );
+            jmp( labelBlock, T_NEAR );
+        }
+
+        L( labelBlock );
+        fillBlock( block );
+        epilogue();
+        // Add VZEROUPPER at the end of any function that uses 256 - bit AVX instructions (see BlobConvolution_jit.inl)
+        vzeroupper();
+        ret();
+    }
+
+    for( auto& loop : channelLoops ) {
+        fillChannelLoop( *loop );
+    }
+    fillConstants();
+    ready();
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::Run( int blockIndex, int filterRowCount, const float* srcPtr,
+    const float* fltPtr, const float* freeTermPtr, float* resPtr )
+{
+    typedef void ( *TBlockFunction )( const float*, const float*, const float*, float* );
+    reinterpret_cast<TBlockFunction>( getCode() + blockCodeOffsets[blockIndex][filterRowCount] )( srcPtr, fltPtr, freeTermPtr, resPtr );
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::prologue()
+{
+    using namespace Xbyak::util;
+    using namespace Xbyak;
+    push( regNumSteps );
+    push( regFltRowCount );
+    push( regFltRowCounter );
+    push( regRowSrcPtr );
+    push( regRowFltPtr );
+#ifdef _WIN32
+    // xmm6-xmm15 are callee-saved on Windows
+    sub( rsp, 10 * 16 );
+    for( int i = 6; i <= 15; i++ ) {
+        vmovups( ptr[rsp + ( i - 6 ) * 16], Xmm( i ) );
+    }
+#endif
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::epilogue()
+{
+    using namespace Xbyak::util;
+    using namespace Xbyak;
+#ifdef _WIN32
+    for( int i = 15; i >= 6; i-- ) {
+        vmovups( Xmm( i ), ptr[rsp + ( i - 6 ) * 16] );
+    }
+    add( rsp, 10 * 16 );
+#endif
+    pop( regRowFltPtr );
+    pop( regRowSrcPtr );
+    pop( regFltRowCounter );
+    pop( regFltRowCount );
+    pop( regNumSteps );
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::fillBlock( const CFilterBlock& block )
+{
+    using namespace Xbyak;
+
+    const int srcXStep = bc.StrideW * bc.ChCnt;
+    // The offset of the window of the result pixel from the beginning of the source row
+    auto srcOffset = [&]( int pixel ) { return ( pixel * bc.StrideW - bc.PaddingW ) * bc.ChCnt; };
+    // How far the batch loops have moved regSrcPtr (in floats) and regResPtr (in result pixels)
+    int srcPos = 0;
+    int resPos = 0;
+
+    int pixel = 0;
+    while( pixel < chunkSize ) {
+        int firstColumn;
+        int lastColumn;
+        bc.getFilterColumns( pixel, firstColumn, lastColumn );
+        if( firstColumn != 0 || lastColumn != bc.FltW ) {
+            // The window of the pixel crosses the border
+            fillKernel( block, 1, srcOffset( pixel ) - srcPos, ( pixel - resPos ) * bc.FltCnt, firstColumn, lastColumn );
+            pixel++;
+            continue;
+        }
+
+        // The windows of the pixels up to the opposite border are inside the source
+        int pixelEnd = pixel + 1;
+        for( ; pixelEnd < chunkSize; pixelEnd++ ) {
+            bc.getFilterColumns( pixelEnd, firstColumn, lastColumn );
+            if( firstColumn != 0 || lastColumn != bc.FltW ) {
+                break;
+            }
+        }
+
+        // The pixels are distributed evenly between the kernel calls, so that the tail is not too short
+        const int runSize = pixelEnd - pixel;
+        const int callCount = ( runSize + block.PixelCount - 1 ) / block.PixelCount;
+        const int pixelCount = ( runSize + callCount - 1 ) / callCount;
+        const int batchCount = runSize / pixelCount;
+        const int tailPixelCount = runSize % pixelCount;
+        Label labelBatch;
+        if( batchCount > 1 ) {
+            mov( regNumSteps, batchCount );
+            L( labelBatch );
+        }
+        fillKernel( block, pixelCount, srcOffset( pixel ) - srcPos, ( pixel - resPos ) * bc.FltCnt, 0, bc.FltW );
+        if( batchCount > 1 ) {
+            add( regSrcPtr, static_cast<uint32_t>( pixelCount * srcXStep * sizeof( float ) ) );
+            add( regResPtr, static_cast<uint32_t>( pixelCount * bc.FltCnt * sizeof( float ) ) );
+            dec( regNumSteps );
+            jnz( labelBatch, T_NEAR );
+            srcPos += batchCount * pixelCount * srcXStep;
+            resPos += batchCount * pixelCount;
+        }
+        pixel += batchCount * pixelCount;
+        if( tailPixelCount > 0 ) {
+            fillKernel( block, tailPixelCount, srcOffset( pixel ) - srcPos, ( pixel - resPos ) * bc.FltCnt, 0, bc.FltW );
+        }
+        pixel = pixelEnd;
+    }
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::fillKernel( const CFilterBlock& block, int pixelCount,
+    int srcOffset, int resOffset, int firstColumn, int lastColumn )
+{
+    using namespace Xbyak;
+
+    const int vectorCount = block.VectorCount;
+    const int accumulatorCount = pixelCount * vectorCount;
+    const int vectorSizeInBytes = bc.VectorSize * sizeof( float );
+    const int fltPixelSize = bc.ChCnt * vectorCount * bc.VectorSize;
+
+    // Initialize the result registers with the free term
+    for( int v = 0; v < vectorCount; v++ ) {
+        vmovups( vectorReg( v ), ptr[regFreeTermPtr + block.Offset * sizeof( float ) + v * vectorSizeInBytes] );
+    }
+    for( int p = 1; p < pixelCount; p++ ) {
+        for( int v = 0; v < vectorCount; v++ ) {
+            vmovaps( vectorReg( p * vectorCount + v ), vectorReg( v ) );
+        }
+    }
+
+    // Process the filter pixels, the loop is over the filter rows inside the source
+    if( firstColumn < lastColumn ) {
+        const Label& labelChannelLoop = getChannelLoop( pixelCount, vectorCount );
+        Label labelRow;
+        Label labelRowEnd;
+        mov( regFltRowCounter, regFltRowCount );
+        test( regFltRowCounter, regFltRowCounter );
+        jz( labelRowEnd, T_NEAR );
+        mov( regRowSrcPtr, regSrcPtr );
+        mov( regRowFltPtr, regFltPtr );
+        L( labelRow );
+        for( int x = firstColumn; x < lastColumn; x++ ) {
+            const int srcPixelOffset = srcOffset + x * bc.DilationW * bc.ChCnt;
+            lea( regTempSrcPtr, ptr[regRowSrcPtr + srcPixelOffset * static_cast<int>( sizeof( float ) )] );
+            lea( regTempFltPtr, ptr[regRowFltPtr + x * fltPixelSize * sizeof( float )] );
+            call( labelChannelLoop );
+        }
+        add( regRowSrcPtr, static_cast<uint32_t>( bc.DilationH * bc.SrcLineStride * sizeof( float ) ) );
+        add( regRowFltPtr, static_cast<uint32_t>( bc.FltW * fltPixelSize * sizeof( float ) ) );
+        dec( regFltRowCounter );
+        jnz( labelRow, T_NEAR );
+        L( labelRowEnd );
+    }
+
+    // The filter registers are free now
+    applyActivation( accumulatorCount, accumulatorCount, accumulatorCount + 1 );
+
+    // Only the last vector of the last block may be partial
+    const int tailSize = bc.FltCnt % bc.VectorSize;
+    const bool hasPartialStore = &block == &bc.filterBlocks.back() && tailSize != 0;
+    const Ymm regMask( vectorRegCount - 1 );
+    if( hasPartialStore ) {
+        if( useZmm ) {
+            mov( regChCnt.cvt32(), ( 1 << tailSize ) - 1 );
+            kmovw( Xbyak::util::k1, regChCnt.cvt32() );
+        } else {
+            vmovups( regMask, ptr[rip + labelStoreMask] );
+        }
+    }
+    for( int p = 0; p < pixelCount; p++ ) {
+        for( int v = 0; v < vectorCount; v++ ) {
+            const int regIndex = p * vectorCount + v;
+            const Address resAddr = ptr[regResPtr + ( resOffset + p * bc.FltCnt + block.Offset ) * static_cast<int>( sizeof( float ) )
+                + v * vectorSizeInBytes];
+            if( hasPartialStore && v == vectorCount - 1 ) {
+                if( useZmm ) {
+                    vmovups( resAddr | Xbyak::util::k1, Zmm( regIndex ) );
+                } else {
+                    vmaskmovps( resAddr, regMask, Ymm( regIndex ) );
+                }
+            } else {
+                vmovups( resAddr, vectorReg( regIndex ) );
+            }
+        }
+    }
+}
+
+inline Xbyak::Label& CBlobConvolutionGeneric::CJitConvolution::getChannelLoop( int pixelCount, int vectorCount )
+{
+    for( auto& loop : channelLoops ) {
+        if( loop->PixelCount == pixelCount && loop->VectorCount == vectorCount ) {
+            return loop->Label;
+        }
+    }
+    channelLoops.emplace_back( new CChannelLoop() );
+    channelLoops.back()->PixelCount = pixelCount;
+    channelLoops.back()->VectorCount = vectorCount;
+    return channelLoops.back()->Label;
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::fillChannelLoop( CChannelLoop& loop )
+{
+    using namespace Xbyak;
+
+    const int pixelCount = loop.PixelCount;
+    const int vectorCount = loop.VectorCount;
+    const int firstFilterReg = pixelCount * vectorCount;
+    const Xmm regSrc = vectorReg( vectorRegCount - 1 );
+    const int vectorSizeInBytes = bc.VectorSize * sizeof( float );
+    const int srcXStepInBytes = bc.StrideW * bc.ChCnt * sizeof( float );
+    const int fltLineInBytes = vectorCount * vectorSizeInBytes;
+
+    auto fillChannels = [&]( int channelCount ) {
+        for( int c = 0; c < channelCount; c++ ) {
+            for( int v = 0; v < vectorCount; v++ ) {
+                vmovups( vectorReg( firstFilterReg + v ), ptr[regTempFltPtr + c * fltLineInBytes + v * vectorSizeInBytes] );
+            }
+            for( int p = 0; p < pixelCount; p++ ) {
+                const int srcOffset = p * srcXStepInBytes + c * sizeof( float );
+                if( useZmm ) {
+                    // The embedded broadcast saves an instruction
+                    for( int v = 0; v < vectorCount; v++ ) {
+                        vfmadd231ps( vectorReg( p * vectorCount + v ), vectorReg( firstFilterReg + v ), ptr_b[regTempSrcPtr + srcOffset] );
+                    }
+                } else {
+                    vbroadcastss( regSrc, ptr[regTempSrcPtr + srcOffset] );
+                    for( int v = 0; v < vectorCount; v++ ) {
+                        vfmadd231ps( vectorReg( p * vectorCount + v ), vectorReg( firstFilterReg + v ), regSrc );
+                    }
+                }
+            }
+        }
+    };
+
+    const int channelStep = 4;
+    const int stepCount = bc.ChCnt / channelStep;
+    const int remainedChannelCount = bc.ChCnt % channelStep;
+
+    L( loop.Label );
+    if( stepCount > 0 ) {
+        Label labelLoop;
+        if( stepCount > 1 ) {
+            mov( regChCnt, stepCount );
+            L( labelLoop );
+        }
+        fillChannels( channelStep );
+        if( stepCount > 1 || remainedChannelCount > 0 ) {
+            add( regTempSrcPtr, static_cast<uint32_t>( channelStep * sizeof( float ) ) );
+            add( regTempFltPtr, static_cast<uint32_t>( channelStep * fltLineInBytes ) );
+        }
+        if( stepCount > 1 ) {
+            dec( regChCnt );
+            jnz( labelLoop, T_NEAR );
+        }
+    }
+    fillChannels( remainedChannelCount );
+    ret();
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::applyActivation( int regCount, int zeroRegIndex, int thresholdRegIndex )
+{
+    using namespace Xbyak;
+
+    if( bc.activation == AF_Linear ) {
+        return;
+    }
+    ASSERT_EXPR( bc.activation == AF_ReLU );
+
+    const Xmm regZero = vectorReg( zeroRegIndex );
+    const Xmm regThreshold = vectorReg( thresholdRegIndex );
+    if( useZmm ) {
+        // vxorps for zmm requires AVX512DQ
+        vpxord( regZero, regZero, regZero );
+    } else {
+        vxorps( regZero, regZero, regZero );
+    }
+    if( bc.reluThreshold > 0 ) {
+        vbroadcastss( regThreshold, ptr[rip + labelThreshold] );
+    }
+
+    for( int i = 0; i < regCount; i++ ) {
+        const Xmm resReg = vectorReg( i );
+        vmaxps( resReg, resReg, regZero );
+        if( bc.reluThreshold > 0 ) {
+            vminps( resReg, resReg, regThreshold );
+        }
+    }
+}
+
+inline void CBlobConvolutionGeneric::CJitConvolution::fillConstants()
+{
+    align( 32 );
+    const int tailSize = bc.FltCnt % bc.VectorSize;
+    if( !useZmm && tailSize != 0 ) {
+        L( labelStoreMask );
+        for( int i = 0; i < bc.VectorSize; i++ ) {
+            dd( i < tailSize ? 0xFFFFFFFF : 0 );
+        }
+    }
+    L( labelThreshold );
+    uint32_t thresholdBits;
+    memcpy( &thresholdBits, &bc.reluThreshold, sizeof( float ) );
+    dd( thresholdBits );
+}
+
+} // namespace NeoML
@@ -19,7 +19,9 @@ using reg64_t = Xbyak::Reg64;
 
 template<int FltCnt>
 CBlobConvolution<FltCnt>::CJitConvolution::CJitConvolution( CBlobConvolution<FltCnt>& bc, int yStepIndex )
-    : Xbyak::CodeGenerator( 256 << 10 )
+    : Xbyak::CodeGenerator( 256 << 10 ),
+    useZmm( bc.UseAvx512 ),
+    numFloatInVector( bc.UseAvx512 ? NumFloatInZmm : NumFloatInYmm )
 {
     using namespace Xbyak::util;
     using namespace Xbyak;
@@ -113,6 +115,8 @@ CBlobConvolution<FltCnt>::CJitConvolution::CJitConvolution( CBlobConvolution<Flt
         L( labelNarrow );
         addRowProcessing( true );
     }
+
+    fillActivationConstants( bc );
 }
 
 template<int FltCnt>
@@ -172,7 +176,8 @@ inline void CBlobConvolution<FltCnt>::CJitConvolution::initResRegs( size_t stepC
 {
     using namespace Xbyak;
 
-    Ymm resRegs[] = { ymm0, ymm1, ymm2, ymm3, ymm4, ymm5, ymm6, ymm7,
+    // The shifts are only used with ymm registers
+    Ymm resYmmRegs[] = { ymm0, ymm1, ymm2, ymm3, ymm4, ymm5, ymm6, ymm7,
         ymm8, ymm9, ymm10, ymm11, ymm12, ymm13, ymm14, ymm15 };
     // tempRegs are always in reverse order in order to not overlap with resRegs.
     Ymm tempRegs[] = { ymm15, ymm14, ymm13, ymm12 };
@@ -190,17 +195,17 @@ inline void CBlobConvolution<FltCnt>::CJitConvolution::initResRegs( size_t stepC
     // We see that r3 is the same as r0, therefore number of shift is 3 (r0, r1, r2)
     const int NumberOfShifts = static_cast<int>( min( stepSize, FltCntM8 == FltCnt ? 1 : stepSize ) );
     // If we shift registers we will do that every ShiftStep regs.
-    constexpr int ChunkSize = FltCntM8 / 8;
+    const int ChunkSize = FltCntM8 / numFloatInVector;
     // Number of identical chunks
     const size_t NumberOfCopies = stepSize * stepCount / ( NumberOfShifts * ChunkSize );
 
     // Init first batch of registers
     if( FltCnt <= 4 && NumberOfShifts == 1 ) {
         // High half of register should be zerroed because we might use it for result accumulation.
-        vmovups( resRegs[0].copyAndSetKind( Operand::XMM ), ptr[regFreeTermPtr] );
+        vmovups( resYmmRegs[0].copyAndSetKind( Operand::XMM ), ptr[regFreeTermPtr] );
     } else {
         for( int i = 0; i < ChunkSize; i++ ) {
-            vmovups( resRegs[i], ptr[regFreeTermPtr + SizeOfYmm * i] );
+            vmovups( vectorReg( i ), ptr[regFreeTermPtr + numFloatInVector * sizeof( float ) * i] );
         }
     }
    
@@ -208,12 +213,12 @@ inline void CBlobConvolution<FltCnt>::CJitConvolution::initResRegs( size_t stepC
         // Duplicate to the identical chunk
         for( int i = 1; i < NumberOfCopies; i++ ) {
             for( int j = 0; j < ChunkSize; j++ ) {
-                vmovaps( resRegs[i * stepSize + j + shiftIdx], resRegs[j + shiftIdx] );
+                vmovaps( vectorReg( static_cast<int>( i * stepSize + j + shiftIdx ) ), vectorReg( j + shiftIdx ) );
             }
         }
 
         if( shiftIdx < ( NumberOfShifts - 1 ) ) {
-            circularShift( &resRegs[( shiftIdx + 1 ) * ChunkSize], &resRegs[shiftIdx * ChunkSize], tempRegs );
+            circularShift( &resYmmRegs[( shiftIdx + 1 ) * ChunkSize], &resYmmRegs[shiftIdx * ChunkSize], tempRegs );
         }
     }
 
@@ -222,22 +227,68 @@ inline void CBlobConvolution<FltCnt>::CJitConvolution::initResRegs( size_t stepC
     L( labelFillWithZeroes );
     // Init with zeroes
     for( int i = 0; i < stepCount * stepSize; i++ ) {
-        vxorps( resRegs[i], resRegs[i], resRegs[i] );
+        if( useZmm ) {
+            // vxorps for zmm requires AVX512DQ
+            vpxord( vectorReg( i ), vectorReg( i ), vectorReg( i ) );
+        } else {
+            vxorps( vectorReg( i ), vectorReg( i ), vectorReg( i ) );
+        }
     }
     L( labelEnd );
 }
 
+template<int FltCnt>
+inline void CBlobConvolution<FltCnt>::CJitConvolution::applyActivation( CBlobConvolution<FltCnt>& bc, size_t regCount )
+{
+    using namespace Xbyak;
+
+    if( bc.activation == AF_Linear ) {
+        return;
+    }
+    ASSERT_EXPR( bc.activation == AF_ReLU );
+
+    for( size_t i = 0; i < regCount; i++ ) {
+        const Xmm resReg = vectorReg( static_cast<int>( i ) );
+        vmaxps( resReg, resReg, ptr[rip + labelActivationZero] );
+        if( bc.reluThreshold > 0 ) {
+            vminps( resReg, resReg, ptr[rip + labelActivationThreshold] );
+        }
+    }
+}
+
+template<int FltCnt>
+inline void CBlobConvolution<FltCnt>::CJitConvolution::fillActivationConstants( CBlobConvolution<FltCnt>& bc )
+{
+    if( bc.activation != AF_ReLU ) {
+        return;
+    }
+
+    // The pool is placed after the last 'ret()' so it's never executed
+    align( static_cast<int>( numFloatInVector * sizeof( float ) ) );
+    L( labelActivationZero );
+    for( unsigned int i = 0; i < numFloatInVector; i++ ) {
+        dd( 0 );
+    }
+    L( labelActivationThreshold );
+    uint32_t thresholdBits;
+    memcpy( &thresholdBits, &bc.reluThreshold, sizeof( float ) );
+    for( unsigned int i = 0; i < numFloatInVector; i++ ) {
+        dd( thresholdBits );
+    }
+}
+
 template<int FltCnt>
 inline void CBlobConvolution<FltCnt>::CJitConvolution::flushResRegs( CBlobConvolution<FltCnt>& bc, size_t stepCount, size_t stepSize, bool useNarrowProcessing )
 {
     using namespace Xbyak;
 
-    const size_t resNarrowStep = useNarrowProcessing ? bc.ResLineStride : stepSize * NumFloatInYmm;
+    applyActivation( bc, stepCount * stepSize );
+
+    const size_t resNarrowStep = useNarrowProcessing ? bc.ResLineStride : stepSize * numFloatInVector;
 
     Label labelPartialStore, labelPartialStoreEnd;
-    Ymm resRegs[] = { ymm0, ymm1, ymm2, ymm3, ymm4, ymm5, ymm6, ymm7,
-        ymm8, ymm9, ymm10, ymm11, ymm12, ymm13, ymm14, ymm15 };
     // Last register is always unused at the end of the processing
+    // The partial flush is never needed with zmm registers (the filter count is a multiple of 16)
     Ymm regMask = ymm15;
 
     // "narrow" kernel processes several rows per time
@@ -245,7 +296,8 @@ inline void CBlobConvolution<FltCnt>::CJitConvolution::flushResRegs( CBlobConvol
     const size_t RowCount = HasSeveralRows ? stepCount : 1;
     const size_t ColCount = HasSeveralRows ? stepSize : stepCount * stepSize;
     // If length of data for flushing doesn't multiple of size of ymm we should perform storring tail of data by mask.
-    const bool HasPartitialFlush = ColCount * NumFloatInYmm % FltCnt != 0;
+    const bool HasPartitialFlush = ColCount * numFloatInVector % FltCnt != 0;
+    PRESUME_EXPR( !useZmm || !HasPartitialFlush );
     // Number of ymm registers stored fully.
     const size_t FullFlushCount = HasPartitialFlush ? ColCount - 1 : ColCount;
 
@@ -258,13 +310,13 @@ inline void CBlobConvolution<FltCnt>::CJitConvolution::flushResRegs( CBlobConvol
     for( int i = 0; i < RowCount; i++ ) {
         int j = 0;
         for( ; j < FullFlushCount; j++ ) {
-            vmovups( ptr[regResPtr + ( resNarrowStepDisp  + offsetDisp ) * sizeof( float )], resRegs[i * ColCount + j] );
-            offsetDisp += NumFloatInYmm;
+            vmovups( ptr[regResPtr + ( resNarrowStepDisp  + offsetDisp ) * sizeof( float )], vectorReg( static_cast<int>( i * ColCount + j ) ) );
+            offsetDisp += numFloatInVector;
         }
 
         if( HasPartitialFlush ) {
             // Mask store ( only elements which is mentioned in regMask )
-            vmaskmovps( ptr[regResPtr + ( resNarrowStepDisp  + offsetDisp ) * sizeof( float )], regMask, resRegs[i * ColCount + j] );
+            vmaskmovps( ptr[regResPtr + ( resNarrowStepDisp  + offsetDisp ) * sizeof( float )], regMask, Ymm( static_cast<int>( i * ColCount + j ) ) );
         }
 
         if( useNarrowProcessing ) {
@@ -26,11 +26,40 @@ const int CBlobConvolution<16>::WideBatchKernelHeight = 1;
 template<>
 const int CBlobConvolution<16>::WideBatchKernelWidth = 5;
 
+template<>
+const int CBlobConvolution<16>::Avx512WideBatchKernelWidth = 10;
+
 template<>
 inline void CBlobConvolution<16>::CJitConvolution::fillBatchProcessingKernel( CBlobConvolution<16>& bc, bool useNarrowProcessing, size_t windowIndex )
 {
     using namespace Xbyak;
 
+    if( useZmm ) {
+        // One zmm register holds all the filters, so twice as many pixels are processed at once
+        const int StepCount = 10;
+        const int StepSize = 1;
+        const int BatchChannelSize = 2;
+
+        Zmm res[10] = { zmm0, zmm1, zmm2, zmm3, zmm4, zmm5, zmm6, zmm7, zmm8, zmm9 };
+        Zmm f[2] = { zmm10, zmm11 };
+
+        std::function<void( int )> fillKernel( [&]( int channelCount ) {
+            // Load one channel for the same pixel as in source for all filters.
+            for( int c = 0; c < channelCount; c++ ) {
+                vmovups( f[c], ptr[regTempFltPtr + c * FltCntM8 * sizeof( float )] );
+            }
+            // The source values are broadcasted from the memory
+            for( int c = 0; c < channelCount; c++ ) {
+                for( int i = 0; i < StepCount; i++ ) {
+                    vfmadd231ps( res[i], f[c], ptr_b[regTempSrcPtr + ( i * bc.SrcXStep + c ) * sizeof( float )] );
+                }
+            }
+            } );
+
+        initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel, windowIndex );
+        return;
+    }
+
     const int StepCount = 5;
     const int StepSize = 2;
     const int BatchChannelSize = 1;
@@ -73,6 +102,35 @@ inline void CBlobConvolution<16>::CJitConvolution::fillSingleProcessingKernel( C
 {
     using namespace Xbyak;
 
+    if( useZmm ) {
+        const int StepCount = 1;
+        const int StepSize = 1;
+        const int BatchChannelSize = 4;
+
+        Zmm res = zmm0;
+        // We will accumulate intermediate result in two registers and then we will merge them.
+        Zmm tempRes[2] = { zmm0, zmm1 };
+        Zmm f[4] = { zmm4, zmm5, zmm6, zmm7 };
+
+        vpxord( tempRes[1], tempRes[1], tempRes[1] );
+        std::function<void()> mergeResRegs( [&]() {
+            vaddps( res, tempRes[0], tempRes[1] );
+        } );
+
+        std::function<void( int )> fillKernel( [&]( int channelCount ) {
+            PRESUME_EXPR( channelCount <= 4 );
+            for( int i = 0; i < channelCount; i++ ) {
+                vmovups( f[i], ptr[regTempFltPtr + i * FltCntM8 * sizeof( float )] );
+            }
+            for( int i = 0; i < channelCount; i++ ) {
+                vfmadd231ps( tempRes[i % 2], f[i], ptr_b[regTempSrcPtr + i * sizeof( float )] );
+            }
+            } );
+        initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel,
+            windowIndex, false, &mergeResRegs );
+        return;
+    }
+
     const int StepCount = 1;
     const int StepSize = 2;
     const int BatchChannelSize = 4;
@@ -26,11 +26,46 @@ const int CBlobConvolution<32>::WideBatchKernelHeight = 1;
 template<>
 const int CBlobConvolution<32>::WideBatchKernelWidth = 2;
 
+template<>
+const int CBlobConvolution<32>::Avx512WideBatchKernelWidth = 4;
+
 template<>
 inline void CBlobConvolution<32>::CJitConvolution::fillBatchProcessingKernel( CBlobConvolution<32>& bc, bool useNarrowProcessing, size_t windowIndex )
 {
     using namespace Xbyak;
 
+    if( useZmm ) {
+        // Two zmm registers hold all the filters, so twice as many pixels are processed at once
+        const int StepCount = 4;
+        const int StepSize = 2;
+        const int BatchChannelSize = 8;
+
+        Zmm res[4][2] = { { zmm0, zmm1 }, { zmm2, zmm3 }, { zmm4, zmm5 }, { zmm6, zmm7 } };
+        Zmm st[4] = { zmm8, zmm9, zmm10, zmm11 };
+        Zmm f[2] = { zmm12, zmm13 };
+
+        std::function<void( int )> fillKernel( [&]( int channelCount ) {
+            for( int c = 0; c < channelCount; c++ ) {
+                size_t fltOffset = c * FltCntM8 * sizeof( float );
+                size_t srcOffset = c * sizeof( float );
+                // Load one channel from one pixels in sequenced windows and fill one zmm register with its value.
+                for( int i = 0; i < StepCount; i++ ) {
+                    vbroadcastss( st[i], ptr[regTempSrcPtr + srcOffset + i * bc.SrcXStep * sizeof( float )] );
+                }
+                // Load one channel for the same pixel as in source for all filters.
+                vmovups( f[0], ptr[regTempFltPtr + fltOffset] );
+                vmovups( f[1], ptr[regTempFltPtr + fltOffset + SizeOfZmm] );
+                for( int i = 0; i < StepCount; i++ ) {
+                    vfmadd231ps( res[i][0], f[0], st[i] );
+                    vfmadd231ps( res[i][1], f[1], st[i] );
+                }
+            }
+            } );
+
+        initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel, windowIndex );
+        return;
+    }
+
     const int StepCount = 2;
     const int StepSize = 4;
     const int BatchChannelSize = 16;
@@ -72,6 +107,40 @@ inline void CBlobConvolution<32>::CJitConvolution::fillSingleProcessingKernel( C
 {
     using namespace Xbyak;
 
+    if( useZmm ) {
+        const int StepCount = 1;
+        const int StepSize = 2;
+        const int BatchChannelSize = 4;
+
+        Zmm res[2] = { zmm0, zmm1 };
+        // We will accumulate intermediate result in temp registers and then we will merge them.
+        Zmm tempRes[2][2] = { { zmm0, zmm1 }, { zmm2, zmm3 } };
+        Zmm f[4][2] = { { zmm4, zmm5 }, { zmm6, zmm7 }, { zmm8, zmm9 }, { zmm10, zmm11 } };
+
+        vpxord( tempRes[1][0], tempRes[1][0], tempRes[1][0] );
+        vpxord( tempRes[1][1], tempRes[1][1], tempRes[1][1] );
+        std::function<void()> mergeResRegs( [&]() {
+            vaddps( res[0], tempRes[0][0], tempRes[1][0] );
+            vaddps( res[1], tempRes[0][1], tempRes[1][1] );
+        } );
+
+        std::function<void( int )> fillKernel( [&]( int channelCount ) {
+            PRESUME_EXPR( channelCount <= 4 );
+            for( int i = 0; i < channelCount; i++ ) {
+                vmovups( f[i][0], ptr[regTempFltPtr + i * FltCntM8 * sizeof( float )] );
+                vmovups( f[i][1], ptr[regTempFltPtr + ( i * FltCntM8 + NumFloatInZmm ) * sizeof( float )] );
+            }
+            for( int i = 0; i < channelCount; i++ ) {
+                const Address src = ptr_b[regTempSrcPtr + i * sizeof( float )];
+                vfmadd231ps( tempRes[i % 2][0], f[i][0], src );
+                vfmadd231ps( tempRes[i % 2][1], f[i][1], src );
+            }
+            } );
+        initProcessingMainLoop( bc, StepCount, StepSize, BatchChannelSize, fillKernel,
+            windowIndex, false, &mergeResRegs );
+        return;
+    }
+
     const int StepCount = 1;
     const int StepSize = 4;
     const int BatchChannelSize = 8;
@@ -25,6 +25,7 @@ limitations under the License.
 #include <Kernel_AVX_6x4.h>
 #include <Kernel_AVX_6x2.h>
 #include <Kernel_AVX_6x1.h>
+#include <Kernel_AVX512_6x32.h>
 
 namespace NeoML {
 
@@ -33,6 +34,12 @@ using CKernelCombi_8 = CKernelCombineHorizontal<CMicroKernel_6x16, CMicroKernel_
 using CKernelCombi_4 = CKernelCombineHorizontal<CMicroKernel_6x16, CMicroKernel_6x8, CMicroKernel_6x4>;
 using CKernelCombi_full = CKernelCombineHorizontal<CMicroKernel_6x16, CMicroKernel_6x8, CMicroKernel_6x4, CMicroKernel_6x2, CMicroKernel_6x1>;
 
+// The AVX-512 kernels process 32 columns at once, the tails are processed by the AVX kernels
+using CKernelCombi512_32 = CKernelCombineHorizontal<CMicroKernel_6x32>;
+using CKernelCombi512_16 = CKernelCombineHorizontal<CMicroKernel_6x32, CMicroKernel_6x16>;
+using CKernelCombi512_8 = CKernelCombineHorizontal<CMicroKernel_6x32, CMicroKernel_6x16, CMicroKernel_6x8>;
+using CKernelCombi512_full = CKernelCombineHorizontal<CMicroKernel_6x32, CMicroKernel_6x16, CMicroKernel_6x8, CMicroKernel_6x4, CMicroKernel_6x2, CMicroKernel_6x1>;
+
 template< class Kernel>
 void AvxMultiplyMatrixSelected( bool transA, bool transB,
 	IMathEngine *engine,
@@ -93,4 +100,44 @@ void AvxMultiplyMatrix( bool transA, bool transB,
 	}
 }
 
+// May only be used if the CPU supports AVX-512F
+void Avx512MultiplyMatrix( bool transA, bool transB,
+	IMathEngine *engine,
+	const float* aPtr, size_t aRowSize,
+	const float* bPtr, size_t bRowSize,
+	float* cPtr, size_t cRowSize,
+	size_t m, size_t n, size_t k )
+{
+	if( n < 32 ) {
+		// The AVX-512 kernel is never used
+		AvxMultiplyMatrix( transA, transB, engine, aPtr, aRowSize, bPtr, bRowSize, cPtr, cRowSize, m, n, k );
+		return;
+	}
+
+	// The same as above: the tail is processed by the bigger kernel if it is only a few columns narrower
+	switch( n % 32 ) {
+	case 11:
+	case 12:
+	case 13:
+	case 14:
+	case 15:
+		AvxMultiplyMatrixSelected<CKernelCombi512_16>( transA, transB, engine, aPtr, aRowSize, bPtr, bRowSize, cPtr, cRowSize, m, n, k );
+		break;
+	case 5:
+	case 6:
+	case 7:
+		AvxMultiplyMatrixSelected<CKernelCombi512_8>( transA, transB, engine, aPtr, aRowSize, bPtr, bRowSize, cPtr, cRowSize, m, n, k );
+		break;
+	case 27:
+	case 28:
+	case 29:
+	case 30:
+	case 31:
+		AvxMultiplyMatrixSelected<CKernelCombi512_32>( transA, transB, engine, aPtr, aRowSize, bPtr, bRowSize, cPtr, cRowSize, m, n, k );
+		break;
+	default:
+		AvxMultiplyMatrixSelected<CKernelCombi512_full>( transA, transB, engine, aPtr, aRowSize, bPtr, bRowSize, cPtr, cRowSize, m, n, k );
+	}
+}
+
 }
@@ -67,10 +67,10 @@ struct CMicroKernel_6x1 : public CMicroKernelBase<6, 1> {
 		}
 
 		if( k == 1 ) {
+			// Only 6 values of A are left, the memory after them may contain anything (even NaN)
 			__m256i mask = _mm256_set_epi64x( 0, -1, -1, -1 );
 			b00 = _mm256_broadcast_ss( bPtr );
-			a00 = _mm256_loadu_ps( aPtr );
-			b00 = _mm256_and_ps( b00, _mm256_castsi256_ps( mask ) );
+			a00 = _mm256_maskload_ps( aPtr, mask );
 			c0 = _mm256_fmadd_ps( a00, b00, c0 );
 		}
 
@@ -90,6 +90,12 @@ void CCudaMathEngine::MultiplyMatrixByTransposedMatrix( int batchSize, const CCo
 		secondHeight, secondHeight * firstHeight, batchSize ) );
 }
 
+void CCudaMathEngine::MultiplyMatrixByTransposedQuantizedMatrix( const CConstFloatHandle&, int, int, float,
+	const CConstIntHandle&, const CConstFloatHandle&, int, const CFloatHandle& )
+{
+	ASSERT_EXPR( false );
+}
+
 void CCudaMathEngine::MultiplyTransposedMatrixByMatrixAndAdd( const CConstFloatHandle& firstHandle, int firstHeight,
 	int firstWidth, int firstRowSize, const CConstFloatHandle& secondHandle, int secondWidth, int secondRowSize,
 	const CFloatHandle& resultHandle, int resultRowSize, int )
@@ -143,6 +143,35 @@ void CCudaMathEngine::BlobConvolution( const CConvolutionDesc& convDesc,
 
 }
 
+void CCudaMathEngine::BlobConvolutionWithActivation( const CConvolutionDesc& convDesc,
+	const CFloatHandle& sourceData, const CFloatHandle& filterData, const CFloatHandle* freeTermData,
+	const CFloatHandle& resultData, TActivationFunction activation, float activationParam )
+{
+	BlobConvolution( convDesc, sourceData, filterData, freeTermData, resultData );
+
+	// No fused kernels on GPU: the activation is a separate pass over the result
+	const int resultSize = static_cast<const CCudaConvolutionDesc&>( convDesc ).Internal.Result.BlobSize();
+	switch( activation ) {
+		case AF_Linear:
+			break;
+		case AF_ReLU:
+		{
+			CFloatHandleStackVar threshold( mathEngine(), 1 );
+			threshold.SetValue( activationParam );
+			VectorReLU( resultData, resultData, resultSize, threshold.GetHandle() );
+			break;
+		}
+		case AF_Sigmoid:
+			VectorSigmoid( resultData, resultData, resultSize );
+			break;
+		case AF_HSwish:
+			VectorHSwish( resultData, resultData, resultSize );
+			break;
+		default:
+			ASSERT_EXPR( false );
+	}
+}
+
 void CCudaMathEngine::BlobConvolutionBackward( const CConvolutionDesc& convDesc, const CFloatHandle& outputDiff,
 	const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& inputDiff )
 {
@@ -245,6 +274,12 @@ void CCudaMathEngine::BlobConvolutionLearnAdd( const CConvolutionDesc& convDesc,
 	}
 }
 
+void CCudaMathEngine::QuantizedBlobConvolution( const CConvolutionDesc&, const CConstFloatHandle&, float,
+	const CConstIntHandle&, const CConstFloatHandle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_EXPR( false );
+}
+
 } // namespace NeoML
 
 #endif // NEOML_USE_CUDA
@@ -692,6 +692,12 @@ void CMetalMathEngine::MultiplyMatrixByTransposedMatrix(int batchSize, const CCo
     kernel.Run();
 }
 
+void CMetalMathEngine::MultiplyMatrixByTransposedQuantizedMatrix( const CConstFloatHandle&, int, int, float,
+	const CConstIntHandle&, const CConstFloatHandle&, int, const CFloatHandle& )
+{
+	ASSERT_EXPR( false );
+}
+
 // result = first * T(second). The result size is firstHeight * secondHeight:
 void CMetalMathEngine::MultiplySparseMatrixByTransposedMatrix( int firstHeight, int firstWidth, int secondHeight,
 	const CSparseMatrixDesc& firstDesc, const CConstFloatHandle& secondHandle, const CFloatHandle& resultHandle )
@@ -626,6 +626,52 @@ void CMetalMathEngine::IndRnnRecurrentLearn( bool /*reverse*/, int /*sequenceLen
     ASSERT_EXPR( false );
 }
 
+void CMetalMathEngine::LstmRecurrent( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*objectSize*/,
+    const CConstFloatHandle& /*wx*/, const CConstFloatHandle& /*u*/, const CConstFloatHandle& /*initialH*/,
+    const CConstFloatHandle& /*initialC*/, const CFloatHandle& /*gates*/, const CFloatHandle& /*h*/, const CFloatHandle& /*c*/ )
+{
+    ASSERT_EXPR( false );
+}
+
+void CMetalMathEngine::LstmRecurrentBackward( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*objectSize*/,
+    const CConstFloatHandle& /*u*/, const CConstFloatHandle& /*initialC*/, const CConstFloatHandle& /*gates*/,
+    const CConstFloatHandle& /*c*/, const CConstFloatHandle& /*hDiff*/, const CConstFloatHandle& /*cDiff*/,
+    const CFloatHandle& /*gatesDiff*/ )
+{
+    ASSERT_EXPR( false );
+}
+
+void CMetalMathEngine::GruRecurrent( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*objectSize*/,
+    const CConstFloatHandle& /*gateWx*/, const CConstFloatHandle& /*mainWx*/, const CConstFloatHandle& /*gateU*/,
+    const CConstFloatHandle& /*mainU*/, const CConstFloatHandle& /*initialH*/, const CFloatHandle& /*gates*/,
+    const CFloatHandle& /*main*/, const CFloatHandle& /*resetH*/, const CFloatHandle& /*h*/ )
+{
+    ASSERT_EXPR( false );
+}
+
+void CMetalMathEngine::GruRecurrentBackward( bool /*reverse*/, int /*sequenceLength*/, int /*batchSize*/, int /*objectSize*/,
+    const CConstFloatHandle& /*gateU*/, const CConstFloatHandle& /*mainU*/, const CConstFloatHandle& /*initialH*/,
+    const CConstFloatHandle& /*gates*/, const CConstFloatHandle& /*main*/, const CConstFloatHandle& /*h*/,
+    const CConstFloatHandle& /*hDiff*/, const CFloatHandle& /*gateDiff*/, const CFloatHandle& /*mainDiff*/ )
+{
+    ASSERT_EXPR( false );
+}
+
+void CMetalMathEngine::ScaledDotProductAttention( int /*batchSize*/, int /*headCount*/, int /*querySize*/, int /*keySize*/,
+    int /*headSize*/, float /*multiplier*/, const CConstFloatHandle& /*query*/, const CConstFloatHandle& /*key*/,
+    const CConstFloatHandle& /*value*/, const CConstFloatHandle& /*mask*/, const CFloatHandle& /*result*/ )
+{
+    ASSERT_EXPR( false );
+}
+
+void CMetalMathEngine::AdaptiveGradientStep( const CAdaptiveGradientStep& /*step*/, int /*count*/, const int* /*sizes*/,
+    const CConstFloatHandle* /*diffs*/, const CFloatHandle* /*params*/, const CFloatHandle* /*moments*/,
+    const CFloatHandle* /*secondMoments*/, const CFloatHandle* /*secondMomentMaxes*/, const CFloatHandle* /*updates*/,
+    const CFloatHandle& /*normSquares*/ )
+{
+    ASSERT_EXPR( false );
+}
+
 void CMetalMathEngine::CtcLossForward( int /*resultLen*/, int /*batchSize*/, int /*classCount*/, int /*labelLen*/,
     int /*blankLabel*/, bool /*skipBlanks*/, const CConstFloatHandle& /*result*/, const CConstIntHandle& /*labels*/,
     const CConstIntHandle& /*labelLens*/, const CConstIntHandle& /*resultLens*/, const CConstFloatHandle& /*labelWeights*/,
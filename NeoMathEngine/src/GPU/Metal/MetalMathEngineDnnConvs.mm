@@ -142,6 +142,35 @@ void CMetalMathEngine::BlobConvolution( const CConvolutionDesc& convDesc,
     }
 }
 
+void CMetalMathEngine::BlobConvolutionWithActivation( const CConvolutionDesc& convDesc,
+	const CFloatHandle& sourceData, const CFloatHandle& filterData, const CFloatHandle* freeTermData,
+	const CFloatHandle& resultData, TActivationFunction activation, float activationParam )
+{
+	BlobConvolution( convDesc, sourceData, filterData, freeTermData, resultData );
+
+	// No fused kernels on GPU: the activation is a separate pass over the result
+	const int resultSize = static_cast<const CCommonConvolutionDesc&>( convDesc ).Result.BlobSize();
+	switch( activation ) {
+		case AF_Linear:
+			break;
+		case AF_ReLU:
+		{
+			CFloatHandleStackVar threshold( mathEngine(), 1 );
+			threshold.SetValue( activationParam );
+			VectorReLU( resultData, resultData, resultSize, threshold.GetHandle() );
+			break;
+		}
+		case AF_Sigmoid:
+			VectorSigmoid( resultData, resultData, resultSize );
+			break;
+		case AF_HSwish:
+			VectorHSwish( resultData, resultData, resultSize );
+			break;
+		default:
+			ASSERT_EXPR( false );
+	}
+}
+
 void CMetalMathEngine::BlobConvolutionBackward( const CConvolutionDesc& convDesc, const CFloatHandle& outputDiffData,
 	const CFloatHandle& filterData, const CFloatHandle* freeTermData, const CFloatHandle& inputDiffData )
 {
@@ -192,6 +221,12 @@ void CMetalMathEngine::BlobConvolutionLearnAdd( const CConvolutionDesc&, const C
 	ASSERT_EXPR( false );
 }
 
+void CMetalMathEngine::QuantizedBlobConvolution( const CConvolutionDesc&, const CConstFloatHandle&, float,
+	const CConstIntHandle&, const CConstFloatHandle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_EXPR( false );
+}
+
 //----------------------------------------------------------------------------------------------------------------------------------------
 // 3D convolution
 
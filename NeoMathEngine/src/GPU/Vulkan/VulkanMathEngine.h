@@ -338,6 +338,9 @@ public:
 		const CFloatHandle& resultHandle, int resultRowSize, int resultBufferSize) override;
 	void MultiplyMatrixByTransposedMatrix(int batchSize, const CConstFloatHandle& firstHandle, int firstHeight, int firstWidth,
 		const CConstFloatHandle& secondHandle, int secondHeight, const CFloatHandle& resultHandle, int resultBufferSize) override;
+	void MultiplyMatrixByTransposedQuantizedMatrix( const CConstFloatHandle& firstHandle, int firstHeight,
+		int firstWidth, float firstScale, const CConstIntHandle& secondHandle, const CConstFloatHandle& secondScalesHandle,
+		int secondHeight, const CFloatHandle& resultHandle ) override;
 	void MultiplySparseMatrixByTransposedMatrix( int firstHeight, int firstWidth, int secondHeight,
 		const CSparseMatrixDesc& firstDesc, const CConstFloatHandle& secondHandle, const CFloatHandle& resultHandle ) override;
 	void MultiplyTransposedMatrixBySparseMatrixAndAdd( int firstHeight, int firstWidth, int secondWidth,
@@ -413,11 +416,17 @@ public:
 	void BlobConvolution( const CConvolutionDesc& desc,
 		const CFloatHandle& source, const CFloatHandle& filter, const CFloatHandle* freeTerm,
 		const CFloatHandle& result ) override;
+	void BlobConvolutionWithActivation( const CConvolutionDesc& desc,
+		const CFloatHandle& source, const CFloatHandle& filter, const CFloatHandle* freeTerm,
+		const CFloatHandle& result, TActivationFunction activation, float activationParam ) override;
 	void BlobConvolutionBackward( const CConvolutionDesc& desc, const CFloatHandle& outputDiff,
 		const CFloatHandle& filter, const CFloatHandle* freeTerm, const CFloatHandle& inputDiff ) override;
 	void BlobConvolutionLearnAdd( const CConvolutionDesc& desc,
 		const CFloatHandle& input, const CFloatHandle& outputDiff, const CFloatHandle& filterDiff,
 		const CFloatHandle* freeTermDiff, bool isFreeTermDiffFromInput ) override;
+	void QuantizedBlobConvolution( const CConvolutionDesc& desc, const CConstFloatHandle& source, float sourceScale,
+		const CConstIntHandle& filter, const CConstFloatHandle& filterScales, const CConstFloatHandle* freeTerm,
+		const CFloatHandle& result ) override;
 	CChannelwiseConvolutionDesc* InitBlobChannelwiseConvolution( const CBlobDesc& input,
 		int paddingHeight, int paddingWidth, int strideHeight, int strideWidth,
 		const CBlobDesc& filter, const CBlobDesc* freeTerm, const CBlobDesc& output ) override;
@@ -531,6 +540,28 @@ public:
 	void IndRnnRecurrentLearn( bool reverse, int sequenceLength, int batchSize, int objectSize, TActivationFunction activation,
 		const CConstFloatHandle& mask, const CConstFloatHandle& u, const CConstFloatHandle& h, const CConstFloatHandle& hDiff,
 		const CFloatHandle& uDiff ) override;
+	void LstmRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& wx, const CConstFloatHandle& u, const CConstFloatHandle& initialH,
+		const CConstFloatHandle& initialC, const CFloatHandle& gates, const CFloatHandle& h, const CFloatHandle& c ) override;
+	void LstmRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& u, const CConstFloatHandle& initialC, const CConstFloatHandle& gates,
+		const CConstFloatHandle& c, const CConstFloatHandle& hDiff, const CConstFloatHandle& cDiff,
+		const CFloatHandle& gatesDiff ) override;
+	void GruRecurrent( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& gateWx, const CConstFloatHandle& mainWx, const CConstFloatHandle& gateU,
+		const CConstFloatHandle& mainU, const CConstFloatHandle& initialH, const CFloatHandle& gates,
+		const CFloatHandle& main, const CFloatHandle& resetH, const CFloatHandle& h ) override;
+	void GruRecurrentBackward( bool reverse, int sequenceLength, int batchSize, int objectSize,
+		const CConstFloatHandle& gateU, const CConstFloatHandle& mainU, const CConstFloatHandle& initialH,
+		const CConstFloatHandle& gates, const CConstFloatHandle& main, const CConstFloatHandle& h,
+		const CConstFloatHandle& hDiff, const CFloatHandle& gateDiff, const CFloatHandle& mainDiff ) override;
+	void ScaledDotProductAttention( int batchSize, int headCount, int querySize, int keySize, int headSize,
+		float multiplier, const CConstFloatHandle& query, const CConstFloatHandle& key, const CConstFloatHandle& value,
+		const CConstFloatHandle& mask, const CFloatHandle& result ) override;
+	void AdaptiveGradientStep( const CAdaptiveGradientStep& step, int count, const int* sizes,
+		const CConstFloatHandle* diffs, const CFloatHandle* params, const CFloatHandle* moments,
+		const CFloatHandle* secondMoments, const CFloatHandle* secondMomentMaxes, const CFloatHandle* updates,
+		const CFloatHandle& normSquares ) override;
 	CLrnDesc* InitLrn( const CBlobDesc& source, int windowSize, float bias, float alpha, float beta ) override;
 	void Lrn( const CLrnDesc& desc, const CConstFloatHandle& input, const CFloatHandle& invSum,
 		const CFloatHandle& invSumBeta, const CFloatHandle& outputHandle ) override;
@@ -159,6 +159,12 @@ void CVulkanMathEngine::MultiplyMatrixByTransposedMatrix(int batchSize, const CC
 	}
 }
 
+void CVulkanMathEngine::MultiplyMatrixByTransposedQuantizedMatrix( const CConstFloatHandle&, int, int, float,
+	const CConstIntHandle&, const CConstFloatHandle&, int, const CFloatHandle& )
+{
+	ASSERT_EXPR( false );
+}
+
 void CVulkanMathEngine::MultiplySparseMatrixByTransposedMatrix( int firstHeight, int firstWidth, int secondHeight,
 	const CSparseMatrixDesc& firstDesc, const CConstFloatHandle& secondHandle, const CFloatHandle& resultHandle )
 {
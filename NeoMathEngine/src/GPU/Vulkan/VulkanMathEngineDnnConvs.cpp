@@ -428,6 +428,35 @@ void CVulkanMathEngine::BlobConvolution( const CConvolutionDesc& convDesc,
 	}
 }
 
+void CVulkanMathEngine::BlobConvolutionWithActivation( const CConvolutionDesc& convDesc,
+	const CFloatHandle& sourceData, const CFloatHandle& filterData, const CFloatHandle* freeTermData,
+	const CFloatHandle& resultData, TActivationFunction activation, float activationParam )
+{
+	BlobConvolution( convDesc, sourceData, filterData, freeTermData, resultData );
+
+	// No fused kernels on GPU: the activation is a separate pass over the result
+	const int resultSize = static_cast<const CCommonConvolutionDesc&>( convDesc ).Result.BlobSize();
+	switch( activation ) {
+		case AF_Linear:
+			break;
+		case AF_ReLU:
+		{
+			CFloatHandleStackVar threshold( mathEngine(), 1 );
+			threshold.SetValue( activationParam );
+			VectorReLU( resultData, resultData, resultSize, threshold.GetHandle() );
+			break;
+		}
+		case AF_Sigmoid:
+			VectorSigmoid( resultData, resultData, resultSize );
+			break;
+		case AF_HSwish:
+			VectorHSwish( resultData, resultData, resultSize );
+			break;
+		default:
+			ASSERT_EXPR( false );
+	}
+}
+
 void CVulkanMathEngine::BlobConvolutionBackward( const CConvolutionDesc& convDesc, const CFloatHandle& outputDiffData,
 	const CFloatHandle& filterData, const CFloatHandle* freeTermData, const CFloatHandle& inputDiffData )
 {
@@ -489,6 +518,12 @@ void CVulkanMathEngine::BlobConvolutionLearnAdd( const CConvolutionDesc&, const
 	ASSERT_EXPR( false );
 }
 
+void CVulkanMathEngine::QuantizedBlobConvolution( const CConvolutionDesc&, const CConstFloatHandle&, float,
+	const CConstIntHandle&, const CConstFloatHandle&, const CConstFloatHandle*, const CFloatHandle& )
+{
+	ASSERT_EXPR( false );
+}
+
 // Implements convolution 1x1 with stride 1
 void CVulkanMathEngine::blobConvolution1x1s1Common( const CCommonConvolutionDesc& desc,
 	const CFloatHandle& sourceData, const CFloatHandle& filterData, const CFloatHandle* freeTermData,
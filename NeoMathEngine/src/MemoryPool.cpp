@@ -19,6 +19,7 @@ limitations under the License.
 #include <NeoMathEngine/CrtAllocatedObject.h>
 #include <MemoryPool.h>
 #include <MemoryHandleInternal.h>
+#include <NeoMathEngine/NeoMathEngineException.h>
 #include <algorithm>
 #include <numeric>
 
@@ -28,8 +29,9 @@ namespace NeoML {
 class CMemoryBuffer : public CCrtAllocatedObject {
 public:
 	CMemoryHandle Data; // the pointer to the data
+	CMemoryBufferPool* const Pool; // the pool the buffer belongs to
 
-	explicit CMemoryBuffer() : next(0) {}
+	explicit CMemoryBuffer( CMemoryBufferPool* pool ) : Pool( pool ), next(0) {}
 
 	CMemoryBuffer* GetNext() { return next; }
 	void SetNext( CMemoryBuffer* _next ) { next = _next; }
@@ -96,7 +98,99 @@ static const unsigned int BufferSizes[] = {
 template <typename T, int size>
 inline constexpr int lengthof( T(&)[size] ) { return size; }
 
+//------------------------------------------------------------------------------------------------------------
+
+// The pools of one thread
+// Only the owner thread takes the buffers from the pools and returns them back
+// The buffers freed by the other threads are pushed to a lock-free list and collected by the owner
+class CMemoryPool::CThreadData : public CCrtAllocatedObject {
+public:
+	typedef std::vector< CMemoryBufferPool*, CrtAllocator<CMemoryBufferPool*> > TPoolVector;
+	typedef std::unordered_map< void*, CMemoryBuffer*, std::hash<void*>, std::equal_to<void*>,
+		CrtAllocator< std::pair<void* const, CMemoryBuffer*> > > TBufferMap;
+
+	TPoolVector Pool;
+	bool Enabled;
+	// All buffers of the pools by their addresses
+	// Modified only by the owner thread under the engine lock, so the owner may read it without locking
+	TBufferMap Buffers;
+
+	explicit CThreadData( bool enabled );
+	~CThreadData();
+
+	// Gets the pool for the given size
+	CMemoryBufferPool* GetPool( size_t size ) const;
+	// Returns the buffer freed by another thread
+	void PushRemoteFreed( CMemoryBuffer* buffer );
+	// Moves the buffers freed by other threads to the pools; returns false if there were none
+	bool CollectRemoteFreed();
+
+private:
+	std::atomic<CMemoryBuffer*> remoteFreed;
+};
+
+CMemoryPool::CThreadData::CThreadData( bool enabled ) :
+	Enabled( enabled ),
+	remoteFreed( nullptr )
+{
+	for( int i = 0; i < lengthof( BufferSizes ); ++i ) {
+		Pool.push_back( new CMemoryBufferPool( BufferSizes[i] ) );
+	}
+}
+
+CMemoryPool::CThreadData::~CThreadData()
+{
+	for( auto curMemBufferPool : Pool ) {
+		delete curMemBufferPool;
+	}
+}
+
+inline static bool poolsCompare( const CMemoryBufferPool* a, const size_t& b )
+{
+	return a->BufferSize < b;
+}
+
+CMemoryBufferPool* CMemoryPool::CThreadData::GetPool( size_t size ) const
+{
+	return *std::lower_bound( Pool.begin(), Pool.end(), size, &poolsCompare );
+}
+
+void CMemoryPool::CThreadData::PushRemoteFreed( CMemoryBuffer* buffer )
+{
+	CMemoryBuffer* head = remoteFreed.load( std::memory_order_relaxed );
+	do {
+		buffer->SetNext( head );
+	} while( !remoteFreed.compare_exchange_weak( head, buffer, std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+bool CMemoryPool::CThreadData::CollectRemoteFreed()
+{
+	if( remoteFreed.load( std::memory_order_relaxed ) == nullptr ) {
+		return false;
+	}
+	CMemoryBuffer* buffer = remoteFreed.exchange( nullptr, std::memory_order_acquire );
+	while( buffer != nullptr ) {
+		CMemoryBuffer* next = buffer->GetNext();
+		buffer->Pool->Free( buffer );
+		buffer = next;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+// The thread data of the pool last used on the current thread
+struct CThreadDataCache {
+	size_t PoolId;
+	void* Data;
+};
+
+static thread_local CThreadDataCache threadDataCache = { 0, nullptr };
+
+static std::atomic<size_t> lastPoolId( 0 );
+
 CMemoryPool::CMemoryPool( size_t _memoryLimit, IRawMemoryManager* _rawMemoryManager, bool reuseMemoryMode ) :
+	id( ++lastPoolId ),
 	memoryLimit( _memoryLimit ),
 	rawMemoryManager( _rawMemoryManager ),
 	defaultReuseMemoryMode( reuseMemoryMode ),
@@ -109,97 +203,145 @@ CMemoryPool::CMemoryPool( size_t _memoryLimit, IRawMemoryManager* _rawMemoryMana
 CMemoryPool::~CMemoryPool()
 {
 	for( auto curPool : pools ) {
-		cleanUp( curPool.first );
-		for( auto curMemBufferPool : curPool.second.Pool ) {
-			delete curMemBufferPool;
-		}
+		cleanUp( *curPool.second );
+		delete curPool.second;
 	}
 }
 
 void CMemoryPool::SetReuseMemoryMode( bool enable )
 {
-	thread::id id = this_thread::get_id();
-	auto pool = pools.find( id );
-	if( pool == pools.end() ) {
-		createPools( id );
-		pool = pools.find( id );
-	}
-
-	pool->second.Enabled = enable;
+	getThreadData().Enabled = enable;
 }
 
 CMemoryHandle CMemoryPool::Alloc( size_t size )
 {
-	thread::id id = this_thread::get_id();
-	auto pool = pools.find( id );
-	if( pool == pools.end() ) {
-		createPools( id );
-		pool = pools.find( id );
-	}
+	CThreadData& data = getThreadData();
 
-	CMemoryHandle result = tryAlloc( size, pool->second );
+	CMemoryHandle result = tryAlloc( size, data );
 	if( !result.IsNull() ) {
 		return result;
 	}
 
 	// Not enough memory. Try to free all allocated pools
 	CleanUp();
-	return tryAlloc( size, pool->second );
+	return tryAlloc( size, data );
 }
 
 void CMemoryPool::Free( const CMemoryHandle& handle )
 {
-	TUsedAddressMap::const_iterator pos = usedMap.find( GetRaw(handle) );
-	const CUsedInfo& info = pos->second;
-	if( info.pool != 0 ) {
-		info.pool->Free(info.buffer);
-		freeMemorySize += info.pool->BufferSize;
-	} else {
+	void* address = GetRaw( handle );
+	TUsedAddressMap::const_iterator pos = usedMap.find( address );
+	if( pos != usedMap.end() ) {
 		// Large buffer, don't use the pool
-		freeMemory(info.size, handle);
-		freeMemorySize += info.size;
+		freeMemory( pos->second, handle );
+		freeMemorySize += pos->second;
+		usedMap.erase( pos );
+		return;
+	}
+
+	if( TryFreeThreadLocal( handle ) ) {
+		return;
+	}
+
+	// The buffer belongs to the pools of another thread
+	for( auto curPool : pools ) {
+		auto buffer = curPool.second->Buffers.find( address );
+		if( buffer != curPool.second->Buffers.end() ) {
+			freeMemorySize += buffer->second->Pool->BufferSize;
+			curPool.second->PushRemoteFreed( buffer->second );
+			return;
+		}
+	}
+	ASSERT_EXPR( false );
+}
+
+CMemoryHandle CMemoryPool::TryAllocThreadLocal( size_t size )
+{
+	CThreadData* data = findThreadData();
+	if( data == nullptr || !data->Enabled || size > BufferSizes[lengthof(BufferSizes) - 1] ) {
+		return CMemoryHandle();
+	}
+
+	CMemoryBufferPool* pool = data->GetPool( size );
+	CMemoryBuffer* buffer = pool->TryAlloc();
+	if( buffer == 0 && data->CollectRemoteFreed() ) {
+		buffer = pool->TryAlloc();
+	}
+	if( buffer == 0 ) {
+		return CMemoryHandle();
+	}
+	freeMemorySize -= pool->BufferSize;
+	return buffer->Data;
+}
+
+bool CMemoryPool::TryFreeThreadLocal( const CMemoryHandle& handle )
+{
+	CThreadData* data = findThreadData();
+	if( data == nullptr ) {
+		return false;
+	}
+
+	auto pos = data->Buffers.find( GetRaw( handle ) );
+	if( pos == data->Buffers.end() ) {
+		return false;
 	}
-	usedMap.erase( pos );
+	CMemoryBuffer* buffer = pos->second;
+	buffer->Pool->Free( buffer );
+	freeMemorySize += buffer->Pool->BufferSize;
+	return true;
 }
 
 size_t CMemoryPool::GetMemoryInPools() const
 {
-	thread::id id = this_thread::get_id();
-	auto pool = pools.find( id );
+	auto pool = pools.find( this_thread::get_id() );
 	if( pool == pools.end() ) {
 		return 0;
 	}
-	const TPoolVector& threadPools = pool->second.Pool;
+	const CThreadData::TPoolVector& threadPools = pool->second->Pool;
 	return std::accumulate( threadPools.begin(), threadPools.end(), size_t( 0 ),
 		[] ( const size_t& sum, const CMemoryBufferPool* cur ) { return sum + cur->GetMemoryInPool(); } );
 }
 
 void CMemoryPool::CleanUp()
 {
-	cleanUp( this_thread::get_id() );
+	auto pool = pools.find( this_thread::get_id() );
+	if( pool != pools.end() ) {
+		cleanUp( *pool->second );
+	}
 }
 
-void CMemoryPool::createPools( thread::id id )
+// Gets the data of the current thread if it has been cached by getThreadData
+CMemoryPool::CThreadData* CMemoryPool::findThreadData() const
 {
-	CThreadData threadData;
-	threadData.Enabled = defaultReuseMemoryMode;
-	for( size_t i = 0; i < sizeof( BufferSizes ) / sizeof( *BufferSizes ); ++i ) {
-		threadData.Pool.push_back( new CMemoryBufferPool( BufferSizes[i] ) );
-	}
-
-	pools[id] = threadData;
+	return threadDataCache.PoolId == id ? static_cast<CThreadData*>( threadDataCache.Data ) : nullptr;
 }
 
-void CMemoryPool::cleanUp( thread::id id )
+// Gets the data of the current thread, creating it if necessary
+CMemoryPool::CThreadData& CMemoryPool::getThreadData()
 {
-	auto pool = pools.find( id );
-	if( pool == pools.end() ) {
-		return;
+	CThreadData* data = findThreadData();
+	if( data == nullptr ) {
+		thread::id threadId = this_thread::get_id();
+		auto pool = pools.find( threadId );
+		if( pool == pools.end() ) {
+			data = new CThreadData( defaultReuseMemoryMode );
+			pools[threadId] = data;
+		} else {
+			data = pool->second;
+		}
+		threadDataCache.PoolId = id;
+		threadDataCache.Data = data;
 	}
+	return *data;
+}
 
-	for( auto cur : pool->second.Pool ) {
+void CMemoryPool::cleanUp( CThreadData& data )
+{
+	data.CollectRemoteFreed();
+	for( auto cur : data.Pool ) {
 		CMemoryBuffer* buffer = cur->TryAlloc();
 		while( buffer != 0 ) {
+			data.Buffers.erase( GetRaw( buffer->Data ) );
 			freeMemory(cur->BufferSize, buffer->Data);
 			delete buffer;
 			buffer = cur->TryAlloc();
@@ -207,11 +349,6 @@ void CMemoryPool::cleanUp( thread::id id )
 	}
 }
 
-inline static bool poolsCompare( const CMemoryBufferPool* a, const size_t& b )
-{
-	return a->BufferSize < b;
-}
-
 // Tries to allocate memory
 CMemoryHandle CMemoryPool::tryAlloc( size_t size, CThreadData& data )
 {
@@ -219,27 +356,28 @@ CMemoryHandle CMemoryPool::tryAlloc( size_t size, CThreadData& data )
 		// Allocate without using the buffers pool
 		CMemoryHandle result = alloc( size );
 		if( !result.IsNull() ) {
-			usedMap[GetRaw( result )] = CUsedInfo( size, 0, 0 );
+			usedMap[GetRaw( result )] = size;
 			freeMemorySize -= size;
 		}
 		return result;
 	}
 
 	// Allocate via the buffers pool
-	TPoolVector::iterator pos = std::lower_bound( data.Pool.begin(), data.Pool.end(), size, &poolsCompare );
-
-	CMemoryBufferPool* pool = *pos;
+	CMemoryBufferPool* pool = data.GetPool( size );
 	CMemoryBuffer* buffer = pool->TryAlloc();
+	if( buffer == 0 && data.CollectRemoteFreed() ) {
+		buffer = pool->TryAlloc();
+	}
 	if( buffer == 0 ) {
-		buffer = new CMemoryBuffer();
+		buffer = new CMemoryBuffer( pool );
 		buffer->Data = alloc( pool->BufferSize );
 		if( buffer->Data.IsNull() ) {
 			delete buffer;
 			return CMemoryHandle();
 		}
+		data.Buffers[GetRaw( buffer->Data )] = buffer;
 	}
 	freeMemorySize -= pool->BufferSize;
-	usedMap[GetRaw(buffer->Data)] = CUsedInfo(size, buffer, pool);
 
 	return buffer->Data;
 }
@@ -21,6 +21,7 @@ limitations under the License.
 #include <RawMemoryManager.h>
 #include <unordered_map>
 #include <thread>
+#include <atomic>
 
 namespace NeoML {
 
@@ -28,6 +29,8 @@ class CMemoryBufferPool;
 class CMemoryBuffer;
 
 // The memory manager
+// Each thread has its own pools of free buffers. The owner thread takes and returns its buffers
+// without locking (see TryAllocThreadLocal and TryFreeThreadLocal); other methods must be called under the engine lock
 class CMemoryPool : public CCrtAllocatedObject {
 public:
 	CMemoryPool( size_t memoryLimit, IRawMemoryManager* rawMemoryManager, bool reuseMemoryMode );
@@ -42,6 +45,16 @@ public:
 	// Frees the memory
 	void Free( const CMemoryHandle& handle );
 
+	// Tries to allocate memory from the free buffers of the current thread
+	// Returns a null handle if there is no suitable free buffer; in this case call Alloc
+	// Doesn't need the engine lock
+	CMemoryHandle TryAllocThreadLocal( size_t size );
+
+	// Tries to return the buffer allocated on the current thread to its pool
+	// Returns false if the memory was allocated otherwise; in this case call Free
+	// Doesn't need the engine lock
+	bool TryFreeThreadLocal( const CMemoryHandle& handle );
+
 	// Gets the amount of memory currently available
 	size_t GetFreeMemorySize() const { return freeMemorySize; }
 
@@ -55,40 +68,28 @@ public:
 	void CleanUp();
 
 private:
-	typedef std::vector< CMemoryBufferPool*, CrtAllocator<CMemoryBufferPool*> > TPoolVector;
-	struct CThreadData {
-		TPoolVector Pool;
-		bool Enabled;
-	};
-	typedef std::unordered_map< std::thread::id, CThreadData, std::hash<std::thread::id>, std::equal_to<std::thread::id>,
-		CrtAllocator< std::pair<const std::thread::id, CThreadData> > > TPoolMap;
+	class CThreadData;
+	typedef std::unordered_map< std::thread::id, CThreadData*, std::hash<std::thread::id>, std::equal_to<std::thread::id>,
+		CrtAllocator< std::pair<const std::thread::id, CThreadData*> > > TPoolMap;
 
+	const size_t id; // the unique identifier of the pool, used to find the thread data
 	const size_t memoryLimit;
 	IRawMemoryManager* const rawMemoryManager;
 	const bool defaultReuseMemoryMode;
 
 	TPoolMap pools;
 	size_t allocatedMemory; // the amount of memory allocated on device (belonging to the user + used for the pools)
-	size_t freeMemorySize; // the amount of free avialable memory
+	std::atomic<size_t> freeMemorySize; // the amount of free avialable memory
 	size_t peakMemoryUsage; // peak memory usage
 
-	// The information about a memory block
-	struct CUsedInfo {
-		size_t size;
-		CMemoryBuffer* buffer;
-		CMemoryBufferPool* pool;
-
-		CUsedInfo() :
-			size( 0 ), buffer( nullptr), pool( 0 ) {}
-		CUsedInfo(size_t _size, CMemoryBuffer* _buffer, CMemoryBufferPool* _pool) :
-			size(_size), buffer(_buffer), pool(_pool) {}
-	};
-	typedef std::unordered_map< void*, CUsedInfo, std::hash<void*>, std::equal_to<void*>,
-		CrtAllocator< std::pair<void* const, CUsedInfo> > > TUsedAddressMap;
+	// The sizes of the memory blocks allocated without the pools
+	typedef std::unordered_map< void*, size_t, std::hash<void*>, std::equal_to<void*>,
+		CrtAllocator< std::pair<void* const, size_t> > > TUsedAddressMap;
 	TUsedAddressMap usedMap;
 
-	void createPools( std::thread::id id );
-	void cleanUp( std::thread::id id );
+	CThreadData* findThreadData() const;
+	CThreadData& getThreadData();
+	void cleanUp( CThreadData& data );
 	CMemoryHandle tryAlloc( size_t size, CThreadData& data );
 	CMemoryHandle alloc( size_t size );
 	void freeMemory( size_t size, const CMemoryHandle& data );
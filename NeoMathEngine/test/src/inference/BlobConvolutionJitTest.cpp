@@ -66,7 +66,10 @@ static void batchConvolutionForward( const float* input, const float* filter, co
     }
 }
 
-static void blobConvolutionImpl( const CTestParams& params, int seed )
+// Compares the convolution with the naive implementation
+// The values are taken from [-maxValue; maxValue]
+// The convolution is run twice with the same descriptor, the filter is changed in place before the second run
+static void testBlobConvolution( const CTestParams& params, int seed, float maxValue, float precision )
 {
     CRandom random( seed );
 
@@ -96,19 +99,17 @@ static void blobConvolutionImpl( const CTestParams& params, int seed )
     const int outputWidth = calcConvOutputSize( inputWidth, paddingWidth, filterWidth, dilationWidth, strideWidth );
 
     for( int channelCount = channelINterval.Begin; channelCount <= channelINterval.End; channelCount++ ) {
-        const CInterval valuesInterval = { -10, 10 };
-
-        CREATE_FILL_FLOAT_ARRAY( inputData, valuesInterval.Begin, valuesInterval.End,
+        CREATE_FILL_FLOAT_ARRAY( inputData, -maxValue, maxValue,
             inputLength * inputBatch * inputHeight * inputWidth * inputDepth * channelCount, random )
             CFloatBlob inputBlob( MathEngine(), inputLength, inputBatch, 1, inputHeight, inputWidth, inputDepth, channelCount );
         inputBlob.CopyFrom( inputData.data() );
 
-        CREATE_FILL_FLOAT_ARRAY( filterData, valuesInterval.Begin, valuesInterval.End,
+        CREATE_FILL_FLOAT_ARRAY( filterData, -maxValue, maxValue,
             filterCount * filterHeight * filterWidth * inputDepth * channelCount, random )
             CFloatBlob filterBlob( MathEngine(), filterCount, filterHeight, filterWidth, inputDepth, channelCount );
         filterBlob.CopyFrom( filterData.data() );
 
-        CREATE_FILL_FLOAT_ARRAY( freeTermData, valuesInterval.Begin, valuesInterval.End, filterCount, random )
+        CREATE_FILL_FLOAT_ARRAY( freeTermData, -maxValue, maxValue, filterCount, random )
             CFloatBlob freeTermBlob( MathEngine(), 1, 1, 1, filterCount );
         freeTermBlob.CopyFrom( freeTermData.data() );
         if( isZeroFreeTerm ) {
@@ -126,33 +127,52 @@ static void blobConvolutionImpl( const CTestParams& params, int seed )
 
         const int outputSize = inputLength * inputBatch * outputHeight * outputWidth * 1 * filterCount;
         std::vector<float> actualData( outputSize );
-
-        MathEngine().BlobConvolution( *convDesc, inputBlob.GetData(), filterBlob.GetData(),
-            isZeroFreeTerm ? 0 : &freeTermDataPtr, outputBlob.GetData() );
-        outputBlob.CopyTo( actualData.data() );
-
-        delete convDesc;
-
         std::vector<float> expectedData( outputSize );
 
-        batchConvolutionForward( inputData.data(), filterData.data(), freeTermData.data(), expectedData.data(),
-            inputLength, inputBatch, inputHeight, inputWidth, inputDepth, channelCount,
-            paddingHeight, paddingWidth, filterCount, filterHeight, filterWidth,
-            dilationHeight, dilationWidth, strideHeight, strideWidth );
-
-        for( int i = 0; i < outputSize; ++i ) {
-            
-            bool res = FloatEq( expectedData[i], actualData[i], 1e-5 );
-            if( !res ) {
-                GTEST_LOG_( ERROR ) << "\n                FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT\n" <<
-                    "ConvParams: " << params.GetStrValue( "MainParams" ) << std::endl <<
-                    "Channel count: " << channelCount;
+        for( int run = 0; run < 2; ++run ) {
+            if( run == 1 ) {
+                for( float& value : filterData ) {
+                    value = -value;
+                }
+                filterBlob.CopyFrom( filterData.data() );
+            }
+
+            MathEngine().BlobConvolution( *convDesc, inputBlob.GetData(), filterBlob.GetData(),
+                isZeroFreeTerm ? 0 : &freeTermDataPtr, outputBlob.GetData() );
+            outputBlob.CopyTo( actualData.data() );
+
+            batchConvolutionForward( inputData.data(), filterData.data(), freeTermData.data(), expectedData.data(),
+                inputLength, inputBatch, inputHeight, inputWidth, inputDepth, channelCount,
+                paddingHeight, paddingWidth, filterCount, filterHeight, filterWidth,
+                dilationHeight, dilationWidth, strideHeight, strideWidth );
+
+            for( int i = 0; i < outputSize; ++i ) {
+                bool res = FloatEq( expectedData[i], actualData[i], precision );
+                if( !res ) {
+                    GTEST_LOG_( ERROR ) << "\n                FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT\n" <<
+                        "ConvParams: " << params.GetStrValue( "MainParams" ) << std::endl <<
+                        "Channel count: " << channelCount << ", run: " << run;
+                }
+                ASSERT_TRUE( res );
             }
-            ASSERT_TRUE( res );
         }
+
+        delete convDesc;
     }
 }
 
+static void blobConvolutionImpl( const CTestParams& params, int seed )
+{
+    testBlobConvolution( params, seed, 10, 1e-5f );
+}
+
+// The generic JIT convolution sums the channels in another order than the naive implementation,
+// the values of the same sign accumulate the larger error
+static void genericBlobConvolutionImpl( const CTestParams& params, int seed )
+{
+    testBlobConvolution( params, seed, 1, 1e-4f );
+}
+
 //------------------------------------------------------------------------------------------------------------
 
 class CMathEngineBlobConvolutionJitTest : public CTestFixtureWithParams {
@@ -238,3 +258,56 @@ TEST_P( CMathEngineBlobConvolutionJitTest, Random )
 {
     RUN_TEST_IMPL( blobConvolutionImpl );
 }
+
+//------------------------------------------------------------------------------------------------------------
+
+class CMathEngineBlobConvolutionGenericJitTest : public CTestFixtureWithParams {
+};
+
+CTestParams GenericJitTestParams[] = {
+    // The filter counts without specialized JIT code
+    // ymm: the filters are split into the blocks of up to 3 registers, 12 / 6 / 4 pixels are processed at once
+    // zmm: the filters are split into the blocks of up to 4 registers, 12 / 12 / 8 / 6 pixels are processed at once
+    // The last register of the last block is stored by mask if the filter count is not a multiple of 8 (16)
+    //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
+    CTestParams( "MainParams = {   1,  3,  3,  1,  1,  1,  1,  1,  1,  29,   4, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {   2,  3,  3,  1,  1,  1,  1,  1,  1,  13,   3, 1 }; ChCount = (1..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {   5,  3,  3,  1,  1,  1,  1,  1,  1,  25,   3, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {   7,  3,  3,  1,  1,  1,  1,  1,  1,  11,   5, 1 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  12,  3,  3,  1,  1,  1,  1,  1,  1,  13,   3, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  13,  3,  3,  1,  1,  1,  1,  1,  1,   7,   3, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  20,  3,  3,  1,  1,  1,  1,  1,  1,  19,   3, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  40,  3,  3,  1,  1,  1,  1,  1,  1,  14,   3, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  48,  3,  3,  1,  1,  1,  1,  1,  1,  14,   3, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  64,  3,  3,  1,  1,  1,  1,  1,  1,  15,   4, 0 }; ChCount = (15..17); TestCount = 1;" ),
+    CTestParams( "MainParams = {  65,  3,  3,  1,  1,  1,  1,  1,  1,   9,   3, 0 }; ChCount = (1..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {  96,  3,  3,  1,  1,  1,  1,  1,  1,  14,   3, 0 }; ChCount = (7..9); TestCount = 1;" ),
+    CTestParams( "MainParams = { 100,  3,  3,  1,  1,  1,  1,  1,  1,  13,   3, 1 }; ChCount = (3..5); TestCount = 1;" ),
+    CTestParams( "MainParams = { 144,  3,  3,  1,  1,  1,  1,  1,  1,   7,   7, 0 }; ChCount = (32..32); TestCount = 1;" ),
+    CTestParams( "MainParams = { 200,  1,  1,  1,  1,  1,  1,  0,  0,  14,   2, 0 }; ChCount = (63..65); TestCount = 1;" ),
+    // Even filter sizes and no padding
+    //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
+    CTestParams( "MainParams = {  10,  2,  2,  1,  1,  1,  1,  0,  0,  17,   5, 0 }; ChCount = (1..9); TestCount = 1;" ),
+    CTestParams( "MainParams = {  36,  4,  2,  1,  1,  1,  1,  2,  0,  17,   5, 0 }; ChCount = (1..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {  11,  1,  5,  1,  1,  1,  1,  0,  2,  12,   9, 0 }; ChCount = (1..5); TestCount = 1;" ),
+    // Stride and dilation
+    //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
+    CTestParams( "MainParams = {  30,  3,  3,  1,  1,  2,  2,  1,  1,  28,   9, 0 }; ChCount = (1..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {  56,  3,  3,  2,  2,  1,  1,  2,  2,  17,   9, 0 }; ChCount = (1..5); TestCount = 1;" ),
+    CTestParams( "MainParams = {  27,  5,  3,  3,  1,  3,  2,  5,  1,  27,   7, 0 }; ChCount = (7..7); TestCount = 1;" ),
+    CTestParams( "MainParams = {  50,  7,  7,  1,  1,  2,  2,  3,  3,  31,  15, 0 }; ChCount = (3..3); TestCount = 1;" ),
+    // The padding is wider than the filter window: some result pixels are the free term only
+    //                            FC  FW  FH  DW  DH  SW  SH  PW  PH SrcW SrcH FT
+    CTestParams( "MainParams = {   9,  3,  3,  1,  1,  2,  1,  4,  3,  10,   6, 0 }; ChCount = (1..5); TestCount = 1;" ),
+    // Huge JIT
+    CTestParams( "MainParams = {  70, 13, 19,  2,  4,  5,  3,  1,  1, 311, 313, 0 }; ChCount = (5..5); TestCount = 1;" )
+};
+
+INSTANTIATE_TEST_CASE_P( CMathEngineBlobConvolutionGenericJitTestInstantiation, CMathEngineBlobConvolutionGenericJitTest,
+    ::testing::ValuesIn( GenericJitTestParams )
+);
+
+TEST_P( CMathEngineBlobConvolutionGenericJitTest, Random )
+{
+    RUN_TEST_IMPL( genericBlobConvolutionImpl );
+}
@@ -0,0 +1,183 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <TestFixture.h>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+// The 3*3 convolution with stride 1 and no dilation
+static void convolution3x3Naive( const std::vector<float>& input, const std::vector<float>& filter,
+	const float* freeTerm, std::vector<float>& output, int batch, int height, int width, int channels,
+	int paddingHeight, int paddingWidth, int filterCount, int outputHeight, int outputWidth )
+{
+	output.resize( batch * outputHeight * outputWidth * filterCount );
+	for( int b = 0; b < batch; ++b ) {
+		for( int h = 0; h < outputHeight; ++h ) {
+			for( int w = 0; w < outputWidth; ++w ) {
+				for( int f = 0; f < filterCount; ++f ) {
+					double sum = freeTerm != nullptr ? freeTerm[f] : 0;
+					for( int filterH = 0; filterH < 3; ++filterH ) {
+						const int inputH = h - paddingHeight + filterH;
+						if( inputH < 0 || inputH >= height ) {
+							continue;
+						}
+						for( int filterW = 0; filterW < 3; ++filterW ) {
+							const int inputW = w - paddingWidth + filterW;
+							if( inputW < 0 || inputW >= width ) {
+								continue;
+							}
+							const float* inputPtr = input.data() + ( ( b * height + inputH ) * width + inputW ) * channels;
+							const float* filterPtr = filter.data() + ( ( f * 3 + filterH ) * 3 + filterW ) * channels;
+							for( int c = 0; c < channels; ++c ) {
+								sum += inputPtr[c] * filterPtr[c];
+							}
+						}
+					}
+					output[( ( b * outputHeight + h ) * outputWidth + w ) * filterCount + f] = static_cast<float>( sum );
+				}
+			}
+		}
+	}
+}
+
+static void checkWinogradResult( const std::vector<float>& expected, const CFloatBlob& outputBlob )
+{
+	std::vector<float> actual( outputBlob.GetDataSize() );
+	outputBlob.CopyTo( actual.data() );
+	ASSERT_EQ( expected.size(), actual.size() );
+	for( size_t i = 0; i < expected.size(); ++i ) {
+		// The Winograd algorithm is less precise than the direct calculation
+		ASSERT_NEAR( expected[i], actual[i], 1e-3 * std::max( 1.f, fabsf( expected[i] ) ) ) << i;
+	}
+}
+
+// The CPU math engine uses the Winograd algorithm only if NEOML_ENABLE_WINOGRAD_CONVOLUTION is set when it is created
+static IMathEngine* createWinogradMathEngine()
+{
+#ifdef _WIN32
+	_putenv_s( "NEOML_ENABLE_WINOGRAD_CONVOLUTION", "1" );
+#else
+	setenv( "NEOML_ENABLE_WINOGRAD_CONVOLUTION", "1", 1 );
+#endif
+	IMathEngine* result = CreateCpuMathEngine( 1, 0 );
+#ifdef _WIN32
+	_putenv_s( "NEOML_ENABLE_WINOGRAD_CONVOLUTION", "" );
+#else
+	unsetenv( "NEOML_ENABLE_WINOGRAD_CONVOLUTION" );
+#endif
+	return result;
+}
+
+// The shapes are large enough for the CPU math engine to choose the Winograd algorithm
+static void blobConvolutionWinogradTestImpl( const CTestParams& params, int seed )
+{
+	CMathEngineInfo meInfo;
+	MathEngine().GetMathEngineInfo( meInfo );
+	if( meInfo.Type != MET_Cpu ) {
+		return;
+	}
+	std::unique_ptr<IMathEngine> mathEngine( createWinogradMathEngine() );
+
+	CRandom random( seed );
+
+	const CInterval batchInterval = params.GetInterval( "Batch" );
+	const CInterval sizeInterval = params.GetInterval( "Size" );
+	const CInterval channelsInterval = params.GetInterval( "Channels" );
+	const CInterval filterCountInterval = params.GetInterval( "FilterCount" );
+	const CInterval paddingInterval = params.GetInterval( "Padding" );
+
+	const int batch = random.UniformInt( batchInterval.Begin, batchInterval.End );
+	const int height = random.UniformInt( sizeInterval.Begin, sizeInterval.End );
+	const int width = random.UniformInt( sizeInterval.Begin, sizeInterval.End );
+	const int channels = random.UniformInt( channelsInterval.Begin, channelsInterval.End );
+	const int filterCount = random.UniformInt( filterCountInterval.Begin, filterCountInterval.End );
+	const int paddingHeight = random.UniformInt( paddingInterval.Begin, paddingInterval.End );
+	const int paddingWidth = random.UniformInt( paddingInterval.Begin, paddingInterval.End );
+	const int outputHeight = height - 2 + 2 * paddingHeight;
+	const int outputWidth = width - 2 + 2 * paddingWidth;
+	const bool hasFreeTerm = random.UniformInt( 0, 1 ) == 1;
+
+	CREATE_FILL_FLOAT_ARRAY( input, -2, 2, batch * height * width * channels, random )
+	CFloatBlob inputBlob( *mathEngine, 1, batch, 1, height, width, 1, channels );
+	inputBlob.CopyFrom( input.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( filter, -1, 1, filterCount * 9 * channels, random )
+	CFloatBlob filterBlob( *mathEngine, filterCount, 3, 3, 1, channels );
+	filterBlob.CopyFrom( filter.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( freeTerm, -1, 1, filterCount, random )
+	CFloatBlob freeTermBlob( *mathEngine, 1, 1, 1, filterCount );
+	freeTermBlob.CopyFrom( freeTerm.data() );
+	CFloatHandle freeTermHandle = freeTermBlob.GetData();
+
+	CFloatBlob outputBlob( *mathEngine, 1, batch, 1, outputHeight, outputWidth, 1, filterCount );
+	std::unique_ptr<CConvolutionDesc> convDesc( mathEngine->InitBlobConvolution( inputBlob.GetDesc(),
+		paddingHeight, paddingWidth, 1, 1, 1, 1, filterBlob.GetDesc(), outputBlob.GetDesc() ) );
+
+	std::vector<float> expected;
+	convolution3x3Naive( input, filter, hasFreeTerm ? freeTerm.data() : nullptr, expected, batch, height, width,
+		channels, paddingHeight, paddingWidth, filterCount, outputHeight, outputWidth );
+	mathEngine->BlobConvolution( *convDesc, inputBlob.GetData(), filterBlob.GetData(),
+		hasFreeTerm ? &freeTermHandle : nullptr, outputBlob.GetData() );
+	checkWinogradResult( expected, outputBlob );
+
+	// The filter is changed in place, as the solver does it: the transformed filter must not be reused
+	CREATE_FILL_FLOAT_ARRAY( newFilter, -1, 1, filterCount * 9 * channels, random )
+	filterBlob.CopyFrom( newFilter.data() );
+	convolution3x3Naive( input, newFilter, freeTerm.data(), expected, batch, height, width,
+		channels, paddingHeight, paddingWidth, filterCount, outputHeight, outputWidth );
+	for( size_t i = 0; i < expected.size(); ++i ) {
+		expected[i] = std::max( expected[i], 0.f );
+	}
+	mathEngine->BlobConvolutionWithActivation( *convDesc, inputBlob.GetData(), filterBlob.GetData(), &freeTermHandle,
+		outputBlob.GetData(), AF_ReLU, 0.f );
+	checkWinogradResult( expected, outputBlob );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+class CBlobConvolutionWinogradTest : public CTestFixtureWithParams {
+};
+
+INSTANTIATE_TEST_CASE_P( CBlobConvolutionWinogradTestInstantiation, CBlobConvolutionWinogradTest,
+	::testing::Values(
+		CTestParams(
+			"Batch = (1..2);"
+			"Size = (28..40);"
+			"Channels = (64..72);"
+			"FilterCount = (64..72);"
+			"Padding = (0..2);"
+			"TestCount = 10;"
+		),
+		// The sizes not multiple of the vector size
+		CTestParams(
+			"Batch = (1..3);"
+			"Size = (26..34);"
+			"Channels = (65..100);"
+			"FilterCount = (65..100);"
+			"Padding = (1..1);"
+			"TestCount = 5;"
+		)
+	)
+);
+
+TEST_P( CBlobConvolutionWinogradTest, Random )
+{
+	RUN_TEST_IMPL( blobConvolutionWinogradTestImpl );
+}
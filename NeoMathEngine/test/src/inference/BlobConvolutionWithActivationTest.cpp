@@ -0,0 +1,157 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <TestFixture.h>
+#include <cmath>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static float activationNaive( float value, TActivationFunction activation, float activationParam )
+{
+	switch( activation ) {
+		case AF_Linear:
+			return value;
+		case AF_ReLU:
+			value = std::max( value, 0.f );
+			return activationParam > 0 ? std::min( value, activationParam ) : value;
+		case AF_Sigmoid:
+			return 1.f / ( 1.f + expf( -value ) );
+		case AF_HSwish:
+			return value <= -3.f ? 0.f : ( value >= 3.f ? value : value * ( value + 3.f ) / 6.f );
+		default:
+			ADD_FAILURE() << "unsupported activation";
+			return value;
+	}
+}
+
+static void blobConvolutionWithActivationTestImpl( const CTestParams& params, int seed )
+{
+	CRandom random( seed );
+
+	const CInterval batchInterval = params.GetInterval( "Batch" );
+	const CInterval sizeInterval = params.GetInterval( "Size" );
+	const CInterval channelsInterval = params.GetInterval( "Channels" );
+	const CInterval filterCountInterval = params.GetInterval( "FilterCount" );
+	const CInterval filterSizeInterval = params.GetInterval( "FilterSize" );
+	const CInterval strideInterval = params.GetInterval( "Stride" );
+
+	const int batch = random.UniformInt( batchInterval.Begin, batchInterval.End );
+	const int height = random.UniformInt( sizeInterval.Begin, sizeInterval.End );
+	const int width = random.UniformInt( sizeInterval.Begin, sizeInterval.End );
+	const int channels = random.UniformInt( channelsInterval.Begin, channelsInterval.End );
+	const int filterCount = random.UniformInt( filterCountInterval.Begin, filterCountInterval.End );
+	// Odd filter sizes are used so the JIT convolution may be chosen
+	const int filterSize = 2 * random.UniformInt( filterSizeInterval.Begin, filterSizeInterval.End ) + 1;
+	const int stride = random.UniformInt( strideInterval.Begin, strideInterval.End );
+	const int padding = filterSize / 2;
+	const int outputHeight = 1 + ( height - filterSize + 2 * padding ) / stride;
+	const int outputWidth = 1 + ( width - filterSize + 2 * padding ) / stride;
+
+	const TActivationFunction activations[] = { AF_Linear, AF_ReLU, AF_ReLU, AF_Sigmoid, AF_HSwish };
+	const int activationIndex = random.UniformInt( 0, 4 );
+	const TActivationFunction activation = activations[activationIndex];
+	// The second AF_ReLU has the upper threshold
+	const float activationParam = activationIndex == 2 ? 1.f : 0.f;
+
+	CREATE_FILL_FLOAT_ARRAY( input, -2, 2, batch * height * width * channels, random )
+	CFloatBlob inputBlob( MathEngine(), 1, batch, 1, height, width, 1, channels );
+	inputBlob.CopyFrom( input.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( filter, -1, 1, filterCount * filterSize * filterSize * channels, random )
+	CFloatBlob filterBlob( MathEngine(), filterCount, filterSize, filterSize, 1, channels );
+	filterBlob.CopyFrom( filter.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( freeTerm, -1, 1, filterCount, random )
+	CFloatBlob freeTermBlob( MathEngine(), 1, 1, 1, filterCount );
+	freeTermBlob.CopyFrom( freeTerm.data() );
+	CFloatHandle freeTermHandle = freeTermBlob.GetData();
+
+	CFloatBlob outputBlob( MathEngine(), 1, batch, 1, outputHeight, outputWidth, 1, filterCount );
+	CConvolutionDesc* convDesc = MathEngine().InitBlobConvolution( inputBlob.GetDesc(), padding, padding,
+		stride, stride, 1, 1, filterBlob.GetDesc(), outputBlob.GetDesc() );
+
+	const int outputSize = outputBlob.GetDataSize();
+	std::vector<float> expected( outputSize );
+	MathEngine().BlobConvolution( *convDesc, inputBlob.GetData(), filterBlob.GetData(), &freeTermHandle,
+		outputBlob.GetData() );
+	outputBlob.CopyTo( expected.data() );
+	for( int i = 0; i < outputSize; ++i ) {
+		expected[i] = activationNaive( expected[i], activation, activationParam );
+	}
+
+	std::vector<float> actual( outputSize );
+	MathEngine().BlobConvolutionWithActivation( *convDesc, inputBlob.GetData(), filterBlob.GetData(), &freeTermHandle,
+		outputBlob.GetData(), activation, activationParam );
+	outputBlob.CopyTo( actual.data() );
+	delete convDesc;
+
+	for( int i = 0; i < outputSize; ++i ) {
+		ASSERT_NEAR( expected[i], actual[i], 1e-4 * std::max( 1.f, fabsf( expected[i] ) ) ) << activation;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+class CBlobConvolutionWithActivationTest : public CTestFixtureWithParams {
+};
+
+INSTANTIATE_TEST_CASE_P( CBlobConvolutionWithActivationTestInstantiation, CBlobConvolutionWithActivationTest,
+	::testing::Values(
+		// 1x1 convolutions
+		CTestParams(
+			"Batch = (1..3);"
+			"Size = (1..20);"
+			"Channels = (1..20);"
+			"FilterCount = (1..40);"
+			"FilterSize = (0..0);"
+			"Stride = (1..2);"
+			"TestCount = 50;"
+		),
+		// The filter counts supported by the JIT convolution
+		CTestParams(
+			"Batch = (1..3);"
+			"Size = (5..30);"
+			"Channels = (1..20);"
+			"FilterCount = (8..8);"
+			"FilterSize = (1..2);"
+			"Stride = (1..1);"
+			"TestCount = 50;"
+		),
+		CTestParams(
+			"Batch = (1..3);"
+			"Size = (5..30);"
+			"Channels = (1..20);"
+			"FilterCount = (24..24);"
+			"FilterSize = (1..2);"
+			"Stride = (1..1);"
+			"TestCount = 50;"
+		),
+		CTestParams(
+			"Batch = (1..3);"
+			"Size = (5..30);"
+			"Channels = (1..20);"
+			"FilterCount = (1..40);"
+			"FilterSize = (1..2);"
+			"Stride = (1..3);"
+			"TestCount = 100;"
+		)
+	)
+);
+
+TEST_P( CBlobConvolutionWithActivationTest, Random )
+{
+	RUN_TEST_IMPL( blobConvolutionWithActivationTestImpl );
+}
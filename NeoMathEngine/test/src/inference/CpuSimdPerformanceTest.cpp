@@ -0,0 +1,332 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <TestFixture.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+using namespace std::chrono;
+
+// Compares the different code of the CPU math engine, it is chosen by the environment variables set when the math engine is created:
+// - the AVX code is used instead of the AVX-512 code if NEOML_DISABLE_AVX512 is set
+//   (if the CPU doesn't support AVX-512 both math engines run the same code;
+//   on the AVX-512 hosts the test should be run with NEOML_ENABLE_AVX512 set, otherwise the AVX code isn't used at all)
+// - the convolution via the matrix multiplication is used instead of the generic JIT convolution if NEOML_DISABLE_GENERIC_CONVOLUTION is set
+// - the Winograd algorithm is used instead of the JIT convolution or the matrix multiplication if NEOML_ENABLE_WINOGRAD_CONVOLUTION is set
+// The variables not in the list are unset
+// The benchmarks only log the time, they are disabled by default (run with --gtest_also_run_disabled_tests)
+
+static IMathEngine* createCpuMathEngine( std::initializer_list<const char*> setVariables )
+{
+	const char* variables[] = { "NEOML_DISABLE_AVX512", "NEOML_DISABLE_GENERIC_CONVOLUTION", "NEOML_ENABLE_WINOGRAD_CONVOLUTION" };
+	for( const char* name : variables ) {
+		bool isSet = false;
+		for( const char* setName : setVariables ) {
+			isSet = isSet || strcmp( name, setName ) == 0;
+		}
+#ifdef _WIN32
+		_putenv_s( name, isSet ? "1" : "" );
+#else
+		if( isSet ) {
+			setenv( name, "1", 1 );
+		} else {
+			unsetenv( name );
+		}
+#endif
+	}
+	IMathEngine* result = CreateCpuMathEngine( 1, 0 );
+	for( const char* name : setVariables ) {
+#ifdef _WIN32
+		_putenv_s( name, "" );
+#else
+		unsetenv( name );
+#endif
+	}
+	return result;
+}
+
+// The best time of several runs, in seconds
+static double measureTime( const std::function<void()>& run, int runCount )
+{
+	// Warm-up: the temporary buffers are allocated and the JIT code is generated
+	run();
+	double result = 0;
+	for( int i = 0; i < runCount; ++i ) {
+		const auto start = high_resolution_clock::now();
+		run();
+		const double time = duration_cast<duration<double>>( high_resolution_clock::now() - start ).count();
+		result = i == 0 ? time : std::min( result, time );
+	}
+	return result;
+}
+
+static void checkResults( const std::vector<float>& expected, const std::vector<float>& actual )
+{
+	ASSERT_EQ( expected.size(), actual.size() );
+	for( size_t i = 0; i < expected.size(); ++i ) {
+		// The sums are accumulated in different order
+		ASSERT_NEAR( expected[i], actual[i], 1e-3 * std::max( 1.f, fabsf( expected[i] ) ) ) << i;
+	}
+}
+
+static bool isCpuMathEngine()
+{
+	CMathEngineInfo meInfo;
+	MathEngine().GetMathEngineInfo( meInfo );
+	return meInfo.Type == MET_Cpu;
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+struct CGemmShape {
+	int M;
+	int N;
+	int K;
+	bool TransposeB;
+};
+
+// Multiplies the matrices and returns GFLOPS
+static double multiplyMatrices( IMathEngine& mathEngine, const CGemmShape& shape, const std::vector<float>& a,
+	const std::vector<float>& b, std::vector<float>& c )
+{
+	CFloatBlob aBlob( mathEngine, 1, shape.M, 1, shape.K );
+	aBlob.CopyFrom( a.data() );
+	CFloatBlob bBlob( mathEngine, 1, shape.K, 1, shape.N );
+	bBlob.CopyFrom( b.data() );
+	CFloatBlob cBlob( mathEngine, 1, shape.M, 1, shape.N );
+
+	const int runCount = std::max( 1, static_cast<int>( 2e8 / ( 2. * shape.M * shape.N * shape.K ) ) );
+	const double time = measureTime( [&]() {
+		if( shape.TransposeB ) {
+			mathEngine.MultiplyMatrixByTransposedMatrix( aBlob.GetData(), shape.M, shape.K, shape.K,
+				bBlob.GetData(), shape.N, shape.K, cBlob.GetData(), shape.N, shape.M * shape.N );
+		} else {
+			mathEngine.MultiplyMatrixByMatrix( 1, aBlob.GetData(), shape.M, shape.K, bBlob.GetData(), shape.N,
+				cBlob.GetData(), shape.M * shape.N );
+		}
+	}, runCount );
+
+	c.resize( shape.M * shape.N );
+	cBlob.CopyTo( c.data() );
+	return 2. * shape.M * shape.N * shape.K / time / 1e9;
+}
+
+TEST( CCpuSimdPerformanceTest, DISABLED_Gemm )
+{
+	if( !isCpuMathEngine() ) {
+		return;
+	}
+
+	const CGemmShape shapes[] = {
+		// Square matrices
+		{ 256, 256, 256, false },
+		{ 512, 512, 512, false },
+		// The convolutions as matrix multiplications: the image size by the filter count by the filter size
+		{ 3136, 64, 576, false },
+		{ 784, 128, 1152, false },
+		{ 196, 256, 2304, false },
+		// The fully connected layers
+		{ 32, 1000, 2048, true },
+		{ 64, 512, 512, true },
+		// The widths not multiple of the kernel width
+		{ 100, 75, 300, false },
+		{ 100, 45, 300, true }
+	};
+
+	std::unique_ptr<IMathEngine> avx512MathEngine( createCpuMathEngine( {} ) );
+	std::unique_ptr<IMathEngine> avxMathEngine( createCpuMathEngine( { "NEOML_DISABLE_AVX512" } ) );
+
+	CRandom random( 0x512 );
+	for( const CGemmShape& shape : shapes ) {
+		CREATE_FILL_FLOAT_ARRAY( a, -1, 1, shape.M * shape.K, random )
+		CREATE_FILL_FLOAT_ARRAY( b, -1, 1, shape.K * shape.N, random )
+
+		std::vector<float> expected;
+		const double avxGflops = multiplyMatrices( *avxMathEngine, shape, a, b, expected );
+		std::vector<float> actual;
+		const double avx512Gflops = multiplyMatrices( *avx512MathEngine, shape, a, b, actual );
+		GTEST_LOG_( INFO ) << "M = " << shape.M << ", N = " << shape.N << ", K = " << shape.K
+			<< ( shape.TransposeB ? ", B transposed" : "" ) << ": AVX " << avxGflops << " GFLOPS, AVX-512 "
+			<< avx512Gflops << " GFLOPS, speedup " << avx512Gflops / avxGflops;
+		checkResults( expected, actual );
+	}
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+struct CConvShape {
+	int Size;
+	int Channels;
+	int FilterCount;
+	int FilterSize;
+};
+
+// Performs the convolution and returns GFLOPS
+static double convolution( IMathEngine& mathEngine, const CConvShape& shape, const std::vector<float>& input,
+	const std::vector<float>& filter, const std::vector<float>& freeTerm, std::vector<float>& output )
+{
+	const int padding = shape.FilterSize / 2;
+	CFloatBlob inputBlob( mathEngine, 1, 1, 1, shape.Size, shape.Size, 1, shape.Channels );
+	inputBlob.CopyFrom( input.data() );
+	CFloatBlob filterBlob( mathEngine, shape.FilterCount, shape.FilterSize, shape.FilterSize, 1, shape.Channels );
+	filterBlob.CopyFrom( filter.data() );
+	CFloatBlob freeTermBlob( mathEngine, 1, 1, 1, shape.FilterCount );
+	freeTermBlob.CopyFrom( freeTerm.data() );
+	CFloatHandle freeTermHandle = freeTermBlob.GetData();
+	CFloatBlob outputBlob( mathEngine, 1, 1, 1, shape.Size, shape.Size, 1, shape.FilterCount );
+
+	std::unique_ptr<CConvolutionDesc> convDesc( mathEngine.InitBlobConvolution( inputBlob.GetDesc(),
+		padding, padding, 1, 1, 1, 1, filterBlob.GetDesc(), outputBlob.GetDesc() ) );
+
+	const double flop = 2. * shape.Size * shape.Size * shape.FilterCount * shape.FilterSize * shape.FilterSize * shape.Channels;
+	const int runCount = std::max( 5, static_cast<int>( 2e8 / flop ) );
+	const double time = measureTime( [&]() {
+		mathEngine.BlobConvolution( *convDesc, inputBlob.GetData(), filterBlob.GetData(), &freeTermHandle,
+			outputBlob.GetData() );
+	}, runCount );
+
+	output.resize( outputBlob.GetDataSize() );
+	outputBlob.CopyTo( output.data() );
+	return flop / time / 1e9;
+}
+
+TEST( CCpuSimdPerformanceTest, DISABLED_Convolution )
+{
+	if( !isCpuMathEngine() ) {
+		return;
+	}
+
+	const CConvShape shapes[] = {
+		// The JIT convolutions
+		{ 112, 16, 16, 3 },
+		{ 56, 32, 32, 3 },
+		{ 56, 16, 32, 3 },
+		{ 28, 64, 32, 3 },
+		{ 28, 32, 16, 5 },
+		// The convolutions performed with the matrix multiplication
+		{ 28, 64, 64, 3 },
+		{ 14, 128, 128, 3 },
+		{ 56, 64, 128, 1 }
+	};
+
+	std::unique_ptr<IMathEngine> avx512MathEngine( createCpuMathEngine( {} ) );
+	std::unique_ptr<IMathEngine> avxMathEngine( createCpuMathEngine( { "NEOML_DISABLE_AVX512" } ) );
+
+	CRandom random( 0x215 );
+	for( const CConvShape& shape : shapes ) {
+		CREATE_FILL_FLOAT_ARRAY( input, -1, 1, shape.Size * shape.Size * shape.Channels, random )
+		CREATE_FILL_FLOAT_ARRAY( filter, -1, 1, shape.FilterCount * shape.FilterSize * shape.FilterSize * shape.Channels, random )
+		CREATE_FILL_FLOAT_ARRAY( freeTerm, -1, 1, shape.FilterCount, random )
+
+		std::vector<float> expected;
+		const double avxGflops = convolution( *avxMathEngine, shape, input, filter, freeTerm, expected );
+		std::vector<float> actual;
+		const double avx512Gflops = convolution( *avx512MathEngine, shape, input, filter, freeTerm, actual );
+		GTEST_LOG_( INFO ) << "Image " << shape.Size << "x" << shape.Size << "x" << shape.Channels << ", filter "
+			<< shape.FilterCount << "x" << shape.FilterSize << "x" << shape.FilterSize << ": AVX " << avxGflops
+			<< " GFLOPS, AVX-512 " << avx512Gflops << " GFLOPS, speedup " << avx512Gflops / avxGflops;
+		checkResults( expected, actual );
+	}
+}
+
+TEST( CCpuSimdPerformanceTest, DISABLED_GenericConvolution )
+{
+	if( !isCpuMathEngine() ) {
+		return;
+	}
+
+	const CConvShape shapes[] = {
+		// ResNet
+		{ 56, 64, 64, 3 },
+		{ 28, 128, 128, 3 },
+		{ 14, 256, 256, 3 },
+		{ 7, 512, 512, 3 },
+		// MobileNet
+		{ 56, 24, 144, 1 },
+		{ 28, 32, 192, 1 },
+		{ 14, 96, 576, 1 },
+		{ 28, 144, 40, 1 },
+		// The filter counts not multiple of the vector size
+		{ 28, 64, 100, 3 },
+		{ 56, 16, 20, 3 }
+	};
+
+	std::unique_ptr<IMathEngine> jitMathEngine( createCpuMathEngine( {} ) );
+	std::unique_ptr<IMathEngine> gemmMathEngine( createCpuMathEngine( { "NEOML_DISABLE_GENERIC_CONVOLUTION" } ) );
+
+	CRandom random( 0x512 );
+	for( const CConvShape& shape : shapes ) {
+		CREATE_FILL_FLOAT_ARRAY( input, -1, 1, shape.Size * shape.Size * shape.Channels, random )
+		CREATE_FILL_FLOAT_ARRAY( filter, -1, 1, shape.FilterCount * shape.FilterSize * shape.FilterSize * shape.Channels, random )
+		CREATE_FILL_FLOAT_ARRAY( freeTerm, -1, 1, shape.FilterCount, random )
+
+		std::vector<float> expected;
+		const double gemmGflops = convolution( *gemmMathEngine, shape, input, filter, freeTerm, expected );
+		std::vector<float> actual;
+		const double jitGflops = convolution( *jitMathEngine, shape, input, filter, freeTerm, actual );
+		GTEST_LOG_( INFO ) << "Image " << shape.Size << "x" << shape.Size << "x" << shape.Channels << ", filter "
+			<< shape.FilterCount << "x" << shape.FilterSize << "x" << shape.FilterSize << ": matrix multiplication "
+			<< gemmGflops << " GFLOPS, JIT " << jitGflops << " GFLOPS, speedup " << jitGflops / gemmGflops;
+		checkResults( expected, actual );
+	}
+}
+
+TEST( CCpuSimdPerformanceTest, DISABLED_WinogradConvolution )
+{
+	if( !isCpuMathEngine() ) {
+		return;
+	}
+
+	const CConvShape shapes[] = {
+		// VGG and ResNet
+		{ 112, 64, 64, 3 },
+		{ 56, 64, 64, 3 },
+		{ 28, 128, 128, 3 },
+		{ 14, 256, 256, 3 },
+		{ 7, 512, 512, 3 },
+		// The filter count not multiple of the vector size
+		{ 28, 64, 100, 3 },
+		// Too few channels for the Winograd algorithm
+		{ 56, 32, 32, 3 }
+	};
+
+	std::unique_ptr<IMathEngine> winogradMathEngine( createCpuMathEngine( { "NEOML_ENABLE_WINOGRAD_CONVOLUTION" } ) );
+	std::unique_ptr<IMathEngine> defaultMathEngine( createCpuMathEngine( {} ) );
+
+	CRandom random( 0x343 );
+	for( const CConvShape& shape : shapes ) {
+		CREATE_FILL_FLOAT_ARRAY( input, -1, 1, shape.Size * shape.Size * shape.Channels, random )
+		CREATE_FILL_FLOAT_ARRAY( filter, -1, 1, shape.FilterCount * shape.FilterSize * shape.FilterSize * shape.Channels, random )
+		CREATE_FILL_FLOAT_ARRAY( freeTerm, -1, 1, shape.FilterCount, random )
+
+		std::vector<float> expected;
+		const double defaultGflops = convolution( *defaultMathEngine, shape, input, filter, freeTerm, expected );
+		std::vector<float> actual;
+		const double winogradGflops = convolution( *winogradMathEngine, shape, input, filter, freeTerm, actual );
+		// The per-layer latency, in milliseconds
+		const double gflop = 2e-9 * shape.Size * shape.Size * shape.FilterCount * shape.FilterSize * shape.FilterSize
+			* shape.Channels;
+		GTEST_LOG_( INFO ) << "Image " << shape.Size << "x" << shape.Size << "x" << shape.Channels << ", filter "
+			<< shape.FilterCount << "x" << shape.FilterSize << "x" << shape.FilterSize << ": default "
+			<< 1e3 * gflop / defaultGflops << " ms, Winograd " << 1e3 * gflop / winogradGflops << " ms, speedup "
+			<< winogradGflops / defaultGflops;
+		checkResults( expected, actual );
+	}
+}
@@ -0,0 +1,257 @@
+/* Copyright © 2017-2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <TestFixture.h>
+#include <cmath>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static inline float sigmoid( float x )
+{
+	return 1.f / ( 1.f + ::expf( -x ) );
+}
+
+// Calculates the product of the previous h and the transposed recurrent weights for one object
+static void recurrentProductNaive( const float* prevH, const float* u, int height, int objectSize, float* result )
+{
+	for( int i = 0; i < height; ++i ) {
+		double sum = 0;
+		for( int j = 0; j < objectSize; ++j ) {
+			sum += prevH[j] * u[i * objectSize + j];
+		}
+		result[i] = static_cast<float>( sum );
+	}
+}
+
+static void lstmRecurrentNaive( bool reverse, int seqLength, int batchSize, int objectSize, const float* wx,
+	const float* u, const float* initialH, const float* initialC, float* h, float* c )
+{
+	const int gatesSize = 4 * objectSize;
+	std::vector<float> recur( gatesSize );
+	for( int step = 0; step < seqLength; ++step ) {
+		const int pos = reverse ? seqLength - 1 - step : step;
+		const int prevPos = reverse ? pos + 1 : pos - 1;
+		for( int b = 0; b < batchSize; ++b ) {
+			const float* prevH = step > 0 ? h + ( prevPos * batchSize + b ) * objectSize
+				: ( initialH == nullptr ? nullptr : initialH + b * objectSize );
+			const float* prevC = step > 0 ? c + ( prevPos * batchSize + b ) * objectSize
+				: ( initialC == nullptr ? nullptr : initialC + b * objectSize );
+			const float* curWx = wx + ( pos * batchSize + b ) * gatesSize;
+			if( prevH != nullptr ) {
+				recurrentProductNaive( prevH, u, gatesSize, objectSize, recur.data() );
+			} else {
+				std::fill( recur.begin(), recur.end(), 0.f );
+			}
+			for( int i = 0; i < objectSize; ++i ) {
+				const float main = ::tanhf( curWx[i] + recur[i] );
+				const float forget = sigmoid( curWx[objectSize + i] + recur[objectSize + i] );
+				const float input = sigmoid( curWx[2 * objectSize + i] + recur[2 * objectSize + i] );
+				const float reset = sigmoid( curWx[3 * objectSize + i] + recur[3 * objectSize + i] );
+				const float newC = ( prevC == nullptr ? 0.f : forget * prevC[i] ) + input * main;
+				c[( pos * batchSize + b ) * objectSize + i] = newC;
+				h[( pos * batchSize + b ) * objectSize + i] = reset * ::tanhf( newC );
+			}
+		}
+	}
+}
+
+static void gruRecurrentNaive( bool reverse, int seqLength, int batchSize, int objectSize, const float* gateWx,
+	const float* mainWx, const float* gateU, const float* mainU, const float* initialH, float* h )
+{
+	std::vector<float> gateRecur( 2 * objectSize );
+	std::vector<float> mainRecur( objectSize );
+	std::vector<float> resetH( objectSize );
+	for( int step = 0; step < seqLength; ++step ) {
+		const int pos = reverse ? seqLength - 1 - step : step;
+		const int prevPos = reverse ? pos + 1 : pos - 1;
+		for( int b = 0; b < batchSize; ++b ) {
+			const float* prevH = step > 0 ? h + ( prevPos * batchSize + b ) * objectSize
+				: ( initialH == nullptr ? nullptr : initialH + b * objectSize );
+			const float* curGateWx = gateWx + ( pos * batchSize + b ) * 2 * objectSize;
+			const float* curMainWx = mainWx + ( pos * batchSize + b ) * objectSize;
+			std::fill( gateRecur.begin(), gateRecur.end(), 0.f );
+			std::fill( mainRecur.begin(), mainRecur.end(), 0.f );
+			if( prevH != nullptr ) {
+				recurrentProductNaive( prevH, gateU, 2 * objectSize, objectSize, gateRecur.data() );
+				for( int i = 0; i < objectSize; ++i ) {
+					resetH[i] = sigmoid( curGateWx[objectSize + i] + gateRecur[objectSize + i] ) * prevH[i];
+				}
+				recurrentProductNaive( resetH.data(), mainU, objectSize, objectSize, mainRecur.data() );
+			}
+			for( int i = 0; i < objectSize; ++i ) {
+				const float update = sigmoid( curGateWx[i] + gateRecur[i] );
+				const float main = ::tanhf( curMainWx[i] + mainRecur[i] );
+				h[( pos * batchSize + b ) * objectSize + i] = ( 1.f - update ) * main
+					+ ( prevH == nullptr ? 0.f : update * prevH[i] );
+			}
+		}
+	}
+}
+
+static void checkResult( const std::vector<float>& expected, const CFloatBlob& actualBlob )
+{
+	std::vector<float> actual( actualBlob.GetDataSize() );
+	actualBlob.CopyTo( actual.data() );
+	ASSERT_EQ( expected.size(), actual.size() );
+	for( size_t i = 0; i < expected.size(); ++i ) {
+		ASSERT_TRUE( FloatEq( expected[i], actual[i], 1e-4f ) ) << i;
+	}
+}
+
+static void lstmInferenceTestImpl( const CTestParams& params, int seed )
+{
+	CRandom random( seed );
+	const CInterval batchLengthInterval = params.GetInterval( "BatchLength" );
+	const CInterval batchWidthInterval = params.GetInterval( "BatchWidth" );
+	const CInterval channelsInterval = params.GetInterval( "Channels" );
+
+	const int batchLength = random.UniformInt( batchLengthInterval.Begin, batchLengthInterval.End );
+	const int batchWidth = random.UniformInt( batchWidthInterval.Begin, batchWidthInterval.End );
+	const int channels = random.UniformInt( channelsInterval.Begin, channelsInterval.End );
+	const bool reverse = random.Next() % 2 == 1;
+	const bool hasInitialState = random.Next() % 2 == 1;
+
+	const int stateSize = batchWidth * channels;
+	const int dataSize = batchLength * stateSize;
+
+	CREATE_FILL_FLOAT_ARRAY( wxData, -1.5f, 1.5f, 4 * dataSize, random );
+	CFloatBlob wxBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, 4 * channels );
+	wxBlob.CopyFrom( wxData.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( uData, -0.5f, 0.5f, 4 * channels * channels, random );
+	CFloatBlob uBlob( MathEngine(), 1, 1, 1, 4 * channels, 1, 1, channels );
+	uBlob.CopyFrom( uData.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( initialHData, -1.f, 1.f, stateSize, random );
+	CFloatBlob initialHBlob( MathEngine(), 1, batchWidth, 1, 1, 1, 1, channels );
+	initialHBlob.CopyFrom( initialHData.data() );
+	CREATE_FILL_FLOAT_ARRAY( initialCData, -1.f, 1.f, stateSize, random );
+	CFloatBlob initialCBlob( MathEngine(), 1, batchWidth, 1, 1, 1, 1, channels );
+	initialCBlob.CopyFrom( initialCData.data() );
+
+	std::vector<float> expectedH( dataSize );
+	std::vector<float> expectedC( dataSize );
+	lstmRecurrentNaive( reverse, batchLength, batchWidth, channels, wxData.data(), uData.data(),
+		hasInitialState ? initialHData.data() : nullptr, hasInitialState ? initialCData.data() : nullptr,
+		expectedH.data(), expectedC.data() );
+
+	CFloatBlob gatesBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, 4 * channels );
+	CFloatBlob hBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, channels );
+	CFloatBlob cBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, channels );
+	MathEngine().LstmRecurrent( reverse, batchLength, batchWidth, channels, wxBlob.GetData(), uBlob.GetData(),
+		hasInitialState ? initialHBlob.GetData() : CFloatHandle(),
+		hasInitialState ? initialCBlob.GetData() : CFloatHandle(),
+		gatesBlob.GetData(), hBlob.GetData(), cBlob.GetData() );
+
+	checkResult( expectedH, hBlob );
+	checkResult( expectedC, cBlob );
+}
+
+static void gruInferenceTestImpl( const CTestParams& params, int seed )
+{
+	CRandom random( seed );
+	const CInterval batchLengthInterval = params.GetInterval( "BatchLength" );
+	const CInterval batchWidthInterval = params.GetInterval( "BatchWidth" );
+	const CInterval channelsInterval = params.GetInterval( "Channels" );
+
+	const int batchLength = random.UniformInt( batchLengthInterval.Begin, batchLengthInterval.End );
+	const int batchWidth = random.UniformInt( batchWidthInterval.Begin, batchWidthInterval.End );
+	const int channels = random.UniformInt( channelsInterval.Begin, channelsInterval.End );
+	const bool reverse = random.Next() % 2 == 1;
+	const bool hasInitialState = random.Next() % 2 == 1;
+
+	const int stateSize = batchWidth * channels;
+	const int dataSize = batchLength * stateSize;
+
+	CREATE_FILL_FLOAT_ARRAY( gateWxData, -1.5f, 1.5f, 2 * dataSize, random );
+	CFloatBlob gateWxBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, 2 * channels );
+	gateWxBlob.CopyFrom( gateWxData.data() );
+	CREATE_FILL_FLOAT_ARRAY( mainWxData, -1.5f, 1.5f, dataSize, random );
+	CFloatBlob mainWxBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, channels );
+	mainWxBlob.CopyFrom( mainWxData.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( gateUData, -0.5f, 0.5f, 2 * channels * channels, random );
+	CFloatBlob gateUBlob( MathEngine(), 1, 1, 1, 2 * channels, 1, 1, channels );
+	gateUBlob.CopyFrom( gateUData.data() );
+	CREATE_FILL_FLOAT_ARRAY( mainUData, -0.5f, 0.5f, channels * channels, random );
+	CFloatBlob mainUBlob( MathEngine(), 1, 1, 1, channels, 1, 1, channels );
+	mainUBlob.CopyFrom( mainUData.data() );
+
+	CREATE_FILL_FLOAT_ARRAY( initialHData, -1.f, 1.f, stateSize, random );
+	CFloatBlob initialHBlob( MathEngine(), 1, batchWidth, 1, 1, 1, 1, channels );
+	initialHBlob.CopyFrom( initialHData.data() );
+
+	std::vector<float> expectedH( dataSize );
+	gruRecurrentNaive( reverse, batchLength, batchWidth, channels, gateWxData.data(), mainWxData.data(),
+		gateUData.data(), mainUData.data(), hasInitialState ? initialHData.data() : nullptr, expectedH.data() );
+
+	CFloatBlob gatesBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, 2 * channels );
+	CFloatBlob mainBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, channels );
+	CFloatBlob resetHBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, channels );
+	CFloatBlob hBlob( MathEngine(), batchLength, batchWidth, 1, 1, 1, 1, channels );
+	MathEngine().GruRecurrent( reverse, batchLength, batchWidth, channels, gateWxBlob.GetData(),
+		mainWxBlob.GetData(), gateUBlob.GetData(), mainUBlob.GetData(),
+		hasInitialState ? initialHBlob.GetData() : CFloatHandle(),
+		gatesBlob.GetData(), mainBlob.GetData(), resetHBlob.GetData(), hBlob.GetData() );
+
+	checkResult( expectedH, hBlob );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+class CLstmGruInferenceTest : public CTestFixtureWithParams {
+};
+
+INSTANTIATE_TEST_CASE_P( CLstmGruInferenceTestInstantiation, CLstmGruInferenceTest,
+	::testing::Values(
+		CTestParams(
+			"BatchLength = (1..20);"
+			"BatchWidth = (1..10);"
+			"Channels = (1..10);"
+			"TestCount = 500;"
+		),
+		CTestParams(
+			"BatchLength = (1..10);"
+			"BatchWidth = (1..16);"
+			"Channels = (50..150);"
+			"TestCount = 10;"
+		)
+	)
+);
+
+TEST_P( CLstmGruInferenceTest, Lstm )
+{
+	CMathEngineInfo meInfo;
+	MathEngine().GetMathEngineInfo( meInfo );
+	if( meInfo.Type != MET_Cpu ) {
+		// The fused recurrent operations are supported only on CPU
+		return;
+	}
+
+	RUN_TEST_IMPL( lstmInferenceTestImpl )
+}
+
+TEST_P( CLstmGruInferenceTest, Gru )
+{
+	CMathEngineInfo meInfo;
+	MathEngine().GetMathEngineInfo( meInfo );
+	if( meInfo.Type != MET_Cpu ) {
+		// The fused recurrent operations are supported only on CPU
+		return;
+	}
+
+	RUN_TEST_IMPL( gruInferenceTestImpl )
+}
@@ -0,0 +1,104 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <TestFixture.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+TEST( CMemoryPoolTest, CrossThreadFree )
+{
+	std::unique_ptr<IMathEngine> mathEngine( CreateCpuMathEngine( 1, 0 ) );
+	const size_t initialFreeMemory = mathEngine->GetFreeMemorySize();
+	mathEngine->SetReuseMemoryMode( true );
+
+	const int bufferCount = 16;
+	std::vector<CMemoryHandle> buffers;
+	for( int i = 0; i < bufferCount; ++i ) {
+		buffers.push_back( mathEngine->HeapAlloc( 1024 * ( i % 4 + 1 ) ) );
+	}
+	const size_t peakMemory = mathEngine->GetPeakMemoryUsage();
+
+	// Free half of the buffers on another thread
+	std::thread thread( [&]() {
+		for( int i = 0; i < bufferCount; i += 2 ) {
+			mathEngine->HeapFree( buffers[i] );
+		}
+	} );
+	thread.join();
+	for( int i = 1; i < bufferCount; i += 2 ) {
+		mathEngine->HeapFree( buffers[i] );
+	}
+	EXPECT_EQ( initialFreeMemory, mathEngine->GetFreeMemorySize() );
+
+	// The buffers freed by the other thread are reused
+	for( int i = 0; i < bufferCount; ++i ) {
+		buffers[i] = mathEngine->HeapAlloc( 1024 * ( i % 4 + 1 ) );
+	}
+	EXPECT_EQ( peakMemory, mathEngine->GetPeakMemoryUsage() );
+	for( int i = 0; i < bufferCount; ++i ) {
+		mathEngine->HeapFree( buffers[i] );
+	}
+	EXPECT_EQ( initialFreeMemory, mathEngine->GetFreeMemorySize() );
+	mathEngine->CleanUp();
+	EXPECT_EQ( 0, mathEngine->GetMemoryInPools() );
+}
+
+static void allocFreeLoop( IMathEngine& mathEngine, int iterationCount )
+{
+	const size_t sizes[] = { 256, 4096, 1000, 65536, 20000, 512 };
+	const int sizeCount = static_cast<int>( sizeof( sizes ) / sizeof( *sizes ) );
+
+	mathEngine.SetReuseMemoryMode( true );
+	CMemoryHandle handles[sizeCount];
+	for( int i = 0; i < iterationCount; ++i ) {
+		for( int j = 0; j < sizeCount; ++j ) {
+			handles[j] = mathEngine.HeapAlloc( sizes[j] );
+		}
+		for( int j = sizeCount - 1; j >= 0; --j ) {
+			mathEngine.HeapFree( handles[j] );
+		}
+	}
+	mathEngine.SetReuseMemoryMode( false );
+	mathEngine.CleanUp();
+}
+
+TEST( CMemoryPoolTest, DISABLED_MultiThreadPerformance )
+{
+	const int iterationCount = 20000;
+	const int operationsPerIteration = 12;
+
+	std::unique_ptr<IMathEngine> mathEngine( CreateCpuMathEngine( 1, 0 ) );
+	const size_t initialFreeMemory = mathEngine->GetFreeMemorySize();
+	for( int threadCount = 1; threadCount <= 8; threadCount *= 2 ) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for( int i = 0; i < threadCount; ++i ) {
+			threads.push_back( std::thread( allocFreeLoop, std::ref( *mathEngine ), iterationCount ) );
+		}
+		for( auto& thread : threads ) {
+			thread.join();
+		}
+		const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+		EXPECT_EQ( initialFreeMemory, mathEngine->GetFreeMemorySize() );
+		GTEST_LOG_( INFO ) << "Threads: " << threadCount << ", HeapAlloc/HeapFree: "
+			<< static_cast<long long>( threadCount * iterationCount * operationsPerIteration / seconds ) << " ops/sec";
+	}
+}
@@ -0,0 +1,113 @@
+/* Copyright © 2017-2020 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <TestFixture.h>
+#include <cmath>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static signed char quantizeNaive( float value, float scale )
+{
+	return static_cast<signed char>( std::max( -127.f, std::min( 127.f, roundf( value / scale ) ) ) );
+}
+
+static void multiplyMatrixByTransposedQuantizedMatrixTestImpl( const CTestParams& params, int seed )
+{
+	CRandom random( seed );
+
+	const CInterval heightInterval = params.GetInterval( "Height" );
+	const CInterval widthInterval = params.GetInterval( "Width" );
+	const CInterval valuesInterval = params.GetInterval( "Values" );
+
+	const int secondHeight = random.UniformInt( heightInterval.Begin, heightInterval.End );
+	const int firstHeight = random.UniformInt( heightInterval.Begin, heightInterval.End );
+	const int width = random.UniformInt( widthInterval.Begin, widthInterval.End );
+	const int rowSize = QuantizedMatrixRowSize( width );
+
+	CREATE_FILL_FLOAT_ARRAY( a, valuesInterval.Begin, valuesInterval.End, firstHeight * width, random )
+	CREATE_FILL_FLOAT_ARRAY( b, valuesInterval.Begin, valuesInterval.End, secondHeight * width, random )
+
+	// Some values of the first matrix are out of the quantization range and should be saturated
+	const float firstScale = static_cast<float>( valuesInterval.End ) / 100;
+
+	std::vector<int> quantizedB;
+	quantizedB.insert( quantizedB.begin(), secondHeight * rowSize, 0 );
+	std::vector<float> scales;
+	scales.resize( secondHeight );
+	for( int j = 0; j < secondHeight; ++j ) {
+		scales[j] = static_cast<float>( random.Uniform( 0.5, 1 ) * valuesInterval.End / 127 );
+		signed char* row = reinterpret_cast<signed char*>( quantizedB.data() + j * rowSize );
+		for( int k = 0; k < width; ++k ) {
+			row[k] = quantizeNaive( b[j * width + k], scales[j] );
+		}
+	}
+
+	std::vector<float> exp;
+	exp.resize( firstHeight * secondHeight );
+	for( int i = 0; i < firstHeight; ++i ) {
+		for( int j = 0; j < secondHeight; ++j ) {
+			const signed char* row = reinterpret_cast<const signed char*>( quantizedB.data() + j * rowSize );
+			int sum = 0;
+			for( int k = 0; k < width; ++k ) {
+				sum += quantizeNaive( a[i * width + k], firstScale ) * row[k];
+			}
+			exp[i * secondHeight + j] = sum * firstScale * scales[j];
+		}
+	}
+
+	std::vector<float> result;
+	result.resize( firstHeight * secondHeight );
+	MathEngine().MultiplyMatrixByTransposedQuantizedMatrix( CARRAY_FLOAT_WRAPPER( a ), firstHeight, width, firstScale,
+		CARRAY_INT_WRAPPER( quantizedB ), CARRAY_FLOAT_WRAPPER( scales ), secondHeight, CARRAY_FLOAT_WRAPPER( result ) );
+
+	for( int i = 0; i < firstHeight * secondHeight; ++i ) {
+		ASSERT_NEAR( exp[i], result[i], 1e-3 * std::max( 1.f, fabsf( exp[i] ) ) );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+class CMultiplyMatrixByTransposedQuantizedMatrixTest : public CTestFixtureWithParams {
+};
+
+INSTANTIATE_TEST_CASE_P( CMultiplyMatrixByTransposedQuantizedMatrixTestInstantiation, CMultiplyMatrixByTransposedQuantizedMatrixTest,
+	::testing::Values(
+		CTestParams(
+			"Height = (1..50);"
+			"Width = (1..50);"
+			"Values = (-1..1);"
+			"TestCount = 100;"
+		),
+		CTestParams(
+			"Height = (100..300);"
+			"Width = (100..500);"
+			"Values = (-10..10);"
+			"TestCount = 5;"
+		)
+	)
+);
+
+TEST_P( CMultiplyMatrixByTransposedQuantizedMatrixTest, Random )
+{
+	CMathEngineInfo meInfo;
+	MathEngine().GetMathEngineInfo( meInfo );
+	if( meInfo.Type != MET_Cpu ) {
+		// The quantized operations are supported only on CPU
+		return;
+	}
+
+	RUN_TEST_IMPL( multiplyMatrixByTransposedQuantizedMatrixTestImpl )
+}
@@ -0,0 +1,151 @@
+/* Copyright © 2017-2021 ABBYY Production LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+--------------------------------------------------------------------------------------------------------------*/
+
+#include <TestFixture.h>
+#include <cmath>
+
+using namespace NeoML;
+using namespace NeoMLTest;
+
+static void scaledDotProductAttentionNaive( int batchSize, int headCount, int querySize, int keySize, int headSize,
+	float multiplier, const float* query, const float* key, const float* value, const float* mask, float* result )
+{
+	const int rowSize = headCount * headSize;
+	std::vector<double> weights( keySize );
+	for( int b = 0; b < batchSize; ++b ) {
+		for( int h = 0; h < headCount; ++h ) {
+			for( int q = 0; q < querySize; ++q ) {
+				const float* queryRow = query + ( b * querySize + q ) * rowSize + h * headSize;
+				double maxWeight = -FLT_MAX;
+				for( int k = 0; k < keySize; ++k ) {
+					const float* keyRow = key + ( b * keySize + k ) * rowSize + h * headSize;
+					double dot = 0;
+					for( int i = 0; i < headSize; ++i ) {
+						dot += queryRow[i] * keyRow[i];
+					}
+					weights[k] = multiplier * dot - ( mask == nullptr ? 0. : 1e9 * mask[q * keySize + k] );
+					maxWeight = std::max( maxWeight, weights[k] );
+				}
+				double sum = 0;
+				for( int k = 0; k < keySize; ++k ) {
+					weights[k] = exp( weights[k] - maxWeight );
+					sum += weights[k];
+				}
+				float* resultRow = result + ( b * querySize + q ) * rowSize + h * headSize;
+				for( int i = 0; i < headSize; ++i ) {
+					double res = 0;
+					for( int k = 0; k < keySize; ++k ) {
+						res += weights[k] * value[( b * keySize + k ) * rowSize + h * headSize + i];
+					}
+					resultRow[i] = static_cast<float>( res / sum );
+				}
+			}
+		}
+	}
+}
+
+static void scaledDotProductAttentionTestImpl( const CTestParams& params, int seed )
+{
+	CRandom random( seed );
+	const CInterval batchSizeInterval = params.GetInterval( "BatchSize" );
+	const CInterval headCountInterval = params.GetInterval( "HeadCount" );
+	const CInterval querySizeInterval = params.GetInterval( "QuerySize" );
+	const CInterval keySizeInterval = params.GetInterval( "KeySize" );
+	const CInterval headSizeInterval = params.GetInterval( "HeadSize" );
+
+	const int batchSize = random.UniformInt( batchSizeInterval.Begin, batchSizeInterval.End );
+	const int headCount = random.UniformInt( headCountInterval.Begin, headCountInterval.End );
+	const int querySize = random.UniformInt( querySizeInterval.Begin, querySizeInterval.End );
+	const int keySize = random.UniformInt( keySizeInterval.Begin, keySizeInterval.End );
+	const int headSize = random.UniformInt( headSizeInterval.Begin, headSizeInterval.End );
+	const bool useMask = random.Next() % 2 == 1;
+	const float multiplier = static_cast<float>( 1. / sqrt( 1. * headCount * headSize ) );
+	const int rowSize = headCount * headSize;
+
+	CREATE_FILL_FLOAT_ARRAY( queryData, -2.f, 2.f, batchSize * querySize * rowSize, random );
+	CFloatBlob queryBlob( MathEngine(), 1, batchSize, querySize, 1, 1, 1, rowSize );
+	queryBlob.CopyFrom( queryData.data() );
+	CREATE_FILL_FLOAT_ARRAY( keyData, -2.f, 2.f, batchSize * keySize * rowSize, random );
+	CFloatBlob keyBlob( MathEngine(), 1, batchSize, keySize, 1, 1, 1, rowSize );
+	keyBlob.CopyFrom( keyData.data() );
+	CREATE_FILL_FLOAT_ARRAY( valueData, -2.f, 2.f, batchSize * keySize * rowSize, random );
+	CFloatBlob valueBlob( MathEngine(), 1, batchSize, keySize, 1, 1, 1, rowSize );
+	valueBlob.CopyFrom( valueData.data() );
+
+	std::vector<float> maskData( querySize * keySize );
+	for( size_t i = 0; i < maskData.size(); ++i ) {
+		maskData[i] = random.Next() % 4 == 0 ? 1.f : 0.f;
+	}
+	// The result for the query with all the keys masked depends on the rounding of the huge values
+	for( int q = 0; q < querySize; ++q ) {
+		maskData[q * keySize + q % keySize] = 0.f;
+	}
+	CFloatBlob maskBlob( MathEngine(), 1, 1, 1, 1, querySize, 1, keySize );
+	maskBlob.CopyFrom( maskData.data() );
+
+	std::vector<float> expected( batchSize * querySize * rowSize );
+	scaledDotProductAttentionNaive( batchSize, headCount, querySize, keySize, headSize, multiplier, queryData.data(),
+		keyData.data(), valueData.data(), useMask ? maskData.data() : nullptr, expected.data() );
+
+	CFloatBlob resultBlob( MathEngine(), 1, batchSize, querySize, 1, 1, 1, rowSize );
+	MathEngine().ScaledDotProductAttention( batchSize, headCount, querySize, keySize, headSize, multiplier,
+		queryBlob.GetData(), keyBlob.GetData(), valueBlob.GetData(),
+		useMask ? maskBlob.GetData() : CFloatHandle(), resultBlob.GetData() );
+	std::vector<float> actual( expected.size() );
+	resultBlob.CopyTo( actual.data() );
+
+	for( size_t i = 0; i < expected.size(); ++i ) {
+		ASSERT_TRUE( FloatEq( expected[i], actual[i], 1e-4f ) ) << i;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+class CScaledDotProductAttentionTest : public CTestFixtureWithParams {
+};
+
+INSTANTIATE_TEST_CASE_P( CScaledDotProductAttentionTestInstantiation, CScaledDotProductAttentionTest,
+	::testing::Values(
+		CTestParams(
+			"BatchSize = (1..3);"
+			"HeadCount = (1..4);"
+			"QuerySize = (1..20);"
+			"KeySize = (1..20);"
+			"HeadSize = (1..10);"
+			"TestCount = 200;"
+		),
+		// Several query tiles and key blocks
+		CTestParams(
+			"BatchSize = (1..2);"
+			"HeadCount = (1..3);"
+			"QuerySize = (30..100);"
+			"KeySize = (250..600);"
+			"HeadSize = (8..40);"
+			"TestCount = 5;"
+		)
+	)
+);
+
+TEST_P( CScaledDotProductAttentionTest, Random )
+{
+	CMathEngineInfo meInfo;
+	MathEngine().GetMathEngineInfo( meInfo );
+	if( meInfo.Type != MET_Cpu ) {
+		// The fused attention is supported only on CPU
+		return;
+	}
+
+	RUN_TEST_IMPL( scaledDotProductAttentionTestImpl )
+}